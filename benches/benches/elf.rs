@@ -0,0 +1,49 @@
+//! Cost of loading programs from ELF.
+
+use std::hint::black_box;
+
+use athena_benches::{FIBONACCI_ELF, HINT_IO_ELF, HOST_ELF};
+use athena_core::disassembler::{transpile, transpile_rrs, Elf};
+use athena_core::runtime::Program;
+use criterion::{criterion_group, criterion_main, Criterion, Throughput};
+
+fn load(c: &mut Criterion) {
+  for (name, elf) in [
+    ("fibonacci", FIBONACCI_ELF),
+    ("hint-io", HINT_IO_ELF),
+    ("host", HOST_ELF),
+  ] {
+    let mut group = c.benchmark_group(format!("load/{name}"));
+    group.throughput(Throughput::Bytes(elf.len() as u64));
+    group.bench_function("decode", |b| b.iter(|| Elf::decode(black_box(elf))));
+    group.bench_function("program", |b| b.iter(|| Program::from(black_box(elf))));
+    group.finish();
+  }
+}
+
+/// Decoding the instructions alone, in instructions per second: with the table, and with rrs-lib
+/// for comparison.
+fn transpile_instructions(c: &mut Criterion) {
+  for (name, elf) in [
+    ("fibonacci", FIBONACCI_ELF),
+    ("hint-io", HINT_IO_ELF),
+    ("host", HOST_ELF),
+  ] {
+    let words = Elf::decode(elf).instructions;
+    let mut group = c.benchmark_group(format!("transpile/{name}"));
+    group.throughput(Throughput::Elements(words.len() as u64));
+    group.bench_function("table", |b| b.iter(|| transpile(black_box(&words))));
+    group.bench_function("rrs", |b| {
+      b.iter(|| {
+        black_box(&words)
+          .iter()
+          .map(|&word| transpile_rrs(word).unwrap())
+          .collect::<Vec<_>>()
+      })
+    });
+    group.finish();
+  }
+}
+
+criterion_group!(benches, load, transpile_instructions);
+criterion_main!(benches);
@@ -0,0 +1,94 @@
+//! A full execution through the C API, as done by a host embedding the VM.
+
+use athcon_client::host::HostContext;
+use athcon_client::types::{
+  Address, Bytes, Bytes32, MessageKind, Revision, StatusCode, StorageStatus, ADDRESS_LENGTH,
+  BYTES32_LENGTH,
+};
+use athena_benches::FIBONACCI_ELF;
+use criterion::{criterion_group, criterion_main, Criterion};
+// Link the VM providing `athcon_create_athenavmwrapper`.
+use athena_vmlib as _;
+
+/// A host without state: the program doesn't use storage.
+struct NullHost;
+
+impl HostContext for NullHost {
+  fn account_exists(&self, _addr: &Address) -> bool {
+    true
+  }
+
+  fn get_storage(&self, _addr: &Address, _key: &Bytes32) -> Bytes32 {
+    [0; BYTES32_LENGTH]
+  }
+
+  fn set_storage(&mut self, _addr: &Address, _key: &Bytes32, _value: &Bytes32) -> StorageStatus {
+    StorageStatus::ATHCON_STORAGE_ASSIGNED
+  }
+
+  fn get_balance(&self, _addr: &Address) -> Bytes32 {
+    [0; BYTES32_LENGTH]
+  }
+
+  fn get_tx_context(&self) -> (Bytes32, Address, i64, i64, i64, Bytes32) {
+    (
+      [0; BYTES32_LENGTH],
+      [0; ADDRESS_LENGTH],
+      0,
+      0,
+      0,
+      [0; BYTES32_LENGTH],
+    )
+  }
+
+  fn get_block_hash(&self, _number: i64) -> Bytes32 {
+    [0; BYTES32_LENGTH]
+  }
+
+  fn call(
+    &mut self,
+    _kind: MessageKind,
+    _destination: &Address,
+    _sender: &Address,
+    _value: &Bytes32,
+    _input: &Bytes,
+    gas: i64,
+    _depth: i32,
+  ) -> (Vec<u8>, i64, Address, StatusCode) {
+    (vec![], gas, [0; ADDRESS_LENGTH], StatusCode::ATHCON_FAILURE)
+  }
+}
+
+fn execute(vm: &athcon_client::AthconVm, host: &mut NullHost) {
+  let (_, _, status_code) = vm.execute(
+    host,
+    Revision::ATHCON_FRONTIER,
+    MessageKind::ATHCON_CALL,
+    0,
+    50_000_000,
+    &[32; ADDRESS_LENGTH],
+    &[128; ADDRESS_LENGTH],
+    &[],
+    &[0; BYTES32_LENGTH],
+    FIBONACCI_ELF,
+  );
+  assert_eq!(status_code, StatusCode::ATHCON_SUCCESS);
+}
+
+fn round_trip(c: &mut Criterion) {
+  let mut group = c.benchmark_group("ffi");
+  group.bench_function("create_execute_destroy", |b| {
+    b.iter(|| {
+      let vm = athcon_client::create();
+      execute(&vm, &mut NullHost);
+      vm.destroy();
+    })
+  });
+  let vm = athcon_client::create();
+  group.bench_function("execute", |b| b.iter(|| execute(&vm, &mut NullHost)));
+  vm.destroy();
+  group.finish();
+}
+
+criterion_group!(benches, round_trip);
+criterion_main!(benches);
@@ -0,0 +1,32 @@
+//! Instruction throughput of the interpreter on the test programs.
+
+use std::sync::Arc;
+
+use athena_benches::{hint_io_stdin, run_untraced, runtime, FIBONACCI_ELF, HINT_IO_ELF, HOST_ELF};
+use athena_core::runtime::Program;
+use criterion::{criterion_group, criterion_main, BatchSize, Criterion, Throughput};
+
+fn interpreter(c: &mut Criterion) {
+  let mut group = c.benchmark_group("interpreter");
+  for (name, elf, stdin) in [
+    ("fibonacci", FIBONACCI_ELF, vec![]),
+    ("hint-io", HINT_IO_ELF, hint_io_stdin()),
+    ("host", HOST_ELF, vec![]),
+  ] {
+    let program = Arc::new(Program::from(elf));
+    // Report instructions per second.
+    let instructions = run_untraced(&program, &stdin);
+    group.throughput(Throughput::Elements(instructions));
+    group.bench_function(name, |b| {
+      b.iter_batched(
+        || runtime(&program, &stdin),
+        |mut runtime| runtime.run_untraced().unwrap(),
+        BatchSize::SmallInput,
+      )
+    });
+  }
+  group.finish();
+}
+
+criterion_group!(benches, interpreter);
+criterion_main!(benches);
@@ -0,0 +1,74 @@
+//! Cost of the crypto precompiles, and of SHA-256 interpreted instruction by instruction.
+
+use std::sync::Arc;
+
+use athena_benches::{runtime, sha256_interpreted, syscall};
+use athena_core::runtime::{Program, SyscallCode};
+use criterion::measurement::WallTime;
+use criterion::{
+  criterion_group, criterion_main, BatchSize, BenchmarkGroup, BenchmarkId, Criterion, Throughput,
+};
+use ed25519_dalek::{Signer, SigningKey};
+
+const INPUT: u32 = 0x1000;
+const OUTPUT: u32 = 0x8000;
+
+fn run(group: &mut BenchmarkGroup<WallTime>, id: BenchmarkId, program: Program) {
+  let program = Arc::new(program);
+  group.bench_with_input(id, &program, |b, program| {
+    b.iter_batched(
+      || runtime(program, &[]),
+      |mut runtime| runtime.run_untraced().unwrap(),
+      BatchSize::SmallInput,
+    )
+  });
+}
+
+fn hashes(c: &mut Criterion) {
+  let mut group = c.benchmark_group("hash");
+  for blocks in [1, 16] {
+    let len = 64 * blocks;
+    group.throughput(Throughput::Bytes(len as u64));
+    run(
+      &mut group,
+      BenchmarkId::new("sha256_interpreted", len),
+      sha256_interpreted(blocks, &[7; 64]),
+    );
+    for (name, code) in [
+      ("sha256", SyscallCode::SHA256),
+      ("keccak256", SyscallCode::KECCAK256),
+    ] {
+      run(
+        &mut group,
+        BenchmarkId::new(name, len),
+        syscall(code, [INPUT, len, OUTPUT, 0]),
+      );
+    }
+  }
+  group.finish();
+}
+
+fn ed25519_verify(c: &mut Criterion) {
+  const PUBLIC_KEY: u32 = 0x2000;
+  const SIGNATURE: u32 = 0x3000;
+  let key = SigningKey::from_bytes(&[1; 32]);
+  let msg = [7; 64];
+  let mut program = syscall(
+    SyscallCode::ED25519_VERIFY,
+    [INPUT, msg.len() as u32, PUBLIC_KEY, SIGNATURE],
+  );
+  for (addr, bytes) in [
+    (INPUT, &msg[..]),
+    (PUBLIC_KEY, &key.verifying_key().to_bytes()),
+    (SIGNATURE, &key.sign(&msg).to_bytes()),
+  ] {
+    program.memory_image.insert_bytes(addr, bytes);
+  }
+
+  let mut group = c.benchmark_group("ed25519");
+  run(&mut group, BenchmarkId::from_parameter("verify"), program);
+  group.finish();
+}
+
+criterion_group!(benches, hashes, ed25519_verify);
+criterion_main!(benches);
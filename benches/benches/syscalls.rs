@@ -0,0 +1,30 @@
+//! Cost of the host storage syscalls against [MockHost](athena_interface::MockHost).
+
+use std::sync::Arc;
+
+use athena_benches::{runtime, storage_storm};
+use criterion::{criterion_group, criterion_main, BatchSize, BenchmarkId, Criterion, Throughput};
+
+fn host_storage(c: &mut Criterion) {
+  let mut group = c.benchmark_group("host_storage");
+  for iterations in [100, 10_000] {
+    let program = Arc::new(storage_storm(iterations));
+    // Each iteration makes a HOST_WRITE and a HOST_READ.
+    group.throughput(Throughput::Elements(2 * iterations as u64));
+    group.bench_with_input(
+      BenchmarkId::from_parameter(iterations),
+      &program,
+      |b, program| {
+        b.iter_batched(
+          || runtime(program, &[]),
+          |mut runtime| runtime.run_untraced().unwrap(),
+          BatchSize::SmallInput,
+        )
+      },
+    );
+  }
+  group.finish();
+}
+
+criterion_group!(benches, host_storage);
+criterion_main!(benches);
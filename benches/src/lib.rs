@@ -0,0 +1,262 @@
+//! Benchmarks of the hot paths of the VM: the interpreter, the host syscalls, the precompiles,
+//! loading programs and executing through the FFI.
+//!
+//! Run with `cargo bench -p athena-benches`. Besides its report, criterion saves the estimates of
+//! each benchmark as JSON in `target/criterion/<group>/<benchmark>/new/estimates.json`. Use
+//! `-- --save-baseline <name>` to keep the results of a release and `-- --baseline <name>` to
+//! compare against them.
+
+use std::cell::RefCell;
+use std::sync::Arc;
+
+use athena_core::runtime::{Instruction, Opcode, Program, Runtime, SyscallCode};
+use athena_core::utils::AthenaCoreOpts;
+use athena_interface::{HostProvider, MockHost};
+
+pub const FIBONACCI_ELF: &[u8] = include_bytes!("../../tests/fibonacci/elf/fibonacci-test");
+pub const HINT_IO_ELF: &[u8] = include_bytes!("../../tests/hint-io/elf/hint-io-test");
+pub const HOST_ELF: &[u8] = include_bytes!("../../tests/host/elf/host-test");
+
+/// The input expected by [HINT_IO_ELF]: the same bytes, serialized and raw.
+pub fn hint_io_stdin() -> Vec<Vec<u8>> {
+  let hint = vec![7u8; 1024];
+  vec![bincode::serialize(&hint).unwrap(), hint]
+}
+
+/// Creates a runtime for `program` with a fresh [MockHost], ready to run with `stdin`.
+pub fn runtime(program: &Arc<Program>, stdin: &[Vec<u8>]) -> Runtime<MockHost> {
+  let host = Arc::new(RefCell::new(HostProvider::new(MockHost::new())));
+  let mut runtime = Runtime::new(program.clone(), Some(host), AthenaCoreOpts::default());
+  for input in stdin {
+    runtime.write_stdin_slice(input);
+  }
+  runtime
+}
+
+/// Runs `program` with [Runtime::run_untraced], returning the number of instructions executed.
+pub fn run_untraced(program: &Arc<Program>, stdin: &[Vec<u8>]) -> u64 {
+  let mut runtime = runtime(program, stdin);
+  runtime.run_untraced().unwrap();
+  runtime.state.global_clk
+}
+
+/// A program which writes a storage slot and reads it back `iterations` times.
+pub fn storage_storm(iterations: u32) -> Program {
+  const KEY: u32 = 0x1000;
+  const ADDRESS: u32 = 0x2000;
+  const VALUE: u32 = 0x3000;
+  let addi = |rd, imm| Instruction::new(Opcode::ADD, rd, 0, imm, false, true);
+  let ecall = Instruction::new(Opcode::ECALL, 5, 10, 11, false, false);
+  Program::new(
+    vec![
+      addi(6, iterations),
+      addi(10, KEY),
+      addi(11, ADDRESS),
+      addi(12, VALUE),
+      // loop:
+      addi(5, SyscallCode::HOST_WRITE as u32),
+      ecall,
+      addi(5, SyscallCode::HOST_READ as u32),
+      ecall,
+      Instruction::new(Opcode::SUB, 6, 6, 1, false, true),
+      // Back 5 instructions to the loop.
+      Instruction::new(Opcode::BNE, 6, 0, -20i32 as u32, false, true),
+    ],
+    0,
+    0,
+  )
+}
+
+/// A program making a single syscall `code` with a0..a3 set to `args`.
+pub fn syscall(code: SyscallCode, args: [u32; 4]) -> Program {
+  let addi = |rd, imm| Instruction::new(Opcode::ADD, rd, 0, imm, false, true);
+  let mut instructions = vec![addi(5, code as u32)];
+  instructions.extend((10..).zip(args).map(|(rd, arg)| addi(rd, arg)));
+  instructions.push(Instruction::new(Opcode::ECALL, 5, 10, 11, false, false));
+  Program::new(instructions, 0, 0)
+}
+
+/// The address of the block compressed by [sha256_interpreted], as 16 big-endian words.
+pub const SHA256_BLOCK: u32 = 0x1000;
+/// The address of the state of [sha256_interpreted], 8 words.
+pub const SHA256_STATE: u32 = 0x2000;
+/// The address of the message schedule of [sha256_interpreted], 64 words.
+const SHA256_SCHEDULE: u32 = 0x3000;
+
+pub const SHA256_INITIAL_STATE: [u32; 8] = [
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+];
+
+const SHA256_ROUND_CONSTANTS: [u32; 64] = [
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+];
+
+/// Emits RV32IM instructions.
+struct Assembler(Vec<Instruction>);
+
+impl Assembler {
+  fn op(&mut self, opcode: Opcode, rd: u32, rs1: u32, rs2: u32) {
+    self
+      .0
+      .push(Instruction::new(opcode, rd, rs1, rs2, false, false));
+  }
+
+  fn opi(&mut self, opcode: Opcode, rd: u32, rs1: u32, imm: u32) {
+    self
+      .0
+      .push(Instruction::new(opcode, rd, rs1, imm, false, true));
+  }
+
+  fn lw(&mut self, rd: u32, addr: u32) {
+    self.opi(Opcode::LW, rd, 0, addr);
+  }
+
+  fn sw(&mut self, rs: u32, addr: u32) {
+    self.opi(Opcode::SW, rs, 0, addr);
+  }
+
+  /// rd = rs rotated right by n, clobbering tmp.
+  fn rotr(&mut self, rd: u32, rs: u32, n: u32, tmp: u32) {
+    self.opi(Opcode::SRL, tmp, rs, n);
+    self.opi(Opcode::SLL, rd, rs, 32 - n);
+    self.op(Opcode::OR, rd, rd, tmp);
+  }
+
+  /// rd = rotr(rs, r0) ^ rotr(rs, r1) ^ (rotr or shr)(rs, r2), clobbering t1 and t2.
+  fn sigma(&mut self, rd: u32, rs: u32, [r0, r1, r2]: [u32; 3], shift: bool, [t1, t2]: [u32; 2]) {
+    self.rotr(rd, rs, r0, t1);
+    self.rotr(t2, rs, r1, t1);
+    self.op(Opcode::XOR, rd, rd, t2);
+    if shift {
+      self.opi(Opcode::SRL, t2, rs, r2);
+    } else {
+      self.rotr(t2, rs, r2, t1);
+    }
+    self.op(Opcode::XOR, rd, rd, t2);
+  }
+}
+
+/// A program compressing the block at [SHA256_BLOCK] into the state at [SHA256_STATE] `blocks`
+/// times, like hashing `blocks` copies of the block without padding, in interpreted RV32IM.
+///
+/// This is the baseline of the SHA256 precompile: a fully unrolled compression function, as a
+/// compiler would emit for a guest hashing without the precompile.
+pub fn sha256_interpreted(blocks: u32, block: &[u8; 64]) -> Program {
+  // The working variables, then scratch registers.
+  let mut v = [16, 17, 18, 19, 20, 21, 22, 23];
+  let (acc, t1, t2, temp1, x, counter) = (24, 25, 26, 27, 28, 29);
+  let w = |i: usize| SHA256_SCHEDULE + 4 * i as u32;
+
+  let mut asm = Assembler(Vec::new());
+  asm.opi(Opcode::ADD, counter, 0, blocks);
+  let start = asm.0.len();
+  // Message schedule
+  for i in 0..16 {
+    asm.lw(x, SHA256_BLOCK + 4 * i as u32);
+    asm.sw(x, w(i));
+  }
+  for i in 16..64 {
+    asm.lw(x, w(i - 15));
+    asm.sigma(acc, x, [7, 18, 3], true, [t1, t2]);
+    asm.lw(x, w(i - 2));
+    asm.sigma(temp1, x, [17, 19, 10], true, [t1, t2]);
+    asm.op(Opcode::ADD, acc, acc, temp1);
+    asm.lw(x, w(i - 16));
+    asm.op(Opcode::ADD, acc, acc, x);
+    asm.lw(x, w(i - 7));
+    asm.op(Opcode::ADD, acc, acc, x);
+    asm.sw(acc, w(i));
+  }
+  // Rounds
+  for (j, reg) in v.iter().enumerate() {
+    asm.lw(*reg, SHA256_STATE + 4 * j as u32);
+  }
+  for (i, k) in SHA256_ROUND_CONSTANTS.into_iter().enumerate() {
+    let [a, b, c, d, e, f, g, h] = v;
+    asm.sigma(acc, e, [6, 11, 25], false, [t1, t2]);
+    // ch = (e & f) ^ (!e & g)
+    asm.op(Opcode::AND, t1, e, f);
+    asm.opi(Opcode::XOR, t2, e, u32::MAX);
+    asm.op(Opcode::AND, t2, t2, g);
+    asm.op(Opcode::XOR, t1, t1, t2);
+    // temp1 = h + S1 + ch + k + w
+    asm.op(Opcode::ADD, temp1, h, acc);
+    asm.op(Opcode::ADD, temp1, temp1, t1);
+    asm.opi(Opcode::ADD, temp1, temp1, k);
+    asm.lw(x, w(i));
+    asm.op(Opcode::ADD, temp1, temp1, x);
+    asm.sigma(acc, a, [2, 13, 22], false, [t1, t2]);
+    // maj = (a & b) ^ (a & c) ^ (b & c)
+    asm.op(Opcode::AND, t1, a, b);
+    asm.op(Opcode::AND, t2, a, c);
+    asm.op(Opcode::XOR, t1, t1, t2);
+    asm.op(Opcode::AND, t2, b, c);
+    asm.op(Opcode::XOR, t1, t1, t2);
+    // temp2 = S0 + maj
+    asm.op(Opcode::ADD, acc, acc, t1);
+    // The new e replaces d and the new a replaces h, then the variables shift.
+    asm.op(Opcode::ADD, d, d, temp1);
+    asm.op(Opcode::ADD, h, temp1, acc);
+    v.rotate_right(1);
+  }
+  for (j, reg) in v.iter().enumerate() {
+    asm.lw(x, SHA256_STATE + 4 * j as u32);
+    asm.op(Opcode::ADD, x, x, *reg);
+    asm.sw(x, SHA256_STATE + 4 * j as u32);
+  }
+  asm.opi(Opcode::SUB, counter, counter, 1);
+  let offset = (start as i32 - asm.0.len() as i32) * 4;
+  asm.opi(Opcode::BNE, counter, 0, offset as u32);
+
+  let mut program = Program::new(asm.0, 0, 0);
+  for (i, word) in block.chunks_exact(4).enumerate() {
+    program.memory_image.insert(
+      SHA256_BLOCK + 4 * i as u32,
+      u32::from_be_bytes(word.try_into().unwrap()),
+    );
+  }
+  for (j, word) in SHA256_INITIAL_STATE.into_iter().enumerate() {
+    program
+      .memory_image
+      .insert(SHA256_STATE + 4 * j as u32, word);
+  }
+  program
+}
+
+#[cfg(test)]
+mod tests {
+  use super::*;
+
+  #[test]
+  fn test_workloads_run() {
+    for (elf, stdin) in [
+      (FIBONACCI_ELF, vec![]),
+      (HINT_IO_ELF, hint_io_stdin()),
+      (HOST_ELF, vec![]),
+    ] {
+      assert!(run_untraced(&Arc::new(Program::from(elf)), &stdin) > 0);
+    }
+    // The loop runs 6 instructions per iteration, after 4 of setup.
+    assert_eq!(run_untraced(&Arc::new(storage_storm(10)), &[]), 4 + 6 * 10);
+  }
+
+  #[test]
+  fn test_sha256_interpreted() {
+    let block = std::array::from_fn(|i| i as u8);
+    let mut runtime = runtime(&Arc::new(sha256_interpreted(3, &block)), &[]);
+    runtime.run_untraced().unwrap();
+    let state: Vec<_> = (0..8).map(|j| runtime.word(SHA256_STATE + 4 * j)).collect();
+
+    let mut expected = SHA256_INITIAL_STATE;
+    let block = sha2::digest::generic_array::GenericArray::clone_from_slice(&block);
+    sha2::compress256(&mut expected, &[block; 3]);
+    assert_eq!(state, expected);
+  }
+}
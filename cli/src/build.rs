@@ -1,4 +1,5 @@
 use anyhow::{Context, Result};
+use athena_core::runtime::Program;
 use cargo_metadata::camino::Utf8PathBuf;
 use clap::Parser;
 use std::{
@@ -123,5 +124,11 @@ pub fn build_program(args: &BuildArgs) -> Result<Utf8PathBuf> {
     let result_elf_path = elf_dir.join(root_package_name.unwrap());
     fs::copy(elf_path, &result_elf_path)?;
 
+    // Also emit the program decoded ahead of time, which nodes load without parsing the ELF.
+    let elf = fs::read(&result_elf_path)?;
+    let artifact_path = result_elf_path.with_extension("athp");
+    fs::write(&artifact_path, Program::from(&elf).to_artifact())
+        .with_context(|| format!("failed to write {}", artifact_path))?;
+
     Ok(result_elf_path)
 }
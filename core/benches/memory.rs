@@ -0,0 +1,97 @@
+//! Compares the guest memory backends on the example programs.
+//!
+//! Run with `cargo bench -p athena-core --bench memory`.
+
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+
+use athena_core::runtime::{MemoryBackend, Program, Runtime};
+use athena_core::utils::AthenaCoreOpts;
+use athena_interface::MockHost;
+use serde::Serialize;
+
+const FIBONACCI_ELF: &[u8] =
+  include_bytes!("../../examples/fibonacci/program/elf/fibonacci-program");
+const IO_ELF: &[u8] = include_bytes!("../../examples/io/program/elf/io-program");
+
+const ITERATIONS: u32 = 20;
+
+#[derive(Serialize)]
+struct MyPointUnaligned {
+  pub x: usize,
+  pub y: usize,
+  pub b: bool,
+}
+
+/// Runs the program, returning the number of instructions executed.
+fn run(program: &Arc<Program>, memory_backend: MemoryBackend, stdin: &[Vec<u8>]) -> u64 {
+  let mut runtime = Runtime::<MockHost>::new(
+    program.clone(),
+    None,
+    AthenaCoreOpts {
+      memory_backend,
+      ..Default::default()
+    },
+  );
+  for input in stdin {
+    runtime.write_stdin_slice(input);
+  }
+  // Compact memory doesn't record accesses, so it only runs in fast mode.
+  match memory_backend {
+    MemoryBackend::Compact => runtime.run_fast(),
+    _ => runtime.run_untraced(),
+  }
+  .unwrap();
+  runtime.state.global_clk
+}
+
+fn bench(name: &str, elf: &[u8], stdin: &[Vec<u8>]) {
+  let program = Arc::new(Program::from(elf));
+  for backend in [
+    MemoryBackend::Map,
+    MemoryBackend::Paged,
+    MemoryBackend::Compact,
+  ] {
+    // Warm up.
+    let cycles = run(&program, backend, stdin);
+    let mut total = Duration::ZERO;
+    for _ in 0..ITERATIONS {
+      let start = Instant::now();
+      run(&program, backend, stdin);
+      total += start.elapsed();
+    }
+    let per_iter = total / ITERATIONS;
+    println!(
+      "{name:<12} {:<8} {:>12?}/iter {:>8.2} MIPS",
+      format!("{backend:?}"),
+      per_iter,
+      cycles as f64 / per_iter.as_secs_f64() / 1e6
+    );
+  }
+}
+
+fn main() {
+  bench(
+    "fibonacci",
+    FIBONACCI_ELF,
+    &[bincode::serialize(&500u32).unwrap()],
+  );
+  bench(
+    "io",
+    IO_ELF,
+    &[
+      bincode::serialize(&MyPointUnaligned {
+        x: 3,
+        y: 5,
+        b: true,
+      })
+      .unwrap(),
+      bincode::serialize(&MyPointUnaligned {
+        x: 8,
+        y: 19,
+        b: true,
+      })
+      .unwrap(),
+    ],
+  );
+}
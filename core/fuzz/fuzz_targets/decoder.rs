@@ -0,0 +1,20 @@
+//! Checks the table-driven decoder against rrs-lib.
+//!
+//! Run with `cargo fuzz run decoder` from `core`.
+
+#![no_main]
+
+use athena_core::disassembler::{decode, transpile_rrs};
+use libfuzzer_sys::fuzz_target;
+
+fuzz_target!(|words: Vec<u32>| {
+  for word in words {
+    if let Some(instruction) = decode(word) {
+      assert_eq!(
+        Some(instruction),
+        transpile_rrs(word),
+        "word {word:#010x} decoded differently"
+      );
+    }
+  }
+});
@@ -0,0 +1,362 @@
+//! A table-driven decoder for the common RV32IM encodings.
+//!
+//! The major opcode, funct3 and the two funct7 bits distinguishing the base, alternate
+//! (`sub`/`sra`) and M-extension operations index a table of 1024 3-byte entries, which fits in
+//! the L1 cache. Every operand is extracted up front with a few shifts and masks, regardless of the
+//! format, so decoding a word is branch-light and whole arrays are decoded in a single pass.
+//!
+//! Encodings not in the table (fences, `mret`, `wfi` and invalid words) are left to rrs-lib, see
+//! [super::transpile].
+
+use super::transpile_rrs;
+use crate::runtime::{Instruction, Opcode, Register};
+
+/// The operand layout of an instruction, which selects how [decode] assembles its operands.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum Format {
+    /// Not decoded by the table.
+    Fallback,
+    R,
+    I,
+    IShamt,
+    S,
+    B,
+    Jal,
+    Lui,
+    Auipc,
+    /// `ecall` and `ebreak`, which are told apart by the whole word.
+    System,
+    /// CSR instructions, which aren't supported. `unimp` is encoded as one.
+    Unimp,
+}
+
+/// The value of [Entry::funct7] accepting any funct7, which then holds an immediate.
+const ANY_FUNCT7: u8 = 0x80;
+
+#[derive(Debug, Clone, Copy)]
+struct Entry {
+    format: Format,
+    opcode: Opcode,
+    /// The funct7 the word must have to be decoded by the entry, or [ANY_FUNCT7].
+    funct7: u8,
+}
+
+impl Entry {
+    const FALLBACK: Entry = Entry::new(Format::Fallback, Opcode::UNIMP, ANY_FUNCT7);
+
+    const fn new(format: Format, opcode: Opcode, funct7: u8) -> Self {
+        Self {
+            format,
+            opcode,
+            funct7,
+        }
+    }
+}
+
+/// The major opcodes, shifted right by 2 as their two lowest bits are always set.
+const LOAD: usize = 0x03 >> 2;
+const OP_IMM: usize = 0x13 >> 2;
+const AUIPC: usize = 0x17 >> 2;
+const STORE: usize = 0x23 >> 2;
+const OP: usize = 0x33 >> 2;
+const LUI: usize = 0x37 >> 2;
+const BRANCH: usize = 0x63 >> 2;
+const JALR: usize = 0x67 >> 2;
+const JAL: usize = 0x6f >> 2;
+const SYSTEM: usize = 0x73 >> 2;
+
+/// The index in [TABLE] of the entry decoding `word`.
+#[inline(always)]
+const fn index(word: u32) -> usize {
+    let opcode = (word >> 2) & 0x1f;
+    let funct3 = (word >> 12) & 0x7;
+    let alternate = (word >> 30) & 1;
+    let muldiv = (word >> 25) & 1;
+    entry_index(
+        opcode as usize,
+        funct3 as usize,
+        alternate as usize,
+        muldiv as usize,
+    )
+}
+
+/// The index in [TABLE] of the entry for `opcode`, `funct3` and the funct7 class: `alternate`
+/// is bit 5 of funct7, set by `sub` and `sra`, and `muldiv` its bit 0, set by the M extension.
+const fn entry_index(opcode: usize, funct3: usize, alternate: usize, muldiv: usize) -> usize {
+    opcode | funct3 << 5 | alternate << 8 | muldiv << 9
+}
+
+static TABLE: [Entry; 1024] = build_table();
+
+const fn build_table() -> [Entry; 1024] {
+    const ALU: [Opcode; 8] = [
+        Opcode::ADD,
+        Opcode::SLL,
+        Opcode::SLT,
+        Opcode::SLTU,
+        Opcode::XOR,
+        Opcode::SRL,
+        Opcode::OR,
+        Opcode::AND,
+    ];
+    const MULDIV: [Opcode; 8] = [
+        Opcode::MUL,
+        Opcode::MULH,
+        Opcode::MULHSU,
+        Opcode::MULHU,
+        Opcode::DIV,
+        Opcode::DIVU,
+        Opcode::REM,
+        Opcode::REMU,
+    ];
+    const LOADS: [Option<Opcode>; 8] = [
+        Some(Opcode::LB),
+        Some(Opcode::LH),
+        Some(Opcode::LW),
+        None,
+        Some(Opcode::LBU),
+        Some(Opcode::LHU),
+        None,
+        None,
+    ];
+    const STORES: [Option<Opcode>; 8] = [
+        Some(Opcode::SB),
+        Some(Opcode::SH),
+        Some(Opcode::SW),
+        None,
+        None,
+        None,
+        None,
+        None,
+    ];
+    const BRANCHES: [Option<Opcode>; 8] = [
+        Some(Opcode::BEQ),
+        Some(Opcode::BNE),
+        None,
+        None,
+        Some(Opcode::BLT),
+        Some(Opcode::BGE),
+        Some(Opcode::BLTU),
+        Some(Opcode::BGEU),
+    ];
+
+    let mut table = [Entry::FALLBACK; 1024];
+    let mut funct3 = 0;
+    while funct3 < 8 {
+        // The funct7 bits are part of the immediate of the formats other than R and shifts, so
+        // their entries are the same for every funct7 class.
+        let mut class = 0;
+        while class < 4 {
+            let (alternate, muldiv) = (class & 1, class >> 1);
+            if let Some(opcode) = LOADS[funct3] {
+                table[entry_index(LOAD, funct3, alternate, muldiv)] =
+                    Entry::new(Format::I, opcode, ANY_FUNCT7);
+            }
+            if let Some(opcode) = STORES[funct3] {
+                table[entry_index(STORE, funct3, alternate, muldiv)] =
+                    Entry::new(Format::S, opcode, ANY_FUNCT7);
+            }
+            if let Some(opcode) = BRANCHES[funct3] {
+                table[entry_index(BRANCH, funct3, alternate, muldiv)] =
+                    Entry::new(Format::B, opcode, ANY_FUNCT7);
+            }
+            if funct3 != 1 && funct3 != 5 {
+                table[entry_index(OP_IMM, funct3, alternate, muldiv)] =
+                    Entry::new(Format::I, ALU[funct3], ANY_FUNCT7);
+            }
+            if funct3 == 0 {
+                table[entry_index(JALR, funct3, alternate, muldiv)] =
+                    Entry::new(Format::I, Opcode::JALR, ANY_FUNCT7);
+                table[entry_index(SYSTEM, funct3, alternate, muldiv)] =
+                    Entry::new(Format::System, Opcode::UNIMP, ANY_FUNCT7);
+            } else if funct3 != 4 {
+                table[entry_index(SYSTEM, funct3, alternate, muldiv)] =
+                    Entry::new(Format::Unimp, Opcode::UNIMP, ANY_FUNCT7);
+            }
+            table[entry_index(AUIPC, funct3, alternate, muldiv)] =
+                Entry::new(Format::Auipc, Opcode::AUIPC, ANY_FUNCT7);
+            table[entry_index(LUI, funct3, alternate, muldiv)] =
+                Entry::new(Format::Lui, Opcode::ADD, ANY_FUNCT7);
+            table[entry_index(JAL, funct3, alternate, muldiv)] =
+                Entry::new(Format::Jal, Opcode::JAL, ANY_FUNCT7);
+            class += 1;
+        }
+
+        // Register-register operations and shifts by an immediate.
+        table[entry_index(OP, funct3, 0, 0)] = Entry::new(Format::R, ALU[funct3], 0);
+        table[entry_index(OP, funct3, 0, 1)] = Entry::new(Format::R, MULDIV[funct3], 0x01);
+        if funct3 == 0 {
+            table[entry_index(OP, funct3, 1, 0)] = Entry::new(Format::R, Opcode::SUB, 0x20);
+        }
+        if funct3 == 1 || funct3 == 5 {
+            table[entry_index(OP_IMM, funct3, 0, 0)] = Entry::new(Format::IShamt, ALU[funct3], 0);
+        }
+        if funct3 == 5 {
+            table[entry_index(OP, funct3, 1, 0)] = Entry::new(Format::R, Opcode::SRA, 0x20);
+            table[entry_index(OP_IMM, funct3, 1, 0)] =
+                Entry::new(Format::IShamt, Opcode::SRA, 0x20);
+        }
+        funct3 += 1;
+    }
+    table
+}
+
+/// Decodes a 32-bit encoded instruction, or returns `None` if it isn't one of the encodings
+/// handled by the table. The result is the same as transpiling the word with rrs-lib.
+#[inline]
+pub fn decode(word: u32) -> Option<Instruction> {
+    let entry = TABLE[index(word)];
+    if word & 0b11 != 0b11 || (entry.funct7 != ANY_FUNCT7 && entry.funct7 as u32 != word >> 25) {
+        return None;
+    }
+
+    let rd = (word >> 7) & 0x1f;
+    let rs1 = (word >> 15) & 0x1f;
+    let rs2 = (word >> 20) & 0x1f;
+    let i_imm = ((word as i32) >> 20) as u32;
+    let s_imm = (i_imm & !0x1f) | rd;
+    let b_imm = (((word as i32) >> 19) as u32 & !0xfff)
+        | ((word << 4) & 0x800)
+        | ((word >> 20) & 0x7e0)
+        | ((word >> 7) & 0x1e);
+    let j_imm = (((word as i32) >> 11) as u32 & !0xfffff)
+        | (word & 0xff000)
+        | ((word >> 9) & 0x800)
+        | ((word >> 20) & 0x7fe);
+    let u_imm = word & 0xfffff000;
+
+    let opcode = entry.opcode;
+    let instruction = match entry.format {
+        Format::Fallback => return None,
+        Format::R => Instruction::new(opcode, rd, rs1, rs2, false, false),
+        Format::I => Instruction::new(opcode, rd, rs1, i_imm, false, true),
+        Format::IShamt => Instruction::new(opcode, rd, rs1, rs2, false, true),
+        Format::S => Instruction::new(opcode, rs2, rs1, s_imm, false, true),
+        Format::B => Instruction::new(opcode, rs1, rs2, b_imm, false, true),
+        Format::Jal => Instruction::new(opcode, rd, j_imm, 0, true, true),
+        Format::Lui => Instruction::new(opcode, rd, 0, u_imm, true, true),
+        Format::Auipc => Instruction::new(opcode, rd, u_imm, u_imm, true, true),
+        Format::System => match word {
+            0x0000_0073 => Instruction::new(
+                Opcode::ECALL,
+                Register::X5 as u32,
+                Register::X10 as u32,
+                Register::X11 as u32,
+                false,
+                false,
+            ),
+            0x0010_0073 => Instruction::new(Opcode::EBREAK, 0, 0, 0, false, false),
+            _ => return None,
+        },
+        Format::Unimp => Instruction::unimp(),
+    };
+    Some(instruction)
+}
+
+/// Decodes the 32-bit encoded instructions in a single pass, with [decode] or rrs-lib for the
+/// encodings not in the table.
+///
+/// Panics if a word isn't a valid RV32IM instruction.
+pub fn decode_instructions(words: &[u32]) -> Vec<Instruction> {
+    let mut instructions = Vec::with_capacity(words.len());
+    instructions.extend(words.iter().map(|&word| {
+        decode(word).unwrap_or_else(|| {
+            transpile_rrs(word).unwrap_or_else(|| panic!("invalid instruction {word:#010x}"))
+        })
+    }));
+    instructions
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::disassembler::Elf;
+    use crate::utils::tests::{FIBONACCI_ELF, HELLO_WORLD_ELF, IO_ELF, TEST_PANIC_ELF};
+
+    /// Checks that the table decodes `word` like rrs-lib, if it decodes it at all, and returns
+    /// whether it did.
+    fn check(word: u32) -> bool {
+        let Some(instruction) = decode(word) else {
+            return false;
+        };
+        assert_eq!(
+            Some(instruction),
+            transpile_rrs(word),
+            "word {word:#010x} decoded differently"
+        );
+        true
+    }
+
+    /// A xorshift generator of pseudo-random words.
+    fn words(mut state: u32, count: usize) -> impl Iterator<Item = u32> {
+        (0..count).map(move |_| {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            state
+        })
+    }
+
+    #[test]
+    fn test_table_matches_rrs() {
+        // Every combination of major opcode, funct3 and funct7 with random operands.
+        let mut decoded = 0;
+        for (i, operands) in words(0x2545_f491, 1 << 17).enumerate() {
+            let opcode = (i as u32 & 0x1f) << 2 | 0b11;
+            let funct3 = (i as u32 >> 5) & 0x7;
+            let funct7 = (i as u32 >> 8) & 0x7f;
+            let word = funct7 << 25 | (operands & 0x01ff_8f80) | funct3 << 12 | opcode;
+            decoded += check(word) as usize;
+        }
+        assert!(decoded > 0);
+
+        // Arbitrary words, most of which are invalid.
+        for word in words(0x9e37_79b9, 1 << 16) {
+            check(word);
+        }
+
+        // The edge cases of the immediates and the system instructions.
+        for word in [
+            0x0000_0073,
+            0x0010_0073,
+            0x8000_0063,
+            0xffff_ffe3,
+            0x8000_006f,
+            0xffff_f06f,
+            0xffff_f037,
+            0xfff0_0067,
+            0xfe00_0fa3,
+            0x4000_5013,
+            0xc000_1073,
+        ] {
+            assert!(check(word), "word {word:#010x} isn't in the table");
+        }
+    }
+
+    #[test]
+    fn test_decode_programs() {
+        for elf in [FIBONACCI_ELF, HELLO_WORLD_ELF, IO_ELF, TEST_PANIC_ELF] {
+            let elf = Elf::decode(elf);
+            let decoded = decode_instructions(&elf.instructions);
+            let transpiled: Vec<_> = elf
+                .instructions
+                .iter()
+                .map(|&word| transpile_rrs(word).unwrap())
+                .collect();
+            assert_eq!(decoded, transpiled);
+            // Fences are rare enough to be left to rrs-lib.
+            let fallbacks = elf
+                .instructions
+                .iter()
+                .filter(|&&word| decode(word).is_none())
+                .count();
+            assert!(fallbacks * 100 < elf.instructions.len());
+        }
+    }
+
+    #[test]
+    #[should_panic(expected = "invalid instruction 0x00000000")]
+    fn test_invalid_instruction() {
+        decode_instructions(&[0x0000_0013, 0]);
+    }
+}
@@ -1,11 +1,12 @@
 use std::cmp::min;
-use std::collections::BTreeMap;
 
 use elf::abi::{EM_RISCV, ET_EXEC, PF_X, PT_LOAD};
 use elf::endian::LittleEndian;
 use elf::file::Class;
 use elf::ElfBytes;
 
+use crate::runtime::MemoryImage;
+
 /// The maximum size of the memory in bytes.
 pub const MAXIMUM_MEMORY_SIZE: u32 = u32::MAX;
 
@@ -25,7 +26,7 @@ pub struct Elf {
     pub pc_base: u32,
 
     /// The initial memory image, useful for global constants.
-    pub memory_image: BTreeMap<u32, u32>,
+    pub memory_image: MemoryImage,
 }
 
 impl Elf {
@@ -34,7 +35,7 @@ impl Elf {
         instructions: Vec<u32>,
         pc_start: u32,
         pc_base: u32,
-        memory_image: BTreeMap<u32, u32>,
+        memory_image: MemoryImage,
     ) -> Self {
         Self {
             instructions,
@@ -48,7 +49,7 @@ impl Elf {
     ///
     /// Reference: https://en.wikipedia.org/wiki/Executable_and_Linkable_Format
     pub fn decode(input: &[u8]) -> Self {
-        let mut image: BTreeMap<u32, u32> = BTreeMap::new();
+        let mut image = MemoryImage::new();
         // Parse the ELF file assuming that it is little-endian..
         let elf = ElfBytes::<LittleEndian>::minimal_parse(input).expect("failed to parse elf");
 
@@ -124,6 +125,7 @@ impl Elf {
                 .expect("offset was larger than 32 bits");
 
             // Read the segment and decode each word as an instruction.
+            let mut data = Vec::with_capacity(mem_size as usize);
             for i in (0..mem_size).step_by(WORD_SIZE) {
                 let addr = vaddr.checked_add(i).expect("invalid segment vaddr");
                 if addr == MAXIMUM_MEMORY_SIZE {
@@ -132,7 +134,7 @@ impl Elf {
 
                 // If we are reading past the end of the file, then break.
                 if i >= file_size {
-                    image.insert(addr, 0);
+                    data.extend_from_slice(&[0; WORD_SIZE]);
                     continue;
                 }
 
@@ -144,11 +146,12 @@ impl Elf {
                     let byte = input.get(offset).expect("invalid segment offset");
                     word |= (*byte as u32) << (j * 8);
                 }
-                image.insert(addr, word);
+                data.extend_from_slice(&word.to_le_bytes());
                 if (segment.p_flags & PF_X) != 0 {
                     instructions.push(word);
                 }
             }
+            image.insert_bytes(vaddr, &data);
         }
 
         Elf::new(instructions, entry, base_address, image)
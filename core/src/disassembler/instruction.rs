@@ -3,6 +3,7 @@ use rrs_lib::instruction_formats::{
 };
 use rrs_lib::{process_instruction, InstructionProcessor};
 
+use super::decode_instructions;
 use crate::runtime::{Instruction, Opcode, Register};
 
 impl Instruction {
@@ -406,12 +407,15 @@ impl InstructionProcessor for InstructionTranspiler {
 }
 
 /// Transpile the instructions from the 32-bit encoded instructions.
+///
+/// The common encodings are decoded by the table of [decode_instructions], and the others by
+/// rrs-lib. Panics if a word isn't a valid RV32IM instruction.
 pub fn transpile(instructions_u32: &[u32]) -> Vec<Instruction> {
-    let mut instructions = Vec::new();
-    let mut transpiler = InstructionTranspiler;
-    for instruction_u32 in instructions_u32 {
-        let instruction = process_instruction(&mut transpiler, *instruction_u32).unwrap();
-        instructions.push(instruction);
-    }
-    instructions
+    decode_instructions(instructions_u32)
+}
+
+/// Transpile a 32-bit encoded instruction with rrs-lib, or return `None` if it isn't a valid
+/// RV32IM instruction. This is the reference the table-driven decoder is checked against.
+pub fn transpile_rrs(instruction_u32: u32) -> Option<Instruction> {
+    process_instruction(&mut InstructionTranspiler, instruction_u32)
 }
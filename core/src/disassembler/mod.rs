@@ -1,12 +1,14 @@
+mod decoder;
 mod elf;
 mod instruction;
 
+pub use decoder::*;
 pub use elf::*;
 pub use instruction::*;
 
-use std::{collections::BTreeMap, fs::File, io::Read};
+use std::{fs::File, io::Read, sync::OnceLock};
 
-use crate::runtime::{Instruction, Program};
+use crate::runtime::{Instruction, MemoryImage, Program};
 
 impl Program {
     /// Create a new program.
@@ -15,7 +17,9 @@ impl Program {
             instructions,
             pc_start,
             pc_base,
-            memory_image: BTreeMap::new(),
+            memory_image: MemoryImage::new(),
+            block_ends: OnceLock::new(),
+            memory_snapshots: [OnceLock::new(), OnceLock::new(), OnceLock::new()],
         }
     }
 
@@ -33,6 +37,8 @@ impl Program {
             pc_start: elf.pc_start,
             pc_base: elf.pc_base,
             memory_image: elf.memory_image,
+            block_ends: OnceLock::new(),
+            memory_snapshots: [OnceLock::new(), OnceLock::new(), OnceLock::new()],
         }
     }
 
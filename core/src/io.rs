@@ -83,10 +83,22 @@ impl AthenaPublicValues {
       }
   }
 
+  /// Create a `AthenaPublicValues` owning `data`, without copying it.
+  pub fn from_vec(data: Vec<u8>) -> Self {
+      Self {
+          buffer: Buffer { data, ptr: 0 },
+      }
+  }
+
   pub fn as_slice(&self) -> &[u8] {
       self.buffer.data.as_slice()
   }
 
+  /// Returns the bytes, without copying them.
+  pub fn into_vec(self) -> Vec<u8> {
+      self.buffer.data
+  }
+
   pub fn to_vec(&self) -> Vec<u8> {
       self.buffer.data.clone()
   }
@@ -0,0 +1,319 @@
+//! A program decoded ahead of time, stored so that it loads without parsing or transpiling an
+//! ELF.
+//!
+//! An artifact is a sequence of little-endian 32-bit words:
+//!
+//! - the header: [ARTIFACT_MAGIC], [ARTIFACT_VERSION], the start pc, the base pc, the number of
+//!   instructions and the number of memory segments,
+//! - the instructions, 4 words each: the opcode with `imm_b` in bit 8 and `imm_c` in bit 9, then
+//!   `op_a`, `op_b` and `op_c`,
+//! - the memory segments in increasing address order: the address of the first word, the number
+//!   of words, then the words.
+//!
+//! Artifacts are produced by `cargo athena build` next to the ELF, and by the program cache of the
+//! SDK in its artifact directory. They are never accepted in place of an ELF, only loaded
+//! explicitly from a code cache with [Program::from_artifact_file].
+//! Decoding checks every opcode, register operand and memory segment, so a corrupted artifact
+//! is rejected rather than executed.
+
+use std::path::Path;
+
+use strum::IntoEnumIterator;
+use thiserror::Error;
+
+use super::{Instruction, Opcode, Program, Register};
+
+pub const ARTIFACT_MAGIC: [u8; 4] = *b"ATHP";
+pub const ARTIFACT_VERSION: u32 = 1;
+
+const HEADER_WORDS: usize = 6;
+const INSTRUCTION_WORDS: usize = 4;
+const IMM_B: u32 = 1 << 8;
+const IMM_C: u32 = 1 << 9;
+
+/// The registers live at the lowest addresses, which memory segments must not overlap.
+const MEMORY_START: u32 = Register::X31 as u32 + 1;
+
+#[derive(Error, Debug)]
+pub enum ArtifactError {
+  #[error("not a program artifact")]
+  InvalidMagic,
+  #[error("unsupported program artifact version {0}")]
+  UnsupportedVersion(u32),
+  #[error("program artifact is truncated")]
+  Truncated,
+  #[error("invalid opcode {0} in program artifact")]
+  InvalidOpcode(u32),
+  #[error("invalid register operand in instruction {0} of program artifact")]
+  InvalidOperand(usize),
+  #[error("invalid memory segment at {0:#010x} in program artifact")]
+  InvalidSegment(u32),
+  #[error("failed to read program artifact: {0}")]
+  Io(#[from] std::io::Error),
+}
+
+impl Program {
+  /// Returns whether `code` is a program artifact rather than an ELF.
+  pub fn is_artifact(code: &[u8]) -> bool {
+    code.starts_with(&ARTIFACT_MAGIC)
+  }
+
+  /// Encodes the program as an artifact.
+  pub fn to_artifact(&self) -> Vec<u8> {
+    let segments = self.memory_image.segments();
+    let mut words = vec![
+      u32::from_le_bytes(ARTIFACT_MAGIC),
+      ARTIFACT_VERSION,
+      self.pc_start,
+      self.pc_base,
+      self.instructions.len() as u32,
+      segments.len() as u32,
+    ];
+    for instruction in &self.instructions {
+      let mut opcode = instruction.opcode as u32;
+      if instruction.imm_b {
+        opcode |= IMM_B;
+      }
+      if instruction.imm_c {
+        opcode |= IMM_C;
+      }
+      words.extend([opcode, instruction.op_a, instruction.op_b, instruction.op_c]);
+    }
+    let mut bytes: Vec<u8> = words.into_iter().flat_map(u32::to_le_bytes).collect();
+    for segment in segments {
+      bytes.extend(segment.base.to_le_bytes());
+      bytes.extend((segment.data.len() as u32 / 4).to_le_bytes());
+      bytes.extend_from_slice(&segment.data);
+    }
+    bytes
+  }
+
+  /// Decodes a program from an artifact.
+  pub fn from_artifact(bytes: &[u8]) -> Result<Self, ArtifactError> {
+    if !Self::is_artifact(bytes) {
+      return Err(ArtifactError::InvalidMagic);
+    }
+    let mut reader = WordReader(bytes);
+    let header = reader.take(HEADER_WORDS)?;
+    if header[1] != ARTIFACT_VERSION {
+      return Err(ArtifactError::UnsupportedVersion(header[1]));
+    }
+    let [pc_start, pc_base, num_instructions, num_segments] = [2, 3, 4, 5].map(|i| header[i]);
+
+    let mut opcodes = [None; 256];
+    for opcode in Opcode::iter() {
+      opcodes[opcode as usize] = Some(opcode);
+    }
+    let encoded = reader.take(num_instructions as usize * INSTRUCTION_WORDS)?;
+    let instructions = encoded
+      .chunks_exact(INSTRUCTION_WORDS)
+      .enumerate()
+      .map(|(i, words)| {
+        let opcode = opcodes
+          .get((words[0] & !(IMM_B | IMM_C)) as usize)
+          .copied()
+          .flatten()
+          .ok_or(ArtifactError::InvalidOpcode(words[0]))?;
+        let (imm_b, imm_c) = (words[0] & IMM_B != 0, words[0] & IMM_C != 0);
+        // Operand A is always a register, B and C are unless they are immediates.
+        let is_register = |op: u32| op <= Register::X31 as u32;
+        if !is_register(words[1])
+          || (!imm_b && !is_register(words[2]))
+          || (!imm_c && !is_register(words[3]))
+        {
+          return Err(ArtifactError::InvalidOperand(i));
+        }
+        Ok(Instruction::new(
+          opcode, words[1], words[2], words[3], imm_b, imm_c,
+        ))
+      })
+      .collect::<Result<Vec<_>, ArtifactError>>()?;
+
+    let mut program = Program::new(instructions, pc_start, pc_base);
+    let mut end = 0;
+    for _ in 0..num_segments {
+      let [addr, len] = reader.take(2)?[..] else {
+        unreachable!()
+      };
+      let data = reader.take_bytes(len as usize)?;
+      if addr % 4 != 0
+        || addr < MEMORY_START
+        || (addr as u64) < end
+        || addr as u64 + data.len() as u64 > 1 << 32
+      {
+        return Err(ArtifactError::InvalidSegment(addr));
+      }
+      end = addr as u64 + data.len() as u64;
+      program.memory_image.push_segment(addr, data.into());
+    }
+    Ok(program)
+  }
+
+  /// Loads a program from an artifact file in a code cache, such as one written by
+  /// `cargo athena build` or by a node warming its cache.
+  pub fn from_artifact_file(path: impl AsRef<Path>) -> Result<Self, ArtifactError> {
+    Self::from_artifact(&std::fs::read(path)?)
+  }
+}
+
+struct WordReader<'a>(&'a [u8]);
+
+impl<'a> WordReader<'a> {
+  fn take(&mut self, words: usize) -> Result<Vec<u32>, ArtifactError> {
+    Ok(
+      self
+        .take_bytes(words)?
+        .chunks_exact(4)
+        .map(|word| u32::from_le_bytes(word.try_into().unwrap()))
+        .collect(),
+    )
+  }
+
+  fn take_bytes(&mut self, words: usize) -> Result<&'a [u8], ArtifactError> {
+    let len = words.checked_mul(4).ok_or(ArtifactError::Truncated)?;
+    if self.0.len() < len {
+      return Err(ArtifactError::Truncated);
+    }
+    let (bytes, rest) = self.0.split_at(len);
+    self.0 = rest;
+    Ok(bytes)
+  }
+}
+
+#[cfg(test)]
+mod tests {
+  use athena_interface::MockHost;
+
+  use super::*;
+  use crate::runtime::Runtime;
+  use crate::utils::{tests::TEST_FIBONACCI_ELF, AthenaCoreOpts};
+
+  fn assert_same_program(a: &Program, b: &Program) {
+    assert_eq!(a.pc_start, b.pc_start);
+    assert_eq!(a.pc_base, b.pc_base);
+    assert_eq!(a.memory_image, b.memory_image);
+    assert_eq!(
+      format!("{:?}", a.instructions),
+      format!("{:?}", b.instructions)
+    );
+    assert_eq!(
+      a.instructions
+        .iter()
+        .map(|i| (i.imm_b, i.imm_c))
+        .collect::<Vec<_>>(),
+      b.instructions
+        .iter()
+        .map(|i| (i.imm_b, i.imm_c))
+        .collect::<Vec<_>>()
+    );
+  }
+
+  #[test]
+  fn test_artifact_roundtrip() {
+    let program = Program::from(TEST_FIBONACCI_ELF);
+    let artifact = program.to_artifact();
+    assert!(Program::is_artifact(&artifact));
+    let decoded = Program::from_artifact(&artifact).unwrap();
+    assert_same_program(&program, &decoded);
+
+    let run = |program: Program| {
+      let mut runtime = Runtime::<MockHost>::new(program, None, AthenaCoreOpts::default());
+      runtime.run().unwrap();
+      (runtime.state.global_clk, runtime.state.public_values_stream)
+    };
+    assert_eq!(run(program), run(decoded));
+  }
+
+  #[test]
+  fn test_artifact_file() {
+    let program = Program::from(TEST_FIBONACCI_ELF);
+    let path = std::env::temp_dir().join(format!("athena-artifact-{}", std::process::id()));
+    std::fs::write(&path, program.to_artifact()).unwrap();
+    let loaded = Program::from_artifact_file(&path);
+    std::fs::remove_file(&path).unwrap();
+    assert_same_program(&program, &loaded.unwrap());
+  }
+
+  #[test]
+  fn test_invalid_artifacts() {
+    let artifact = Program::from(TEST_FIBONACCI_ELF).to_artifact();
+    assert!(matches!(
+      Program::from_artifact(TEST_FIBONACCI_ELF),
+      Err(ArtifactError::InvalidMagic)
+    ));
+    assert!(matches!(
+      Program::from_artifact(&artifact[..artifact.len() - 4]),
+      Err(ArtifactError::Truncated)
+    ));
+    let mut future = artifact.clone();
+    future[4] = 2;
+    assert!(matches!(
+      Program::from_artifact(&future),
+      Err(ArtifactError::UnsupportedVersion(2))
+    ));
+    let mut invalid = artifact.clone();
+    invalid[4 * HEADER_WORDS..4 * HEADER_WORDS + 2].copy_from_slice(&[0xff, 0]);
+    assert!(matches!(
+      Program::from_artifact(&invalid),
+      Err(ArtifactError::InvalidOpcode(0xff))
+    ));
+  }
+
+  #[test]
+  fn test_invalid_artifact_operands() {
+    let add = |op_a, op_b, op_c, imm_c| {
+      let mut program = Program::new(
+        vec![Instruction::new(
+          Opcode::ADD,
+          op_a,
+          op_b,
+          op_c,
+          false,
+          imm_c,
+        )],
+        0x1000,
+        0x1000,
+      );
+      program.memory_image.push_segment(0x1000, vec![0; 4].into());
+      Program::from_artifact(&program.to_artifact())
+    };
+    assert!(add(31, 31, 31, false).is_ok());
+    assert!(add(1, 2, 1 << 20, true).is_ok());
+    for (op_a, op_b, op_c) in [(32, 1, 1), (1, 32, 1), (1, 1, 32)] {
+      assert!(matches!(
+        add(op_a, op_b, op_c, false),
+        Err(ArtifactError::InvalidOperand(0))
+      ));
+    }
+  }
+
+  #[test]
+  fn test_invalid_artifact_segments() {
+    // Encodes the segments by hand, since a memory image can't hold invalid ones.
+    let with_segments = |segments: &[(u32, u32)]| {
+      let mut artifact = Program::new(vec![], 0x1000, 0x1000).to_artifact();
+      artifact[4 * (HEADER_WORDS - 1)..4 * HEADER_WORDS]
+        .copy_from_slice(&(segments.len() as u32).to_le_bytes());
+      for &(addr, words) in segments {
+        artifact.extend(addr.to_le_bytes());
+        artifact.extend(words.to_le_bytes());
+        artifact.extend(vec![0; 4 * words as usize]);
+      }
+      Program::from_artifact(&artifact)
+    };
+    assert!(with_segments(&[(32, 1), (0x1000, 2)]).is_ok());
+    // Segments must not overlap the registers, each other, or the end of the address space.
+    for (segments, addr) in [
+      (&[(0, 1)][..], 0),
+      (&[(28, 1)], 28),
+      (&[(0x1000, 2), (0x1004, 1)], 0x1004),
+      (&[(0xffff_fffc, 2)], 0xffff_fffc),
+      (&[(0x1002, 1)], 0x1002),
+    ] {
+      assert!(
+        matches!(with_segments(segments), Err(ArtifactError::InvalidSegment(a)) if a == addr),
+        "{segments:?}"
+      );
+    }
+  }
+}
@@ -0,0 +1,881 @@
+use std::collections::{BTreeMap, HashMap};
+use std::fmt;
+use std::sync::Arc;
+
+use nohash_hasher::BuildNoHashHasher;
+use serde::ser::SerializeMap;
+use serde::{Deserialize, Deserializer, Serialize, Serializer};
+
+use super::MemoryRecord;
+
+/// The number of registers, which live at addresses `0..32` of the memory.
+const NUM_REGISTERS: u32 = 32;
+
+/// Guest addresses are split into a directory index, a table index, a word index and the byte
+/// offset within the word: `[31:22] [21:12] [11:2] [1:0]`.
+const WORD_INDEX_BITS: u32 = 10;
+const TABLE_INDEX_BITS: u32 = 10;
+const DIRECTORY_INDEX_BITS: u32 = 32 - 2 - WORD_INDEX_BITS - TABLE_INDEX_BITS;
+
+/// The number of words in a page (4 KiB of guest memory).
+const PAGE_WORDS: usize = 1 << WORD_INDEX_BITS;
+const TABLE_ENTRIES: usize = 1 << TABLE_INDEX_BITS;
+const DIRECTORY_ENTRIES: usize = 1 << DIRECTORY_INDEX_BITS;
+
+/// Selects the data structure backing guest memory.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub enum MemoryBackend {
+  /// One hash map entry per accessed address. The default, as traced executions for proving
+  /// rely on it.
+  #[default]
+  Map,
+
+  /// Fixed-size pages allocated on demand and shared copy-on-write between clones.
+  Paged,
+
+  /// Pages like [MemoryBackend::Paged] holding only the value of each word, half the size, for
+  /// executions which don't create access records (e.g. [super::Runtime::run_fast]). Access
+  /// timestamps can't be recorded, so traced executions panic.
+  Compact,
+}
+
+#[derive(Clone)]
+struct Page<V> {
+  /// A bit per word marking whether it has been initialized.
+  present: [u64; PAGE_WORDS / 64],
+  values: [V; PAGE_WORDS],
+}
+
+impl<V: Copy + Default> Page<V> {
+  fn new() -> Self {
+    Self {
+      present: [0; PAGE_WORDS / 64],
+      values: [V::default(); PAGE_WORDS],
+    }
+  }
+
+  #[inline(always)]
+  fn is_present(&self, word: usize) -> bool {
+    self.present[word / 64] & (1 << (word % 64)) != 0
+  }
+
+  #[inline(always)]
+  fn set_present(&mut self, word: usize, present: bool) {
+    if present {
+      self.present[word / 64] |= 1 << (word % 64);
+    } else {
+      self.present[word / 64] &= !(1 << (word % 64));
+    }
+  }
+}
+
+type Table<V> = [Option<Arc<Page<V>>>; TABLE_ENTRIES];
+type Directory<V> = [Option<Arc<Table<V>>>; DIRECTORY_ENTRIES];
+
+/// Splits a word-aligned address into its directory, table and word indices.
+#[inline(always)]
+const fn split(addr: u32) -> (usize, usize, usize) {
+  (
+    (addr >> (2 + WORD_INDEX_BITS + TABLE_INDEX_BITS)) as usize,
+    ((addr >> (2 + WORD_INDEX_BITS)) as usize) & (TABLE_ENTRIES - 1),
+    ((addr >> 2) as usize) & (PAGE_WORDS - 1),
+  )
+}
+
+/// Returns the page at the given indices, allocating it, or copying it if it is shared with a
+/// clone, as needed.
+#[inline(always)]
+fn page_mut<'a, V: Copy + Default>(
+  directory: &'a mut Directory<V>,
+  pages: &mut usize,
+  dir: usize,
+  table: usize,
+) -> &'a mut Page<V> {
+  let entries =
+    Arc::make_mut(directory[dir].get_or_insert_with(|| Arc::new(std::array::from_fn(|_| None))));
+  let page = entries[table].get_or_insert_with(|| {
+    *pages += 1;
+    Arc::new(Page::new())
+  });
+  make_page_mut(page, pages)
+}
+
+/// Returns `page` for writing, copying it if it is shared with a clone. The copy is counted in
+/// `pages`, as it is a new allocation.
+#[inline(always)]
+fn make_page_mut<'a, V: Copy>(page: &'a mut Arc<Page<V>>, pages: &mut usize) -> &'a mut Page<V> {
+  if Arc::get_mut(page).is_none() {
+    *pages += 1;
+  }
+  Arc::make_mut(page)
+}
+
+/// A sparse memory made of fixed-size pages held in a two-level page table.
+///
+/// Registers and word-aligned addresses are resolved with an index computation instead of a hash
+/// lookup. Pages are reference counted, so cloning the memory is cheap and a page is only copied
+/// when one of the clones writes to it. Unaligned addresses (other than the registers) are rare
+/// and kept in a side map so that every address stays a distinct cell, exactly as in
+/// [MemoryBackend::Map].
+pub struct PagedMemory<V = MemoryRecord> {
+  registers: [V; NUM_REGISTERS as usize],
+  registers_present: u32,
+  directory: Box<Directory<V>>,
+  unaligned: HashMap<u32, V, BuildNoHashHasher<u32>>,
+  len: usize,
+  /// The number of pages allocated, counting those shared with clones and the copies made when
+  /// writing to a shared page. A copy stays counted once the clone it was copied from is
+  /// dropped, so this may overestimate the pages held.
+  pages: usize,
+}
+
+impl<V: Copy + Default> PagedMemory<V> {
+  /// The size of a page, in bytes.
+  pub const PAGE_SIZE: usize = std::mem::size_of::<Page<V>>();
+
+  pub fn new() -> Self {
+    Self {
+      registers: [V::default(); NUM_REGISTERS as usize],
+      registers_present: 0,
+      directory: vec![None; DIRECTORY_ENTRIES]
+        .into_boxed_slice()
+        .try_into()
+        .unwrap_or_else(|_| unreachable!()),
+      unaligned: HashMap::default(),
+      len: 0,
+      pages: 0,
+    }
+  }
+
+  /// The number of initialized addresses.
+  pub fn len(&self) -> usize {
+    self.len
+  }
+
+  pub fn is_empty(&self) -> bool {
+    self.len == 0
+  }
+
+  /// The number of pages allocated.
+  pub fn pages(&self) -> usize {
+    self.pages
+  }
+
+  /// The number of pages which writing the `len` bytes from the word-aligned `addr` would
+  /// allocate: those not allocated yet, and those shared with a clone, which are copied.
+  pub fn pages_allocated_by_write(&self, addr: u32, len: u32) -> usize {
+    if len == 0 {
+      return 0;
+    }
+    let first = addr as u64 >> (2 + WORD_INDEX_BITS);
+    let last = (addr as u64 + len as u64 - 1) >> (2 + WORD_INDEX_BITS);
+    (first..=last)
+      .filter(|&page| {
+        let dir = (page >> TABLE_INDEX_BITS) as usize;
+        let table = page as usize & (TABLE_ENTRIES - 1);
+        self.directory[dir]
+          .as_ref()
+          .and_then(|entries| Some((entries, entries[table].as_ref()?)))
+          // A page is also shared when its table is, as copying the table shares its pages.
+          .map_or(true, |(entries, page)| {
+            Arc::strong_count(entries) > 1 || Arc::strong_count(page) > 1
+          })
+      })
+      .count()
+  }
+
+  /// Resets every address to uninitialized, keeping the page directory allocated.
+  pub fn clear(&mut self) {
+    self.registers_present = 0;
+    self.directory.fill(None);
+    self.unaligned.clear();
+    self.len = 0;
+    self.pages = 0;
+  }
+
+  #[inline]
+  pub fn get(&self, addr: u32) -> Option<&V> {
+    if addr < NUM_REGISTERS {
+      return (self.registers_present & (1 << addr) != 0).then(|| &self.registers[addr as usize]);
+    }
+    if addr % 4 != 0 {
+      return self.unaligned.get(&addr);
+    }
+    let (dir, table, word) = split(addr);
+    let page = self.directory[dir].as_ref()?[table].as_ref()?;
+    page.is_present(word).then(|| &page.values[word])
+  }
+
+  #[inline]
+  pub fn get_mut(&mut self, addr: u32) -> Option<&mut V> {
+    if addr < NUM_REGISTERS {
+      return (self.registers_present & (1 << addr) != 0)
+        .then(|| &mut self.registers[addr as usize]);
+    }
+    if addr % 4 != 0 {
+      return self.unaligned.get_mut(&addr);
+    }
+    let (dir, table, word) = split(addr);
+    let entries = Arc::make_mut(self.directory[dir].as_mut()?);
+    let page = make_page_mut(entries[table].as_mut()?, &mut self.pages);
+    page.is_present(word).then(|| &mut page.values[word])
+  }
+
+  /// Returns the value at `addr`, initializing it with `init` if it has never been set.
+  #[inline]
+  pub fn get_or_insert_with(&mut self, addr: u32, init: impl FnOnce() -> V) -> &mut V {
+    if addr < NUM_REGISTERS {
+      if self.registers_present & (1 << addr) == 0 {
+        self.registers_present |= 1 << addr;
+        self.registers[addr as usize] = init();
+        self.len += 1;
+      }
+      return &mut self.registers[addr as usize];
+    }
+    if addr % 4 != 0 {
+      let len = &mut self.len;
+      return self.unaligned.entry(addr).or_insert_with(|| {
+        *len += 1;
+        init()
+      });
+    }
+    let (dir, table, word) = split(addr);
+    let page = page_mut(&mut self.directory, &mut self.pages, dir, table);
+    if !page.is_present(word) {
+      page.set_present(word, true);
+      page.values[word] = init();
+      self.len += 1;
+    }
+    &mut page.values[word]
+  }
+
+  /// Sets the value at `addr`, returning the previous value if there was one.
+  pub fn insert(&mut self, addr: u32, value: V) -> Option<V> {
+    let prev = self.remove(addr);
+    *self.get_or_insert_with(addr, V::default) = value;
+    prev
+  }
+
+  /// Resets `addr` to uninitialized, returning its value if there was one.
+  pub fn remove(&mut self, addr: u32) -> Option<V> {
+    if addr < NUM_REGISTERS {
+      if self.registers_present & (1 << addr) == 0 {
+        return None;
+      }
+      self.registers_present &= !(1 << addr);
+      self.len -= 1;
+      return Some(std::mem::take(&mut self.registers[addr as usize]));
+    }
+    if addr % 4 != 0 {
+      let prev = self.unaligned.remove(&addr);
+      self.len -= prev.is_some() as usize;
+      return prev;
+    }
+    let (dir, table, word) = split(addr);
+    let entries = Arc::make_mut(self.directory[dir].as_mut()?);
+    let page = make_page_mut(entries[table].as_mut()?, &mut self.pages);
+    if !page.is_present(word) {
+      return None;
+    }
+    page.set_present(word, false);
+    self.len -= 1;
+    Some(std::mem::take(&mut page.values[word]))
+  }
+
+  /// Calls `update` with the index and value of each of the `count` words from the word-aligned
+  /// `addr` on, initializing those which have never been set. Each page is resolved once rather
+  /// than once per word.
+  pub fn update_words(&mut self, addr: u32, count: usize, mut update: impl FnMut(usize, &mut V)) {
+    debug_assert_eq!(addr % 4, 0);
+    let mut i = 0;
+    while i < count {
+      let addr = addr + i as u32 * 4;
+      if addr < NUM_REGISTERS {
+        update(i, self.get_or_insert_with(addr, V::default));
+        i += 1;
+        continue;
+      }
+      let (dir, table, word) = split(addr);
+      let page = page_mut(&mut self.directory, &mut self.pages, dir, table);
+      let n = (PAGE_WORDS - word).min(count - i);
+      for (j, w) in (word..word + n).enumerate() {
+        if !page.is_present(w) {
+          page.set_present(w, true);
+          page.values[w] = V::default();
+          self.len += 1;
+        }
+        update(i + j, &mut page.values[w]);
+      }
+      i += n;
+    }
+  }
+
+  /// Iterates over the initialized addresses: registers first, then memory in address order.
+  pub fn iter(&self) -> impl Iterator<Item = (u32, &V)> + '_ {
+    let registers = (0..NUM_REGISTERS)
+      .filter(move |addr| self.registers_present & (1 << addr) != 0)
+      .map(move |addr| (addr, &self.registers[addr as usize]));
+    let pages = self
+      .directory
+      .iter()
+      .enumerate()
+      .filter_map(|(dir, entries)| entries.as_ref().map(|entries| (dir, entries)))
+      .flat_map(|(dir, entries)| {
+        entries
+          .iter()
+          .enumerate()
+          .filter_map(move |(table, page)| page.as_ref().map(|page| (dir, table, page)))
+      })
+      .flat_map(|(dir, table, page)| {
+        let base = ((dir << TABLE_INDEX_BITS | table) << WORD_INDEX_BITS) as u32;
+        (0..PAGE_WORDS)
+          .filter(move |word| page.is_present(*word))
+          .map(move |word| ((base + word as u32) << 2, &page.values[word]))
+      });
+    registers
+      .chain(pages)
+      .chain(self.unaligned.iter().map(|(addr, value)| (*addr, value)))
+  }
+}
+
+impl<V: Copy> Clone for PagedMemory<V> {
+  fn clone(&self) -> Self {
+    Self {
+      registers: self.registers,
+      registers_present: self.registers_present,
+      directory: self.directory.clone(),
+      unaligned: self.unaligned.clone(),
+      len: self.len,
+      pages: self.pages,
+    }
+  }
+
+  /// Copies `source` into the existing allocations: the page directory is reused and pages are
+  /// shared with `source` until written to.
+  fn clone_from(&mut self, source: &Self) {
+    self.registers = source.registers;
+    self.registers_present = source.registers_present;
+    self.directory.clone_from_slice(&source.directory[..]);
+    self.unaligned.clone_from(&source.unaligned);
+    self.len = source.len;
+    self.pages = source.pages;
+  }
+}
+
+impl<V: Copy + Default> Default for PagedMemory<V> {
+  fn default() -> Self {
+    Self::new()
+  }
+}
+
+impl<V> fmt::Debug for PagedMemory<V> {
+  fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+    f.debug_struct("PagedMemory")
+      .field("len", &self.len)
+      .finish_non_exhaustive()
+  }
+}
+
+impl<V: Copy + Default + Serialize> Serialize for PagedMemory<V> {
+  fn serialize<S: Serializer>(&self, serializer: S) -> Result<S::Ok, S::Error> {
+    // The chained iterator has no exact size hint, so pass the length explicitly for formats
+    // such as bincode which require it up front.
+    let mut map = serializer.serialize_map(Some(self.len))?;
+    for (addr, value) in self.iter() {
+      map.serialize_entry(&addr, value)?;
+    }
+    map.end()
+  }
+}
+
+impl<'de, V: Copy + Default + Deserialize<'de>> Deserialize<'de> for PagedMemory<V> {
+  fn deserialize<D: Deserializer<'de>>(deserializer: D) -> Result<Self, D::Error> {
+    let entries = BTreeMap::<u32, V>::deserialize(deserializer)?;
+    let mut memory = Self::new();
+    for (addr, value) in entries {
+      memory.insert(addr, value);
+    }
+    Ok(memory)
+  }
+}
+
+/// The memory which instructions operate over.
+///
+/// All backends hold the same values for the same sequence of accesses; [MemoryBackend::Map] is
+/// kept for tracing and proving, where the set of touched addresses is consumed as a map.
+///
+/// The methods reading or writing whole [MemoryRecord]s are for traced executions. With
+/// [MemoryBackend::Compact], records read back with a timestamp of 0 and those returning a
+/// reference to a record panic.
+#[derive(Debug, Serialize, Deserialize)]
+pub enum GuestMemory {
+  Map(HashMap<u32, MemoryRecord, BuildNoHashHasher<u32>>),
+  Paged(PagedMemory<MemoryRecord>),
+  Compact(PagedMemory<u32>),
+}
+
+#[cold]
+#[inline(never)]
+fn no_records() -> ! {
+  panic!("compact guest memory doesn't record access timestamps")
+}
+
+const fn value_record(value: u32) -> MemoryRecord {
+  MemoryRecord {
+    value,
+    timestamp: 0,
+  }
+}
+
+impl GuestMemory {
+  pub fn new(backend: MemoryBackend) -> Self {
+    match backend {
+      MemoryBackend::Map => GuestMemory::Map(HashMap::default()),
+      MemoryBackend::Paged => GuestMemory::Paged(PagedMemory::new()),
+      MemoryBackend::Compact => GuestMemory::Compact(PagedMemory::new()),
+    }
+  }
+
+  pub fn backend(&self) -> MemoryBackend {
+    match self {
+      GuestMemory::Map(_) => MemoryBackend::Map,
+      GuestMemory::Paged(_) => MemoryBackend::Paged,
+      GuestMemory::Compact(_) => MemoryBackend::Compact,
+    }
+  }
+
+  /// The number of initialized addresses.
+  pub fn len(&self) -> usize {
+    match self {
+      GuestMemory::Map(map) => map.len(),
+      GuestMemory::Paged(paged) => paged.len(),
+      GuestMemory::Compact(compact) => compact.len(),
+    }
+  }
+
+  pub fn is_empty(&self) -> bool {
+    self.len() == 0
+  }
+
+  /// The approximate number of bytes held for guest memory: the allocated pages of the paged
+  /// backends, including the copies of pages shared with the program's memory snapshot or a
+  /// checkpoint, or the entries of the map.
+  pub fn size(&self) -> usize {
+    match self {
+      GuestMemory::Map(map) => map.len() * std::mem::size_of::<(u32, MemoryRecord)>(),
+      GuestMemory::Paged(paged) => paged.pages() * PagedMemory::<MemoryRecord>::PAGE_SIZE,
+      GuestMemory::Compact(compact) => compact.pages() * PagedMemory::<u32>::PAGE_SIZE,
+    }
+  }
+
+  /// The [GuestMemory::size] once the words spanned by the `len` bytes from `addr` have been
+  /// written, computed without writing them.
+  pub fn size_after_write(&self, addr: u32, len: u32) -> usize {
+    let start = addr & !3;
+    let len = (addr % 4 + len).next_multiple_of(4);
+    match self {
+      GuestMemory::Map(map) => {
+        let missing = (0..len)
+          .step_by(4)
+          .filter(|offset| !map.contains_key(&(start + offset)))
+          .count();
+        (map.len() + missing) * std::mem::size_of::<(u32, MemoryRecord)>()
+      }
+      GuestMemory::Paged(paged) => {
+        (paged.pages() + paged.pages_allocated_by_write(start, len))
+          * PagedMemory::<MemoryRecord>::PAGE_SIZE
+      }
+      GuestMemory::Compact(compact) => {
+        (compact.pages() + compact.pages_allocated_by_write(start, len))
+          * PagedMemory::<u32>::PAGE_SIZE
+      }
+    }
+  }
+
+  /// Whether the [GuestMemory::size] stays within `limit` once the words spanned by the `len`
+  /// bytes from `addr` have been written. With [MemoryBackend::Map], the words are only looked
+  /// up when the size of the map alone doesn't settle it.
+  pub fn fits_after_write(&self, addr: u32, len: u32, limit: usize) -> bool {
+    let GuestMemory::Map(map) = self else {
+      return self.size_after_write(addr, len) <= limit;
+    };
+    let start = addr & !3;
+    let words = ((addr % 4 + len).div_ceil(4)) as usize;
+    let capacity = limit / std::mem::size_of::<(u32, MemoryRecord)>();
+    // The number of words which can still be added.
+    let Some(headroom) = capacity.checked_sub(map.len()) else {
+      return false;
+    };
+    if words <= headroom {
+      return true;
+    }
+    // At most map.len() of the words are written already.
+    if words.saturating_sub(map.len()) > headroom {
+      return false;
+    }
+    (0..words as u32)
+      .filter(|word| !map.contains_key(&(start + word * 4)))
+      .nth(headroom)
+      .is_none()
+  }
+
+  /// Resets every address to uninitialized, keeping allocations for reuse.
+  pub fn clear(&mut self) {
+    match self {
+      GuestMemory::Map(map) => map.clear(),
+      GuestMemory::Paged(paged) => paged.clear(),
+      GuestMemory::Compact(compact) => compact.clear(),
+    }
+  }
+
+  /// Returns the value at `addr`, if it has been initialized.
+  #[inline]
+  pub fn value(&self, addr: u32) -> Option<u32> {
+    match self {
+      GuestMemory::Map(map) => map.get(&addr).map(|record| record.value),
+      GuestMemory::Paged(paged) => paged.get(addr).map(|record| record.value),
+      GuestMemory::Compact(compact) => compact.get(addr).copied(),
+    }
+  }
+
+  /// Returns the value at `addr`, initializing it with `init` if it has never been accessed.
+  #[inline]
+  pub fn value_or_insert_with(&mut self, addr: u32, init: impl FnOnce() -> u32) -> &mut u32 {
+    match self {
+      GuestMemory::Map(map) => {
+        &mut map
+          .entry(addr)
+          .or_insert_with(|| value_record(init()))
+          .value
+      }
+      GuestMemory::Paged(paged) => {
+        &mut paged
+          .get_or_insert_with(addr, || value_record(init()))
+          .value
+      }
+      GuestMemory::Compact(compact) => compact.get_or_insert_with(addr, init),
+    }
+  }
+
+  #[inline]
+  pub fn get(&self, addr: u32) -> Option<MemoryRecord> {
+    match self {
+      GuestMemory::Map(map) => map.get(&addr).copied(),
+      GuestMemory::Paged(paged) => paged.get(addr).copied(),
+      GuestMemory::Compact(compact) => compact.get(addr).map(|&value| value_record(value)),
+    }
+  }
+
+  #[inline]
+  pub fn get_mut(&mut self, addr: u32) -> Option<&mut MemoryRecord> {
+    match self {
+      GuestMemory::Map(map) => map.get_mut(&addr),
+      GuestMemory::Paged(paged) => paged.get_mut(addr),
+      GuestMemory::Compact(_) => no_records(),
+    }
+  }
+
+  /// Returns the record at `addr`, initializing it with `init` if it has never been accessed.
+  #[inline]
+  pub fn get_or_insert_with(
+    &mut self,
+    addr: u32,
+    init: impl FnOnce() -> MemoryRecord,
+  ) -> &mut MemoryRecord {
+    match self {
+      GuestMemory::Map(map) => map.entry(addr).or_insert_with(init),
+      GuestMemory::Paged(paged) => paged.get_or_insert_with(addr, init),
+      GuestMemory::Compact(_) => no_records(),
+    }
+  }
+
+  pub fn insert(&mut self, addr: u32, record: MemoryRecord) -> Option<MemoryRecord> {
+    match self {
+      GuestMemory::Map(map) => map.insert(addr, record),
+      GuestMemory::Paged(paged) => paged.insert(addr, record),
+      GuestMemory::Compact(compact) => compact.insert(addr, record.value).map(value_record),
+    }
+  }
+
+  pub fn remove(&mut self, addr: u32) -> Option<MemoryRecord> {
+    match self {
+      GuestMemory::Map(map) => map.remove(&addr),
+      GuestMemory::Paged(paged) => paged.remove(addr),
+      GuestMemory::Compact(compact) => compact.remove(addr).map(value_record),
+    }
+  }
+
+  /// Calls `update` with the index and value of each of the `count` words from the word-aligned
+  /// `addr` on, initializing those which have never been accessed.
+  pub fn update_values(
+    &mut self,
+    addr: u32,
+    count: usize,
+    mut update: impl FnMut(usize, &mut u32),
+  ) {
+    match self {
+      GuestMemory::Map(map) => {
+        map.reserve(count);
+        for i in 0..count {
+          update(i, &mut map.entry(addr + i as u32 * 4).or_default().value);
+        }
+      }
+      GuestMemory::Paged(paged) => {
+        paged.update_words(addr, count, |i, record| update(i, &mut record.value))
+      }
+      GuestMemory::Compact(compact) => compact.update_words(addr, count, update),
+    }
+  }
+
+  /// Iterates over the initialized addresses. The order is only defined for the paged backends.
+  pub fn iter(&self) -> Box<dyn Iterator<Item = (u32, MemoryRecord)> + '_> {
+    match self {
+      GuestMemory::Map(map) => Box::new(map.iter().map(|(addr, record)| (*addr, *record))),
+      GuestMemory::Paged(paged) => Box::new(paged.iter().map(|(addr, record)| (addr, *record))),
+      GuestMemory::Compact(compact) => Box::new(
+        compact
+          .iter()
+          .map(|(addr, value)| (addr, value_record(*value))),
+      ),
+    }
+  }
+}
+
+impl Clone for GuestMemory {
+  fn clone(&self) -> Self {
+    match self {
+      GuestMemory::Map(map) => GuestMemory::Map(map.clone()),
+      GuestMemory::Paged(paged) => GuestMemory::Paged(paged.clone()),
+      GuestMemory::Compact(compact) => GuestMemory::Compact(compact.clone()),
+    }
+  }
+
+  /// Copies `source` into the existing allocations if both use the same backend.
+  fn clone_from(&mut self, source: &Self) {
+    match (self, source) {
+      (GuestMemory::Map(map), GuestMemory::Map(source)) => map.clone_from(source),
+      (GuestMemory::Paged(paged), GuestMemory::Paged(source)) => paged.clone_from(source),
+      (GuestMemory::Compact(compact), GuestMemory::Compact(source)) => compact.clone_from(source),
+      (this, source) => *this = source.clone(),
+    }
+  }
+}
+
+impl Default for GuestMemory {
+  fn default() -> Self {
+    Self::new(MemoryBackend::default())
+  }
+}
+
+#[cfg(test)]
+mod tests {
+  use super::*;
+
+  fn record(value: u32) -> MemoryRecord {
+    MemoryRecord {
+      value,
+      timestamp: 0,
+    }
+  }
+
+  #[test]
+  fn test_paged_registers_and_words_are_distinct_cells() {
+    let mut memory = PagedMemory::<MemoryRecord>::new();
+    // register x5 and the hint-style word at 0x1000 don't alias, nor do unaligned addresses.
+    memory.insert(5, record(1));
+    memory.insert(0x1000, record(2));
+    memory.insert(0x1001, record(3));
+    memory.insert(0xFFFF_FFFC, record(4));
+    assert_eq!(memory.get(5).unwrap().value, 1);
+    assert_eq!(memory.get(0x1000).unwrap().value, 2);
+    assert_eq!(memory.get(0x1001).unwrap().value, 3);
+    assert_eq!(memory.get(0xFFFF_FFFC).unwrap().value, 4);
+    assert!(memory.get(4).is_none());
+    assert!(memory.get(0x1004).is_none());
+    assert_eq!(memory.len(), 4);
+
+    let addrs: Vec<u32> = memory.iter().map(|(addr, _)| addr).collect();
+    assert_eq!(addrs, vec![5, 0x1000, 0xFFFF_FFFC, 0x1001]);
+
+    assert_eq!(memory.remove(0x1000).unwrap().value, 2);
+    assert!(memory.get(0x1000).is_none());
+    assert_eq!(memory.len(), 3);
+  }
+
+  #[test]
+  fn test_paged_clone_is_copy_on_write() {
+    let mut memory = PagedMemory::<MemoryRecord>::new();
+    memory.insert(0x2000, record(7));
+    let snapshot = memory.clone();
+    memory.get_mut(0x2000).unwrap().value = 8;
+    memory.insert(0x2004, record(9));
+    assert_eq!(snapshot.get(0x2000).unwrap().value, 7);
+    assert!(snapshot.get(0x2004).is_none());
+    assert_eq!(memory.get(0x2000).unwrap().value, 8);
+  }
+
+  #[test]
+  fn test_clone_from_and_clear() {
+    for backend in [MemoryBackend::Map, MemoryBackend::Paged] {
+      let mut snapshot = GuestMemory::new(backend);
+      snapshot.insert(0x5000, record(1));
+      let mut memory = GuestMemory::new(backend);
+      memory.insert(0x6000, record(2));
+
+      memory.clone_from(&snapshot);
+      assert_eq!(memory.len(), 1);
+      assert_eq!(memory.get(0x5000).unwrap().value, 1);
+      assert!(memory.get(0x6000).is_none());
+
+      // Writes after restoring don't reach the snapshot.
+      memory.get_mut(0x5000).unwrap().value = 3;
+      assert_eq!(snapshot.get(0x5000).unwrap().value, 1);
+
+      memory.clear();
+      assert!(memory.is_empty());
+      assert!(memory.get(0x5000).is_none());
+    }
+  }
+
+  #[test]
+  fn test_get_or_insert_with_only_initializes_once() {
+    for backend in [MemoryBackend::Map, MemoryBackend::Paged] {
+      let mut memory = GuestMemory::new(backend);
+      memory.get_or_insert_with(0x3000, || record(1)).timestamp = 4;
+      let record = memory.get_or_insert_with(0x3000, || unreachable!());
+      assert_eq!((record.value, record.timestamp), (1, 4));
+      assert_eq!(memory.len(), 1);
+    }
+  }
+
+  #[test]
+  fn test_update_values_spans_pages() {
+    let start = (PAGE_WORDS as u32 - 2) * 4;
+    for backend in [
+      MemoryBackend::Map,
+      MemoryBackend::Paged,
+      MemoryBackend::Compact,
+    ] {
+      let mut memory = GuestMemory::new(backend);
+      memory.insert(start + 4, record(7));
+      memory.update_values(start, 4, |i, value| *value += i as u32);
+      assert_eq!(memory.len(), 4);
+      let values: Vec<u32> = (0..4)
+        .map(|i| memory.get(start + i * 4).unwrap().value)
+        .collect();
+      assert_eq!(values, [0, 8, 2, 3]);
+    }
+  }
+
+  #[test]
+  fn test_size_after_write() {
+    for backend in [
+      MemoryBackend::Map,
+      MemoryBackend::Paged,
+      MemoryBackend::Compact,
+    ] {
+      let mut memory = GuestMemory::new(backend);
+      memory.insert(0x1000, record(1));
+      // 9 bytes from 0x1ffe span 3 words over two pages, the second one new.
+      let size = memory.size_after_write(0x1ffe, 9);
+      assert_eq!(memory.size_after_write(0x1000, 4), memory.size());
+      assert_eq!(memory.size_after_write(0x1000, 0), memory.size());
+      for addr in [0x1ffc, 0x2000, 0x2004] {
+        memory.insert(addr, record(0));
+      }
+      assert_eq!(size, memory.size(), "{backend:?}");
+    }
+  }
+
+  #[test]
+  fn test_fits_after_write() {
+    for backend in [
+      MemoryBackend::Map,
+      MemoryBackend::Paged,
+      MemoryBackend::Compact,
+    ] {
+      let mut memory = GuestMemory::new(backend);
+      for addr in (0x1000..0x1040).step_by(4) {
+        memory.insert(addr, record(1));
+      }
+      // Writes over memory in use, partly or entirely, and past it.
+      for (addr, len) in [
+        (0x1000, 0x40),
+        (0x1ffe, 9),
+        (0x1020, 0x100),
+        (0x1000, 0x10000),
+        (0x8000, 0x10000),
+      ] {
+        let size = memory.size_after_write(addr, len);
+        for limit in [0, size - 1, size, size + 1, usize::MAX] {
+          assert_eq!(
+            memory.fits_after_write(addr, len, limit),
+            size <= limit,
+            "{backend:?} {addr:#x} {len:#x} {limit}"
+          );
+        }
+      }
+    }
+  }
+
+  #[test]
+  fn test_size_after_write_counts_shared_pages() {
+    for backend in [MemoryBackend::Paged, MemoryBackend::Compact] {
+      let mut snapshot = GuestMemory::new(backend);
+      snapshot.insert(0x1000, record(1));
+      snapshot.insert(0x3000, record(1));
+      let mut memory = GuestMemory::new(backend);
+      memory.clone_from(&snapshot);
+      let page_size = memory.size() / 2;
+
+      // Writing to a page shared with the snapshot copies it.
+      let size = memory.size_after_write(0x1000, 4);
+      assert_eq!(size, 3 * page_size, "{backend:?}");
+      memory.update_values(0x1000, 1, |_, value| *value = 2);
+      assert_eq!(memory.size(), size, "{backend:?}");
+      assert_eq!(memory.size_after_write(0x1004, 4), size);
+
+      memory.insert(0x3000, record(2));
+      assert_eq!(memory.size(), 4 * page_size, "{backend:?}");
+      assert_eq!(snapshot.get(0x1000).unwrap().value, 1);
+      assert_eq!(snapshot.get(0x3000).unwrap().value, 1);
+    }
+  }
+
+  #[test]
+  fn test_compact_holds_values() {
+    let mut memory = GuestMemory::new(MemoryBackend::Compact);
+    memory.insert(0x7000, record(5));
+    *memory.value_or_insert_with(0x7004, || 6) += 1;
+    assert_eq!(memory.value(0x7004), Some(7));
+    let record = memory.get(0x7000).unwrap();
+    assert_eq!((record.value, record.timestamp), (5, 0));
+    assert_eq!(memory.size(), PagedMemory::<u32>::PAGE_SIZE);
+    assert_eq!(
+      PagedMemory::<u32>::PAGE_SIZE,
+      PAGE_WORDS * 4 + PAGE_WORDS / 8
+    );
+    assert_eq!(
+      PagedMemory::<MemoryRecord>::PAGE_SIZE,
+      PAGE_WORDS * 8 + PAGE_WORDS / 8
+    );
+
+    let snapshot = memory.clone();
+    memory.clear();
+    assert_eq!(memory.size(), 0);
+    memory.clone_from(&snapshot);
+    assert_eq!(memory.value(0x7000), Some(5));
+  }
+
+  #[test]
+  fn test_paged_serde_roundtrip() {
+    let mut memory = GuestMemory::new(MemoryBackend::Paged);
+    memory.insert(1, record(1));
+    memory.insert(0x4000, record(2));
+    let bytes = bincode::serialize(&memory).unwrap();
+    let decoded: GuestMemory = bincode::deserialize(&bytes).unwrap();
+    assert_eq!(decoded.backend(), MemoryBackend::Paged);
+    assert_eq!(decoded.len(), 2);
+    assert_eq!(decoded.get(0x4000).unwrap().value, 2);
+  }
+}
@@ -4,7 +4,7 @@ use serde::{Deserialize, Serialize};
 use super::Opcode;
 
 /// An instruction specifies an operation to execute and the operands.
-#[derive(Clone, Copy, Serialize, Deserialize)]
+#[derive(Clone, Copy, PartialEq, Eq, Serialize, Deserialize)]
 pub struct Instruction {
     pub opcode: Opcode,
     pub op_a: u32,
@@ -91,6 +91,14 @@ impl Instruction {
     pub const fn is_jump_instruction(&self) -> bool {
         matches!(self.opcode, Opcode::JAL | Opcode::JALR)
     }
+
+    /// Returns if the instruction may continue anywhere other than the next instruction, and
+    /// thus ends a basic block.
+    pub const fn is_block_terminator(&self) -> bool {
+        self.is_branch_instruction()
+            || self.is_jump_instruction()
+            || matches!(self.opcode, Opcode::ECALL | Opcode::EBREAK | Opcode::UNIMP)
+    }
 }
 
 impl Debug for Instruction {
@@ -0,0 +1,218 @@
+use std::collections::VecDeque;
+
+use athena_interface::{LogRecord, LogStream};
+use serde::{Deserialize, Serialize};
+
+/// The size of the header preceding the data of each record: the stream, the clock and the
+/// length of the data.
+const HEADER_LEN: usize = 1 + 8 + 4;
+
+/// Selects where the guest's standard output, standard error and cycle-tracker markers go.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub enum GuestLogMode {
+  /// Print lines to the standard output of the process as they are completed, and time
+  /// cycle-tracked regions in the log. Meant for development.
+  #[default]
+  Print,
+
+  /// Keep the most recent output in a [GuestLog] holding at most the given number of bytes,
+  /// see [super::Runtime::flush_log].
+  Buffer(usize),
+
+  /// Discard the output.
+  Off,
+}
+
+/// A bounded buffer of the log output of an execution.
+///
+/// The buffer is allocated once, with its full capacity, and reused across executions. When it
+/// is full, the oldest records are dropped to make room for new ones.
+#[derive(Debug, Clone, Default, Serialize, Deserialize)]
+pub struct GuestLog {
+  /// The records, oldest first, each a header followed by its data.
+  data: VecDeque<u8>,
+  capacity: usize,
+  dropped: u64,
+  /// The number of bytes appended since the log was cleared, see [GuestLog::mark].
+  appended: u64,
+}
+
+impl GuestLog {
+  pub fn new(capacity: usize) -> Self {
+    Self {
+      data: VecDeque::with_capacity(capacity),
+      capacity,
+      dropped: 0,
+      appended: 0,
+    }
+  }
+
+  /// The maximum number of bytes held, counting a header of a few bytes per record.
+  pub fn capacity(&self) -> usize {
+    self.capacity
+  }
+
+  /// Clears the log and sets its capacity, allocating only if it grows.
+  pub fn reset(&mut self, capacity: usize) {
+    self.clear();
+    self.capacity = capacity;
+    self.data.reserve(capacity);
+  }
+
+  pub fn clear(&mut self) {
+    self.data.clear();
+    self.dropped = 0;
+    self.appended = 0;
+  }
+
+  pub fn is_empty(&self) -> bool {
+    self.data.is_empty()
+  }
+
+  /// The number of records dropped to make room for newer ones, or because they didn't fit.
+  pub fn dropped(&self) -> u64 {
+    self.dropped
+  }
+
+  /// Appends a record of the `len` bytes of `data`, truncated to fit in the log, dropping the
+  /// oldest records as needed.
+  pub fn push(&mut self, stream: LogStream, clk: u64, len: usize, data: impl Iterator<Item = u8>) {
+    let Some(max_len) = self.capacity.checked_sub(HEADER_LEN) else {
+      self.dropped += 1;
+      return;
+    };
+    let len = len.min(max_len);
+    while self.data.len() + HEADER_LEN + len > self.capacity {
+      let record_len = HEADER_LEN + self.front_record_len();
+      self.data.drain(..record_len);
+      self.dropped += 1;
+    }
+    self.data.push_back(stream as u8);
+    self.data.extend(clk.to_le_bytes());
+    self.data.extend((len as u32).to_le_bytes());
+    self.data.extend(data.take(len));
+    self.appended += (HEADER_LEN + len) as u64;
+  }
+
+  /// Marks the end of the log, to truncate it back to with [GuestLog::truncate].
+  pub fn mark(&self) -> u64 {
+    self.appended
+  }
+
+  /// Drops the records appended since `mark` was taken. Records dropped meanwhile to make room
+  /// for them aren't brought back.
+  pub fn truncate(&mut self, mark: u64) {
+    let len = (self.appended - mark).min(self.data.len() as u64);
+    self.data.truncate(self.data.len() - len as usize);
+    self.appended = mark;
+  }
+
+  /// Iterates over the records, oldest first.
+  pub fn records(&mut self) -> impl Iterator<Item = LogRecord<'_>> {
+    let mut data: &[u8] = self.data.make_contiguous();
+    std::iter::from_fn(move || {
+      let (header, rest) = data.split_first_chunk::<HEADER_LEN>()?;
+      let len = u32::from_le_bytes(header[9..].try_into().unwrap()) as usize;
+      let (record, rest) = rest.split_at(len);
+      data = rest;
+      Some(LogRecord {
+        stream: LogStream::from_u8(header[0]).unwrap(),
+        clk: u64::from_le_bytes(header[1..9].try_into().unwrap()),
+        data: record,
+      })
+    })
+  }
+
+  /// The length of the data of the oldest record.
+  fn front_record_len(&self) -> usize {
+    let len: [u8; 4] = std::array::from_fn(|i| self.data[9 + i]);
+    u32::from_le_bytes(len) as usize
+  }
+}
+
+#[cfg(test)]
+mod tests {
+  use super::*;
+
+  fn push(log: &mut GuestLog, stream: LogStream, clk: u64, data: &[u8]) {
+    log.push(stream, clk, data.len(), data.iter().copied());
+  }
+
+  fn records(log: &mut GuestLog) -> Vec<(LogStream, u64, Vec<u8>)> {
+    log
+      .records()
+      .map(|record| (record.stream, record.clk, record.data.to_vec()))
+      .collect()
+  }
+
+  #[test]
+  fn test_records_roundtrip() {
+    let mut log = GuestLog::new(256);
+    push(&mut log, LogStream::Stdout, 1, b"hello\n");
+    push(&mut log, LogStream::CycleTrackerStart, 7, b"loop");
+    push(&mut log, LogStream::Stderr, 9, b"");
+    assert_eq!(
+      records(&mut log),
+      [
+        (LogStream::Stdout, 1, b"hello\n".to_vec()),
+        (LogStream::CycleTrackerStart, 7, b"loop".to_vec()),
+        (LogStream::Stderr, 9, vec![]),
+      ]
+    );
+    assert_eq!(log.dropped(), 0);
+  }
+
+  #[test]
+  fn test_full_log_drops_oldest_records() {
+    let mut log = GuestLog::new(3 * (HEADER_LEN + 4));
+    for clk in 0..5u64 {
+      push(
+        &mut log,
+        LogStream::Stdout,
+        clk,
+        &(clk as u32).to_le_bytes(),
+      );
+    }
+    let clks: Vec<u64> = records(&mut log).iter().map(|record| record.1).collect();
+    assert_eq!(clks, [2, 3, 4]);
+    assert_eq!(log.dropped(), 2);
+
+    // Records larger than the log are truncated.
+    push(&mut log, LogStream::Stderr, 5, &[1; 100]);
+    let records = records(&mut log);
+    assert_eq!(records.len(), 1);
+    assert_eq!(records[0].2.len(), log.capacity() - HEADER_LEN);
+
+    // Nothing fits in a log smaller than a header.
+    log.reset(HEADER_LEN - 1);
+    assert!(log.is_empty());
+    push(&mut log, LogStream::Stdout, 0, b"dropped");
+    assert!(log.is_empty());
+    assert_eq!(log.dropped(), 1);
+  }
+
+  #[test]
+  fn test_truncate_to_mark() {
+    let mut log = GuestLog::new(3 * (HEADER_LEN + 4));
+    push(&mut log, LogStream::Stdout, 0, b"keep");
+    let mark = log.mark();
+    push(&mut log, LogStream::Stdout, 1, b"drop");
+    log.truncate(mark);
+    assert_eq!(
+      records(&mut log),
+      [(LogStream::Stdout, 0, b"keep".to_vec())]
+    );
+
+    // Records pushed out of a full log since the mark stay dropped.
+    for clk in 1..5 {
+      push(&mut log, LogStream::Stdout, clk, b"drop");
+    }
+    log.truncate(mark);
+    assert!(log.is_empty());
+    push(&mut log, LogStream::Stdout, 5, b"next");
+    assert_eq!(
+      records(&mut log),
+      [(LogStream::Stdout, 5, b"next".to_vec())]
+    );
+  }
+}
@@ -80,6 +80,16 @@ impl MemoryReadRecord {
             _private: (),
         }
     }
+
+    /// Creates a record holding only the value, for executions which don't track timestamps.
+    pub const fn untimed(value: u32) -> Self {
+        Self {
+            value,
+            timestamp: 0,
+            prev_timestamp: 0,
+            _private: (),
+        }
+    }
 }
 
 impl MemoryWriteRecord {
@@ -98,4 +108,15 @@ impl MemoryWriteRecord {
             _private: (),
         }
     }
+
+    /// Creates a record holding only the value, for executions which don't track timestamps.
+    pub const fn untimed(value: u32) -> Self {
+        Self {
+            value,
+            timestamp: 0,
+            prev_value: 0,
+            prev_timestamp: 0,
+            _private: (),
+        }
+    }
 }
@@ -0,0 +1,222 @@
+use std::sync::Arc;
+
+use serde::{Deserialize, Serialize};
+
+use super::GuestMemory;
+
+/// A contiguous range of initialized memory.
+#[derive(Debug, Clone, PartialEq, Eq, Serialize, Deserialize)]
+pub struct MemorySegment {
+  /// The word-aligned address of the first byte.
+  pub base: u32,
+  /// The bytes of the segment, a whole number of words. Shared by every clone of the image.
+  pub data: Arc<[u8]>,
+}
+
+impl MemorySegment {
+  /// The address one past the last byte of the segment.
+  pub fn end(&self) -> u64 {
+    self.base as u64 + self.data.len() as u64
+  }
+
+  /// Iterates over the address and value of each word of the segment.
+  pub fn words(&self) -> impl Iterator<Item = (u32, u32)> + '_ {
+    self.data.chunks_exact(4).enumerate().map(|(i, word)| {
+      (
+        self.base + 4 * i as u32,
+        u32::from_le_bytes(word.try_into().unwrap()),
+      )
+    })
+  }
+}
+
+/// The initial memory of a program, held as a few contiguous segments (typically one per ELF
+/// segment) rather than per word.
+///
+/// Segments are sorted by address and never overlap. Their bytes are reference counted, so
+/// cloning a program shares its image with every runtime executing it.
+#[derive(Debug, Clone, Default, PartialEq, Eq, Serialize, Deserialize)]
+pub struct MemoryImage {
+  segments: Vec<MemorySegment>,
+}
+
+impl MemoryImage {
+  pub const fn new() -> Self {
+    Self {
+      segments: Vec::new(),
+    }
+  }
+
+  /// The segments, in increasing address order.
+  pub fn segments(&self) -> &[MemorySegment] {
+    &self.segments
+  }
+
+  /// The number of initialized words.
+  pub fn len(&self) -> usize {
+    self.segments.iter().map(|s| s.data.len() / 4).sum()
+  }
+
+  pub fn is_empty(&self) -> bool {
+    self.segments.is_empty()
+  }
+
+  /// Returns the word at the word-aligned `addr`, if it is initialized.
+  pub fn get(&self, addr: u32) -> Option<u32> {
+    let idx = self.segments.partition_point(|s| s.end() <= addr as u64);
+    let segment = self.segments.get(idx).filter(|s| s.base <= addr)?;
+    let offset = (addr - segment.base) as usize;
+    Some(u32::from_le_bytes(
+      segment.data[offset..offset + 4].try_into().unwrap(),
+    ))
+  }
+
+  /// Iterates over the address and value of each initialized word, in address order.
+  pub fn words(&self) -> impl Iterator<Item = (u32, u32)> + '_ {
+    self.segments.iter().flat_map(MemorySegment::words)
+  }
+
+  /// Sets the word at the word-aligned `addr`.
+  pub fn insert(&mut self, addr: u32, value: u32) {
+    self.insert_bytes(addr, &value.to_le_bytes());
+  }
+
+  /// Initializes memory from the word-aligned `addr` with `bytes`, padded with zeros to a whole
+  /// number of words. Words already initialized are overwritten.
+  pub fn insert_bytes(&mut self, addr: u32, bytes: &[u8]) {
+    assert_eq!(addr % 4, 0, "segment address {addr:08x} is unaligned");
+    let len = bytes.len().next_multiple_of(4);
+    let end = addr as u64 + len as u64;
+    assert!(
+      end <= 1 << 32,
+      "segment at {addr:08x} exceeds the address space"
+    );
+    if len == 0 {
+      return;
+    }
+
+    // Overlapping segments are merged into the new one.
+    let first = self.segments.partition_point(|s| s.end() <= addr as u64);
+    let last = self.segments[first..].partition_point(|s| (s.base as u64) < end) + first;
+    let merged = &self.segments[first..last];
+    let base = merged.first().map_or(addr, |s| s.base.min(addr));
+    let merged_end = merged.last().map_or(end, |s| s.end().max(end));
+    let mut data = vec![0; (merged_end - base as u64) as usize];
+    for segment in merged {
+      let offset = (segment.base - base) as usize;
+      data[offset..offset + segment.data.len()].copy_from_slice(&segment.data);
+    }
+    let offset = (addr - base) as usize;
+    data[offset..offset + bytes.len()].copy_from_slice(bytes);
+    data[offset + bytes.len()..offset + len].fill(0);
+
+    self.segments.splice(
+      first..last,
+      [MemorySegment {
+        base,
+        data: data.into(),
+      }],
+    );
+  }
+
+  /// Adds a segment without copying its bytes. It must not overlap the existing segments.
+  pub fn push_segment(&mut self, base: u32, data: Arc<[u8]>) {
+    assert_eq!(base % 4, 0, "segment address {base:08x} is unaligned");
+    assert_eq!(
+      data.len() % 4,
+      0,
+      "segment at {base:08x} isn't a whole number of words"
+    );
+    let segment = MemorySegment { base, data };
+    assert!(
+      segment.end() <= 1 << 32,
+      "segment at {base:08x} exceeds the address space"
+    );
+    let idx = self.segments.partition_point(|s| s.end() <= base as u64);
+    if let Some(next) = self.segments.get(idx) {
+      assert!(
+        segment.end() <= next.base as u64,
+        "segment at {base:08x} overlaps"
+      );
+    }
+    if !segment.data.is_empty() {
+      self.segments.insert(idx, segment);
+    }
+  }
+
+  /// Initializes `memory` with the image, a segment at a time.
+  pub fn load_into(&self, memory: &mut GuestMemory) {
+    for segment in &self.segments {
+      let words = segment.data.len() / 4;
+      let data = &segment.data;
+      memory.update_values(segment.base, words, |i, value| {
+        *value = u32::from_le_bytes(data[4 * i..4 * i + 4].try_into().unwrap());
+      });
+    }
+  }
+}
+
+#[cfg(test)]
+mod tests {
+  use super::*;
+  use crate::runtime::MemoryBackend;
+
+  #[test]
+  fn test_insert_merges_overlapping_segments() {
+    let mut image = MemoryImage::new();
+    image.insert(0x1000, 1);
+    image.insert(0x1008, 3);
+    image.insert(0x2000, 5);
+    assert_eq!(image.segments().len(), 3);
+
+    // Overlaps the word at 0x1008, and is only adjacent to the one at 0x1000.
+    image.insert_bytes(0x1004, &[2, 0, 0, 0, 9, 0]);
+    assert_eq!(image.segments().len(), 3);
+    assert_eq!(image.segments()[1].base, 0x1004);
+    assert_eq!(
+      image.words().collect::<Vec<_>>(),
+      [(0x1000, 1), (0x1004, 2), (0x1008, 9), (0x2000, 5)]
+    );
+    assert_eq!(image.get(0x1008), Some(9));
+    assert_eq!(image.get(0x100c), None);
+    assert_eq!(image.get(0xffc), None);
+    assert_eq!(image.len(), 4);
+  }
+
+  #[test]
+  fn test_clones_share_segments() {
+    let mut image = MemoryImage::new();
+    image.push_segment(0x1000, vec![0xab; 4096].into());
+    let clone = image.clone();
+    assert!(Arc::ptr_eq(
+      &image.segments()[0].data,
+      &clone.segments()[0].data
+    ));
+    // Writing to the image replaces the segment rather than modifying the shared one.
+    image.insert(0x1000, 0);
+    assert_eq!(image.get(0x1000), Some(0));
+    assert_eq!(clone.get(0x1000), Some(0xabab_abab));
+  }
+
+  #[test]
+  #[should_panic(expected = "overlaps")]
+  fn test_push_overlapping_segment() {
+    let mut image = MemoryImage::new();
+    image.push_segment(0x1000, vec![0; 8].into());
+    image.push_segment(0xffc, vec![0; 8].into());
+  }
+
+  #[test]
+  fn test_load_into() {
+    let mut image = MemoryImage::new();
+    image.insert_bytes(0x4000, &[1, 0, 0, 0, 2, 0, 0, 0]);
+    image.insert(8, 3);
+    for backend in [MemoryBackend::Map, MemoryBackend::Paged] {
+      let mut memory = GuestMemory::new(backend);
+      image.load_into(&mut memory);
+      assert_eq!(memory.len(), 3);
+      assert_eq!(memory.get(0x4004).unwrap().value, 2);
+      assert_eq!(memory.get(8).unwrap().value, 3);
+    }
+  }
+}
@@ -1,36 +1,50 @@
+mod artifact;
+mod guest_memory;
 mod instruction;
 mod io;
+mod log;
 mod memory;
+mod memory_image;
 mod opcode;
+mod pool;
 mod program;
 mod register;
+mod slice;
 mod state;
+#[cfg(feature = "stats")]
+mod stats;
 mod syscall;
+mod trace;
 #[macro_use]
 mod utils;
 
+pub use artifact::*;
+pub use guest_memory::*;
 pub use instruction::*;
+pub use log::*;
 pub use memory::*;
+pub use memory_image::*;
 pub use opcode::*;
+pub use pool::*;
 pub use program::*;
 pub use register::*;
+pub use slice::*;
 pub use state::*;
+#[cfg(feature = "stats")]
+pub use stats::*;
 pub use syscall::*;
+pub use trace::*;
 pub use utils::*;
 
 use std::cell::RefCell;
-use std::collections::hash_map::Entry;
 use std::collections::HashMap;
-use std::fs::File;
-use std::io::BufWriter;
-use std::io::Write;
-use std::sync::Arc;
+use std::sync::{Arc, OnceLock};
 
 use thiserror::Error;
 
 use crate::utils::AthenaCoreOpts;
 
-use athena_interface::{HostInterface, HostProvider};
+use athena_interface::{ExecutionMetrics, HostInterface, HostProvider};
 
 /// An implementation of a runtime for the Athena RISC-V VM.
 ///
@@ -52,11 +66,14 @@ pub struct Runtime<T: HostInterface> {
   /// A counter for the number of cycles that have been executed in certain functions.
   pub cycle_tracker: HashMap<String, (u64, u32)>,
 
-  /// A buffer for stdout and stderr IO.
+  /// A buffer for stdout and stderr IO, with [GuestLogMode::Print].
   pub io_buf: HashMap<u32, String>,
 
-  /// A buffer for writing trace events to a file.
-  pub trace_buf: Option<BufWriter<File>>,
+  /// Where the guest's log output goes.
+  pub guest_log: GuestLogMode,
+
+  /// The writer of the execution trace, see [TraceConfig::from_env].
+  pub trace: Option<TraceWriter>,
 
   /// Whether the runtime is in constrained mode or not.
   ///
@@ -66,11 +83,34 @@ pub struct Runtime<T: HostInterface> {
 
   pub(crate) unconstrained_state: ForkState,
 
-  pub syscall_map: HashMap<SyscallCode, Arc<dyn Syscall<T>>>,
+  /// The custom syscalls added with [Runtime::register_syscall], which take precedence over the
+  /// built-in ones with the same syscall id. Runtimes without custom syscalls have none, and
+  /// only use the built-in syscalls shared by every runtime.
+  pub custom_syscalls: Option<Arc<SyscallTable<T>>>,
 
   pub max_syscall_cycles: u32,
 
   pub emit_events: bool,
+
+  /// The gas left for execution, or `None` if execution isn't metered.
+  ///
+  /// Every instruction costs 1 gas, and a syscall additionally costs its
+  /// [Syscall::num_extra_cycles] and the cycles it charges with
+  /// [SyscallContext::charge_cycles].
+  pub gas_left: Option<u64>,
+
+  /// The maximum size of guest memory in bytes, see [GuestMemory::size]. Memory is checked
+  /// after every basic block, so it may exceed the limit by the pages touched by the
+  /// instructions of one block. Syscalls writing ranges of memory check it before writing.
+  pub memory_limit: Option<usize>,
+
+  /// The measured cost of the execution so far, see [Runtime::metrics]. Unlike
+  /// [Runtime::take_stats], it's always kept, as it only takes a few additions per block.
+  metrics: ExecutionMetrics,
+
+  /// The counters of the execution, see [Runtime::take_stats].
+  #[cfg(feature = "stats")]
+  pub stats: ExecutionStats,
 }
 
 #[derive(Error, Debug)]
@@ -85,6 +125,18 @@ pub enum ExecutionError {
   Breakpoint(),
   #[error("got unimplemented as opcode")]
   Unimplemented(),
+  #[error("out of gas")]
+  OutOfGas(),
+  #[error("out of memory")]
+  OutOfMemory(),
+  #[error("invalid hint read: {0}")]
+  InvalidHintRead(&'static str),
+  #[error("invalid memory operation: {0}")]
+  InvalidMemoryOperation(&'static str),
+  #[error("invalid storage batch: {0}")]
+  InvalidStorageBatch(&'static str),
+  #[error("no host to serve the syscall")]
+  MissingHost(),
 }
 
 impl<T> Runtime<T>
@@ -92,42 +144,56 @@ where
   T: HostInterface,
 {
   // Create a new runtime from a program and, optionally, a host.
+  //
+  // The program may be passed already shared (e.g. from a cache of decoded programs).
   pub fn new(
-    program: Program,
+    program: impl Into<Arc<Program>>,
     host: Option<Arc<RefCell<HostProvider<T>>>>,
-    _opts: AthenaCoreOpts,
+    opts: AthenaCoreOpts,
   ) -> Self {
     // Create a shared reference to the program and host.
-    let program = Arc::new(program);
-
-    // If TRACE_FILE is set, initialize the trace buffer.
-    let trace_buf = if let Ok(trace_file) = std::env::var("TRACE_FILE") {
-      let file = File::create(trace_file).unwrap();
-      Some(BufWriter::new(file))
-    } else {
-      None
-    };
+    let program: Arc<Program> = program.into();
+    let state = ExecutionState::with_memory_backend(program.pc_start, opts.memory_backend);
+    Self::with_state(program, host, opts, state)
+  }
 
-    // Determine the maximum number of cycles for any syscall.
-    let syscall_map = default_syscall_map();
-    let max_syscall_cycles = syscall_map
-      .values()
-      .map(|syscall| syscall.num_extra_cycles())
-      .max()
-      .unwrap_or(0);
+  /// Creates a new runtime executing `program` from `state`, which must be ready to start at
+  /// the program's entrypoint.
+  pub(crate) fn with_state(
+    program: Arc<Program>,
+    host: Option<Arc<RefCell<HostProvider<T>>>>,
+    opts: AthenaCoreOpts,
+    mut state: ExecutionState,
+  ) -> Self {
+    // If TRACE_FILE is set, start the trace writer. The variables are only read once per process.
+    static TRACE_CONFIG: OnceLock<Option<TraceConfig>> = OnceLock::new();
+    let trace = TRACE_CONFIG
+      .get_or_init(TraceConfig::from_env)
+      .as_ref()
+      .map(|config| TraceWriter::create(config.clone()).expect("failed to create trace file"));
+
+    if let GuestLogMode::Buffer(capacity) = opts.guest_log {
+      state.log.reset(capacity);
+    }
 
     Self {
-      state: ExecutionState::new(program.pc_start),
+      state,
       program,
       host,
       cycle_tracker: HashMap::new(),
       io_buf: HashMap::new(),
-      trace_buf,
+      guest_log: opts.guest_log,
+      trace,
       unconstrained: false,
       unconstrained_state: ForkState::default(),
-      syscall_map,
+      custom_syscalls: None,
       emit_events: true,
-      max_syscall_cycles,
+      max_syscall_cycles: SyscallCode::MAX_EXTRA_CYCLES,
+      gas_left: opts.gas_limit,
+      memory_limit: opts.memory_limit,
+      metrics: ExecutionMetrics::default(),
+      #[cfg(feature = "stats")]
+      stats: ExecutionStats::default(),
     }
   }
 
@@ -143,10 +209,7 @@ where
     let mut registers = [0; 32];
     for i in 0..32 {
       let addr = Register::from_u32(i as u32) as u32;
-      registers[i] = match self.state.memory.get(&addr) {
-        Some(record) => record.value,
-        None => 0,
-      };
+      registers[i] = self.state.memory.value(addr).unwrap_or(0);
     }
     registers
   }
@@ -154,18 +217,13 @@ where
   /// Get the current value of a register.
   pub fn register(&self, register: Register) -> u32 {
     let addr = register as u32;
-    match self.state.memory.get(&addr) {
-      Some(record) => record.value,
-      None => 0,
-    }
+    self.state.memory.value(addr).unwrap_or(0)
   }
 
-  /// Get the current value of a word.
+  /// Get the current value of a word, which is its hinted value if it was hinted but not
+  /// accessed yet.
   pub fn word(&self, addr: u32) -> u32 {
-    match self.state.memory.get(&addr) {
-      Some(record) => record.value,
-      None => 0,
-    }
+    self.state.read_word(addr)
   }
 
   /// Get the current value of a byte.
@@ -174,6 +232,24 @@ where
     (word >> ((addr % 4) * 8)) as u8
   }
 
+  /// Takes a checkpoint of the execution, e.g. before a call which may revert. See [Checkpoint]
+  /// for its cost with each memory backend.
+  pub fn checkpoint(&mut self) -> Checkpoint {
+    self.state.checkpoint()
+  }
+
+  /// Rolls the execution back to `checkpoint`. The gas used since isn't refunded.
+  pub fn restore(&mut self, checkpoint: Checkpoint) {
+    #[cfg(feature = "stats")]
+    self.record_memory_use();
+    self.state.restore(checkpoint);
+  }
+
+  /// Discards `checkpoint`, keeping the changes made since.
+  pub fn commit(&mut self, checkpoint: Checkpoint) {
+    self.state.commit(checkpoint);
+  }
+
   /// Get the current timestamp for a given memory access position.
   pub const fn timestamp(&self, position: &MemoryAccessPosition) -> u32 {
     self.state.clk + *position as u32
@@ -181,36 +257,28 @@ where
 
   /// Read a word from memory and create an access record.
   pub fn mr(&mut self, addr: u32, timestamp: u32) -> MemoryReadRecord {
-    // Get the memory record entry.
-    let entry = self.state.memory.entry(addr);
-
     // If we're in unconstrained mode, we don't want to modify state, so we'll save the
     // original state if it's the first time modifying it.
     if self.unconstrained {
-      let record = match entry {
-        Entry::Occupied(ref entry) => Some(entry.get()),
-        Entry::Vacant(_) => None,
-      };
+      let record = self.state.memory.get(addr);
       self
         .unconstrained_state
         .memory_diff
         .entry(addr)
-        .or_insert(record.copied());
+        .or_insert(record);
     }
 
     // If it's the first time accessing this address, initialize previous values.
-    let record: &mut MemoryRecord = match entry {
-      Entry::Occupied(entry) => entry.into_mut(),
-      Entry::Vacant(entry) => {
-        // If addr has a specific value to be initialized with, use that, otherwise 0.
-        let value = self.state.uninitialized_memory.remove(&addr).unwrap_or(0);
-
-        entry.insert(MemoryRecord {
-          value,
-          timestamp: 0,
-        })
+    let uninitialized_memory = &mut self.state.uninitialized_memory;
+    let record = self.state.memory.get_or_insert_with(addr, || {
+      // If addr has a specific value to be initialized with, use that, otherwise 0.
+      let value = uninitialized_memory.remove(&addr).unwrap_or(0);
+
+      MemoryRecord {
+        value,
+        timestamp: 0,
       }
-    };
+    });
     let value = record.value;
     let prev_timestamp = record.timestamp;
     record.timestamp = timestamp;
@@ -221,36 +289,28 @@ where
 
   /// Write a word to memory and create an access record.
   pub fn mw(&mut self, addr: u32, value: u32, timestamp: u32) -> MemoryWriteRecord {
-    // Get the memory record entry.
-    let entry = self.state.memory.entry(addr);
-
     // If we're in unconstrained mode, we don't want to modify state, so we'll save the
     // original state if it's the first time modifying it.
     if self.unconstrained {
-      let record = match entry {
-        Entry::Occupied(ref entry) => Some(entry.get()),
-        Entry::Vacant(_) => None,
-      };
+      let record = self.state.memory.get(addr);
       self
         .unconstrained_state
         .memory_diff
         .entry(addr)
-        .or_insert(record.copied());
+        .or_insert(record);
     }
 
     // If it's the first time accessing this address, initialize previous values.
-    let record: &mut MemoryRecord = match entry {
-      Entry::Occupied(entry) => entry.into_mut(),
-      Entry::Vacant(entry) => {
-        // If addr has a specific value to be initialized with, use that, otherwise 0.
-        let value = self.state.uninitialized_memory.remove(&addr).unwrap_or(0);
-
-        entry.insert(MemoryRecord {
-          value,
-          timestamp: 0,
-        })
+    let uninitialized_memory = &mut self.state.uninitialized_memory;
+    let record = self.state.memory.get_or_insert_with(addr, || {
+      // If addr has a specific value to be initialized with, use that, otherwise 0.
+      let value = uninitialized_memory.remove(&addr).unwrap_or(0);
+
+      MemoryRecord {
+        value,
+        timestamp: 0,
       }
-    };
+    });
     let prev_value = record.value;
     let prev_timestamp = record.timestamp;
     record.value = value;
@@ -297,16 +357,120 @@ where
     }
   }
 
+  /// Read a word from memory without creating an access record or updating its timestamp.
+  #[inline]
+  pub fn mr_fast(&mut self, addr: u32) -> u32 {
+    self.state.read_word(addr)
+  }
+
+  /// Write a word to memory without creating an access record or updating its timestamp.
+  #[inline]
+  pub fn mw_fast(&mut self, addr: u32, value: u32) {
+    self.state.write_word(addr, value)
+  }
+
+  /// Charges `gas` if execution is metered, failing if there isn't enough gas left.
+  #[inline(always)]
+  pub(crate) fn charge_gas(&mut self, gas: u64) -> Result<(), ExecutionError> {
+    if let Some(gas_left) = self.gas_left.as_mut() {
+      if *gas_left < gas {
+        *gas_left = 0;
+        return Err(ExecutionError::OutOfGas());
+      }
+      *gas_left -= gas;
+    }
+    Ok(())
+  }
+
+  /// Records the size of guest memory, and fails if it has grown past [Runtime::memory_limit].
+  #[inline(always)]
+  fn check_memory_limit(&mut self) -> Result<(), ExecutionError> {
+    let size = self.state.memory.size();
+    self.metrics.peak_memory = self.metrics.peak_memory.max(size as u64);
+    match self.memory_limit {
+      Some(limit) if size > limit => Err(ExecutionError::OutOfMemory()),
+      _ => Ok(()),
+    }
+  }
+
+  /// Fails if writing the `len` bytes from `addr` would grow guest memory past
+  /// [Runtime::memory_limit], for syscalls which write more than a block's instructions can.
+  pub(crate) fn check_memory_write(&self, addr: u32, len: u32) -> Result<(), ExecutionError> {
+    match self.memory_limit {
+      Some(limit) if !self.state.memory.fits_after_write(addr, len, limit) => {
+        Err(ExecutionError::OutOfMemory())
+      }
+      _ => Ok(()),
+    }
+  }
+
+  /// Read from a register, only creating an access record if `TRACED`.
+  #[inline(always)]
+  fn read_register<const TRACED: bool>(
+    &mut self,
+    register: Register,
+    position: MemoryAccessPosition,
+  ) -> u32 {
+    if TRACED {
+      self.rr(register, position)
+    } else {
+      self.mr_fast(register as u32)
+    }
+  }
+
+  /// Write to a register, only creating an access record if `TRACED`.
+  #[inline(always)]
+  fn write_register<const TRACED: bool>(&mut self, register: Register, value: u32) {
+    if TRACED {
+      self.rw(register, value)
+    } else if register == Register::X0 {
+      self.mw_fast(register as u32, 0);
+    } else {
+      self.mw_fast(register as u32, value);
+    }
+  }
+
+  /// Read from memory, only creating an access record if `TRACED`.
+  #[inline(always)]
+  fn read_memory<const TRACED: bool>(&mut self, addr: u32, position: MemoryAccessPosition) -> u32 {
+    if TRACED {
+      self.mr_cpu(addr, position)
+    } else {
+      assert_valid_memory_access!(addr, position);
+      self.mr_fast(addr)
+    }
+  }
+
+  /// Write to memory, only creating an access record if `TRACED`.
+  #[inline(always)]
+  fn write_memory<const TRACED: bool>(
+    &mut self,
+    addr: u32,
+    value: u32,
+    position: MemoryAccessPosition,
+  ) {
+    if TRACED {
+      self.mw_cpu(addr, value, position)
+    } else {
+      assert_valid_memory_access!(addr, position);
+      self.mw_fast(addr, value);
+    }
+  }
+
   /// Fetch the destination register and input operand values for an ALU instruction.
-  fn alu_rr(&mut self, instruction: Instruction) -> (Register, u32, u32) {
+  fn alu_rr<const TRACED: bool>(&mut self, instruction: Instruction) -> (Register, u32, u32) {
     if !instruction.imm_c {
       let (rd, rs1, rs2) = instruction.r_type();
-      let c = self.rr(rs2, MemoryAccessPosition::C);
-      let b = self.rr(rs1, MemoryAccessPosition::B);
+      let c = self.read_register::<TRACED>(rs2, MemoryAccessPosition::C);
+      let b = self.read_register::<TRACED>(rs1, MemoryAccessPosition::B);
       (rd, b, c)
     } else if !instruction.imm_b && instruction.imm_c {
       let (rd, rs1, imm) = instruction.i_type();
-      let (rd, b, c) = (rd, self.rr(rs1, MemoryAccessPosition::B), imm);
+      let (rd, b, c) = (
+        rd,
+        self.read_register::<TRACED>(rs1, MemoryAccessPosition::B),
+        imm,
+      );
       (rd, b, c)
     } else {
       assert!(instruction.imm_b && instruction.imm_c);
@@ -320,47 +484,63 @@ where
   }
 
   /// Set the destination register with the result and emit an ALU event.
-  fn alu_rw(&mut self, _instruction: Instruction, rd: Register, a: u32, _b: u32, _c: u32) {
-    self.rw(rd, a);
+  fn alu_rw<const TRACED: bool>(
+    &mut self,
+    _instruction: Instruction,
+    rd: Register,
+    a: u32,
+    _b: u32,
+    _c: u32,
+  ) {
+    self.write_register::<TRACED>(rd, a);
   }
 
   /// Fetch the input operand values for a load instruction.
-  fn load_rr(&mut self, instruction: Instruction) -> (Register, u32, u32, u32, u32) {
+  fn load_rr<const TRACED: bool>(
+    &mut self,
+    instruction: Instruction,
+  ) -> (Register, u32, u32, u32, u32) {
     let (rd, rs1, imm) = instruction.i_type();
-    let (b, c) = (self.rr(rs1, MemoryAccessPosition::B), imm);
+    let (b, c) = (
+      self.read_register::<TRACED>(rs1, MemoryAccessPosition::B),
+      imm,
+    );
     let addr = b.wrapping_add(c);
-    let memory_value = self.mr_cpu(align(addr), MemoryAccessPosition::Memory);
+    let memory_value = self.read_memory::<TRACED>(align(addr), MemoryAccessPosition::Memory);
     (rd, b, c, addr, memory_value)
   }
 
   /// Fetch the input operand values for a store instruction.
-  fn store_rr(&mut self, instruction: Instruction) -> (u32, u32, u32, u32, u32) {
+  fn store_rr<const TRACED: bool>(
+    &mut self,
+    instruction: Instruction,
+  ) -> (u32, u32, u32, u32, u32) {
     let (rs1, rs2, imm) = instruction.s_type();
     let c = imm;
-    let b = self.rr(rs2, MemoryAccessPosition::B);
-    let a = self.rr(rs1, MemoryAccessPosition::A);
+    let b = self.read_register::<TRACED>(rs2, MemoryAccessPosition::B);
+    let a = self.read_register::<TRACED>(rs1, MemoryAccessPosition::A);
     let addr = b.wrapping_add(c);
     let memory_value = self.word(align(addr));
     (a, b, c, addr, memory_value)
   }
 
   /// Fetch the input operand values for a branch instruction.
-  fn branch_rr(&mut self, instruction: Instruction) -> (u32, u32, u32) {
+  fn branch_rr<const TRACED: bool>(&mut self, instruction: Instruction) -> (u32, u32, u32) {
     let (rs1, rs2, imm) = instruction.b_type();
     let c = imm;
-    let b = self.rr(rs2, MemoryAccessPosition::B);
-    let a = self.rr(rs1, MemoryAccessPosition::A);
+    let b = self.read_register::<TRACED>(rs2, MemoryAccessPosition::B);
+    let a = self.read_register::<TRACED>(rs1, MemoryAccessPosition::A);
     (a, b, c)
   }
 
-  /// Fetch the instruction at the current program counter.
-  fn fetch(&self) -> Instruction {
-    let idx = ((self.state.pc - self.program.pc_base) / 4) as usize;
-    self.program.instructions[idx]
-  }
-
   /// Execute the given instruction over the current state of the runtime.
-  fn execute_instruction(&mut self, instruction: Instruction) -> Result<(), ExecutionError> {
+  ///
+  /// `input` is the hint input borrowed by the execution (see [Runtime::run_fast_with_input]).
+  fn execute_instruction<const TRACED: bool>(
+    &mut self,
+    instruction: Instruction,
+    input: &[&[u8]],
+  ) -> Result<(), ExecutionError> {
     let mut next_pc = self.state.pc.wrapping_add(4);
 
     let rd: Register;
@@ -370,65 +550,65 @@ where
     match instruction.opcode {
       // Arithmetic instructions.
       Opcode::ADD => {
-        (rd, b, c) = self.alu_rr(instruction);
+        (rd, b, c) = self.alu_rr::<TRACED>(instruction);
         a = b.wrapping_add(c);
-        self.alu_rw(instruction, rd, a, b, c);
+        self.alu_rw::<TRACED>(instruction, rd, a, b, c);
       }
       Opcode::SUB => {
-        (rd, b, c) = self.alu_rr(instruction);
+        (rd, b, c) = self.alu_rr::<TRACED>(instruction);
         a = b.wrapping_sub(c);
-        self.alu_rw(instruction, rd, a, b, c);
+        self.alu_rw::<TRACED>(instruction, rd, a, b, c);
       }
       Opcode::XOR => {
-        (rd, b, c) = self.alu_rr(instruction);
+        (rd, b, c) = self.alu_rr::<TRACED>(instruction);
         a = b ^ c;
-        self.alu_rw(instruction, rd, a, b, c);
+        self.alu_rw::<TRACED>(instruction, rd, a, b, c);
       }
       Opcode::OR => {
-        (rd, b, c) = self.alu_rr(instruction);
+        (rd, b, c) = self.alu_rr::<TRACED>(instruction);
         a = b | c;
-        self.alu_rw(instruction, rd, a, b, c);
+        self.alu_rw::<TRACED>(instruction, rd, a, b, c);
       }
       Opcode::AND => {
-        (rd, b, c) = self.alu_rr(instruction);
+        (rd, b, c) = self.alu_rr::<TRACED>(instruction);
         a = b & c;
-        self.alu_rw(instruction, rd, a, b, c);
+        self.alu_rw::<TRACED>(instruction, rd, a, b, c);
       }
       Opcode::SLL => {
-        (rd, b, c) = self.alu_rr(instruction);
+        (rd, b, c) = self.alu_rr::<TRACED>(instruction);
         a = b.wrapping_shl(c);
-        self.alu_rw(instruction, rd, a, b, c);
+        self.alu_rw::<TRACED>(instruction, rd, a, b, c);
       }
       Opcode::SRL => {
-        (rd, b, c) = self.alu_rr(instruction);
+        (rd, b, c) = self.alu_rr::<TRACED>(instruction);
         a = b.wrapping_shr(c);
-        self.alu_rw(instruction, rd, a, b, c);
+        self.alu_rw::<TRACED>(instruction, rd, a, b, c);
       }
       Opcode::SRA => {
-        (rd, b, c) = self.alu_rr(instruction);
+        (rd, b, c) = self.alu_rr::<TRACED>(instruction);
         a = (b as i32).wrapping_shr(c) as u32;
-        self.alu_rw(instruction, rd, a, b, c);
+        self.alu_rw::<TRACED>(instruction, rd, a, b, c);
       }
       Opcode::SLT => {
-        (rd, b, c) = self.alu_rr(instruction);
+        (rd, b, c) = self.alu_rr::<TRACED>(instruction);
         a = if (b as i32) < (c as i32) { 1 } else { 0 };
-        self.alu_rw(instruction, rd, a, b, c);
+        self.alu_rw::<TRACED>(instruction, rd, a, b, c);
       }
       Opcode::SLTU => {
-        (rd, b, c) = self.alu_rr(instruction);
+        (rd, b, c) = self.alu_rr::<TRACED>(instruction);
         a = if b < c { 1 } else { 0 };
-        self.alu_rw(instruction, rd, a, b, c);
+        self.alu_rw::<TRACED>(instruction, rd, a, b, c);
       }
 
       // Load instructions.
       Opcode::LB => {
-        (rd, _, _, addr, memory_read_value) = self.load_rr(instruction);
+        (rd, _, _, addr, memory_read_value) = self.load_rr::<TRACED>(instruction);
         let value = (memory_read_value).to_le_bytes()[(addr % 4) as usize];
         a = ((value as i8) as i32) as u32;
-        self.rw(rd, a);
+        self.write_register::<TRACED>(rd, a);
       }
       Opcode::LH => {
-        (rd, _, _, addr, memory_read_value) = self.load_rr(instruction);
+        (rd, _, _, addr, memory_read_value) = self.load_rr::<TRACED>(instruction);
         if addr % 2 != 0 {
           return Err(ExecutionError::InvalidMemoryAccess(Opcode::LH, addr));
         }
@@ -438,24 +618,24 @@ where
           _ => unreachable!(),
         };
         a = ((value as i16) as i32) as u32;
-        self.rw(rd, a);
+        self.write_register::<TRACED>(rd, a);
       }
       Opcode::LW => {
-        (rd, _, _, addr, memory_read_value) = self.load_rr(instruction);
+        (rd, _, _, addr, memory_read_value) = self.load_rr::<TRACED>(instruction);
         if addr % 4 != 0 {
           return Err(ExecutionError::InvalidMemoryAccess(Opcode::LW, addr));
         }
         a = memory_read_value;
-        self.rw(rd, a);
+        self.write_register::<TRACED>(rd, a);
       }
       Opcode::LBU => {
-        (rd, _, _, addr, memory_read_value) = self.load_rr(instruction);
+        (rd, _, _, addr, memory_read_value) = self.load_rr::<TRACED>(instruction);
         let value = (memory_read_value).to_le_bytes()[(addr % 4) as usize];
         a = value as u32;
-        self.rw(rd, a);
+        self.write_register::<TRACED>(rd, a);
       }
       Opcode::LHU => {
-        (rd, _, _, addr, memory_read_value) = self.load_rr(instruction);
+        (rd, _, _, addr, memory_read_value) = self.load_rr::<TRACED>(instruction);
         if addr % 2 != 0 {
           return Err(ExecutionError::InvalidMemoryAccess(Opcode::LHU, addr));
         }
@@ -465,12 +645,12 @@ where
           _ => unreachable!(),
         };
         a = (value as u16) as u32;
-        self.rw(rd, a);
+        self.write_register::<TRACED>(rd, a);
       }
 
       // Store instructions.
       Opcode::SB => {
-        (a, _, _, addr, memory_read_value) = self.store_rr(instruction);
+        (a, _, _, addr, memory_read_value) = self.store_rr::<TRACED>(instruction);
         let value = match addr % 4 {
           0 => (a & 0x000000FF) + (memory_read_value & 0xFFFFFF00),
           1 => ((a & 0x000000FF) << 8) + (memory_read_value & 0xFFFF00FF),
@@ -478,10 +658,10 @@ where
           3 => ((a & 0x000000FF) << 24) + (memory_read_value & 0x00FFFFFF),
           _ => unreachable!(),
         };
-        self.mw_cpu(align(addr), value, MemoryAccessPosition::Memory);
+        self.write_memory::<TRACED>(align(addr), value, MemoryAccessPosition::Memory);
       }
       Opcode::SH => {
-        (a, _, _, addr, memory_read_value) = self.store_rr(instruction);
+        (a, _, _, addr, memory_read_value) = self.store_rr::<TRACED>(instruction);
         if addr % 2 != 0 {
           return Err(ExecutionError::InvalidMemoryAccess(Opcode::SH, addr));
         }
@@ -490,50 +670,50 @@ where
           1 => ((a & 0x0000FFFF) << 16) + (memory_read_value & 0x0000FFFF),
           _ => unreachable!(),
         };
-        self.mw_cpu(align(addr), value, MemoryAccessPosition::Memory);
+        self.write_memory::<TRACED>(align(addr), value, MemoryAccessPosition::Memory);
       }
       Opcode::SW => {
-        (a, _, _, addr, _) = self.store_rr(instruction);
+        (a, _, _, addr, _) = self.store_rr::<TRACED>(instruction);
         if addr % 4 != 0 {
           return Err(ExecutionError::InvalidMemoryAccess(Opcode::SW, addr));
         }
         let value = a;
-        self.mw_cpu(align(addr), value, MemoryAccessPosition::Memory);
+        self.write_memory::<TRACED>(align(addr), value, MemoryAccessPosition::Memory);
       }
 
       // B-type instructions.
       Opcode::BEQ => {
-        (a, b, c) = self.branch_rr(instruction);
+        (a, b, c) = self.branch_rr::<TRACED>(instruction);
         if a == b {
           next_pc = self.state.pc.wrapping_add(c);
         }
       }
       Opcode::BNE => {
-        (a, b, c) = self.branch_rr(instruction);
+        (a, b, c) = self.branch_rr::<TRACED>(instruction);
         if a != b {
           next_pc = self.state.pc.wrapping_add(c);
         }
       }
       Opcode::BLT => {
-        (a, b, c) = self.branch_rr(instruction);
+        (a, b, c) = self.branch_rr::<TRACED>(instruction);
         if (a as i32) < (b as i32) {
           next_pc = self.state.pc.wrapping_add(c);
         }
       }
       Opcode::BGE => {
-        (a, b, c) = self.branch_rr(instruction);
+        (a, b, c) = self.branch_rr::<TRACED>(instruction);
         if (a as i32) >= (b as i32) {
           next_pc = self.state.pc.wrapping_add(c);
         }
       }
       Opcode::BLTU => {
-        (a, b, c) = self.branch_rr(instruction);
+        (a, b, c) = self.branch_rr::<TRACED>(instruction);
         if a < b {
           next_pc = self.state.pc.wrapping_add(c);
         }
       }
       Opcode::BGEU => {
-        (a, b, c) = self.branch_rr(instruction);
+        (a, b, c) = self.branch_rr::<TRACED>(instruction);
         if a >= b {
           next_pc = self.state.pc.wrapping_add(c);
         }
@@ -543,14 +723,17 @@ where
       Opcode::JAL => {
         let (rd, imm) = instruction.j_type();
         a = self.state.pc + 4;
-        self.rw(rd, a);
+        self.write_register::<TRACED>(rd, a);
         next_pc = self.state.pc.wrapping_add(imm);
       }
       Opcode::JALR => {
         let (rd, rs1, imm) = instruction.i_type();
-        (b, c) = (self.rr(rs1, MemoryAccessPosition::B), imm);
+        (b, c) = (
+          self.read_register::<TRACED>(rs1, MemoryAccessPosition::B),
+          imm,
+        );
         a = self.state.pc + 4;
-        self.rw(rd, a);
+        self.write_register::<TRACED>(rd, a);
         next_pc = b.wrapping_add(c);
       }
 
@@ -558,7 +741,7 @@ where
       Opcode::AUIPC => {
         let (rd, imm) = instruction.u_type();
         a = self.state.pc.wrapping_add(imm);
-        self.rw(rd, a);
+        self.write_register::<TRACED>(rd, a);
       }
 
       // System instructions.
@@ -567,17 +750,45 @@ where
         // register is that we write to it later.
         let t0 = Register::X5;
         let syscall_id = self.register(t0);
-        c = self.rr(Register::X11, MemoryAccessPosition::C);
-        b = self.rr(Register::X10, MemoryAccessPosition::B);
-        let syscall = SyscallCode::from_u32(syscall_id);
-
-        let syscall_impl = self.get_syscall(syscall).cloned();
+        c = self.read_register::<TRACED>(Register::X11, MemoryAccessPosition::C);
+        b = self.read_register::<TRACED>(Register::X10, MemoryAccessPosition::B);
+
+        // Built-in syscalls are found in a static table shared by every runtime. Custom ones are
+        // looked up in the runtime's own table, which is cloned (a reference count increment) to
+        // be borrowed while the syscall mutates the runtime.
+        let builtin = SyscallCode::from_u32(syscall_id);
+        let custom_syscalls = self
+          .custom_syscalls
+          .as_ref()
+          .filter(|table| table.has_id(syscall_id))
+          .cloned();
+        let syscall_impl: Option<&dyn Syscall<T>> = match &custom_syscalls {
+          Some(table) => table.get(syscall_id).map(|syscall| syscall.as_ref()),
+          None => builtin.as_ref().map(|code| code as &dyn Syscall<T>),
+        };
+        self.metrics.syscalls += 1;
+        if builtin.is_some_and(|code| code.calls_host()) {
+          self.metrics.host_calls += 1;
+        }
+        // The syscall is paid for before it runs, so that without enough gas it fails before
+        // reaching the host. Cycles it charges itself are paid as they're charged.
+        let precompile_cycles = syscall_impl.map_or(0, |syscall| syscall.num_extra_cycles());
+        self.charge_gas(precompile_cycles as u64)?;
         let mut precompile_rt = SyscallContext::new(self);
-        let (precompile_next_pc, precompile_cycles, _returned_exit_code) =
+        precompile_rt.traced = TRACED;
+        precompile_rt.input = input;
+        let (precompile_next_pc, charged_cycles, _returned_exit_code) =
           if let Some(syscall_impl) = syscall_impl {
             // Executing a syscall optionally returns a value to write to the t0 register.
             // If it returns None, we just keep the syscall_id in t0.
-            let res = syscall_impl.execute(&mut precompile_rt, b, c);
+            #[cfg(feature = "stats")]
+            let start = std::time::Instant::now();
+            let res = syscall_impl.execute(&mut precompile_rt, b, c)?;
+            #[cfg(feature = "stats")]
+            precompile_rt
+              .rt
+              .stats
+              .record_syscall(syscall_id, start.elapsed());
             if let Some(val) = res {
               a = val;
             } else {
@@ -585,7 +796,7 @@ where
             }
 
             // If the syscall is `HALT` and the exit code is non-zero, return an error.
-            if syscall == SyscallCode::HALT && precompile_rt.exit_code != 0 {
+            if syscall_id == SyscallCode::HALT as u32 && precompile_rt.exit_code != 0 {
               return Err(ExecutionError::HaltWithNonZeroExitCode(
                 precompile_rt.exit_code,
               ));
@@ -593,7 +804,7 @@ where
 
             (
               precompile_rt.next_pc,
-              syscall_impl.num_extra_cycles(),
+              precompile_rt.charged_cycles,
               precompile_rt.exit_code,
             )
           } else {
@@ -601,9 +812,11 @@ where
           };
 
         // Allow the syscall impl to modify state.clk/pc (exit unconstrained does this)
-        self.rw(t0, a);
+        self.write_register::<TRACED>(t0, a);
         next_pc = precompile_next_pc;
-        self.state.clk += precompile_cycles;
+        if TRACED {
+          self.state.clk += precompile_cycles + charged_cycles;
+        }
       }
       Opcode::EBREAK => {
         return Err(ExecutionError::Breakpoint());
@@ -611,60 +824,60 @@ where
 
       // Multiply instructions.
       Opcode::MUL => {
-        (rd, b, c) = self.alu_rr(instruction);
+        (rd, b, c) = self.alu_rr::<TRACED>(instruction);
         a = b.wrapping_mul(c);
-        self.alu_rw(instruction, rd, a, b, c);
+        self.alu_rw::<TRACED>(instruction, rd, a, b, c);
       }
       Opcode::MULH => {
-        (rd, b, c) = self.alu_rr(instruction);
+        (rd, b, c) = self.alu_rr::<TRACED>(instruction);
         a = (((b as i32) as i64).wrapping_mul((c as i32) as i64) >> 32) as u32;
-        self.alu_rw(instruction, rd, a, b, c);
+        self.alu_rw::<TRACED>(instruction, rd, a, b, c);
       }
       Opcode::MULHU => {
-        (rd, b, c) = self.alu_rr(instruction);
+        (rd, b, c) = self.alu_rr::<TRACED>(instruction);
         a = ((b as u64).wrapping_mul(c as u64) >> 32) as u32;
-        self.alu_rw(instruction, rd, a, b, c);
+        self.alu_rw::<TRACED>(instruction, rd, a, b, c);
       }
       Opcode::MULHSU => {
-        (rd, b, c) = self.alu_rr(instruction);
+        (rd, b, c) = self.alu_rr::<TRACED>(instruction);
         a = (((b as i32) as i64).wrapping_mul(c as i64) >> 32) as u32;
-        self.alu_rw(instruction, rd, a, b, c);
+        self.alu_rw::<TRACED>(instruction, rd, a, b, c);
       }
       Opcode::DIV => {
-        (rd, b, c) = self.alu_rr(instruction);
+        (rd, b, c) = self.alu_rr::<TRACED>(instruction);
         if c == 0 {
           a = u32::MAX;
         } else {
           a = (b as i32).wrapping_div(c as i32) as u32;
         }
-        self.alu_rw(instruction, rd, a, b, c);
+        self.alu_rw::<TRACED>(instruction, rd, a, b, c);
       }
       Opcode::DIVU => {
-        (rd, b, c) = self.alu_rr(instruction);
+        (rd, b, c) = self.alu_rr::<TRACED>(instruction);
         if c == 0 {
           a = u32::MAX;
         } else {
           a = b.wrapping_div(c);
         }
-        self.alu_rw(instruction, rd, a, b, c);
+        self.alu_rw::<TRACED>(instruction, rd, a, b, c);
       }
       Opcode::REM => {
-        (rd, b, c) = self.alu_rr(instruction);
+        (rd, b, c) = self.alu_rr::<TRACED>(instruction);
         if c == 0 {
           a = b;
         } else {
           a = (b as i32).wrapping_rem(c as i32) as u32;
         }
-        self.alu_rw(instruction, rd, a, b, c);
+        self.alu_rw::<TRACED>(instruction, rd, a, b, c);
       }
       Opcode::REMU => {
-        (rd, b, c) = self.alu_rr(instruction);
+        (rd, b, c) = self.alu_rr::<TRACED>(instruction);
         if c == 0 {
           a = b;
         } else {
           a = b.wrapping_rem(c);
         }
-        self.alu_rw(instruction, rd, a, b, c);
+        self.alu_rw::<TRACED>(instruction, rd, a, b, c);
       }
 
       // See https://github.com/riscv-non-isa/riscv-asm-manual/blob/master/riscv-asm.md#instruction-aliases
@@ -677,37 +890,64 @@ where
     self.state.pc = next_pc;
 
     // Update the clk to the next cycle.
-    self.state.clk += 4;
+    if TRACED {
+      self.state.clk += 4;
+    }
 
     Ok(())
   }
 
-  /// Executes one cycle of the program, returning whether the program has finished.
+  /// Executes the basic block at the current program counter, returning whether the program has
+  /// finished.
+  ///
+  /// Only the last instruction of a block can jump, halt or call into the host, so the rest run
+  /// back to back without checking for the end of the program.
   #[inline]
-  fn execute_cycle(&mut self) -> Result<bool, ExecutionError> {
-    // Fetch the instruction at the current program counter.
-    let instruction = self.fetch();
+  fn execute_block<const TRACED: bool>(
+    &mut self,
+    program: &Program,
+    input: &[&[u8]],
+  ) -> Result<bool, ExecutionError> {
+    let start = ((self.state.pc - program.pc_base) / 4) as usize;
+    let end = program.block_end(start);
+
+    // Charge for the whole block up front: only its last instruction can leave it.
+    self.charge_gas((end - start) as u64)?;
+
+    for instruction in &program.instructions[start..end] {
+      // Log the current state of the runtime.
+      let record = if TRACED {
+        self.log(instruction);
+        self.trace_begin(instruction)
+      } else {
+        None
+      };
 
-    // Log the current state of the runtime.
-    self.log(&instruction);
+      #[cfg(feature = "stats")]
+      {
+        self.stats.instructions[instruction.opcode as usize] += 1;
+      }
 
-    // Execute the instruction.
-    self.execute_instruction(instruction)?;
+      // Execute the instruction.
+      self.execute_instruction::<TRACED>(*instruction, input)?;
+      if let Some(record) = record {
+        self.trace_end(instruction, record);
+      }
 
-    // Increment the clock.
-    self.state.global_clk += 1;
+      // Increment the clock.
+      self.state.global_clk += 1;
+    }
+    self.check_memory_limit()?;
 
-    Ok(
-      self.state.pc.wrapping_sub(self.program.pc_base)
-        >= (self.program.instructions.len() * 4) as u32,
-    )
+    Ok(self.state.pc.wrapping_sub(program.pc_base) >= (program.instructions.len() * 4) as u32)
   }
 
-  /// Execute up to `self.shard_batch_size` cycles, returning a copy of the prestate and whether the program ended.
+  /// Executes the next basic block, returning a copy of the prestate and whether the program
+  /// ended. See [Runtime::run_slice] to pause and resume without copying the state.
   pub fn execute_state(&mut self) -> Result<(ExecutionState, bool), ExecutionError> {
     self.emit_events = false;
     let state = self.state.clone();
-    let done = self.execute()?;
+    let done = self.execute::<true>()?;
     Ok((state, done))
   }
 
@@ -715,14 +955,12 @@ where
     self.state.clk = 0;
 
     tracing::info!("loading memory image");
-    for (addr, value) in self.program.memory_image.iter() {
-      self.state.memory.insert(
-        *addr,
-        MemoryRecord {
-          value: *value,
-          timestamp: 0,
-        },
-      );
+    if self.state.memory.is_empty() {
+      // Restore the image with a bulk copy.
+      let snapshot = self.program.memory_snapshot(self.state.memory.backend());
+      self.state.memory.clone_from(snapshot);
+    } else {
+      self.program.memory_image.load_into(&mut self.state.memory);
     }
 
     tracing::info!("starting execution");
@@ -730,39 +968,71 @@ where
 
   pub fn run_untraced(&mut self) -> Result<(), ExecutionError> {
     self.emit_events = false;
-    while !self.execute()? {}
-    Ok(())
+    self.execute_to_end::<true>(&[])
   }
 
   pub fn run(&mut self) -> Result<(), ExecutionError> {
     self.emit_events = true;
-    while !self.execute()? {}
-    Ok(())
+    self.execute_to_end::<true>(&[])
+  }
+
+  /// Runs the program for its result only, e.g. on a node that doesn't prove.
+  ///
+  /// This uses a separate instantiation of the interpreter which only tracks values: no memory
+  /// access records are created, memory timestamps are left untouched and `clk` isn't advanced.
+  /// The resulting register, memory and output values are the same as with [Runtime::run], but
+  /// the state can't be used for proving.
+  pub fn run_fast(&mut self) -> Result<(), ExecutionError> {
+    self.run_fast_with_input(&[])
+  }
+
+  /// Runs the program like [Runtime::run_fast], with `input` as the first hint inputs, ahead of
+  /// those in [ExecutionState::input_stream].
+  ///
+  /// The input is borrowed rather than copied into the runtime, so hint reads copy it straight
+  /// from the caller's buffers into guest memory.
+  pub fn run_fast_with_input(&mut self, input: &[&[u8]]) -> Result<(), ExecutionError> {
+    debug_assert!(
+      !self.unconstrained,
+      "fast mode doesn't support unconstrained blocks"
+    );
+    self.emit_events = false;
+    self.execute_to_end::<false>(input)
   }
 
   pub fn dry_run(&mut self) {
     self.emit_events = false;
-    while !self.execute().unwrap() {}
+    self.execute_to_end::<true>(&[]).unwrap();
   }
 
-  /// Executes up to `self.shard_batch_size` cycles of the program, returning whether the program has finished.
-  fn execute(&mut self) -> Result<bool, ExecutionError> {
+  /// Executes the next basic block of the program, returning whether the program has finished.
+  fn execute<const TRACED: bool>(&mut self) -> Result<bool, ExecutionError> {
     // If it's the first cycle, initialize the program.
     if self.state.global_clk == 0 {
       self.initialize();
     }
 
-    // Loop until we've executed `self.shard_batch_size` shards if `self.shard_batch_size` is set.
-    loop {
-      return if self.execute_cycle()? {
-        self.postprocess();
-        Ok(true)
-      } else {
-        Ok(false)
-      };
+    let program = self.program.clone();
+    if self.execute_block::<TRACED>(&program, &[])? {
+      self.postprocess();
+      Ok(true)
+    } else {
+      Ok(false)
     }
   }
 
+  /// Executes the program until it finishes.
+  fn execute_to_end<const TRACED: bool>(&mut self, input: &[&[u8]]) -> Result<(), ExecutionError> {
+    if self.state.global_clk == 0 {
+      self.initialize();
+    }
+
+    let program = self.program.clone();
+    while !self.execute_block::<TRACED>(&program, input)? {}
+    self.postprocess();
+    Ok(())
+  }
+
   fn postprocess(&mut self) {
     tracing::info!(
       "finished execution clk = {} pc = 0x{:x?}",
@@ -784,14 +1054,60 @@ where
       }
     }
 
-    // Flush trace buf
-    if let Some(ref mut buf) = self.trace_buf {
-      buf.flush().unwrap();
+    // Hand the rest of the trace to its writer.
+    if let Some(trace) = &mut self.trace {
+      trace.flush();
+    }
+  }
+
+  /// Hands the buffered log output to the host (see [HostInterface::log]) and clears it.
+  pub fn flush_log(&mut self) {
+    if let Some(host) = &self.host {
+      let mut host = host.borrow_mut();
+      for record in self.state.log.records() {
+        host.log(&record);
+      }
+    }
+    self.state.log.clear();
+  }
+
+  /// The measured cost of the execution so far.
+  pub fn metrics(&self) -> ExecutionMetrics {
+    ExecutionMetrics {
+      cycles: self.state.global_clk,
+      peak_memory: self
+        .metrics
+        .peak_memory
+        .max(self.state.memory.size() as u64),
+      ..self.metrics
     }
   }
 
-  fn get_syscall(&mut self, code: SyscallCode) -> Option<&Arc<dyn Syscall<T>>> {
-    self.syscall_map.get(&code)
+  /// Counts `len` bytes of input read with a hint read, see [ExecutionMetrics::hint_bytes].
+  pub(crate) fn record_hint_read(&mut self, len: u32) {
+    self.metrics.hint_bytes += len as u64;
+  }
+
+  /// Returns the counters of the execution so far and resets them.
+  #[cfg(feature = "stats")]
+  pub fn take_stats(&mut self) -> ExecutionStats {
+    self.record_memory_use();
+    std::mem::take(&mut self.stats)
+  }
+
+  #[cfg(feature = "stats")]
+  fn record_memory_use(&mut self) {
+    self.stats.memory_high_water = self.stats.memory_high_water.max(self.state.memory.len());
+  }
+
+  /// Registers a custom syscall under the syscall number `code`, replacing any syscall with the
+  /// same syscall id.
+  pub fn register_syscall(&mut self, code: u32, syscall: Arc<dyn Syscall<T>>) {
+    let table = self
+      .custom_syscalls
+      .get_or_insert_with(|| Arc::new(SyscallTable::empty()));
+    Arc::make_mut(table).register(code, syscall);
+    self.max_syscall_cycles = SyscallCode::MAX_EXTRA_CYCLES.max(table.max_extra_cycles());
   }
 }
 
@@ -800,12 +1116,12 @@ pub mod tests {
 
   use std::{cell::RefCell, sync::Arc};
 
-  use athena_interface::{HostProvider, MockHost};
+  use athena_interface::{HostProvider, LogStream, MockHost};
 
   use crate::{
-    runtime::Register,
+    runtime::{ExecutionError, MemoryBackend, Register, Syscall, SyscallCode, SyscallContext},
     utils::{
-      tests::{TEST_FIBONACCI_ELF, TEST_HOST, TEST_PANIC_ELF},
+      tests::{FIBONACCI_ELF, TEST_FIBONACCI_ELF, TEST_HOST, TEST_PANIC_ELF},
       AthenaCoreOpts,
     },
   };
@@ -862,6 +1178,738 @@ pub mod tests {
     runtime.run().unwrap();
   }
 
+  #[test]
+  fn test_memory_backends_agree() {
+    let run = |memory_backend| {
+      let mut runtime = Runtime::<MockHost>::new(
+        fibonacci_program(),
+        None,
+        AthenaCoreOpts {
+          memory_backend,
+          ..Default::default()
+        },
+      );
+      runtime.run().unwrap();
+      runtime
+    };
+    let map = run(MemoryBackend::Map);
+    let paged = run(MemoryBackend::Paged);
+
+    assert_eq!(map.state.global_clk, paged.state.global_clk);
+    assert_eq!(map.registers(), paged.registers());
+    assert_eq!(map.state.memory.len(), paged.state.memory.len());
+    for (addr, record) in map.state.memory.iter() {
+      let other = paged.state.memory.get(addr).unwrap();
+      assert_eq!(
+        (record.value, record.timestamp),
+        (other.value, other.timestamp)
+      );
+    }
+  }
+
+  /// The observable outcome of an execution, compared across execution modes by
+  /// [assert_modes_agree].
+  #[derive(Debug, PartialEq)]
+  struct Outcome {
+    result: Result<(), String>,
+    gas_left: Option<u64>,
+    global_clk: u64,
+    pc: u32,
+    registers: [u32; 32],
+    memory: Vec<(u32, u32)>,
+    public_values: Vec<u8>,
+    log: Vec<(LogStream, Vec<u8>)>,
+  }
+
+  type Mode = fn(&mut Runtime<MockHost>) -> Result<(), ExecutionError>;
+
+  /// Runs `program` once in each of `modes`, with a host, and asserts that they end in the same
+  /// outcome. Memory is compared at the addresses touched by the first mode. Returns the
+  /// runtimes in the order of `modes`.
+  ///
+  /// A new way of executing programs is checked against the interpreter by adding it as a mode.
+  fn assert_modes_agree(
+    program: &Program,
+    opts: AthenaCoreOpts,
+    modes: &[Mode],
+  ) -> Vec<Runtime<MockHost>> {
+    let mut runs: Vec<_> = modes
+      .iter()
+      .map(|mode| {
+        let provider = HostProvider::new(MockHost::new());
+        let mut runtime = Runtime::<MockHost>::new(
+          program.clone(),
+          Some(Arc::new(RefCell::new(provider))),
+          opts,
+        );
+        let result = mode(&mut runtime).map_err(|err| err.to_string());
+        (runtime, result)
+      })
+      .collect();
+    let addrs: Vec<u32> = runs[0]
+      .0
+      .state
+      .memory
+      .iter()
+      .map(|(addr, _)| addr)
+      .collect();
+    let outcomes: Vec<_> = runs
+      .iter_mut()
+      .map(|(runtime, result)| Outcome {
+        result: result.clone(),
+        gas_left: runtime.gas_left,
+        global_clk: runtime.state.global_clk,
+        pc: runtime.state.pc,
+        registers: runtime.registers(),
+        memory: addrs
+          .iter()
+          .map(|&addr| (addr, runtime.word(addr)))
+          .collect(),
+        public_values: runtime.state.public_values_stream.clone(),
+        // Records are timestamped with `clk`, which only the traced modes advance.
+        log: runtime
+          .state
+          .log
+          .records()
+          .map(|record| (record.stream, record.data.to_vec()))
+          .collect(),
+      })
+      .collect();
+    for (mode, outcome) in outcomes.iter().enumerate().skip(1) {
+      assert_eq!(&outcomes[0], outcome, "mode {mode} disagrees with mode 0");
+    }
+    runs.into_iter().map(|(runtime, _)| runtime).collect()
+  }
+
+  #[test]
+  fn test_run_fast_matches_run() {
+    let modes: [Mode; 3] = [Runtime::run, Runtime::run_untraced, Runtime::run_fast];
+    let metered = AthenaCoreOpts {
+      gas_limit: Some(1 << 40),
+      ..Default::default()
+    };
+    // Running out of gas stops every mode at the same instruction.
+    let out_of_gas = AthenaCoreOpts {
+      gas_limit: Some(1000),
+      ..Default::default()
+    };
+    for (program, opts) in [
+      (fibonacci_program(), AthenaCoreOpts::default()),
+      (fibonacci_program(), metered),
+      (fibonacci_program(), out_of_gas),
+      (host_program(), metered),
+      (panic_program(), metered),
+    ] {
+      let runtimes = assert_modes_agree(&program, opts, &modes);
+
+      // No bookkeeping for proving is done in fast mode.
+      let fast = &runtimes[2];
+      assert_eq!(fast.state.clk, 0);
+      assert!(fast
+        .state
+        .memory
+        .iter()
+        .all(|(_, record)| record.timestamp == 0));
+    }
+  }
+
+  #[test]
+  fn test_borrowed_input_matches_stdin() {
+    let program = Arc::new(Program::from(FIBONACCI_ELF));
+    let input = bincode::serialize(&20u32).unwrap();
+
+    let mut owned = Runtime::<MockHost>::new(program.clone(), None, AthenaCoreOpts::default());
+    owned.write_stdin_slice(&input);
+    owned.run_fast().unwrap();
+    let mut borrowed = Runtime::<MockHost>::new(program, None, AthenaCoreOpts::default());
+    borrowed.run_fast_with_input(&[&input]).unwrap();
+
+    assert_eq!(owned.state.global_clk, borrowed.state.global_clk);
+    assert_eq!(owned.registers(), borrowed.registers());
+    assert_eq!(
+      owned.state.public_values_stream,
+      borrowed.state.public_values_stream
+    );
+    assert!(borrowed.state.input_stream.is_empty());
+  }
+
+  #[test]
+  fn test_basic_blocks() {
+    //     addi x29, x0, 5
+    //     beq x0, x0, 8
+    //     addi x30, x0, 37
+    //     beq x30, x0, -4
+    //     add x31, x30, x29
+    let instructions = vec![
+      Instruction::new(Opcode::ADD, 29, 0, 5, false, true),
+      Instruction::new(Opcode::BEQ, 0, 0, 8, false, true),
+      Instruction::new(Opcode::ADD, 30, 0, 37, false, true),
+      Instruction::new(Opcode::BEQ, 30, 0, -4i32 as u32, false, true),
+      Instruction::new(Opcode::ADD, 31, 30, 29, false, false),
+    ];
+    let program = Program::new(instructions, 0, 0);
+    let ends: Vec<usize> = (0..5).map(|idx| program.block_end(idx)).collect();
+    assert_eq!(ends, vec![2, 2, 4, 4, 5]);
+
+    // The first branch jumps into the middle of the second block, whose branch then goes back to
+    // its start once.
+    let mut runtime = Runtime::<MockHost>::new(program, None, AthenaCoreOpts::default());
+    runtime.run().unwrap();
+    assert_eq!(runtime.register(Register::X31), 42);
+    assert_eq!(runtime.state.global_clk, 6);
+  }
+
+  struct SyscallAnswer;
+
+  impl Syscall<MockHost> for SyscallAnswer {
+    fn execute(
+      &self,
+      _: &mut SyscallContext<MockHost>,
+      _: u32,
+      _: u32,
+    ) -> Result<Option<u32>, ExecutionError> {
+      Ok(Some(42))
+    }
+  }
+
+  #[test]
+  fn test_custom_and_unsupported_syscalls() {
+    let ecall = |syscall_id| {
+      Program::new(
+        vec![
+          Instruction::new(Opcode::ADD, 5, 0, syscall_id, false, true),
+          Instruction::new(Opcode::ECALL, 5, 10, 11, false, false),
+        ],
+        0,
+        0,
+      )
+    };
+
+    let mut runtime = Runtime::<MockHost>::new(ecall(0x01), None, AthenaCoreOpts::default());
+    // Runtimes only get a table of their own for custom syscalls.
+    assert!(runtime.custom_syscalls.is_none());
+    runtime.register_syscall(0x01, Arc::new(SyscallAnswer));
+    runtime.run().unwrap();
+    assert_eq!(runtime.register(Register::X5), 42);
+
+    // Custom syscalls replace the built-in ones with the same id.
+    let write = SyscallCode::WRITE as u32;
+    let mut runtime = Runtime::<MockHost>::new(ecall(write), None, AthenaCoreOpts::default());
+    runtime.register_syscall(write, Arc::new(SyscallAnswer));
+    runtime.run_fast().unwrap();
+    assert_eq!(runtime.register(Register::X5), 42);
+
+    let mut runtime = Runtime::<MockHost>::new(ecall(0x03), None, AthenaCoreOpts::default());
+    assert!(matches!(
+      runtime.run_fast(),
+      Err(ExecutionError::UnsupportedSyscall(0x03))
+    ));
+  }
+
+  #[test]
+  fn test_hint_read() {
+    let hint_read = |len| {
+      Program::new(
+        vec![
+          Instruction::new(Opcode::ADD, 10, 0, 0x1000, false, true),
+          Instruction::new(Opcode::ADD, 11, 0, len, false, true),
+          Instruction::new(
+            Opcode::ADD,
+            5,
+            0,
+            SyscallCode::HINT_READ as u32,
+            false,
+            true,
+          ),
+          Instruction::new(Opcode::ECALL, 5, 10, 11, false, false),
+        ],
+        0,
+        0,
+      )
+    };
+    let input = [1, 2, 3, 4, 5];
+
+    let mut traced = Runtime::<MockHost>::new(hint_read(5), None, AthenaCoreOpts::default());
+    traced.write_stdin_slice(&input);
+    traced.run().unwrap();
+    let mut fast = Runtime::<MockHost>::new(hint_read(5), None, AthenaCoreOpts::default());
+    fast.run_fast_with_input(&[&input]).unwrap();
+    for runtime in [&traced, &fast] {
+      assert_eq!(runtime.state.read_word(0x1000), 0x04030201);
+      assert_eq!(runtime.state.read_word(0x1004), 0x05);
+    }
+    // The fast path writes the words straight to memory.
+    assert_eq!(fast.word(0x1004), 0x05);
+
+    let mut runtime = Runtime::<MockHost>::new(hint_read(4), None, AthenaCoreOpts::default());
+    assert!(matches!(
+      runtime.run_fast_with_input(&[&input]),
+      Err(ExecutionError::InvalidHintRead(_))
+    ));
+    let mut runtime = Runtime::<MockHost>::new(hint_read(5), None, AthenaCoreOpts::default());
+    assert!(matches!(
+      runtime.run(),
+      Err(ExecutionError::InvalidHintRead(_))
+    ));
+  }
+
+  #[test]
+  fn test_hint_read_into_registers() {
+    let program = Program::new(
+      vec![
+        Instruction::new(Opcode::ADD, 10, 0, 8, false, true),
+        Instruction::new(Opcode::ADD, 11, 0, 4, false, true),
+        Instruction::new(
+          Opcode::ADD,
+          5,
+          0,
+          SyscallCode::HINT_READ as u32,
+          false,
+          true,
+        ),
+        Instruction::new(Opcode::ECALL, 5, 10, 11, false, false),
+      ],
+      0,
+      0,
+    );
+    let input = [0xff; 4];
+
+    let mut traced = Runtime::<MockHost>::new(program.clone(), None, AthenaCoreOpts::default());
+    traced.write_stdin_slice(&input);
+    assert!(matches!(
+      traced.run(),
+      Err(ExecutionError::InvalidMemoryOperation(_))
+    ));
+    let mut fast = Runtime::<MockHost>::new(program, None, AthenaCoreOpts::default());
+    assert!(matches!(
+      fast.run_fast_with_input(&[&input]),
+      Err(ExecutionError::InvalidMemoryOperation(_))
+    ));
+    // Register x2 is left alone.
+    assert_eq!(fast.state.read_word(8), 0);
+  }
+
+  #[test]
+  fn test_hint_read_into_used_memory() {
+    // Memory reused by the guest allocator may have been written before.
+    let program = Program::new(
+      vec![
+        Instruction::new(Opcode::ADD, 6, 0, 0xffff, false, true),
+        Instruction::new(Opcode::SW, 6, 0, 0x1000, false, true),
+        Instruction::new(Opcode::ADD, 10, 0, 0x1000, false, true),
+        Instruction::new(Opcode::ADD, 11, 0, 5, false, true),
+        Instruction::new(
+          Opcode::ADD,
+          5,
+          0,
+          SyscallCode::HINT_READ as u32,
+          false,
+          true,
+        ),
+        Instruction::new(Opcode::ECALL, 5, 10, 11, false, false),
+      ],
+      0,
+      0,
+    );
+    let mut runtime = Runtime::<MockHost>::new(program, None, AthenaCoreOpts::default());
+    runtime.write_stdin_slice(&[1, 2, 3, 4, 5]);
+    runtime.run().unwrap();
+    assert_eq!(runtime.state.read_word(0x1000), 0x04030201);
+    assert_eq!(runtime.state.read_word(0x1004), 0x05);
+  }
+
+  #[test]
+  fn test_hint_read_twice() {
+    // The second read overwrites the words of the first, traced or not.
+    let instructions = vec![
+      Instruction::new(Opcode::ADD, 10, 0, 0x1000, false, true),
+      Instruction::new(Opcode::ADD, 11, 0, 8, false, true),
+      Instruction::new(
+        Opcode::ADD,
+        5,
+        0,
+        SyscallCode::HINT_READ as u32,
+        false,
+        true,
+      ),
+      Instruction::new(Opcode::ECALL, 5, 10, 11, false, false),
+      Instruction::new(Opcode::ADD, 11, 0, 4, false, true),
+      Instruction::new(Opcode::ECALL, 5, 10, 11, false, false),
+      Instruction::new(Opcode::LW, 12, 0, 0x1000, false, true),
+    ];
+    let program = Program::new(instructions, 0, 0);
+    let run = |traced: bool| {
+      let mut runtime = Runtime::<MockHost>::new(program.clone(), None, AthenaCoreOpts::default());
+      runtime.write_stdin_slice(&[1, 2, 3, 4, 5, 6, 7, 8]);
+      runtime.write_stdin_slice(&[9, 10, 11, 12]);
+      if traced {
+        runtime.run().unwrap();
+      } else {
+        runtime.run_fast().unwrap();
+      }
+      (runtime.register(Register::X12), runtime.word(0x1004))
+    };
+    assert_eq!(run(true), (0x0c0b0a09, 0x08070605));
+    assert_eq!(run(false), run(true));
+  }
+
+  #[test]
+  fn test_restore_checkpoint() {
+    let program = Program::new(
+      vec![
+        Instruction::new(Opcode::ADD, 10, 0, 0x1000, false, true),
+        Instruction::new(Opcode::ADD, 11, 0, 5, false, true),
+        Instruction::new(
+          Opcode::ADD,
+          5,
+          0,
+          SyscallCode::HINT_READ as u32,
+          false,
+          true,
+        ),
+        Instruction::new(Opcode::ECALL, 5, 10, 11, false, false),
+      ],
+      0,
+      0,
+    );
+    let mut runtime = Runtime::<MockHost>::new(program, None, AthenaCoreOpts::default());
+    runtime.write_stdin_slice(&[1, 2, 3, 4, 5]);
+    let checkpoint = runtime.checkpoint();
+    runtime.run_fast().unwrap();
+    assert_eq!(runtime.word(0x1000), 0x04030201);
+    let end = (runtime.state.pc, runtime.registers());
+
+    runtime.restore(checkpoint.clone());
+    assert_eq!(runtime.state.pc, 0);
+    assert_eq!(runtime.word(0x1000), 0);
+    assert_eq!(runtime.registers(), [0; 32]);
+
+    // The input read before the checkpoint was restored can be read again.
+    runtime.run_fast().unwrap();
+    assert_eq!(runtime.word(0x1000), 0x04030201);
+    assert_eq!((runtime.state.pc, runtime.registers()), end);
+
+    // Traced, the hinted words are journaled and dropped again by the restore.
+    runtime.restore(checkpoint.clone());
+    runtime.run().unwrap();
+    assert!(!runtime.state.uninitialized_memory.is_empty());
+    runtime.restore(checkpoint.clone());
+    assert!(runtime.state.uninitialized_memory.is_empty());
+    assert_eq!(runtime.state.uninitialized_memory.journal_len(), 0);
+    assert_eq!(runtime.word(0x1000), 0);
+
+    // A failed read leaves the input in place.
+    runtime.state.input_stream[0].push(6);
+    assert!(matches!(
+      runtime.run_fast(),
+      Err(ExecutionError::InvalidHintRead(_))
+    ));
+    assert_eq!(runtime.state.input_stream, [vec![1, 2, 3, 4, 5, 6]]);
+  }
+
+  #[test]
+  fn test_restore_checkpoint_drops_log() {
+    let mut program = Program::new(
+      vec![
+        Instruction::new(Opcode::ADD, 5, 0, SyscallCode::WRITE as u32, false, true),
+        Instruction::new(Opcode::ADD, 10, 0, 1, false, true),
+        Instruction::new(Opcode::ADD, 11, 0, 0x1000, false, true),
+        Instruction::new(Opcode::ADD, 12, 0, 5, false, true),
+        Instruction::new(Opcode::ECALL, 5, 10, 11, false, false),
+      ],
+      0,
+      0,
+    );
+    program.memory_image.insert_bytes(0x1000, b"hello");
+    let opts = AthenaCoreOpts {
+      guest_log: GuestLogMode::Buffer(1024),
+      ..Default::default()
+    };
+    let mut runtime = Runtime::<MockHost>::new(program, None, opts);
+    runtime.run_fast().unwrap();
+    let checkpoint = runtime.checkpoint();
+    runtime.state.pc = 0;
+    runtime.run_fast().unwrap();
+    assert_eq!(runtime.state.log.records().count(), 2);
+
+    // The output of the reverted run is dropped, and that from before the checkpoint kept.
+    runtime.restore(checkpoint);
+    let records: Vec<_> = runtime
+      .state
+      .log
+      .records()
+      .map(|record| record.data.to_vec())
+      .collect();
+    assert_eq!(records, [b"hello".to_vec()]);
+  }
+
+  #[test]
+  fn test_commit_checkpoint() {
+    let program = Program::new(
+      vec![
+        Instruction::new(Opcode::ADD, 10, 0, 0x1000, false, true),
+        Instruction::new(Opcode::ADD, 11, 0, 8, false, true),
+        Instruction::new(
+          Opcode::ADD,
+          5,
+          0,
+          SyscallCode::HINT_READ as u32,
+          false,
+          true,
+        ),
+        Instruction::new(Opcode::ECALL, 5, 10, 11, false, false),
+      ],
+      0,
+      0,
+    );
+    let mut runtime = Runtime::<MockHost>::new(program, None, AthenaCoreOpts::default());
+    runtime.write_stdin_slice(&[1, 2, 3, 4, 5, 6, 7, 8]);
+    let outer = runtime.checkpoint();
+    let inner = runtime.checkpoint();
+    runtime.run().unwrap();
+    assert_eq!(runtime.state.uninitialized_memory.journal_len(), 2);
+
+    // Committing the inner checkpoint keeps the journal for the outer one.
+    runtime.commit(inner);
+    assert_eq!(runtime.state.uninitialized_memory.journal_len(), 2);
+    assert_eq!(runtime.word(0x1004), 0x08070605);
+
+    // Committing the outermost checkpoint drops the journal, and later hints aren't journaled.
+    runtime.commit(outer);
+    assert_eq!(runtime.state.uninitialized_memory.journal_len(), 0);
+    runtime.state.uninitialized_memory.insert(0x2000, 1);
+    assert_eq!(runtime.state.uninitialized_memory.journal_len(), 0);
+    assert_eq!(runtime.word(0x1004), 0x08070605);
+  }
+
+  #[test]
+  fn test_metrics() {
+    let host = Arc::new(RefCell::new(HostProvider::new(MockHost::new())));
+    let opts = AthenaCoreOpts {
+      memory_backend: MemoryBackend::Compact,
+      ..Default::default()
+    };
+    let mut runtime = Runtime::<MockHost>::new(host_program(), Some(host), opts);
+    runtime.run_fast().unwrap();
+    let metrics = runtime.metrics();
+    assert_eq!(metrics.cycles, runtime.state.global_clk);
+    assert_eq!(metrics.host_calls, 2);
+    assert!(metrics.syscalls > metrics.host_calls);
+    assert_eq!(metrics.hint_bytes, 0);
+    assert!(metrics.peak_memory >= runtime.state.memory.size() as u64);
+    assert!(metrics.peak_memory > 0);
+
+    let input = bincode::serialize(&20u32).unwrap();
+    let mut runtime = Runtime::<MockHost>::new(Program::from(FIBONACCI_ELF), None, opts);
+    runtime.run_fast_with_input(&[&input]).unwrap();
+    assert_eq!(runtime.metrics().hint_bytes, input.len() as u64);
+    assert_eq!(runtime.metrics().host_calls, 0);
+  }
+
+  #[test]
+  #[cfg(feature = "stats")]
+  fn test_stats() {
+    let host = Arc::new(RefCell::new(HostProvider::new(MockHost::new())));
+    let mut runtime = Runtime::<MockHost>::new(host_program(), Some(host), Default::default());
+    runtime.run_fast().unwrap();
+    let stats = runtime.take_stats();
+
+    assert_eq!(
+      stats.instructions.iter().sum::<u64>(),
+      runtime.state.global_clk
+    );
+    let syscalls = stats.syscalls.values().map(|stats| stats.count);
+    assert_eq!(stats.instructions(Opcode::ECALL), syscalls.sum());
+    assert_eq!(stats.syscalls[&(SyscallCode::HOST_READ as u32)].count, 1);
+    assert_eq!(stats.syscalls[&(SyscallCode::HOST_WRITE as u32)].count, 1);
+    assert_eq!(stats.host_latency.count(), 2);
+    assert_eq!(stats.memory_high_water, runtime.state.memory.len());
+    assert!(stats
+      .counters()
+      .contains(&("syscalls.host_read.count".to_string(), 1)));
+    assert_eq!(runtime.take_stats().syscalls.len(), 0);
+  }
+
+  #[test]
+  fn test_gas_metering() {
+    let run = |gas_limit| {
+      let opts = AthenaCoreOpts {
+        gas_limit: Some(gas_limit),
+        ..Default::default()
+      };
+      let mut runtime = Runtime::<MockHost>::new(fibonacci_program(), None, opts);
+      let result = runtime.run_fast();
+      (result, runtime.gas_left)
+    };
+
+    // Every instruction costs 1 gas, and the WRITE syscalls of the program also pay for the
+    // bytes they write.
+    let mut unmetered = Runtime::<MockHost>::new(fibonacci_program(), None, Default::default());
+    unmetered.run_fast().unwrap();
+    let (result, gas_left) = run(1 << 40);
+    assert!(result.is_ok());
+    let gas_used = (1 << 40) - gas_left.unwrap();
+    assert!(gas_used > unmetered.state.global_clk);
+
+    let (result, gas_left) = run(gas_used + 10);
+    assert!(result.is_ok());
+    assert_eq!(gas_left, Some(10));
+    let (result, gas_left) = run(gas_used);
+    assert!(result.is_ok());
+    assert_eq!(gas_left, Some(0));
+    let (result, gas_left) = run(gas_used - 1);
+    assert!(matches!(result, Err(ExecutionError::OutOfGas())));
+    assert_eq!(gas_left, Some(0));
+
+    // The traced path is metered the same way.
+    let opts = AthenaCoreOpts {
+      gas_limit: Some(gas_used - 1),
+      ..Default::default()
+    };
+    let mut runtime = Runtime::<MockHost>::new(fibonacci_program(), None, opts);
+    assert!(matches!(runtime.run(), Err(ExecutionError::OutOfGas())));
+  }
+
+  /// Writes a word to memory, at a fixed cost of 100 cycles.
+  struct SyscallCostlyWrite;
+
+  impl Syscall<MockHost> for SyscallCostlyWrite {
+    fn execute(
+      &self,
+      ctx: &mut SyscallContext<MockHost>,
+      arg1: u32,
+      _: u32,
+    ) -> Result<Option<u32>, ExecutionError> {
+      ctx.mw_words(arg1, &[42]);
+      Ok(None)
+    }
+
+    fn num_extra_cycles(&self) -> u32 {
+      100
+    }
+  }
+
+  #[test]
+  fn test_syscall_paid_before_it_runs() {
+    let program = Program::new(
+      vec![
+        Instruction::new(Opcode::ADD, 5, 0, 0x01, false, true),
+        Instruction::new(Opcode::ADD, 10, 0, 0x1000, false, true),
+        Instruction::new(Opcode::ECALL, 5, 10, 11, false, false),
+      ],
+      0,
+      0,
+    );
+    let run = |gas_limit| {
+      let opts = AthenaCoreOpts {
+        gas_limit: Some(gas_limit),
+        ..Default::default()
+      };
+      let mut runtime = Runtime::<MockHost>::new(program.clone(), None, opts);
+      runtime.register_syscall(0x01, Arc::new(SyscallCostlyWrite));
+      let result = runtime.run_fast();
+      (result, runtime.state.read_word(0x1000))
+    };
+
+    let (result, word) = run(3 + 100);
+    assert!(result.is_ok());
+    assert_eq!(word, 42);
+    // Without enough gas for its fixed cost, the syscall fails without doing any work.
+    let (result, word) = run(3 + 99);
+    assert!(matches!(result, Err(ExecutionError::OutOfGas())));
+    assert_eq!(word, 0);
+  }
+
+  /// Stores a word to each of 100 consecutive pages.
+  fn page_touching_program() -> Program {
+    let instructions = vec![
+      Instruction::new(Opcode::ADD, 5, 0, 0x10000, false, true),
+      Instruction::new(Opcode::ADD, 6, 0, 100, false, true),
+      Instruction::new(Opcode::SW, 6, 5, 0, false, true),
+      Instruction::new(Opcode::ADD, 5, 5, 4096, false, true),
+      Instruction::new(Opcode::ADD, 6, 6, -1i32 as u32, false, true),
+      Instruction::new(Opcode::BNE, 6, 0, -12i32 as u32, false, true),
+    ];
+    Program::new(instructions, 0, 0)
+  }
+
+  #[test]
+  fn test_memory_limit() {
+    let mut sizes = Vec::new();
+    for memory_backend in [
+      MemoryBackend::Map,
+      MemoryBackend::Paged,
+      MemoryBackend::Compact,
+    ] {
+      let run = |memory_limit| {
+        let opts = AthenaCoreOpts {
+          memory_backend,
+          memory_limit,
+          ..Default::default()
+        };
+        let mut runtime = Runtime::<MockHost>::new(page_touching_program(), None, opts);
+        runtime.run_fast().map(|_| runtime)
+      };
+      let unlimited = run(None).unwrap();
+      assert_eq!(unlimited.word(0x10000 + 99 * 4096), 1);
+      let size = unlimited.state.memory.size();
+      assert!(run(Some(size)).is_ok());
+      assert!(matches!(
+        run(Some(size - 1)),
+        Err(ExecutionError::OutOfMemory())
+      ));
+      sizes.push(size);
+    }
+    // Compact pages don't hold timestamps.
+    assert!(sizes[2] < sizes[1] * 52 / 100);
+  }
+
+  #[test]
+  fn test_hint_read_memory_limit() {
+    let len = 64 * 1024;
+    let program = Program::new(
+      vec![
+        Instruction::new(Opcode::ADD, 10, 0, 0x10000, false, true),
+        Instruction::new(Opcode::ADD, 11, 0, len, false, true),
+        Instruction::new(
+          Opcode::ADD,
+          5,
+          0,
+          SyscallCode::HINT_READ as u32,
+          false,
+          true,
+        ),
+        Instruction::new(Opcode::ECALL, 5, 10, 11, false, false),
+      ],
+      0,
+      0,
+    );
+    let opts = AthenaCoreOpts {
+      memory_limit: Some(len as usize),
+      ..Default::default()
+    };
+    let mut runtime = Runtime::<MockHost>::new(program, None, opts);
+    runtime.write_stdin_slice(&vec![1; len as usize]);
+    assert!(matches!(
+      runtime.run_fast(),
+      Err(ExecutionError::OutOfMemory())
+    ));
+    // The input is left unread and memory untouched.
+    assert_eq!(runtime.state.input_stream_ptr, 0);
+    assert_eq!(runtime.state.read_word(0x10000), 0);
+  }
+
+  #[test]
+  #[should_panic(expected = "compact guest memory")]
+  fn test_compact_memory_is_untraced() {
+    let opts = AthenaCoreOpts {
+      memory_backend: MemoryBackend::Compact,
+      ..Default::default()
+    };
+    let mut runtime = Runtime::<MockHost>::new(fibonacci_program(), None, opts);
+    runtime.run().unwrap();
+  }
+
   #[test]
   fn test_add() {
     // main:
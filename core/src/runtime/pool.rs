@@ -0,0 +1,111 @@
+use std::cell::RefCell;
+use std::sync::{Arc, Mutex};
+
+use athena_interface::{HostInterface, HostProvider};
+
+use super::{ExecutionState, Program, Runtime};
+use crate::utils::AthenaCoreOpts;
+
+/// A pool of execution states which are reset and reused across executions.
+///
+/// Creating a [Runtime] allocates its guest memory and IO buffers; for short contract calls that
+/// dominates the cost of execution. Runtimes acquired from the pool keep those allocations from a
+/// previous execution. The pool only holds host-independent state, so a single pool can serve
+/// hosts which borrow per-call data.
+///
+/// A nested call made by the host acquires its own runtime while the caller's is still running,
+/// so the idle states act as a stack of call frames, reused in LIFO order. A caller which needs
+/// to roll back its own state, e.g. when the effects of an inner step revert, can use
+/// [Runtime::checkpoint] instead of a fresh runtime.
+pub struct RuntimePool {
+  states: Mutex<Vec<ExecutionState>>,
+  capacity: usize,
+}
+
+impl RuntimePool {
+  /// The number of idle states kept by default.
+  pub const DEFAULT_CAPACITY: usize = 16;
+
+  /// Creates a pool keeping at most `capacity` idle states.
+  pub fn new(capacity: usize) -> Self {
+    Self {
+      states: Mutex::new(Vec::new()),
+      capacity,
+    }
+  }
+
+  /// Returns a runtime ready to execute `program`, reusing an idle state if available.
+  pub fn acquire<T: HostInterface>(
+    &self,
+    program: impl Into<Arc<Program>>,
+    host: Option<Arc<RefCell<HostProvider<T>>>>,
+    opts: AthenaCoreOpts,
+  ) -> Runtime<T> {
+    let program: Arc<Program> = program.into();
+    let idle = self.states.lock().unwrap().pop();
+    match idle {
+      Some(mut state) => {
+        state.reset(program.pc_start, opts.memory_backend);
+        Runtime::with_state(program, host, opts, state)
+      }
+      None => Runtime::new(program, host, opts),
+    }
+  }
+
+  /// Returns the state of a runtime to the pool once its results have been read.
+  pub fn release<T: HostInterface>(&self, runtime: Runtime<T>) {
+    let mut state = runtime.state;
+    // Don't keep the guest memory of the finished execution alive while idle.
+    state.memory.clear();
+
+    let mut states = self.states.lock().unwrap();
+    if states.len() < self.capacity {
+      states.push(state);
+    }
+  }
+
+  /// The number of idle states in the pool.
+  pub fn idle(&self) -> usize {
+    self.states.lock().unwrap().len()
+  }
+}
+
+impl Default for RuntimePool {
+  fn default() -> Self {
+    Self::new(Self::DEFAULT_CAPACITY)
+  }
+}
+
+#[cfg(test)]
+mod tests {
+  use athena_interface::MockHost;
+
+  use super::RuntimePool;
+  use crate::runtime::{Program, Runtime};
+  use crate::utils::{tests::FIBONACCI_ELF, AthenaCoreOpts};
+
+  #[test]
+  fn test_reused_runtime_matches_fresh_one() {
+    let program = std::sync::Arc::new(Program::from(FIBONACCI_ELF));
+    let pool = RuntimePool::new(1);
+    let stdin = bincode::serialize(&20u32).unwrap();
+
+    let mut results = Vec::new();
+    for _ in 0..3 {
+      let mut runtime: Runtime<MockHost> =
+        pool.acquire(program.clone(), None, AthenaCoreOpts::default());
+      runtime.write_stdin_slice(&stdin);
+      runtime.run().unwrap();
+      results.push((
+        runtime.state.global_clk,
+        runtime.registers(),
+        runtime.state.memory.len(),
+        runtime.state.public_values_stream.clone(),
+      ));
+      pool.release(runtime);
+      assert_eq!(pool.idle(), 1);
+    }
+    assert_eq!(results[0], results[1]);
+    assert_eq!(results[0], results[2]);
+  }
+}
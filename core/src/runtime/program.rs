@@ -1,7 +1,7 @@
 use serde::{Deserialize, Serialize};
-use std::collections::BTreeMap;
+use std::sync::OnceLock;
 
-use super::Instruction;
+use super::{GuestMemory, Instruction, MemoryBackend, MemoryImage};
 
 /// A program that can be executed by the VM.
 #[derive(Debug, Clone, Default, Serialize, Deserialize)]
@@ -16,5 +16,48 @@ pub struct Program {
     pub pc_base: u32,
 
     /// The initial memory image, useful for global constants.
-    pub memory_image: BTreeMap<u32, u32>,
+    pub memory_image: MemoryImage,
+
+    /// For each instruction, the index one past the end of the basic block it starts. Computed
+    /// once, on first execution, and shared by every runtime executing this program.
+    #[serde(skip)]
+    pub(crate) block_ends: OnceLock<Box<[u32]>>,
+
+    /// The memory image loaded into guest memory, per [MemoryBackend], so that each execution
+    /// restores it with a bulk copy. Computed once per backend, on first execution.
+    #[serde(skip)]
+    pub(crate) memory_snapshots: [OnceLock<GuestMemory>; 3],
+}
+
+impl Program {
+    /// Returns the index one past the last instruction of the basic block starting at `idx`.
+    ///
+    /// A basic block runs up to and including the next instruction which may transfer control
+    /// (see [Instruction::is_block_terminator]), so every other instruction in it falls through to
+    /// the next one. Jumps may enter a block anywhere, so blocks are resolved per starting index.
+    #[inline]
+    pub fn block_end(&self, idx: usize) -> usize {
+        self.block_ends.get_or_init(|| self.compute_block_ends())[idx] as usize
+    }
+
+    /// Returns the memory image loaded into guest memory with the given backend.
+    pub fn memory_snapshot(&self, backend: MemoryBackend) -> &GuestMemory {
+        self.memory_snapshots[backend as usize].get_or_init(|| {
+            let mut memory = GuestMemory::new(backend);
+            self.memory_image.load_into(&mut memory);
+            memory
+        })
+    }
+
+    fn compute_block_ends(&self) -> Box<[u32]> {
+        let mut block_ends = vec![0; self.instructions.len()];
+        let mut end = self.instructions.len() as u32;
+        for (idx, instruction) in self.instructions.iter().enumerate().rev() {
+            if instruction.is_block_terminator() {
+                end = idx as u32 + 1;
+            }
+            block_ends[idx] = end;
+        }
+        block_ends.into_boxed_slice()
+    }
 }
@@ -0,0 +1,207 @@
+use std::time::{Duration, Instant};
+
+use athena_interface::HostInterface;
+
+use super::{ExecutionError, Runtime};
+
+/// How often, in instructions, a time-bounded slice reads the clock.
+const TIME_CHECK_INTERVAL: u64 = 4096;
+
+/// Bounds how long [Runtime::run_slice] and [Runtime::run_fast_slice] execute before pausing.
+///
+/// A slice always executes at least one basic block, so that every slice makes progress.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct SliceBudget {
+  /// The maximum number of instructions to execute. Slices pause at a basic block boundary, so
+  /// they only run past it when the first block alone is longer.
+  pub cycles: Option<u64>,
+
+  /// The maximum time to execute for. The clock is read every few thousand instructions, so
+  /// slices may run slightly longer.
+  pub time: Option<Duration>,
+}
+
+impl SliceBudget {
+  pub const fn cycles(cycles: u64) -> Self {
+    Self {
+      cycles: Some(cycles),
+      time: None,
+    }
+  }
+
+  pub const fn time(time: Duration) -> Self {
+    Self {
+      cycles: None,
+      time: Some(time),
+    }
+  }
+}
+
+/// The outcome of executing a slice.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum SliceStatus {
+  /// The budget ran out. Calling the same method again resumes the execution.
+  Paused,
+
+  /// The program finished.
+  Finished,
+}
+
+impl<T> Runtime<T>
+where
+  T: HostInterface,
+{
+  /// Runs the program like [Runtime::run] until it finishes or `budget` runs out.
+  ///
+  /// Pausing leaves the execution in the runtime as is, without copying its state: the runtime
+  /// is the handle to resume. A scheduler can thus interleave many long executions on a few
+  /// threads, one slice at a time.
+  pub fn run_slice(&mut self, budget: SliceBudget) -> Result<SliceStatus, ExecutionError> {
+    self.emit_events = true;
+    self.execute_slice::<true>(budget)
+  }
+
+  /// Runs the program like [Runtime::run_fast] until it finishes or `budget` runs out, see
+  /// [Runtime::run_slice].
+  pub fn run_fast_slice(&mut self, budget: SliceBudget) -> Result<SliceStatus, ExecutionError> {
+    debug_assert!(
+      !self.unconstrained,
+      "fast mode doesn't support unconstrained blocks"
+    );
+    self.emit_events = false;
+    self.execute_slice::<false>(budget)
+  }
+
+  fn execute_slice<const TRACED: bool>(
+    &mut self,
+    budget: SliceBudget,
+  ) -> Result<SliceStatus, ExecutionError> {
+    if self.state.global_clk == 0 {
+      self.initialize();
+    }
+
+    let program = self.program.clone();
+    let finished =
+      |pc: u32| pc.wrapping_sub(program.pc_base) >= (program.instructions.len() * 4) as u32;
+    if finished(self.state.pc) {
+      return Ok(SliceStatus::Finished);
+    }
+
+    let start_clk = self.state.global_clk;
+    let cycle_limit = budget.cycles.map(|cycles| start_clk.saturating_add(cycles));
+    let deadline = budget.time.map(|time| Instant::now() + time);
+    let mut next_time_check = start_clk + TIME_CHECK_INTERVAL;
+    loop {
+      if self.execute_block::<TRACED>(&program, &[])? {
+        self.postprocess();
+        return Ok(SliceStatus::Finished);
+      }
+
+      // Pause before the next block if it doesn't fit in the budget.
+      if let Some(limit) = cycle_limit {
+        let idx = ((self.state.pc - program.pc_base) / 4) as usize;
+        let len = (program.block_end(idx) - idx) as u64;
+        if self.state.global_clk + len > limit {
+          return Ok(SliceStatus::Paused);
+        }
+      }
+      if let Some(deadline) = deadline {
+        if self.state.global_clk >= next_time_check {
+          if Instant::now() >= deadline {
+            return Ok(SliceStatus::Paused);
+          }
+          next_time_check = self.state.global_clk + TIME_CHECK_INTERVAL;
+        }
+      }
+    }
+  }
+}
+
+#[cfg(test)]
+mod tests {
+  use athena_interface::MockHost;
+
+  use super::*;
+  use crate::runtime::{Instruction, Opcode, Program, Register};
+  use crate::utils::AthenaCoreOpts;
+
+  /// Counts x5 down from 10000 to 0, executing 20002 instructions.
+  fn loop_program() -> Program {
+    let instructions = vec![
+      Instruction::new(Opcode::ADD, 5, 0, 10000, false, true),
+      Instruction::new(Opcode::ADD, 5, 5, -1i32 as u32, false, true),
+      Instruction::new(Opcode::BNE, 5, 0, -4i32 as u32, false, true),
+      Instruction::new(Opcode::ADD, 6, 0, 1, false, true),
+    ];
+    Program::new(instructions, 0, 0)
+  }
+
+  fn new_runtime() -> Runtime<MockHost> {
+    Runtime::new(loop_program(), None, AthenaCoreOpts::default())
+  }
+
+  #[test]
+  fn test_slices_match_full_run() {
+    let mut full = new_runtime();
+    full.run().unwrap();
+    assert_eq!(full.state.global_clk, 20002);
+
+    let mut sliced = new_runtime();
+    let mut slices = 0;
+    let mut clk = 0;
+    while sliced.run_slice(SliceBudget::cycles(1001)).unwrap() == SliceStatus::Paused {
+      // The loop body is 2 instructions long, so slices stop 1 short of the budget.
+      assert_eq!(
+        sliced.state.global_clk - clk,
+        if clk == 0 { 1001 } else { 1000 }
+      );
+      clk = sliced.state.global_clk;
+      slices += 1;
+    }
+    assert_eq!(slices, 19);
+    assert_eq!(sliced.state.global_clk, full.state.global_clk);
+    assert_eq!(sliced.state.clk, full.state.clk);
+    assert_eq!(sliced.registers(), full.registers());
+    assert_eq!(sliced.register(Register::X6), 1);
+
+    // Resuming a finished execution does nothing.
+    assert_eq!(
+      sliced.run_slice(SliceBudget::cycles(1000)).unwrap(),
+      SliceStatus::Finished
+    );
+    assert_eq!(sliced.state.global_clk, full.state.global_clk);
+  }
+
+  #[test]
+  fn test_fast_slices_match_run_fast() {
+    let mut full = new_runtime();
+    full.run_fast().unwrap();
+
+    let mut sliced = new_runtime();
+    // A zero budget still executes a block per slice.
+    let mut slices = 0;
+    while sliced.run_fast_slice(SliceBudget::cycles(0)).unwrap() == SliceStatus::Paused {
+      slices += 1;
+    }
+    assert_eq!(slices, 10000);
+    assert_eq!(sliced.state.global_clk, full.state.global_clk);
+    assert_eq!(sliced.registers(), full.registers());
+  }
+
+  #[test]
+  fn test_time_budget() {
+    let mut sliced = new_runtime();
+    let budget = SliceBudget::time(Duration::ZERO);
+    assert_eq!(sliced.run_fast_slice(budget).unwrap(), SliceStatus::Paused);
+    assert!(sliced.state.global_clk >= TIME_CHECK_INTERVAL);
+    assert!(sliced.state.global_clk < TIME_CHECK_INTERVAL + 2);
+    while sliced.run_fast_slice(budget).unwrap() == SliceStatus::Paused {}
+    assert_eq!(sliced.register(Register::X6), 1);
+
+    let mut unbounded = new_runtime();
+    assert_eq!(
+      unbounded.run_fast_slice(SliceBudget::default()).unwrap(),
+      SliceStatus::Finished
+    );
+  }
+}
@@ -4,7 +4,7 @@ use nohash_hasher::BuildNoHashHasher;
 use serde::{Deserialize, Serialize};
 use serde_with::serde_as;
 
-use super::MemoryRecord;
+use super::{GuestLog, GuestMemory, MemoryBackend, MemoryRecord};
 
 /// Holds data describing the current state of a program's execution.
 #[serde_as]
@@ -29,11 +29,11 @@ pub struct ExecutionState {
 
     /// The memory which instructions operate over. Values contain the memory value and last shard
     /// + timestamp that each memory address was accessed.
-    pub memory: HashMap<u32, MemoryRecord, BuildNoHashHasher<u32>>,
+    pub memory: GuestMemory,
 
     /// Uninitialized memory addresses that have a specific value they should be initialized with.
     /// SyscallHintRead uses this to write hint data into uninitialized memory.
-    pub uninitialized_memory: HashMap<u32, u32, BuildNoHashHasher<u32>>,
+    pub uninitialized_memory: UninitializedMemory,
 
     /// A stream of input values (global to the entire program).
     pub input_stream: Vec<Vec<u8>>,
@@ -46,10 +46,18 @@ pub struct ExecutionState {
 
     /// A ptr to the current position in the public values stream, incremented when reading from public_values_stream.
     pub public_values_stream_ptr: usize,
+
+    /// The log output of the program, with [super::GuestLogMode::Buffer]. Restoring a checkpoint
+    /// drops the output written since.
+    pub log: GuestLog,
 }
 
 impl ExecutionState {
     pub fn new(pc_start: u32) -> Self {
+        Self::with_memory_backend(pc_start, MemoryBackend::default())
+    }
+
+    pub fn with_memory_backend(pc_start: u32, memory_backend: MemoryBackend) -> Self {
         Self {
             global_clk: 0,
             // Start at shard 1 since shard 0 is reserved for memory initialization.
@@ -57,13 +65,247 @@ impl ExecutionState {
             clk: 0,
             channel: 0,
             pc: pc_start,
-            memory: HashMap::default(),
-            uninitialized_memory: HashMap::default(),
+            memory: GuestMemory::new(memory_backend),
+            uninitialized_memory: UninitializedMemory::default(),
             input_stream: Vec::new(),
             input_stream_ptr: 0,
             public_values_stream: Vec::new(),
             public_values_stream_ptr: 0,
+            log: GuestLog::default(),
+        }
+    }
+
+    /// Resets the state to start executing from `pc_start`, keeping allocations for reuse.
+    pub fn reset(&mut self, pc_start: u32, memory_backend: MemoryBackend) {
+        self.global_clk = 0;
+        self.current_shard = 1;
+        self.clk = 0;
+        self.channel = 0;
+        self.pc = pc_start;
+        if self.memory.backend() == memory_backend {
+            self.memory.clear();
+        } else {
+            self.memory = GuestMemory::new(memory_backend);
+        }
+        self.uninitialized_memory.clear();
+        self.input_stream.clear();
+        self.input_stream_ptr = 0;
+        self.public_values_stream.clear();
+        self.public_values_stream_ptr = 0;
+        self.log.clear();
+    }
+
+    /// Reads a word without creating an access record. An address that was never accessed reads
+    /// as its hinted value, if any, otherwise 0.
+    #[inline]
+    pub fn read_word(&self, addr: u32) -> u32 {
+        match self.memory.value(addr) {
+            Some(value) => value,
+            None => self.uninitialized_memory.get(&addr).copied().unwrap_or(0),
+        }
+    }
+
+    /// Writes a word without creating an access record or updating its timestamp.
+    #[inline]
+    pub fn write_word(&mut self, addr: u32, value: u32) {
+        let uninitialized_memory = &mut self.uninitialized_memory;
+        *self.memory.value_or_insert_with(addr, || {
+            uninitialized_memory.remove(&addr);
+            0
+        }) = value;
+    }
+
+    /// Writes `bytes` to the words from the word-aligned `addr` on, right-padding the last word
+    /// with zeros, without creating access records.
+    pub fn write_bytes(&mut self, addr: u32, bytes: &[u8]) {
+        let count = bytes.len().div_ceil(4);
+        if !self.uninitialized_memory.is_empty() {
+            for i in 0..count {
+                self.uninitialized_memory.remove(&(addr + i as u32 * 4));
+            }
         }
+        self.memory.update_values(addr, count, |i, value| {
+            let chunk = &bytes[i * 4..bytes.len().min(i * 4 + 4)];
+            let mut word = [0; 4];
+            word[..chunk.len()].copy_from_slice(chunk);
+            *value = u32::from_le_bytes(word);
+        });
+    }
+}
+
+/// The values of the words hinted into memory that wasn't accessed yet.
+///
+/// Once a checkpoint has been taken, each change is journaled with the value it replaced, so
+/// that restoring a checkpoint undoes the changes made since instead of copying the whole map.
+/// The journal is emptied when the outermost checkpoint is restored and dropped when it is
+/// committed.
+#[derive(Debug, Clone, Default, Serialize, Deserialize)]
+pub struct UninitializedMemory {
+    words: HashMap<u32, u32, BuildNoHashHasher<u32>>,
+    /// The address and previous value of each change, if a checkpoint was taken.
+    #[serde(skip)]
+    journal: Option<Vec<(u32, Option<u32>)>>,
+    /// The number of checkpoints neither restored nor committed yet.
+    #[serde(skip)]
+    depth: usize,
+}
+
+/// The position of the [UninitializedMemory] journal when a checkpoint was taken.
+#[derive(Debug, Clone, Copy)]
+struct JournalMark {
+    len: usize,
+    depth: usize,
+}
+
+impl UninitializedMemory {
+    #[inline]
+    pub fn get(&self, addr: &u32) -> Option<&u32> {
+        self.words.get(addr)
+    }
+
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.words.is_empty()
+    }
+
+    pub fn reserve(&mut self, additional: usize) {
+        self.words.reserve(additional);
+    }
+
+    /// Sets the value of `addr`, returning its previous value.
+    pub fn insert(&mut self, addr: u32, value: u32) -> Option<u32> {
+        let prev = self.words.insert(addr, value);
+        if let Some(journal) = &mut self.journal {
+            journal.push((addr, prev));
+        }
+        prev
+    }
+
+    /// Removes the value of `addr`, when it is first accessed, returning it.
+    #[inline]
+    pub fn remove(&mut self, addr: &u32) -> Option<u32> {
+        let value = self.words.remove(addr)?;
+        if let Some(journal) = &mut self.journal {
+            journal.push((*addr, Some(value)));
+        }
+        Some(value)
+    }
+
+    /// Removes all values and stops journaling.
+    pub fn clear(&mut self) {
+        self.words.clear();
+        self.journal = None;
+        self.depth = 0;
+    }
+
+    /// Starts journaling changes, if not done already, and returns the position to roll back
+    /// to with [UninitializedMemory::rollback].
+    fn mark(&mut self) -> JournalMark {
+        let mark = JournalMark {
+            len: self.journal.get_or_insert_with(Vec::new).len(),
+            depth: self.depth,
+        };
+        self.depth += 1;
+        mark
+    }
+
+    /// Undoes the changes made since `mark` was returned. Rolling back to the outermost mark
+    /// empties the journal.
+    fn rollback(&mut self, mark: JournalMark) {
+        self.depth = mark.depth;
+        let Some(journal) = &mut self.journal else {
+            return;
+        };
+        for (addr, prev) in journal.drain(mark.len.min(journal.len())..).rev() {
+            match prev {
+                Some(value) => self.words.insert(addr, value),
+                None => self.words.remove(&addr),
+            };
+        }
+    }
+
+    /// Keeps the changes made since `mark` was returned. At the outermost mark nothing can be
+    /// rolled back any more, so the journal is dropped until the next checkpoint.
+    fn release(&mut self, mark: JournalMark) {
+        self.depth = mark.depth;
+        if mark.depth == 0 {
+            self.journal = None;
+        }
+    }
+
+    /// The number of changes journaled.
+    #[cfg(test)]
+    pub(super) fn journal_len(&self) -> usize {
+        self.journal.as_ref().map_or(0, Vec::len)
+    }
+}
+
+/// A point of an execution to roll back to, e.g. when a nested call reverts.
+///
+/// With [MemoryBackend::Paged] and [MemoryBackend::Compact] the checkpoint shares its memory
+/// pages with the execution, which only copies the pages it writes to afterwards, and restoring
+/// it is a move. With [MemoryBackend::Map], the default, taking a checkpoint copies the whole
+/// memory, so it costs as much as the memory in use rather than the pages written: nested calls
+/// should run with a paged backend. Hinted values are journaled, see [UninitializedMemory].
+#[derive(Debug, Clone)]
+pub struct Checkpoint {
+    global_clk: u64,
+    current_shard: u32,
+    clk: u32,
+    channel: u32,
+    pc: u32,
+    memory: GuestMemory,
+    uninitialized_memory_mark: JournalMark,
+    input_stream_len: usize,
+    input_stream_ptr: usize,
+    public_values_stream_len: usize,
+    public_values_stream_ptr: usize,
+    log_mark: u64,
+}
+
+impl ExecutionState {
+    /// Takes a checkpoint of the state. The IO streams and the log are only appended to, so only
+    /// their lengths are recorded.
+    pub fn checkpoint(&mut self) -> Checkpoint {
+        Checkpoint {
+            global_clk: self.global_clk,
+            current_shard: self.current_shard,
+            clk: self.clk,
+            channel: self.channel,
+            pc: self.pc,
+            memory: self.memory.clone(),
+            uninitialized_memory_mark: self.uninitialized_memory.mark(),
+            input_stream_len: self.input_stream.len(),
+            input_stream_ptr: self.input_stream_ptr,
+            public_values_stream_len: self.public_values_stream.len(),
+            public_values_stream_ptr: self.public_values_stream_ptr,
+            log_mark: self.log.mark(),
+        }
+    }
+
+    /// Rolls the state back to `checkpoint`, which must have been taken from this state.
+    pub fn restore(&mut self, checkpoint: Checkpoint) {
+        self.global_clk = checkpoint.global_clk;
+        self.current_shard = checkpoint.current_shard;
+        self.clk = checkpoint.clk;
+        self.channel = checkpoint.channel;
+        self.pc = checkpoint.pc;
+        self.memory = checkpoint.memory;
+        self.uninitialized_memory
+            .rollback(checkpoint.uninitialized_memory_mark);
+        self.input_stream.truncate(checkpoint.input_stream_len);
+        self.input_stream_ptr = checkpoint.input_stream_ptr;
+        self.public_values_stream
+            .truncate(checkpoint.public_values_stream_len);
+        self.public_values_stream_ptr = checkpoint.public_values_stream_ptr;
+        self.log.truncate(checkpoint.log_mark);
+    }
+
+    /// Discards `checkpoint`, which must have been taken from this state, keeping the changes
+    /// made since, e.g. when a nested call returns successfully.
+    pub fn commit(&mut self, checkpoint: Checkpoint) {
+        self.uninitialized_memory
+            .release(checkpoint.uninitialized_memory_mark);
     }
 }
 
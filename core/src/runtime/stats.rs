@@ -0,0 +1,162 @@
+use std::collections::BTreeMap;
+use std::time::Duration;
+
+use athena_interface::PrefetchStats;
+use strum::IntoEnumIterator;
+
+use super::{Opcode, SyscallCode};
+
+/// One more than the largest opcode, so that instruction counts can be indexed by opcode.
+const NUM_OPCODES: usize = Opcode::UNIMP as usize + 1;
+
+/// Counters of an execution, collected when the `stats` feature is enabled.
+///
+/// The counters are kept by the [Runtime](super::Runtime) executing the program and taken with
+/// [Runtime::take_stats](super::Runtime::take_stats).
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct ExecutionStats {
+  /// The number of instructions executed, indexed by opcode.
+  pub instructions: [u64; NUM_OPCODES],
+  /// The calls made to each syscall, by syscall number.
+  pub syscalls: BTreeMap<u32, SyscallStats>,
+  /// The latency of the syscalls calling the host, which is mostly spent in the host callback.
+  pub host_latency: LatencyHistogram,
+  /// The largest number of memory words, including registers, used by the execution.
+  pub memory_high_water: usize,
+  /// How many of the storage slots read had been prefetched, filled in by the caller owning the
+  /// host (see `HostProvider::take_prefetch_stats`).
+  pub prefetch: PrefetchStats,
+}
+
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct SyscallStats {
+  pub count: u64,
+  /// The wall time spent executing the syscall.
+  pub time: Duration,
+}
+
+/// A histogram of durations with power-of-two buckets: bucket `i` counts the durations shorter
+/// than 2^i nanoseconds which don't fit in a previous bucket. The last bucket has no upper bound.
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct LatencyHistogram {
+  pub buckets: [u64; 32],
+}
+
+impl LatencyHistogram {
+  pub fn record(&mut self, latency: Duration) {
+    let nanos = u64::try_from(latency.as_nanos()).unwrap_or(u64::MAX);
+    let bucket = (u64::BITS - nanos.leading_zeros()) as usize;
+    self.buckets[bucket.min(self.buckets.len() - 1)] += 1;
+  }
+
+  /// The exclusive upper bound of bucket `i`, or `None` for the last bucket.
+  pub fn bound(&self, i: usize) -> Option<Duration> {
+    (i + 1 < self.buckets.len()).then(|| Duration::from_nanos(1 << i))
+  }
+
+  /// The number of durations recorded.
+  pub fn count(&self) -> u64 {
+    self.buckets.iter().sum()
+  }
+}
+
+impl Default for ExecutionStats {
+  fn default() -> Self {
+    Self {
+      instructions: [0; NUM_OPCODES],
+      syscalls: BTreeMap::new(),
+      host_latency: LatencyHistogram::default(),
+      memory_high_water: 0,
+      prefetch: PrefetchStats::default(),
+    }
+  }
+}
+
+impl ExecutionStats {
+  /// The number of instructions executed with `opcode`.
+  pub fn instructions(&self, opcode: Opcode) -> u64 {
+    self.instructions[opcode as usize]
+  }
+
+  pub(crate) fn record_syscall(&mut self, code: u32, time: Duration) {
+    let stats = self.syscalls.entry(code).or_default();
+    stats.count += 1;
+    stats.time += time;
+    if SyscallCode::from_u32(code).is_some_and(|code| code.calls_host()) {
+      self.host_latency.record(time);
+    }
+  }
+
+  /// Lists the counters which aren't zero as name and value pairs, e.g. to export them as
+  /// metrics:
+  ///
+  /// - `instructions.<mnemonic>`: the instructions executed with an opcode,
+  /// - `syscalls.<name>.count` and `syscalls.<name>.nanos`: the calls and time spent in a
+  ///   syscall, named after its [SyscallCode] in lower case or its number in hex otherwise,
+  /// - `host_latency.lt_<nanos>` and `host_latency.inf`: the buckets of [Self::host_latency],
+  /// - `memory_high_water`: see [Self::memory_high_water],
+  /// - `prefetch.slots`, `prefetch.hits` and `prefetch.misses`: see [Self::prefetch], when
+  ///   storage was prefetched.
+  pub fn counters(&self) -> Vec<(String, u64)> {
+    let mut counters = Vec::new();
+    for opcode in Opcode::iter() {
+      let count = self.instructions(opcode);
+      if count > 0 {
+        counters.push((format!("instructions.{}", opcode.mnemonic()), count));
+      }
+    }
+    for (code, stats) in &self.syscalls {
+      let name = match SyscallCode::from_u32(*code) {
+        Some(code) => format!("{code:?}").to_lowercase(),
+        None => format!("{code:#x}"),
+      };
+      counters.push((format!("syscalls.{name}.count"), stats.count));
+      counters.push((
+        format!("syscalls.{name}.nanos"),
+        u64::try_from(stats.time.as_nanos()).unwrap_or(u64::MAX),
+      ));
+    }
+    for (i, count) in self.host_latency.buckets.iter().enumerate() {
+      if *count > 0 {
+        let name = match self.host_latency.bound(i) {
+          Some(bound) => format!("host_latency.lt_{}", bound.as_nanos()),
+          None => "host_latency.inf".to_string(),
+        };
+        counters.push((name, *count));
+      }
+    }
+    counters.push((
+      "memory_high_water".to_string(),
+      self.memory_high_water as u64,
+    ));
+    if self.prefetch != PrefetchStats::default() {
+      counters.push(("prefetch.slots".to_string(), self.prefetch.prefetched));
+      counters.push(("prefetch.hits".to_string(), self.prefetch.hits));
+      counters.push(("prefetch.misses".to_string(), self.prefetch.misses));
+    }
+    counters
+  }
+}
+
+#[cfg(test)]
+mod tests {
+  use super::*;
+
+  #[test]
+  fn test_latency_histogram_buckets() {
+    let mut histogram = LatencyHistogram::default();
+    for nanos in [0, 1, 2, 3, 4, 1000, u64::MAX] {
+      histogram.record(Duration::from_nanos(nanos));
+    }
+    assert_eq!(histogram.buckets[0], 1);
+    assert_eq!(histogram.buckets[1], 1);
+    assert_eq!(histogram.buckets[2], 2);
+    assert_eq!(histogram.buckets[3], 1);
+    // 1000ns < 1024ns
+    assert_eq!(histogram.buckets[10], 1);
+    assert_eq!(histogram.buckets[31], 1);
+    assert_eq!(histogram.bound(10), Some(Duration::from_nanos(1024)));
+    assert_eq!(histogram.bound(31), None);
+    assert_eq!(histogram.count(), 7);
+  }
+}
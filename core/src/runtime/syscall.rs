@@ -1,11 +1,12 @@
-use std::collections::HashMap;
 use std::sync::Arc;
 
 use strum_macros::EnumIter;
 
-use crate::runtime::{Register, Runtime};
+use crate::runtime::{ExecutionError, Register, Runtime};
 use crate::syscall::{
-  SyscallHalt, SyscallHintLen, SyscallHintRead, SyscallHostRead, SyscallHostWrite, SyscallWrite,
+  SyscallEd25519Verify, SyscallHalt, SyscallHintLen, SyscallHintRead, SyscallHostRead,
+  SyscallHostReadMany, SyscallHostWrite, SyscallHostWriteMany, SyscallKeccak256, SyscallMemcpy,
+  SyscallMemset, SyscallSha256, SyscallWrite,
 };
 use crate::{runtime::MemoryReadRecord, runtime::MemoryWriteRecord};
 
@@ -23,12 +24,31 @@ pub enum SyscallCode {
   /// Halts the program.
   HALT = 0x00_00_00_00,
 
-  /// Write to the output buffer.
+  /// Write to the output buffer. Costs one cycle per word written, on top of the `ecall`.
   WRITE = 0x00_00_00_02,
 
   /// Host functions
   HOST_READ = 0x00_00_00_A0,
   HOST_WRITE = 0x00_00_00_A1,
+  HOST_READ_MANY = 0x00_00_00_A2,
+  HOST_WRITE_MANY = 0x00_00_00_A3,
+
+  /// Copies memory, the source and destination may overlap.
+  MEMCPY = 0x00_00_00_B0,
+  MEMMOVE = 0x00_00_00_B1,
+
+  /// Sets memory to a byte.
+  MEMSET = 0x00_00_00_B2,
+
+  /// Hashes memory with Keccak-256.
+  KECCAK256 = 0x00_40_00_C0,
+
+  /// Hashes memory with SHA-256.
+  SHA256 = 0x00_40_00_C1,
+
+  /// Verifies an Ed25519 signature. The fixed cost is the largest a syscall number can encode,
+  /// and the syscall charges the rest of its cost (see `ED25519_VERIFY_SURCHARGE`).
+  ED25519_VERIFY = 0x00_FF_00_C2,
 
   /// Executes the `HINT_LEN` precompile.
   HINT_LEN = 0x00_00_00_F0,
@@ -37,18 +57,116 @@ pub enum SyscallCode {
   HINT_READ = 0x00_00_00_F1,
 }
 
+/// The built-in syscalls, indexed by syscall id. The table doesn't depend on the host, so it is
+/// built at compile time and shared by every runtime.
+static BUILTIN_SYSCALLS: [Option<SyscallCode>; SYSCALL_TABLE_SIZE] = {
+  let mut table = [None; SYSCALL_TABLE_SIZE];
+  let mut i = 0;
+  while i < SyscallCode::ALL.len() {
+    let code = SyscallCode::ALL[i];
+    table[code as usize % SYSCALL_TABLE_SIZE] = Some(code);
+    i += 1;
+  }
+  table
+};
+
+/// Runs `$body` with `$syscall` bound to the implementation of the built-in syscall `$code`.
+macro_rules! with_builtin {
+  ($code:expr, $syscall:ident => $body:expr) => {
+    match $code {
+      SyscallCode::HALT => {
+        let $syscall = SyscallHalt::new();
+        $body
+      }
+      SyscallCode::WRITE => {
+        let $syscall = SyscallWrite::new();
+        $body
+      }
+      SyscallCode::HOST_READ => {
+        let $syscall = SyscallHostRead::new();
+        $body
+      }
+      SyscallCode::HOST_WRITE => {
+        let $syscall = SyscallHostWrite::new();
+        $body
+      }
+      SyscallCode::HOST_READ_MANY => {
+        let $syscall = SyscallHostReadMany::new();
+        $body
+      }
+      SyscallCode::HOST_WRITE_MANY => {
+        let $syscall = SyscallHostWriteMany::new();
+        $body
+      }
+      SyscallCode::MEMCPY | SyscallCode::MEMMOVE => {
+        let $syscall = SyscallMemcpy::new();
+        $body
+      }
+      SyscallCode::MEMSET => {
+        let $syscall = SyscallMemset::new();
+        $body
+      }
+      SyscallCode::KECCAK256 => {
+        let $syscall = SyscallKeccak256::new();
+        $body
+      }
+      SyscallCode::SHA256 => {
+        let $syscall = SyscallSha256::new();
+        $body
+      }
+      SyscallCode::ED25519_VERIFY => {
+        let $syscall = SyscallEd25519Verify::new();
+        $body
+      }
+      SyscallCode::HINT_LEN => {
+        let $syscall = SyscallHintLen::new();
+        $body
+      }
+      SyscallCode::HINT_READ => {
+        let $syscall = SyscallHintRead::new();
+        $body
+      }
+    }
+  };
+}
+
 impl SyscallCode {
-  /// Create a syscall from a u32.
-  pub fn from_u32(value: u32) -> Self {
-    match value {
-      0x00_00_00_00 => SyscallCode::HALT,
-      0x00_00_00_02 => SyscallCode::WRITE,
-      0x00_00_00_A0 => SyscallCode::HOST_READ,
-      0x00_00_00_A1 => SyscallCode::HOST_WRITE,
-      0x00_00_00_F0 => SyscallCode::HINT_LEN,
-      0x00_00_00_F1 => SyscallCode::HINT_READ,
-      _ => panic!("invalid syscall number: {}", value),
+  /// Every built-in syscall.
+  pub const ALL: [SyscallCode; 14] = [
+    SyscallCode::HALT,
+    SyscallCode::WRITE,
+    SyscallCode::HOST_READ,
+    SyscallCode::HOST_WRITE,
+    SyscallCode::HOST_READ_MANY,
+    SyscallCode::HOST_WRITE_MANY,
+    SyscallCode::MEMCPY,
+    SyscallCode::MEMMOVE,
+    SyscallCode::MEMSET,
+    SyscallCode::KECCAK256,
+    SyscallCode::SHA256,
+    SyscallCode::ED25519_VERIFY,
+    SyscallCode::HINT_LEN,
+    SyscallCode::HINT_READ,
+  ];
+
+  /// The maximum number of extra cycles taken by a built-in syscall.
+  pub const MAX_EXTRA_CYCLES: u32 = {
+    let mut max = 0;
+    let mut i = 0;
+    while i < Self::ALL.len() {
+      let cycles = (Self::ALL[i] as u32 >> 16) & 0xff;
+      if cycles > max {
+        max = cycles;
+      }
+      i += 1;
     }
+    max
+  };
+
+  /// Create a syscall from a u32, or `None` if it isn't a built-in syscall number.
+  #[inline]
+  pub fn from_u32(value: u32) -> Option<Self> {
+    BUILTIN_SYSCALLS[value as usize % SYSCALL_TABLE_SIZE].filter(|code| *code as u32 == value)
   }
 
   pub fn syscall_id(&self) -> u32 {
@@ -62,6 +180,17 @@ impl SyscallCode {
   pub fn num_cycles(&self) -> u32 {
     (*self as u32).to_le_bytes()[2].into()
   }
+
+  /// Whether the syscall is served by calling the host.
+  pub fn calls_host(&self) -> bool {
+    matches!(
+      self,
+      SyscallCode::HOST_READ
+        | SyscallCode::HOST_WRITE
+        | SyscallCode::HOST_READ_MANY
+        | SyscallCode::HOST_WRITE_MANY
+    )
+  }
 }
 
 pub trait Syscall<T: HostInterface>: Send + Sync {
@@ -70,7 +199,14 @@ pub trait Syscall<T: HostInterface>: Send + Sync {
   /// is that the return value is only for system calls such as `HALT`. Most precompiles use `arg1`
   /// and `arg2` to denote the addresses of the input data, and write the result to the memory at
   /// `arg1`.
-  fn execute(&self, ctx: &mut SyscallContext<T>, arg1: u32, arg2: u32) -> Option<u32>;
+  ///
+  /// An error fails the execution, e.g. if the guest passed invalid arguments.
+  fn execute(
+    &self,
+    ctx: &mut SyscallContext<T>,
+    arg1: u32,
+    arg2: u32,
+  ) -> Result<Option<u32>, ExecutionError>;
 
   /// The number of extra cycles that the syscall takes to execute. Unless this syscall is complex
   /// and requires many cycles, this should be zero.
@@ -86,6 +222,12 @@ pub struct SyscallContext<'a, T: HostInterface> {
   pub(crate) next_pc: u32,
   /// This is the exit_code used for the HALT syscall
   pub(crate) exit_code: u32,
+  /// Whether memory accesses create records and update timestamps (see [Runtime::run_fast]).
+  pub(crate) traced: bool,
+  /// The hint input borrowed by the execution, read ahead of the runtime's input stream.
+  pub(crate) input: &'a [&'a [u8]],
+  /// The cycles charged with [Self::charge_cycles], on top of [Syscall::num_extra_cycles].
+  pub(crate) charged_cycles: u32,
   pub(crate) rt: &'a mut Runtime<T>,
 }
 
@@ -99,6 +241,9 @@ where
       clk,
       next_pc: runtime.state.pc.wrapping_add(4),
       exit_code: 0,
+      traced: true,
+      input: &[],
+      charged_cycles: 0,
       rt: runtime,
     }
   }
@@ -108,13 +253,17 @@ where
   }
 
   pub fn mr(&mut self, addr: u32) -> (MemoryReadRecord, u32) {
-    let record = self.rt.mr(addr, self.clk);
+    let record = if self.traced {
+      self.rt.mr(addr, self.clk)
+    } else {
+      MemoryReadRecord::untimed(self.rt.mr_fast(addr))
+    };
     (record, record.value)
   }
 
   pub fn mr_slice(&mut self, addr: u32, len: usize) -> (Vec<MemoryReadRecord>, Vec<u32>) {
-    let mut records = Vec::new();
-    let mut values = Vec::new();
+    let mut records = Vec::with_capacity(len);
+    let mut values = Vec::with_capacity(len);
     for i in 0..len {
       let (record, value) = self.mr(addr + i as u32 * 4);
       records.push(record);
@@ -124,11 +273,16 @@ where
   }
 
   pub fn mw(&mut self, addr: u32, value: u32) -> MemoryWriteRecord {
-    self.rt.mw(addr, value, self.clk)
+    if self.traced {
+      self.rt.mw(addr, value, self.clk)
+    } else {
+      self.rt.mw_fast(addr, value);
+      MemoryWriteRecord::untimed(value)
+    }
   }
 
   pub fn mw_slice(&mut self, addr: u32, values: &[u32]) -> Vec<MemoryWriteRecord> {
-    let mut records = Vec::new();
+    let mut records = Vec::with_capacity(values.len());
     for i in 0..values.len() {
       let record = self.mw(addr + i as u32 * 4, values[i]);
       records.push(record);
@@ -136,6 +290,18 @@ where
     records
   }
 
+  /// Write consecutive words to memory, for callers which don't need the access records.
+  pub fn mw_words(&mut self, addr: u32, values: &[u32]) {
+    for (i, value) in values.iter().enumerate() {
+      let addr = addr + i as u32 * 4;
+      if self.traced {
+        self.rt.mw(addr, *value, self.clk);
+      } else {
+        self.rt.mw_fast(addr, *value);
+      }
+    }
+  }
+
   /// Get the current value of a register, but doesn't use a memory record.
   /// This is generally unconstrained, so you must be careful using it.
   pub fn register_unsafe(&self, register: Register) -> u32 {
@@ -158,6 +324,21 @@ where
     values
   }
 
+  /// Charges `cycles` on top of [Syscall::num_extra_cycles], for syscalls whose cost depends on
+  /// their arguments. Metered executions pay for the cycles in gas right away, so this fails
+  /// before any work is done if there isn't enough gas left.
+  pub fn charge_cycles(&mut self, cycles: u32) -> Result<(), ExecutionError> {
+    self.rt.charge_gas(cycles as u64)?;
+    self.charged_cycles += cycles;
+    Ok(())
+  }
+
+  /// Fails with [ExecutionError::OutOfMemory] if writing the `len` bytes from `addr` would grow
+  /// guest memory past the memory limit, so that large writes fail before any work is done.
+  pub fn check_memory_write(&self, addr: u32, len: u32) -> Result<(), ExecutionError> {
+    self.rt.check_memory_write(addr, len)
+  }
+
   pub fn set_next_pc(&mut self, next_pc: u32) {
     self.next_pc = next_pc;
   }
@@ -167,47 +348,206 @@ where
   }
 }
 
-pub fn default_syscall_map<T: HostInterface>() -> HashMap<SyscallCode, Arc<dyn Syscall<T>>> {
-  let mut syscall_map = HashMap::<SyscallCode, Arc<dyn Syscall<T>>>::default();
-  syscall_map.insert(SyscallCode::HALT, Arc::new(SyscallHalt {}));
-  syscall_map.insert(SyscallCode::WRITE, Arc::new(SyscallWrite::new()));
-  syscall_map.insert(SyscallCode::HOST_READ, Arc::new(SyscallHostRead::new()));
-  syscall_map.insert(SyscallCode::HOST_WRITE, Arc::new(SyscallHostWrite::new()));
-  syscall_map.insert(SyscallCode::HINT_LEN, Arc::new(SyscallHintLen::new()));
-  syscall_map.insert(SyscallCode::HINT_READ, Arc::new(SyscallHintRead::new()));
+/// A built-in syscall is its own implementation, which dispatches to the syscall's type with a
+/// `match`, so built-in syscalls need no allocated table.
+impl<T: HostInterface> Syscall<T> for SyscallCode {
+  #[inline]
+  fn execute(
+    &self,
+    ctx: &mut SyscallContext<T>,
+    arg1: u32,
+    arg2: u32,
+  ) -> Result<Option<u32>, ExecutionError> {
+    with_builtin!(self, syscall => syscall.execute(ctx, arg1, arg2))
+  }
+
+  fn num_extra_cycles(&self) -> u32 {
+    with_builtin!(self, syscall => Syscall::<T>::num_extra_cycles(&syscall))
+  }
+}
+
+/// The number of entries in a [SyscallTable], one for every possible syscall id byte.
+const SYSCALL_TABLE_SIZE: usize = 256;
 
-  syscall_map
+struct SyscallEntry<T: HostInterface> {
+  code: u32,
+  syscall: Arc<dyn Syscall<T>>,
+}
+
+impl<T: HostInterface> Clone for SyscallEntry<T> {
+  fn clone(&self) -> Self {
+    Self {
+      code: self.code,
+      syscall: self.syscall.clone(),
+    }
+  }
+}
+
+/// A dispatch table of syscalls, indexed by the syscall id (the first byte of the syscall number).
+///
+/// Looking up a syscall is a single array index, so the table is cheap to consult on every
+/// `ecall`. Runtimes only hold one for custom syscalls, see [Runtime::register_syscall]: the
+/// built-in ones are found in a table shared by every runtime, see [SyscallCode::from_u32].
+pub struct SyscallTable<T: HostInterface> {
+  entries: Box<[Option<SyscallEntry<T>>]>,
+  max_extra_cycles: u32,
+}
+
+impl<T: HostInterface> SyscallTable<T> {
+  /// Creates a table without any syscalls.
+  pub fn empty() -> Self {
+    Self {
+      entries: vec![None; SYSCALL_TABLE_SIZE].into_boxed_slice(),
+      max_extra_cycles: 0,
+    }
+  }
+
+  /// Registers `syscall` under the syscall number `code`, returning the syscall it replaces.
+  ///
+  /// Only one syscall can be registered per syscall id, so this also replaces a syscall with a
+  /// different number sharing the id of `code`.
+  pub fn register(
+    &mut self,
+    code: u32,
+    syscall: Arc<dyn Syscall<T>>,
+  ) -> Option<Arc<dyn Syscall<T>>> {
+    self.max_extra_cycles = self.max_extra_cycles.max(syscall.num_extra_cycles());
+    let entry = SyscallEntry { code, syscall };
+    self.entries[Self::index(code)]
+      .replace(entry)
+      .map(|entry| entry.syscall)
+  }
+
+  /// Returns the syscall registered under the syscall number `code`.
+  #[inline]
+  pub fn get(&self, code: u32) -> Option<&Arc<dyn Syscall<T>>> {
+    match &self.entries[Self::index(code)] {
+      Some(entry) if entry.code == code => Some(&entry.syscall),
+      _ => None,
+    }
+  }
+
+  /// Whether a syscall is registered under the syscall id of `code`, whatever its number.
+  #[inline]
+  pub fn has_id(&self, code: u32) -> bool {
+    self.entries[Self::index(code)].is_some()
+  }
+
+  /// Iterates over the registered syscalls and their numbers.
+  pub fn iter(&self) -> impl Iterator<Item = (u32, &Arc<dyn Syscall<T>>)> {
+    self
+      .entries
+      .iter()
+      .flatten()
+      .map(|entry| (entry.code, &entry.syscall))
+  }
+
+  /// The maximum number of extra cycles taken by any registered syscall.
+  pub fn max_extra_cycles(&self) -> u32 {
+    self.max_extra_cycles
+  }
+
+  #[inline]
+  fn index(code: u32) -> usize {
+    code as usize % SYSCALL_TABLE_SIZE
+  }
+}
+
+impl<T: HostInterface> Clone for SyscallTable<T> {
+  fn clone(&self) -> Self {
+    Self {
+      entries: self.entries.clone(),
+      max_extra_cycles: self.max_extra_cycles,
+    }
+  }
+}
+
+impl<T: HostInterface> Default for SyscallTable<T> {
+  /// Creates a table of the syscalls built into the VM.
+  fn default() -> Self {
+    let mut table = Self::empty();
+    for code in SyscallCode::ALL {
+      table.register(code as u32, Arc::new(code));
+    }
+    table
+  }
 }
 
 #[cfg(test)]
 mod tests {
-  use super::{default_syscall_map, SyscallCode};
+  use std::sync::Arc;
+
+  use super::{ExecutionError, Syscall, SyscallCode, SyscallContext, SyscallTable};
   use athena_interface::MockHost;
   use strum::IntoEnumIterator;
 
   #[test]
   fn test_syscalls_in_default_map() {
-    let default_syscall_map = default_syscall_map::<MockHost>();
+    let table = SyscallTable::<MockHost>::default();
     for code in SyscallCode::iter() {
-      default_syscall_map.get(&code).unwrap();
+      table.get(code as u32).unwrap();
     }
   }
 
   #[test]
   fn test_syscall_num_cycles_encoding() {
-    for (syscall_code, syscall_impl) in default_syscall_map::<MockHost>().iter() {
-      let encoded_num_cycles = syscall_code.num_cycles();
+    for (syscall_code, syscall_impl) in SyscallTable::<MockHost>::default().iter() {
+      let encoded_num_cycles = SyscallCode::from_u32(syscall_code).unwrap().num_cycles();
       assert_eq!(syscall_impl.num_extra_cycles(), encoded_num_cycles);
     }
   }
 
   #[test]
   fn test_encoding_roundtrip() {
-    for (syscall_code, _) in default_syscall_map::<MockHost>().iter() {
-      assert_eq!(SyscallCode::from_u32(*syscall_code as u32), *syscall_code);
+    for code in SyscallCode::iter() {
+      assert_eq!(SyscallCode::from_u32(code as u32), Some(code));
+    }
+    assert_eq!(SyscallCode::from_u32(0x00_00_00_01), None);
+    assert_eq!(
+      SyscallCode::ALL.to_vec(),
+      SyscallCode::iter().collect::<Vec<_>>()
+    );
+    assert_eq!(
+      SyscallCode::MAX_EXTRA_CYCLES,
+      SyscallCode::iter()
+        .map(|code| code.num_cycles())
+        .max()
+        .unwrap()
+    );
+  }
+
+  struct SyscallNoop;
+
+  impl Syscall<MockHost> for SyscallNoop {
+    fn execute(
+      &self,
+      _: &mut SyscallContext<MockHost>,
+      _: u32,
+      _: u32,
+    ) -> Result<Option<u32>, ExecutionError> {
+      Ok(None)
     }
   }
 
+  #[test]
+  fn test_syscall_table_lookup() {
+    let mut table = SyscallTable::<MockHost>::default();
+    assert!(table.get(0x00_00_00_01).is_none());
+    // Only the id byte indexes the table, but the whole number must match.
+    assert!(table
+      .get(SyscallCode::HOST_READ as u32 | 0x00_01_00_00)
+      .is_none());
+
+    assert!(table
+      .register(0x00_00_00_01, Arc::new(SyscallNoop))
+      .is_none());
+    assert!(table.get(0x00_00_00_01).is_some());
+    assert!(table
+      .register(SyscallCode::WRITE as u32, Arc::new(SyscallNoop))
+      .is_some());
+    assert_eq!(table.iter().count(), SyscallCode::iter().count() + 1);
+  }
+
   #[test]
   /// Check that the Syscall number match the VM crate's.
   fn test_syscall_consistency_vm() {
@@ -217,6 +557,20 @@ mod tests {
         SyscallCode::WRITE => assert_eq!(code as u32, athena_vm::syscalls::WRITE),
         SyscallCode::HOST_READ => assert_eq!(code as u32, athena_vm::syscalls::HOST_READ),
         SyscallCode::HOST_WRITE => assert_eq!(code as u32, athena_vm::syscalls::HOST_WRITE),
+        SyscallCode::HOST_READ_MANY => {
+          assert_eq!(code as u32, athena_vm::syscalls::HOST_READ_MANY)
+        }
+        SyscallCode::HOST_WRITE_MANY => {
+          assert_eq!(code as u32, athena_vm::syscalls::HOST_WRITE_MANY)
+        }
+        SyscallCode::MEMCPY => assert_eq!(code as u32, athena_vm::syscalls::MEMCPY),
+        SyscallCode::MEMMOVE => assert_eq!(code as u32, athena_vm::syscalls::MEMMOVE),
+        SyscallCode::MEMSET => assert_eq!(code as u32, athena_vm::syscalls::MEMSET),
+        SyscallCode::KECCAK256 => assert_eq!(code as u32, athena_vm::syscalls::KECCAK256),
+        SyscallCode::SHA256 => assert_eq!(code as u32, athena_vm::syscalls::SHA256),
+        SyscallCode::ED25519_VERIFY => {
+          assert_eq!(code as u32, athena_vm::syscalls::ED25519_VERIFY)
+        }
         SyscallCode::HINT_LEN => assert_eq!(code as u32, athena_vm::syscalls::HINT_LEN),
         SyscallCode::HINT_READ => assert_eq!(code as u32, athena_vm::syscalls::HINT_READ),
       }
@@ -0,0 +1,572 @@
+use std::cell::UnsafeCell;
+use std::fs::File;
+use std::io::{self, BufWriter, Write};
+use std::mem::MaybeUninit;
+use std::ops::Range;
+use std::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+use std::sync::Arc;
+use std::thread::{self, JoinHandle};
+
+use thiserror::Error;
+
+use super::{Instruction, Opcode};
+
+/// The first bytes of a trace file.
+pub const TRACE_MAGIC: [u8; 4] = *b"ATHT";
+
+/// The version of the trace format written by [TraceWriter].
+///
+/// A trace starts with [TRACE_MAGIC], the version byte, the sampling interval as a varint and
+/// the traced pc range as two little-endian `u32`s. Each record then holds:
+/// - the clock delta since the previous record, as a varint,
+/// - the pc delta since the previous record, as a zigzag varint,
+/// - a byte of [TraceRecord] flags,
+/// - the register written, if any: its index, then the delta since the last value recorded for
+///   it as a zigzag varint,
+/// - the memory word accessed, if any: the address delta since the previous access as a zigzag
+///   varint, then the value as a varint.
+pub const TRACE_VERSION: u8 = 1;
+
+const REGISTER_WRITE: u8 = 1 << 0;
+const MEMORY_READ: u8 = 1 << 1;
+const MEMORY_WRITE: u8 = 1 << 2;
+
+/// What to trace, read from the environment by [TraceConfig::from_env].
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct TraceConfig {
+  /// The file the trace is written to.
+  pub path: String,
+  /// Only every `sample`th instruction is traced.
+  pub sample: u32,
+  /// Only the instructions in this range are traced.
+  pub pc_range: Range<u32>,
+}
+
+impl TraceConfig {
+  /// Traces every instruction to `path`.
+  pub fn new(path: impl Into<String>) -> Self {
+    Self {
+      path: path.into(),
+      sample: 1,
+      pc_range: 0..u32::MAX,
+    }
+  }
+
+  /// Returns the configuration if `TRACE_FILE` is set. `TRACE_SAMPLE` sets the sampling interval
+  /// and `TRACE_PC_RANGE` the traced pcs, as `start..end` in hex or decimal.
+  pub fn from_env() -> Option<Self> {
+    let mut config = Self::new(std::env::var("TRACE_FILE").ok()?);
+    if let Ok(sample) = std::env::var("TRACE_SAMPLE") {
+      config.sample = sample
+        .parse::<u32>()
+        .ok()
+        .filter(|sample| *sample > 0)
+        .expect("TRACE_SAMPLE must be a positive integer");
+    }
+    if let Ok(range) = std::env::var("TRACE_PC_RANGE") {
+      config.pc_range = parse_pc_range(&range).expect("TRACE_PC_RANGE must be start..end");
+    }
+    Some(config)
+  }
+
+  /// Whether the instruction executed at `clk` and `pc` is traced.
+  #[inline]
+  pub fn traces(&self, clk: u64, pc: u32) -> bool {
+    clk % self.sample as u64 == 0 && self.pc_range.contains(&pc)
+  }
+}
+
+fn parse_pc_range(range: &str) -> Option<Range<u32>> {
+  let parse = |pc: &str| match pc.trim().strip_prefix("0x") {
+    Some(hex) => u32::from_str_radix(hex, 16).ok(),
+    None => pc.trim().parse().ok(),
+  };
+  let (start, end) = range.split_once("..")?;
+  Some(parse(start)?..parse(end)?)
+}
+
+/// A memory word accessed by an instruction.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct TraceMemoryAccess {
+  pub addr: u32,
+  /// The value read, or written by the instruction.
+  pub value: u32,
+  pub write: bool,
+}
+
+/// An instruction of a trace.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct TraceRecord {
+  pub clk: u64,
+  pub pc: u32,
+  /// The register written by the instruction and its new value.
+  pub register: Option<(u8, u32)>,
+  /// The memory word accessed by a load or store.
+  pub memory: Option<TraceMemoryAccess>,
+}
+
+impl TraceRecord {
+  /// Whether `instruction` writes its first operand register.
+  pub(crate) const fn writes_register(instruction: &Instruction) -> bool {
+    instruction.is_alu_instruction()
+      || instruction.is_jump_instruction()
+      || matches!(
+        instruction.opcode,
+        Opcode::LB
+          | Opcode::LH
+          | Opcode::LW
+          | Opcode::LBU
+          | Opcode::LHU
+          | Opcode::AUIPC
+          | Opcode::ECALL
+      )
+  }
+}
+
+#[derive(Error, Debug, PartialEq, Eq)]
+pub enum TraceError {
+  #[error("not a trace file")]
+  InvalidMagic,
+  #[error("unsupported trace version {0}")]
+  UnsupportedVersion(u8),
+  #[error("truncated trace")]
+  Truncated,
+  #[error("invalid ELF: {0}")]
+  InvalidElf(String),
+}
+
+/// The header of a trace.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct TraceHeader {
+  pub sample: u32,
+  pub pc_range: Range<u32>,
+}
+
+impl TraceHeader {
+  pub fn encode(&self, out: &mut Vec<u8>) {
+    out.extend_from_slice(&TRACE_MAGIC);
+    out.push(TRACE_VERSION);
+    write_varint(out, self.sample as u64);
+    out.extend_from_slice(&self.pc_range.start.to_le_bytes());
+    out.extend_from_slice(&self.pc_range.end.to_le_bytes());
+  }
+
+  /// Decodes the header at the start of `input`, advancing it past the header.
+  pub fn decode(input: &mut &[u8]) -> Result<Self, TraceError> {
+    if take(input, 4)? != TRACE_MAGIC {
+      return Err(TraceError::InvalidMagic);
+    }
+    let version = take(input, 1)?[0];
+    if version != TRACE_VERSION {
+      return Err(TraceError::UnsupportedVersion(version));
+    }
+    let sample = read_varint(input)? as u32;
+    let start = u32::from_le_bytes(take(input, 4)?.try_into().unwrap());
+    let end = u32::from_le_bytes(take(input, 4)?.try_into().unwrap());
+    Ok(Self {
+      sample,
+      pc_range: start..end,
+    })
+  }
+}
+
+/// The previous values records are delta-encoded against, shared by the encoder and decoder.
+#[derive(Debug, Clone, Default)]
+pub struct TraceCodec {
+  clk: u64,
+  pc: u32,
+  addr: u32,
+  registers: [u32; 32],
+}
+
+impl TraceCodec {
+  pub fn encode(&mut self, record: &TraceRecord, out: &mut Vec<u8>) {
+    write_varint(out, record.clk - self.clk);
+    write_varint(out, zigzag(record.pc.wrapping_sub(self.pc)));
+    let mut flags = 0;
+    if record.register.is_some() {
+      flags |= REGISTER_WRITE;
+    }
+    match record.memory {
+      Some(TraceMemoryAccess { write: true, .. }) => flags |= MEMORY_WRITE,
+      Some(TraceMemoryAccess { write: false, .. }) => flags |= MEMORY_READ,
+      None => {}
+    }
+    out.push(flags);
+    if let Some((register, value)) = record.register {
+      out.push(register);
+      let last = &mut self.registers[register as usize % 32];
+      write_varint(out, zigzag(value.wrapping_sub(*last)));
+      *last = value;
+    }
+    if let Some(access) = record.memory {
+      write_varint(out, zigzag(access.addr.wrapping_sub(self.addr)));
+      write_varint(out, access.value as u64);
+      self.addr = access.addr;
+    }
+    self.clk = record.clk;
+    self.pc = record.pc;
+  }
+
+  /// Decodes the record at the start of `input`, advancing it past the record.
+  pub fn decode(&mut self, input: &mut &[u8]) -> Result<TraceRecord, TraceError> {
+    let clk = self.clk + read_varint(input)?;
+    let pc = self.pc.wrapping_add(unzigzag(read_varint(input)?));
+    let flags = take(input, 1)?[0];
+    let register = if flags & REGISTER_WRITE != 0 {
+      let register = take(input, 1)?[0];
+      let last = &mut self.registers[register as usize % 32];
+      *last = last.wrapping_add(unzigzag(read_varint(input)?));
+      Some((register, *last))
+    } else {
+      None
+    };
+    let memory = if flags & (MEMORY_READ | MEMORY_WRITE) != 0 {
+      self.addr = self.addr.wrapping_add(unzigzag(read_varint(input)?));
+      Some(TraceMemoryAccess {
+        addr: self.addr,
+        value: read_varint(input)? as u32,
+        write: flags & MEMORY_WRITE != 0,
+      })
+    } else {
+      None
+    };
+    self.clk = clk;
+    self.pc = pc;
+    Ok(TraceRecord {
+      clk,
+      pc,
+      register,
+      memory,
+    })
+  }
+}
+
+const fn zigzag(delta: u32) -> u64 {
+  let delta = delta as i32;
+  ((delta << 1) ^ (delta >> 31)) as u32 as u64
+}
+
+const fn unzigzag(value: u64) -> u32 {
+  let value = value as u32;
+  (value >> 1) ^ (value & 1).wrapping_neg()
+}
+
+fn write_varint(out: &mut Vec<u8>, mut value: u64) {
+  while value >= 0x80 {
+    out.push(value as u8 | 0x80);
+    value >>= 7;
+  }
+  out.push(value as u8);
+}
+
+fn read_varint(input: &mut &[u8]) -> Result<u64, TraceError> {
+  let mut value = 0;
+  for shift in (0..64).step_by(7) {
+    let byte = take(input, 1)?[0];
+    value |= ((byte & 0x7f) as u64) << shift;
+    if byte < 0x80 {
+      return Ok(value);
+    }
+  }
+  Err(TraceError::Truncated)
+}
+
+fn take<'a>(input: &mut &'a [u8], len: usize) -> Result<&'a [u8], TraceError> {
+  if input.len() < len {
+    return Err(TraceError::Truncated);
+  }
+  let (head, tail) = input.split_at(len);
+  *input = tail;
+  Ok(head)
+}
+
+/// A bounded queue with a single producer and a single consumer, neither of which ever blocks
+/// the other.
+struct SpscQueue<T> {
+  slots: Box<[UnsafeCell<MaybeUninit<T>>]>,
+  /// The number of values popped so far. Only written by the consumer.
+  head: AtomicUsize,
+  /// The number of values pushed so far. Only written by the producer.
+  tail: AtomicUsize,
+  closed: AtomicBool,
+}
+
+// SAFETY: a slot is only accessed by the producer before it is published by `tail`, and by the
+// consumer after that until it is released by `head`.
+unsafe impl<T: Send> Sync for SpscQueue<T> {}
+
+impl<T> SpscQueue<T> {
+  fn new(capacity: usize) -> Self {
+    Self {
+      slots: (0..capacity)
+        .map(|_| UnsafeCell::new(MaybeUninit::uninit()))
+        .collect(),
+      head: AtomicUsize::new(0),
+      tail: AtomicUsize::new(0),
+      closed: AtomicBool::new(false),
+    }
+  }
+
+  /// Pushes `value`, or returns it if the queue is full. Must only be called by the producer.
+  fn push(&self, value: T) -> Result<(), T> {
+    let tail = self.tail.load(Ordering::Relaxed);
+    if tail - self.head.load(Ordering::Acquire) == self.slots.len() {
+      return Err(value);
+    }
+    unsafe { (*self.slots[tail % self.slots.len()].get()).write(value) };
+    self.tail.store(tail + 1, Ordering::Release);
+    Ok(())
+  }
+
+  /// Must only be called by the consumer.
+  fn pop(&self) -> Option<T> {
+    let head = self.head.load(Ordering::Relaxed);
+    if head == self.tail.load(Ordering::Acquire) {
+      return None;
+    }
+    let value = unsafe { (*self.slots[head % self.slots.len()].get()).assume_init_read() };
+    self.head.store(head + 1, Ordering::Release);
+    Some(value)
+  }
+}
+
+impl<T> Drop for SpscQueue<T> {
+  fn drop(&mut self) {
+    while self.pop().is_some() {}
+  }
+}
+
+/// Writes a trace to a file from a background thread.
+///
+/// Records are encoded into chunks which are handed to the writer thread through a lock-free
+/// queue, so the execution only waits for the file when the queue is full. If writing the file
+/// fails, the error is logged and the writer stops, see [TraceWriter::is_stopped].
+pub struct TraceWriter {
+  config: TraceConfig,
+  codec: TraceCodec,
+  chunk: Vec<u8>,
+  queue: Arc<SpscQueue<Vec<u8>>>,
+  thread: Option<JoinHandle<io::Result<()>>>,
+}
+
+impl TraceWriter {
+  /// The size of the chunks handed to the writer thread.
+  const CHUNK_SIZE: usize = 64 * 1024;
+  /// The number of chunks which can wait for the writer thread.
+  const QUEUE_CAPACITY: usize = 64;
+
+  /// Creates the trace file and starts the thread writing it.
+  pub fn create(config: TraceConfig) -> io::Result<Self> {
+    let mut file = BufWriter::new(File::create(&config.path)?);
+    let queue = Arc::new(SpscQueue::<Vec<u8>>::new(Self::QUEUE_CAPACITY));
+    let consumer = queue.clone();
+    let thread = thread::Builder::new()
+      .name("trace-writer".to_string())
+      .spawn(move || {
+        loop {
+          match consumer.pop() {
+            Some(chunk) => file.write_all(&chunk)?,
+            // Values pushed before closing are still popped before stopping.
+            None if consumer.closed.load(Ordering::Acquire) => match consumer.pop() {
+              Some(chunk) => file.write_all(&chunk)?,
+              None => break,
+            },
+            None => thread::park(),
+          }
+        }
+        file.flush()
+      })?;
+
+    let mut chunk = Vec::with_capacity(Self::CHUNK_SIZE);
+    TraceHeader {
+      sample: config.sample,
+      pc_range: config.pc_range.clone(),
+    }
+    .encode(&mut chunk);
+    Ok(Self {
+      config,
+      codec: TraceCodec::default(),
+      chunk,
+      queue,
+      thread: Some(thread),
+    })
+  }
+
+  pub fn config(&self) -> &TraceConfig {
+    &self.config
+  }
+
+  /// Whether the writer thread stopped after failing to write the file, so that no more records
+  /// are written.
+  pub fn is_stopped(&self) -> bool {
+    self.thread.is_none()
+  }
+
+  #[inline]
+  pub fn record(&mut self, record: &TraceRecord) {
+    if self.is_stopped() {
+      return;
+    }
+    self.codec.encode(record, &mut self.chunk);
+    if self.chunk.len() >= Self::CHUNK_SIZE {
+      self.send();
+    }
+  }
+
+  /// Hands the records so far to the writer thread.
+  pub fn flush(&mut self) {
+    if !self.chunk.is_empty() {
+      self.send();
+    }
+  }
+
+  fn send(&mut self) {
+    let Some(handle) = &self.thread else {
+      self.chunk.clear();
+      return;
+    };
+    let thread = handle.thread().clone();
+    let mut chunk = std::mem::replace(&mut self.chunk, Vec::with_capacity(Self::CHUNK_SIZE));
+    while let Err(full) = self.queue.push(chunk) {
+      // The writer thread only stops early when it fails, and would never empty the queue.
+      if self.thread.as_ref().is_some_and(JoinHandle::is_finished) {
+        self.join();
+        return;
+      }
+      chunk = full;
+      thread.unpark();
+      thread::yield_now();
+    }
+    thread.unpark();
+  }
+
+  /// Waits for the writer thread to stop, logging why it failed if it did.
+  fn join(&mut self) {
+    let Some(thread) = self.thread.take() else {
+      return;
+    };
+    thread.thread().unpark();
+    match thread.join() {
+      Ok(Ok(())) => {}
+      Ok(Err(err)) => log::error!("failed to write trace to {}: {err}", self.config.path),
+      Err(_) => log::error!("trace writer thread panicked"),
+    }
+  }
+}
+
+impl Drop for TraceWriter {
+  fn drop(&mut self) {
+    self.flush();
+    self.queue.closed.store(true, Ordering::Release);
+    self.join();
+  }
+}
+
+#[cfg(test)]
+mod tests {
+  use super::*;
+
+  #[test]
+  fn test_codec_round_trip() {
+    let records = [
+      TraceRecord {
+        clk: 0,
+        pc: 0x20_0000,
+        register: Some((10, 7)),
+        memory: None,
+      },
+      TraceRecord {
+        clk: 3,
+        pc: 0x1f_fff0,
+        register: Some((10, 2)),
+        memory: Some(TraceMemoryAccess {
+          addr: 0x7000,
+          value: u32::MAX,
+          write: false,
+        }),
+      },
+      TraceRecord {
+        clk: 4,
+        pc: 0x1f_fff4,
+        register: None,
+        memory: Some(TraceMemoryAccess {
+          addr: 0x6ffc,
+          value: 1,
+          write: true,
+        }),
+      },
+    ];
+    let header = TraceHeader {
+      sample: 3,
+      pc_range: 0x1000..0x30_0000,
+    };
+    let mut bytes = Vec::new();
+    header.encode(&mut bytes);
+    let mut encoder = TraceCodec::default();
+    for record in &records {
+      encoder.encode(record, &mut bytes);
+    }
+
+    let mut input = &bytes[..];
+    assert_eq!(TraceHeader::decode(&mut input), Ok(header));
+    let mut decoder = TraceCodec::default();
+    for record in &records {
+      assert_eq!(decoder.decode(&mut input).as_ref(), Ok(record));
+    }
+    assert!(input.is_empty());
+    assert_eq!(decoder.decode(&mut input), Err(TraceError::Truncated));
+  }
+
+  #[test]
+  fn test_parse_pc_range() {
+    assert_eq!(parse_pc_range("0x1000..0x2000"), Some(0x1000..0x2000));
+    assert_eq!(parse_pc_range("16..32"), Some(16..32));
+    assert_eq!(parse_pc_range("16"), None);
+  }
+
+  #[test]
+  fn test_queue_keeps_order_across_threads() {
+    let queue = Arc::new(SpscQueue::new(4));
+    let consumer = queue.clone();
+    let received = thread::spawn(move || {
+      let mut received = Vec::new();
+      while received.len() < 1000 {
+        match consumer.pop() {
+          Some(value) => received.push(value),
+          None => thread::yield_now(),
+        }
+      }
+      received
+    });
+    for mut value in 0..1000 {
+      while let Err(full) = queue.push(value) {
+        assert!(!received.is_finished(), "consumer stopped early");
+        value = full;
+        thread::yield_now();
+      }
+    }
+    assert_eq!(received.join().unwrap(), (0..1000).collect::<Vec<_>>());
+  }
+
+  #[cfg(target_os = "linux")]
+  #[test]
+  fn test_writer_stops_when_writing_fails() {
+    // Writes to /dev/full fail.
+    let mut writer = TraceWriter::create(TraceConfig::new("/dev/full")).unwrap();
+    // Every record takes at least a byte, so this fills more chunks than the queue holds.
+    let records = (TraceWriter::QUEUE_CAPACITY + 2) * TraceWriter::CHUNK_SIZE;
+    for clk in 0..records as u64 {
+      writer.record(&TraceRecord {
+        clk,
+        pc: 0x20_0000,
+        register: None,
+        memory: None,
+      });
+      if writer.is_stopped() {
+        break;
+      }
+    }
+    assert!(writer.is_stopped());
+  }
+}
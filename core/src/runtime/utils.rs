@@ -1,8 +1,6 @@
-use std::io::Write;
-
 use athena_interface::HostInterface;
 
-use super::{Instruction, Runtime};
+use super::{Instruction, Opcode, Runtime, TraceMemoryAccess, TraceRecord};
 use crate::runtime::Register;
 
 pub const fn align(addr: u32) -> u32 {
@@ -35,13 +33,6 @@ where
 {
   #[inline]
   pub fn log(&mut self, instruction: &Instruction) {
-    // Write the current program counter to the trace buffer for the cycle tracer.
-    if let Some(ref mut buf) = self.trace_buf {
-      if !self.unconstrained {
-        buf.write_all(&u32::to_be_bytes(self.state.pc)).unwrap();
-      }
-    }
-
     // If RUST_LOG is set to "trace", then log the current state of the runtime every cycle.
     let width = 12;
     log::trace!(
@@ -78,4 +69,50 @@ where
       );
     }
   }
+
+  /// Starts the trace record of `instruction`, about to be executed, if it is traced.
+  #[inline]
+  pub(crate) fn trace_begin(&self, instruction: &Instruction) -> Option<TraceRecord> {
+    let trace = self.trace.as_ref()?;
+    if self.unconstrained || !trace.config().traces(self.state.global_clk, self.state.pc) {
+      return None;
+    }
+    // The address is computed before the base register can be overwritten by a load.
+    let memory = instruction
+      .is_memory_instruction()
+      .then(|| TraceMemoryAccess {
+        addr: align(
+          self
+            .register(Register::from_u32(instruction.op_b))
+            .wrapping_add(instruction.op_c),
+        ),
+        value: 0,
+        write: matches!(instruction.opcode, Opcode::SB | Opcode::SH | Opcode::SW),
+      });
+    Some(TraceRecord {
+      clk: self.state.global_clk,
+      pc: self.state.pc,
+      register: None,
+      memory,
+    })
+  }
+
+  /// Completes the trace record of `instruction` once executed and writes it.
+  #[inline]
+  pub(crate) fn trace_end(&mut self, instruction: &Instruction, mut record: TraceRecord) {
+    if TraceRecord::writes_register(instruction) && instruction.op_a != 0 {
+      let register = Register::from_u32(instruction.op_a);
+      record.register = Some((instruction.op_a as u8, self.register(register)));
+    }
+    if let Some(memory) = &mut record.memory {
+      memory.value = self.word(memory.addr);
+    }
+    if let Some(trace) = &mut self.trace {
+      trace.record(&record);
+      // Tracing is disabled once the trace can't be written.
+      if trace.is_stopped() {
+        self.trace = None;
+      }
+    }
+  }
 }
@@ -0,0 +1,321 @@
+use athena_interface::HostInterface;
+use ed25519_dalek::{Signature, VerifyingKey};
+use sha2::{Digest, Sha256};
+use sha3::Keccak256;
+
+use super::memory::{charge_words, check_range, read_bytes, write_bytes};
+use crate::runtime::{ExecutionError, Register, Syscall, SyscallCode, SyscallContext};
+
+/// The length of the digests of the hash syscalls.
+const DIGEST_LENGTH: u32 = 32;
+const ED25519_PUBLIC_KEY_LENGTH: u32 = 32;
+const ED25519_SIGNATURE_LENGTH: u32 = 64;
+
+/// The cycles charged for verifying an Ed25519 signature on top of the fixed cost encoded in
+/// [SyscallCode::ED25519_VERIFY], which is at most 255 cycles.
+///
+/// The total is meant to cost as much as the same time spent interpreting instructions. On an
+/// x86-64 host, `verify_strict` takes about 47us, and the interpreter runs the SHA-256 loop of
+/// the precompiles benchmark at about 57M cycles/s. A verification therefore takes as long as
+/// about 2,700 cycles. The surcharge rounds the total up to 3,000 cycles. The message is hashed
+/// as part of the verification and is charged per word on top of that.
+pub const ED25519_VERIFY_SURCHARGE: u32 = 3_000 - 0xFF;
+
+/// SyscallKeccak256 hashes `len` bytes (in a1) from `input` (in a0) with Keccak-256, writing the
+/// digest to `output` (in a2).
+pub struct SyscallKeccak256;
+
+impl SyscallKeccak256 {
+  pub const fn new() -> Self {
+    Self
+  }
+}
+
+impl<T> Syscall<T> for SyscallKeccak256
+where
+  T: HostInterface,
+{
+  fn execute(
+    &self,
+    ctx: &mut SyscallContext<T>,
+    input: u32,
+    len: u32,
+  ) -> Result<Option<u32>, ExecutionError> {
+    hash(ctx, input, len, keccak256)
+  }
+
+  fn num_extra_cycles(&self) -> u32 {
+    SyscallCode::KECCAK256.num_cycles()
+  }
+}
+
+/// SyscallSha256 hashes `len` bytes (in a1) from `input` (in a0) with SHA-256, writing the
+/// digest to `output` (in a2).
+pub struct SyscallSha256;
+
+impl SyscallSha256 {
+  pub const fn new() -> Self {
+    Self
+  }
+}
+
+impl<T> Syscall<T> for SyscallSha256
+where
+  T: HostInterface,
+{
+  fn execute(
+    &self,
+    ctx: &mut SyscallContext<T>,
+    input: u32,
+    len: u32,
+  ) -> Result<Option<u32>, ExecutionError> {
+    hash(ctx, input, len, sha256)
+  }
+
+  fn num_extra_cycles(&self) -> u32 {
+    SyscallCode::SHA256.num_cycles()
+  }
+}
+
+/// SyscallEd25519Verify verifies the Ed25519 signature (at the address in a3) of `len` bytes (in
+/// a1) from `msg` (in a0) by the public key (at the address in a2), returning 1 if the signature
+/// is valid and 0 otherwise.
+///
+/// Signatures are verified strictly, rejecting non-canonical and small order points, so that
+/// the result doesn't depend on the implementation.
+pub struct SyscallEd25519Verify;
+
+impl SyscallEd25519Verify {
+  pub const fn new() -> Self {
+    Self
+  }
+}
+
+impl<T> Syscall<T> for SyscallEd25519Verify
+where
+  T: HostInterface,
+{
+  fn execute(
+    &self,
+    ctx: &mut SyscallContext<T>,
+    msg: u32,
+    len: u32,
+  ) -> Result<Option<u32>, ExecutionError> {
+    let public_key = ctx.register_unsafe(Register::X12);
+    let signature = ctx.register_unsafe(Register::X13);
+    check_range(msg, len)?;
+    check_range(public_key, ED25519_PUBLIC_KEY_LENGTH)?;
+    check_range(signature, ED25519_SIGNATURE_LENGTH)?;
+    ctx.charge_cycles(ED25519_VERIFY_SURCHARGE)?;
+    charge_words(ctx, msg, len)?;
+
+    let msg = read_bytes(ctx, msg, len);
+    let public_key = read_bytes(ctx, public_key, ED25519_PUBLIC_KEY_LENGTH);
+    let signature = read_bytes(ctx, signature, ED25519_SIGNATURE_LENGTH);
+    let signature = Signature::from_bytes(signature.as_slice().try_into().unwrap());
+    let valid = VerifyingKey::from_bytes(public_key.as_slice().try_into().unwrap())
+      .is_ok_and(|key| key.verify_strict(&msg, &signature).is_ok());
+    Ok(Some(valid as u32))
+  }
+
+  fn num_extra_cycles(&self) -> u32 {
+    SyscallCode::ED25519_VERIFY.num_cycles()
+  }
+}
+
+/// Hashes the input of a hash syscall, charging for its words, and writes the digest to the
+/// address in a2.
+fn hash<T: HostInterface>(
+  ctx: &mut SyscallContext<T>,
+  input: u32,
+  len: u32,
+  digest: impl FnOnce(&[u8]) -> [u8; DIGEST_LENGTH as usize],
+) -> Result<Option<u32>, ExecutionError> {
+  let output = ctx.register_unsafe(Register::X12);
+  check_range(input, len)?;
+  check_range(output, DIGEST_LENGTH)?;
+  charge_words(ctx, input, len)?;
+  ctx.check_memory_write(output, DIGEST_LENGTH)?;
+  let data = read_bytes(ctx, input, len);
+  write_bytes(ctx, output, &digest(&data));
+  Ok(None)
+}
+
+pub fn sha256(data: &[u8]) -> [u8; 32] {
+  Sha256::digest(data).into()
+}
+
+/// Keccak-256, as used by Ethereum, which pads differently from the standardized SHA3-256.
+pub fn keccak256(data: &[u8]) -> [u8; 32] {
+  Keccak256::digest(data).into()
+}
+
+#[cfg(test)]
+mod tests {
+  use athena_interface::MockHost;
+  use ed25519_dalek::{Signer, SigningKey};
+
+  use super::*;
+  use crate::runtime::{Instruction, Opcode, Program, Runtime};
+  use crate::utils::AthenaCoreOpts;
+
+  #[test]
+  fn test_keccak256() {
+    for (data, digest) in [
+      (
+        &b""[..],
+        "c5d2460186f7233c927e7db2dcc703c0e500b653ca82273b7bfad8045d85a470",
+      ),
+      (
+        b"abc",
+        "4e03657aea45a94fc7d47ba826c8d667c0d1e6e33a64a036ec44f58fa12d6c45",
+      ),
+    ] {
+      assert_eq!(hex::encode(keccak256(data)), digest);
+    }
+  }
+
+  const INPUT: u32 = 0x1000;
+  const OUTPUT: u32 = 0x2000;
+  const PUBLIC_KEY: u32 = 0x3000;
+  const SIGNATURE: u32 = 0x4000;
+
+  /// Returns the instructions calling `syscall` with a0..a3 set to `args`.
+  fn ecall(syscall: SyscallCode, args: [u32; 4]) -> Vec<Instruction> {
+    let mut instructions = vec![Instruction::new(
+      Opcode::ADD,
+      5,
+      0,
+      syscall as u32,
+      false,
+      true,
+    )];
+    for (i, arg) in args.into_iter().enumerate() {
+      instructions.push(Instruction::new(
+        Opcode::ADD,
+        10 + i as u32,
+        0,
+        arg,
+        false,
+        true,
+      ));
+    }
+    instructions.push(Instruction::new(Opcode::ECALL, 5, 10, 11, false, false));
+    instructions
+  }
+
+  /// Runs `syscall` with a0..a3 set to `args`, with `data` in memory at [INPUT], returning the
+  /// runtime and the value returned in t0.
+  fn run(syscall: SyscallCode, args: [u32; 4], data: &[(u32, &[u8])]) -> (Runtime<MockHost>, u32) {
+    let instructions = ecall(syscall, args);
+    let mut program = Program::new(instructions, 0, 0);
+    for &(addr, bytes) in data {
+      program.memory_image.insert_bytes(addr, bytes);
+    }
+    let mut runtime = Runtime::<MockHost>::new(program, None, AthenaCoreOpts::default());
+    runtime.run().unwrap();
+    let t0 = runtime.register(Register::X5);
+    (runtime, t0)
+  }
+
+  fn digest(runtime: &Runtime<MockHost>) -> Vec<u8> {
+    (OUTPUT..OUTPUT + DIGEST_LENGTH)
+      .map(|addr| runtime.byte(addr))
+      .collect()
+  }
+
+  #[test]
+  fn test_hash_syscalls() {
+    let data = [7u8; 203];
+    let len = data.len() as u32;
+    for (syscall, expected) in [
+      (SyscallCode::KECCAK256, keccak256(&data[1..])),
+      (SyscallCode::SHA256, sha256(&data[1..])),
+    ] {
+      // Unaligned input and output.
+      let (runtime, _) = run(syscall, [INPUT + 1, len - 1, OUTPUT, 0], &[(INPUT, &data)]);
+      assert_eq!(digest(&runtime), expected);
+    }
+  }
+
+  #[test]
+  fn test_crypto_syscalls_read_hinted_memory() {
+    let key = SigningKey::from_bytes(&[3; 32]);
+    let msg = [7u8; 40];
+    let len = msg.len() as u32;
+    // The message, public key and signature are hinted and never accessed before the syscalls.
+    let instructions = [
+      ecall(SyscallCode::HINT_READ, [INPUT, len, 0, 0]),
+      ecall(SyscallCode::HINT_READ, [PUBLIC_KEY, 32, 0, 0]),
+      ecall(SyscallCode::HINT_READ, [SIGNATURE, 64, 0, 0]),
+      ecall(SyscallCode::KECCAK256, [INPUT, len, OUTPUT, 0]),
+      ecall(SyscallCode::SHA256, [INPUT, len, OUTPUT + 32, 0]),
+      ecall(
+        SyscallCode::ED25519_VERIFY,
+        [INPUT, len, PUBLIC_KEY, SIGNATURE],
+      ),
+    ]
+    .concat();
+    let mut runtime = Runtime::<MockHost>::new(
+      Program::new(instructions, 0, 0),
+      None,
+      AthenaCoreOpts::default(),
+    );
+    runtime.write_stdin_slice(&msg);
+    runtime.write_stdin_slice(&key.verifying_key().to_bytes());
+    runtime.write_stdin_slice(&key.sign(&msg).to_bytes());
+    runtime.run().unwrap();
+    let digests: Vec<u8> = (OUTPUT..OUTPUT + 64)
+      .map(|addr| runtime.byte(addr))
+      .collect();
+    assert_eq!(digests[..32], keccak256(&msg));
+    assert_eq!(digests[32..], sha256(&msg));
+    assert_eq!(runtime.register(Register::X5), 1);
+  }
+
+  #[test]
+  fn test_ed25519_verify() {
+    let key = SigningKey::from_bytes(&[3; 32]);
+    let msg = b"athena";
+    let signature = key.sign(msg).to_bytes();
+    let public_key = key.verifying_key().to_bytes();
+    let verify = |msg: &[u8]| {
+      run(
+        SyscallCode::ED25519_VERIFY,
+        [INPUT, msg.len() as u32, PUBLIC_KEY, SIGNATURE],
+        &[
+          (INPUT, msg),
+          (PUBLIC_KEY, &public_key),
+          (SIGNATURE, &signature),
+        ],
+      )
+      .1
+    };
+    assert_eq!(verify(msg), 1);
+    assert_eq!(verify(b"athenb"), 0);
+  }
+
+  #[test]
+  fn test_crypto_syscall_cycles() {
+    let cycles = |len| {
+      let (runtime, _) = run(SyscallCode::SHA256, [INPUT, len, OUTPUT, 0], &[]);
+      runtime.state.clk
+    };
+    // One cycle per word hashed, on top of the fixed cost.
+    assert_eq!(cycles(40), cycles(0) + 10);
+
+    // Verifying a signature costs its surcharge on top of the fixed cost and the message words.
+    let (runtime, _) = run(
+      SyscallCode::ED25519_VERIFY,
+      [INPUT, 8, PUBLIC_KEY, SIGNATURE],
+      &[],
+    );
+    let (fixed, _) = run(SyscallCode::SHA256, [INPUT, 8, OUTPUT, 0], &[]);
+    assert_eq!(
+      runtime.state.clk,
+      fixed.state.clk - SyscallCode::SHA256.num_cycles()
+        + SyscallCode::ED25519_VERIFY.num_cycles()
+        + ED25519_VERIFY_SURCHARGE
+    );
+  }
+}
@@ -1,4 +1,4 @@
-use crate::runtime::{Syscall, SyscallContext};
+use crate::runtime::{ExecutionError, Syscall, SyscallContext};
 use athena_interface::HostInterface;
 
 pub struct SyscallHalt;
@@ -13,9 +13,14 @@ impl<T> Syscall<T> for SyscallHalt
 where
   T: HostInterface,
 {
-  fn execute(&self, ctx: &mut SyscallContext<T>, exit_code: u32, _: u32) -> Option<u32> {
+  fn execute(
+    &self,
+    ctx: &mut SyscallContext<T>,
+    exit_code: u32,
+    _: u32,
+  ) -> Result<Option<u32>, ExecutionError> {
     ctx.set_next_pc(0);
     ctx.set_exit_code(exit_code);
-    None
+    Ok(None)
   }
 }
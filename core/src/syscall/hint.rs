@@ -1,6 +1,7 @@
 use athena_interface::HostInterface;
 
-use crate::runtime::{Syscall, SyscallContext};
+use super::memory::check_range;
+use crate::runtime::{ExecutionError, Syscall, SyscallContext};
 
 pub struct SyscallHintLen;
 
@@ -15,17 +16,27 @@ impl<T> Syscall<T> for SyscallHintLen
 where
   T: HostInterface,
 {
-  fn execute(&self, ctx: &mut SyscallContext<T>, _arg1: u32, _arg2: u32) -> Option<u32> {
-    if ctx.rt.state.input_stream_ptr >= ctx.rt.state.input_stream.len() {
-      panic!("not enough vecs in hint input stream");
-    }
-    Some(ctx.rt.state.input_stream[ctx.rt.state.input_stream_ptr].len() as u32)
+  fn execute(
+    &self,
+    ctx: &mut SyscallContext<T>,
+    _arg1: u32,
+    _arg2: u32,
+  ) -> Result<Option<u32>, ExecutionError> {
+    let ptr = ctx.rt.state.input_stream_ptr;
+    let len = match ctx.input.get(ptr) {
+      Some(input) => input.len(),
+      None => match ctx.rt.state.input_stream.get(ptr - ctx.input.len()) {
+        Some(input) => input.len(),
+        None => return Err(ExecutionError::InvalidHintRead(NO_INPUT_LEFT)),
+      },
+    };
+    Ok(Some(len as u32))
   }
 }
 
 pub struct SyscallHintRead;
 
-/// SyscallHintRead returns the length of the next slice in the hint input stream.
+/// SyscallHintRead reads the next slice in the hint input stream into guest memory.
 impl SyscallHintRead {
   pub const fn new() -> Self {
     Self
@@ -36,47 +47,95 @@ impl<T> Syscall<T> for SyscallHintRead
 where
   T: HostInterface,
 {
-  fn execute(&self, ctx: &mut SyscallContext<T>, ptr: u32, len: u32) -> Option<u32> {
-    if ctx.rt.state.input_stream_ptr >= ctx.rt.state.input_stream.len() {
-      panic!("not enough vecs in hint input stream");
+  fn execute(
+    &self,
+    ctx: &mut SyscallContext<T>,
+    ptr: u32,
+    len: u32,
+  ) -> Result<Option<u32>, ExecutionError> {
+    let fail = |reason| Err(ExecutionError::InvalidHintRead(reason));
+    if ctx.rt.unconstrained {
+      return fail("hint read should not be used in a unconstrained block");
     }
-    let vec = &ctx.rt.state.input_stream[ctx.rt.state.input_stream_ptr];
-    ctx.rt.state.input_stream_ptr += 1;
-    assert!(
-      !ctx.rt.unconstrained,
-      "hint read should not be used in a unconstrained block"
-    );
-    assert_eq!(
-      vec.len() as u32,
+    let idx = ctx.rt.state.input_stream_ptr;
+    // Borrowed inputs come first. Inputs in the runtime's own stream are moved out while they
+    // are copied, to release the borrow of the runtime, and put back afterwards, whether or not
+    // the read succeeds, so a restored checkpoint can read them again.
+    let input = ctx.input;
+    let owned = match input.get(idx) {
+      Some(_) => None,
+      None => match ctx.rt.state.input_stream.get_mut(idx - input.len()) {
+        Some(input) => Some(std::mem::take(input)),
+        None => return fail(NO_INPUT_LEFT),
+      },
+    };
+    let result = read_hint(
+      ctx,
+      ptr,
       len,
-      "hint input stream read length mismatch"
+      owned.as_deref().unwrap_or_else(|| &input[idx]),
     );
-    assert_eq!(ptr % 4, 0, "hint read address not aligned to 4 bytes");
-    // Iterate through the vec in 4-byte chunks
-    for i in (0..len).step_by(4) {
-      // Get each byte in the chunk
-      let b1 = vec[i as usize];
-      // In case the vec is not a multiple of 4, right-pad with 0s. This is fine because we
-      // are assuming the word is uninitialized, so filling it with 0s makes sense.
-      let b2 = vec.get(i as usize + 1).copied().unwrap_or(0);
-      let b3 = vec.get(i as usize + 2).copied().unwrap_or(0);
-      let b4 = vec.get(i as usize + 3).copied().unwrap_or(0);
-      let word = u32::from_le_bytes([b1, b2, b3, b4]);
-
-      // Save the data into runtime state so the runtime will use the desired data instead of
-      // 0 when first reading/writing from this address.
-      ctx
-        .rt
-        .state
-        .uninitialized_memory
-        .entry(ptr + i)
-        .and_modify(|_| panic!("hint read address is initialized already"))
-        .or_insert(word);
+    if let Some(owned) = owned {
+      ctx.rt.state.input_stream[idx - input.len()] = owned;
     }
-    None
+    result.map(|()| None)
   }
 }
 
+/// Copies the next hint input `vec` to `ptr`, checking that it is `len` bytes long.
+fn read_hint<T: HostInterface>(
+  ctx: &mut SyscallContext<T>,
+  ptr: u32,
+  len: u32,
+  vec: &[u8],
+) -> Result<(), ExecutionError> {
+  let fail = |reason| Err(ExecutionError::InvalidHintRead(reason));
+  if vec.len() as u32 != len {
+    return fail("hint input stream read length mismatch");
+  }
+  if ptr % 4 != 0 {
+    return fail("hint read address not aligned to 4 bytes");
+  }
+  if ptr.checked_add(len).is_none() {
+    return fail("hint read out of bounds");
+  }
+  check_range(ptr, len)?;
+  ctx.check_memory_write(ptr, len)?;
+  ctx.rt.state.input_stream_ptr += 1;
+  ctx.rt.record_hint_read(len);
+
+  if ctx.traced {
+    // Save the data into runtime state so the runtime will use the desired data instead of 0
+    // when first reading/writing from this address. In case the vec is not a multiple of 4,
+    // right-pad with 0s. This is fine because we are assuming the word is uninitialized, so
+    // filling it with 0s makes sense. Words which were accessed already, e.g. in memory freed
+    // and reused by the guest allocator, are written instead. Words hinted before and not
+    // accessed since take the new value, as they do when copied straight into memory below.
+    ctx
+      .rt
+      .state
+      .uninitialized_memory
+      .reserve(vec.len().div_ceil(4));
+    for (i, chunk) in vec.chunks(4).enumerate() {
+      let addr = ptr + i as u32 * 4;
+      let mut word = [0; 4];
+      word[..chunk.len()].copy_from_slice(chunk);
+      let word = u32::from_le_bytes(word);
+      if ctx.rt.state.memory.get(addr).is_some() {
+        ctx.mw(addr, word);
+      } else {
+        ctx.rt.state.uninitialized_memory.insert(addr, word);
+      }
+    }
+  } else {
+    // Without access records there is nothing to defer, so copy straight into memory.
+    ctx.rt.state.write_bytes(ptr, vec);
+  }
+  Ok(())
+}
+
+const NO_INPUT_LEFT: &str = "not enough vecs in hint input stream";
+
 // #[cfg(test)]
 // mod tests {
 //     use rand::RngCore;
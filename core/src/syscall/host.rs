@@ -1,8 +1,19 @@
-use crate::runtime::{Register, Syscall, SyscallContext};
+use super::memory::check_range;
+use crate::runtime::{ExecutionError, Register, Syscall, SyscallContext};
 use athena_interface::{
-  AddressWrapper, Bytes32Wrapper, HostInterface, ADDRESS_LENGTH, BYTES32_LENGTH,
+  AddressWrapper, Bytes32, Bytes32Wrapper, HostInterface, ADDRESS_LENGTH, BYTES32_LENGTH,
 };
 
+/// The maximum number of storage slots read or written by a single batched host syscall.
+pub const MAX_STORAGE_BATCH: u32 = 1024;
+
+/// The cycles charged per storage slot by the batched host syscalls, on top of the `ecall`.
+/// It is what a [SyscallHostRead] or [SyscallHostWrite] `ecall` costs, so batching saves host
+/// round trips but not gas.
+pub const STORAGE_CYCLES_PER_SLOT: u32 = 1;
+
+const BYTES32_WORDS: usize = BYTES32_LENGTH / 4;
+
 pub struct SyscallHostRead;
 
 impl SyscallHostRead {
@@ -15,7 +26,12 @@ impl<T> Syscall<T> for SyscallHostRead
 where
   T: HostInterface,
 {
-  fn execute(&self, ctx: &mut SyscallContext<T>, arg1: u32, arg2: u32) -> Option<u32> {
+  fn execute(
+    &self,
+    ctx: &mut SyscallContext<T>,
+    arg1: u32,
+    arg2: u32,
+  ) -> Result<Option<u32>, ExecutionError> {
     // marshal inputs
     let address_words = ADDRESS_LENGTH / 4;
     let key = ctx.slice_unsafe(arg1, BYTES32_LENGTH / 4);
@@ -23,15 +39,15 @@ where
 
     // read value from host
     let host = ctx.rt.host.as_mut().expect("Missing host interface");
-    let value = host.borrow().get_storage(
+    let value = host.borrow_mut().get_storage(
       &AddressWrapper::from(address).into(),
       &Bytes32Wrapper::from(key).into(),
     );
 
     // set return value
     let value_vec: Vec<u32> = Bytes32Wrapper::new(value).into();
-    ctx.mw_slice(arg1, value_vec.as_slice());
-    None
+    ctx.mw_words(arg1, value_vec.as_slice());
+    Ok(None)
   }
 }
 
@@ -47,7 +63,12 @@ impl<T> Syscall<T> for SyscallHostWrite
 where
   T: HostInterface,
 {
-  fn execute(&self, ctx: &mut SyscallContext<T>, arg1: u32, arg2: u32) -> Option<u32> {
+  fn execute(
+    &self,
+    ctx: &mut SyscallContext<T>,
+    arg1: u32,
+    arg2: u32,
+  ) -> Result<Option<u32>, ExecutionError> {
     // marshal inputs
     let address_words = ADDRESS_LENGTH / 4;
     let key = ctx.slice_unsafe(arg1, BYTES32_LENGTH / 4);
@@ -70,7 +91,427 @@ where
     // save return code
     let mut status_word = [0u32; 8];
     status_word[0] = status_code as u32;
-    ctx.mw_slice(arg1, &status_word);
-    None
+    ctx.mw_words(arg1, &status_word);
+    Ok(None)
+  }
+}
+
+/// Reads `count` consecutive 32-byte values from guest memory.
+fn read_bytes32s<T: HostInterface>(
+  ctx: &SyscallContext<T>,
+  addr: u32,
+  count: usize,
+) -> Vec<Bytes32> {
+  let words = ctx.slice_unsafe(addr, count * BYTES32_WORDS);
+  words
+    .chunks_exact(BYTES32_WORDS)
+    .map(|chunk| {
+      let mut bytes = [0u8; BYTES32_LENGTH];
+      for (i, word) in chunk.iter().enumerate() {
+        bytes[i * 4..(i + 1) * 4].copy_from_slice(&word.to_le_bytes());
+      }
+      bytes
+    })
+    .collect()
+}
+
+/// Flattens 32-byte values into the words making them up in guest memory.
+fn bytes32s_to_words(values: &[Bytes32]) -> Vec<u32> {
+  values
+    .iter()
+    .flat_map(|value| value.chunks_exact(4))
+    .map(|chunk| u32::from_le_bytes(chunk.try_into().unwrap()))
+    .collect()
+}
+
+/// Reads many storage slots of one account with a single host call.
+///
+/// `arg1` points to `count` keys, which are overwritten with the values read; `arg2` points to
+/// the address and register a2 holds `count`.
+pub struct SyscallHostReadMany;
+
+impl SyscallHostReadMany {
+  pub const fn new() -> Self {
+    Self
+  }
+}
+
+impl<T> Syscall<T> for SyscallHostReadMany
+where
+  T: HostInterface,
+{
+  fn execute(
+    &self,
+    ctx: &mut SyscallContext<T>,
+    arg1: u32,
+    arg2: u32,
+  ) -> Result<Option<u32>, ExecutionError> {
+    // marshal inputs
+    let count = ctx.rt.register(Register::X12);
+    if count > MAX_STORAGE_BATCH {
+      return Err(ExecutionError::InvalidStorageBatch(
+        "too many storage slots",
+      ));
+    }
+    let len = count * BYTES32_LENGTH as u32;
+    check_range(arg1, len)?;
+    check_range(arg2, ADDRESS_LENGTH as u32)?;
+    ctx.charge_cycles(count * STORAGE_CYCLES_PER_SLOT)?;
+    ctx.check_memory_write(arg1, len)?;
+    let keys = read_bytes32s(ctx, arg1, count as usize);
+    let address = ctx.slice_unsafe(arg2, ADDRESS_LENGTH / 4);
+
+    // read values from host
+    let host = ctx.rt.host.as_mut().ok_or(ExecutionError::MissingHost())?;
+    let values = host
+      .borrow_mut()
+      .get_storage_many(&AddressWrapper::from(address).into(), &keys);
+    if values.len() != keys.len() {
+      return Err(ExecutionError::InvalidStorageBatch(
+        "host returned wrong number of values",
+      ));
+    }
+
+    // set return values
+    ctx.mw_words(arg1, &bytes32s_to_words(&values));
+    Ok(None)
+  }
+}
+
+/// Writes many storage slots of one account with a single host call.
+///
+/// `arg1` points to `count` keys, which are overwritten with the status of each write (in the
+/// first word of each key, like [SyscallHostWrite]); `arg2` points to the address, register a2
+/// points to the `count` values and register a3 holds `count`.
+pub struct SyscallHostWriteMany;
+
+impl SyscallHostWriteMany {
+  pub const fn new() -> Self {
+    Self
+  }
+}
+
+impl<T> Syscall<T> for SyscallHostWriteMany
+where
+  T: HostInterface,
+{
+  fn execute(
+    &self,
+    ctx: &mut SyscallContext<T>,
+    arg1: u32,
+    arg2: u32,
+  ) -> Result<Option<u32>, ExecutionError> {
+    // marshal inputs
+    let values_ptr = ctx.rt.register(Register::X12);
+    let count = ctx.rt.register(Register::X13);
+    if count > MAX_STORAGE_BATCH {
+      return Err(ExecutionError::InvalidStorageBatch(
+        "too many storage slots",
+      ));
+    }
+    let len = count * BYTES32_LENGTH as u32;
+    check_range(arg1, len)?;
+    check_range(values_ptr, len)?;
+    check_range(arg2, ADDRESS_LENGTH as u32)?;
+    ctx.charge_cycles(count * STORAGE_CYCLES_PER_SLOT)?;
+    ctx.check_memory_write(arg1, len)?;
+    let keys = read_bytes32s(ctx, arg1, count as usize);
+    let values = read_bytes32s(ctx, values_ptr, count as usize);
+    let address = ctx.slice_unsafe(arg2, ADDRESS_LENGTH / 4);
+
+    // write values to host
+    let host = ctx.rt.host.as_mut().ok_or(ExecutionError::MissingHost())?;
+    let status_codes =
+      host
+        .borrow_mut()
+        .set_storage_many(&AddressWrapper::from(address).into(), &keys, &values);
+    if status_codes.len() != keys.len() {
+      return Err(ExecutionError::InvalidStorageBatch(
+        "host returned wrong number of statuses",
+      ));
+    }
+
+    // save return codes
+    let mut status_words = vec![0u32; keys.len() * BYTES32_WORDS];
+    for (i, status_code) in status_codes.into_iter().enumerate() {
+      status_words[i * BYTES32_WORDS] = status_code as u32;
+    }
+    ctx.mw_words(arg1, &status_words);
+    Ok(None)
+  }
+}
+
+#[cfg(test)]
+mod tests {
+  use std::{cell::RefCell, collections::BTreeMap, sync::Arc};
+
+  use athena_interface::{
+    Address, AthenaMessage, Bytes32, ExecutionResult, HostInterface, HostProvider, StorageStatus,
+    TransactionContext,
+  };
+
+  use super::{MAX_STORAGE_BATCH, STORAGE_CYCLES_PER_SLOT};
+  use crate::runtime::{ExecutionError, Instruction, Opcode, Program, Runtime, SyscallCode};
+  use crate::utils::AthenaCoreOpts;
+
+  /// A host keeping storage in memory, which only supports batched storage access.
+  #[derive(Default)]
+  struct BatchHost {
+    storage: BTreeMap<Bytes32, Bytes32>,
+  }
+
+  impl HostInterface for BatchHost {
+    fn account_exists(&self, _addr: &Address) -> bool {
+      true
+    }
+    fn get_storage(&self, _addr: &Address, _key: &Bytes32) -> Bytes32 {
+      unimplemented!()
+    }
+    fn set_storage(&mut self, _addr: &Address, _key: &Bytes32, _value: &Bytes32) -> StorageStatus {
+      unimplemented!()
+    }
+    fn get_storage_many(&self, _addr: &Address, keys: &[Bytes32]) -> Vec<Bytes32> {
+      keys
+        .iter()
+        .map(|key| self.storage.get(key).copied().unwrap_or_default())
+        .collect()
+    }
+    fn set_storage_many(
+      &mut self,
+      _addr: &Address,
+      keys: &[Bytes32],
+      values: &[Bytes32],
+    ) -> Vec<StorageStatus> {
+      keys
+        .iter()
+        .zip(values)
+        .map(|(key, value)| match self.storage.insert(*key, *value) {
+          Some(_) => StorageStatus::StorageModified,
+          None => StorageStatus::StorageAdded,
+        })
+        .collect()
+    }
+    fn get_balance(&self, _addr: &Address) -> u64 {
+      0
+    }
+    fn get_tx_context(&self) -> TransactionContext {
+      unimplemented!()
+    }
+    fn get_block_hash(&self, _number: i64) -> Bytes32 {
+      unimplemented!()
+    }
+    fn call(&mut self, _msg: AthenaMessage) -> ExecutionResult {
+      unimplemented!()
+    }
+  }
+
+  #[test]
+  fn test_host_storage_many() {
+    const KEYS: u32 = 0x400;
+    const VALUES: u32 = 0x500;
+    const READ_KEYS: u32 = 0x600;
+    const ADDRESS: u32 = 0x700;
+    let addi = |rd, imm| Instruction::new(Opcode::ADD, rd, 0, imm, false, true);
+    let ecall = Instruction::new(Opcode::ECALL, 5, 10, 11, false, false);
+    let instructions = vec![
+      addi(5, SyscallCode::HOST_WRITE_MANY as u32),
+      addi(10, KEYS),
+      addi(11, ADDRESS),
+      addi(12, VALUES),
+      addi(13, 2),
+      ecall,
+      addi(5, SyscallCode::HOST_READ_MANY as u32),
+      addi(10, READ_KEYS),
+      addi(12, 3),
+      ecall,
+    ];
+    let mut program = Program::new(instructions, 0, 0);
+    // Two keys to write and three to read back, the last of which is never written.
+    for i in 0..8 {
+      program.memory_image.insert(KEYS + i * 4, 1);
+      program.memory_image.insert(KEYS + 32 + i * 4, 2);
+      program.memory_image.insert(VALUES + i * 4, 10 + i);
+      program.memory_image.insert(VALUES + 32 + i * 4, 20 + i);
+      program.memory_image.insert(READ_KEYS + i * 4, 2);
+      program.memory_image.insert(READ_KEYS + 32 + i * 4, 1);
+      program.memory_image.insert(READ_KEYS + 64 + i * 4, 3);
+    }
+
+    for storage_cache in [false, true] {
+      let mut provider = HostProvider::new(BatchHost::default());
+      if storage_cache {
+        provider.enable_storage_cache();
+      }
+      let host = Arc::new(RefCell::new(provider));
+      let mut runtime = Runtime::new(
+        program.clone(),
+        Some(host.clone()),
+        AthenaCoreOpts::default(),
+      );
+      runtime.run().unwrap();
+
+      // Cached writes only reach the host once committed.
+      let written = if storage_cache { 0 } else { 2 };
+      assert_eq!(host.borrow().storage.len(), written);
+      host.borrow_mut().commit_storage();
+      assert_eq!(host.borrow().storage.len(), 2);
+      for i in 0..8 {
+        let status = if i == 0 {
+          StorageStatus::StorageAdded as u32
+        } else {
+          0
+        };
+        assert_eq!(runtime.word(KEYS + i * 4), status);
+        assert_eq!(runtime.word(KEYS + 32 + i * 4), status);
+        assert_eq!(runtime.word(READ_KEYS + i * 4), 20 + i);
+        assert_eq!(runtime.word(READ_KEYS + 32 + i * 4), 10 + i);
+        assert_eq!(runtime.word(READ_KEYS + 64 + i * 4), 0);
+      }
+    }
+  }
+
+  #[test]
+  fn test_host_storage_many_rejects_oversized_batch() {
+    let addi = |rd, imm| Instruction::new(Opcode::ADD, rd, 0, imm, false, true);
+    let ecall = Instruction::new(Opcode::ECALL, 5, 10, 11, false, false);
+    for (code, count_register) in [
+      (SyscallCode::HOST_READ_MANY, 12),
+      (SyscallCode::HOST_WRITE_MANY, 13),
+    ] {
+      let instructions = vec![
+        addi(5, code as u32),
+        addi(10, 0x400),
+        addi(11, 0x700),
+        addi(12, 0x500),
+        addi(count_register, MAX_STORAGE_BATCH + 1),
+        ecall,
+      ];
+      let program = Program::new(instructions, 0, 0);
+      let host = Arc::new(RefCell::new(HostProvider::new(BatchHost::default())));
+      let mut runtime = Runtime::new(program, Some(host.clone()), AthenaCoreOpts::default());
+      assert!(matches!(
+        runtime.run(),
+        Err(ExecutionError::InvalidStorageBatch(_))
+      ));
+      assert!(host.borrow().storage.is_empty());
+    }
+  }
+
+  #[test]
+  fn test_host_storage_many_rejects_invalid_ranges() {
+    let addi = |rd, imm| Instruction::new(Opcode::ADD, rd, 0, imm, false, true);
+    let run = |code: SyscallCode, keys, address, values, host| {
+      // Reads take the count in a2, and writes the values.
+      let a2 = if code == SyscallCode::HOST_READ_MANY {
+        2
+      } else {
+        values
+      };
+      let instructions = vec![
+        addi(5, code as u32),
+        addi(10, keys),
+        addi(11, address),
+        addi(12, a2),
+        addi(13, 2),
+        Instruction::new(Opcode::ECALL, 5, 10, 11, false, false),
+      ];
+      let program = Program::new(instructions, 0, 0);
+      let mut runtime = Runtime::new(program, host, AthenaCoreOpts::default());
+      runtime.run()
+    };
+    for code in [SyscallCode::HOST_READ_MANY, SyscallCode::HOST_WRITE_MANY] {
+      // Ranges overlapping the registers, or past the end of memory, whether of the keys, the
+      // address or the values.
+      for (keys, address, values) in [
+        (0x10, 0x700, 0x500),
+        (0x400, 0x8, 0x500),
+        (u32::MAX - 0x20, 0x700, 0x500),
+        (0x400, u32::MAX - 0x10, 0x500),
+        (0x400, 0x700, 0x10),
+        (0x400, 0x700, u32::MAX - 0x20),
+      ] {
+        let host = Arc::new(RefCell::new(HostProvider::new(BatchHost::default())));
+        let result = run(code, keys, address, values, Some(host.clone()));
+        if code == SyscallCode::HOST_READ_MANY && values != 0x500 {
+          assert!(result.is_ok());
+          continue;
+        }
+        assert!(matches!(
+          result,
+          Err(ExecutionError::InvalidMemoryOperation(_))
+        ));
+        assert!(host.borrow().storage.is_empty());
+      }
+      assert!(matches!(
+        run(code, 0x400, 0x700, 0x500, None),
+        Err(ExecutionError::MissingHost())
+      ));
+    }
+  }
+
+  #[test]
+  fn test_host_write_many_out_of_gas() {
+    let addi = |rd, imm| Instruction::new(Opcode::ADD, rd, 0, imm, false, true);
+    let instructions = vec![
+      addi(5, SyscallCode::HOST_WRITE_MANY as u32),
+      addi(10, 0x400),
+      addi(11, 0x700),
+      addi(12, 0x500),
+      addi(13, 2),
+      Instruction::new(Opcode::ECALL, 5, 10, 11, false, false),
+    ];
+    let run = |gas_limit| {
+      let program = Program::new(instructions.clone(), 0, 0);
+      let host = Arc::new(RefCell::new(HostProvider::new(BatchHost::default())));
+      let opts = AthenaCoreOpts {
+        gas_limit: Some(gas_limit),
+        ..Default::default()
+      };
+      let mut runtime = Runtime::new(program, Some(host.clone()), opts);
+      let result = runtime.run_fast();
+      let written = host.borrow().storage.len();
+      (result, written)
+    };
+
+    // Each instruction costs 1 gas and each slot written costs its cycles on top.
+    let gas = instructions.len() as u64 + 2 * STORAGE_CYCLES_PER_SLOT as u64;
+    let (result, written) = run(gas);
+    assert!(result.is_ok());
+    assert_eq!(written, 2);
+    // Running out of gas at the write leaves the host untouched.
+    let (result, written) = run(gas - 1);
+    assert!(matches!(result, Err(ExecutionError::OutOfGas())));
+    assert_eq!(written, 0);
+  }
+
+  #[test]
+  fn test_host_storage_many_cycles() {
+    let addi = |rd, imm| Instruction::new(Opcode::ADD, rd, 0, imm, false, true);
+    let ecall = Instruction::new(Opcode::ECALL, 5, 10, 11, false, false);
+    let run = |code: SyscallCode, count_register, count| {
+      let instructions = vec![
+        addi(5, code as u32),
+        addi(10, 0x400),
+        addi(11, 0x700),
+        addi(12, 0x500),
+        addi(count_register, count),
+        ecall,
+      ];
+      let program = Program::new(instructions, 0, 0);
+      let host = Arc::new(RefCell::new(HostProvider::new(BatchHost::default())));
+      let mut runtime = Runtime::new(program, Some(host), AthenaCoreOpts::default());
+      runtime.run().unwrap();
+      runtime.state.clk
+    };
+    for (code, count_register) in [
+      (SyscallCode::HOST_READ_MANY, 12),
+      (SyscallCode::HOST_WRITE_MANY, 13),
+    ] {
+      // Each slot costs as much as a single host read or write.
+      assert_eq!(
+        run(code, count_register, 3),
+        run(code, count_register, 0) + 3 * STORAGE_CYCLES_PER_SLOT
+      );
+    }
   }
 }
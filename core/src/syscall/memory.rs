@@ -0,0 +1,386 @@
+use athena_interface::HostInterface;
+
+use crate::runtime::{ExecutionError, Register, Syscall, SyscallContext};
+
+/// The cycles charged per word of memory copied or set, on top of the `ecall`.
+pub const MEMORY_CYCLES_PER_WORD: u32 = 1;
+
+/// The lowest address of the memory which can be copied or set. The registers are stored below.
+const MEMORY_START: u32 = 32;
+
+/// SyscallMemcpy copies `len` bytes (in a2) from `src` (in a1) to `dest` (in a0).
+///
+/// Words are copied in the direction which reads each source byte before it is overwritten, so
+/// the ranges may overlap and the same syscall implements both `memcpy` and `memmove`.
+pub struct SyscallMemcpy;
+
+impl SyscallMemcpy {
+  pub const fn new() -> Self {
+    Self
+  }
+}
+
+impl<T> Syscall<T> for SyscallMemcpy
+where
+  T: HostInterface,
+{
+  fn execute(
+    &self,
+    ctx: &mut SyscallContext<T>,
+    dest: u32,
+    src: u32,
+  ) -> Result<Option<u32>, ExecutionError> {
+    let len = ctx.register_unsafe(Register::X12);
+    check_range(dest, len)?;
+    check_range(src, len)?;
+    charge_words(ctx, dest, len)?;
+    ctx.check_memory_write(dest, len)?;
+    copy_words(ctx, dest, src, len);
+    Ok(None)
+  }
+}
+
+/// SyscallMemset sets `len` bytes (in a2) from `dest` (in a0) to the low byte of a1.
+pub struct SyscallMemset;
+
+impl SyscallMemset {
+  pub const fn new() -> Self {
+    Self
+  }
+}
+
+impl<T> Syscall<T> for SyscallMemset
+where
+  T: HostInterface,
+{
+  fn execute(
+    &self,
+    ctx: &mut SyscallContext<T>,
+    dest: u32,
+    value: u32,
+  ) -> Result<Option<u32>, ExecutionError> {
+    let len = ctx.register_unsafe(Register::X12);
+    check_range(dest, len)?;
+    charge_words(ctx, dest, len)?;
+    ctx.check_memory_write(dest, len)?;
+    if len > 0 {
+      let end = dest + len;
+      let word = u32::from_ne_bytes([value as u8; 4]);
+      for word_addr in (dest & !3..end.next_multiple_of(4)).step_by(4) {
+        write_word_masked(ctx, word_addr, word, dest, end);
+      }
+    }
+    Ok(None)
+  }
+}
+
+pub(super) fn check_range(addr: u32, len: u32) -> Result<(), ExecutionError> {
+  if len == 0 {
+    return Ok(());
+  }
+  if addr < MEMORY_START {
+    return Err(ExecutionError::InvalidMemoryOperation(
+      "memory range overlaps the registers",
+    ));
+  }
+  // The end is rounded up to a word, which must not overflow either.
+  match addr.checked_add(len) {
+    Some(end) if end <= u32::MAX - 3 => Ok(()),
+    _ => Err(ExecutionError::InvalidMemoryOperation(
+      "memory range out of bounds",
+    )),
+  }
+}
+
+/// Charges for the words spanned by `len` bytes from `addr`, before touching them.
+pub(super) fn charge_words<T: HostInterface>(
+  ctx: &mut SyscallContext<T>,
+  addr: u32,
+  len: u32,
+) -> Result<(), ExecutionError> {
+  let words = ((addr % 4 + len).div_ceil(4)) * MEMORY_CYCLES_PER_WORD;
+  ctx.charge_cycles(words)
+}
+
+/// Copies `len` bytes from `src` to `dest` a word at a time, without buffering them. Copying
+/// forwards when the destination is below the source, and backwards otherwise, each source byte
+/// is read before the copy overwrites it.
+fn copy_words<T: HostInterface>(ctx: &mut SyscallContext<T>, dest: u32, src: u32, len: u32) {
+  if len == 0 {
+    return;
+  }
+  let end = dest + len;
+  let words = (dest & !3..end.next_multiple_of(4)).step_by(4);
+  let mut copy = |word_addr: u32| {
+    // The bytes of the first and last words outside the destination are read, but not copied.
+    let word = read_unaligned_word(ctx, word_addr.wrapping_add(src).wrapping_sub(dest));
+    write_word_masked(ctx, word_addr, word, dest, end);
+  };
+  if dest <= src {
+    words.for_each(&mut copy);
+  } else {
+    words.rev().for_each(&mut copy);
+  }
+}
+
+/// Reads the word made of the 4 bytes from `addr` on, which may be unaligned.
+fn read_unaligned_word<T: HostInterface>(ctx: &SyscallContext<T>, addr: u32) -> u32 {
+  let word_addr = addr & !3;
+  let shift = (addr % 4) * 8;
+  if shift == 0 {
+    return ctx.word_unsafe(word_addr);
+  }
+  ctx.word_unsafe(word_addr) >> shift | ctx.word_unsafe(word_addr + 4) << (32 - shift)
+}
+
+/// Writes the bytes of `word` which fall in `start..end` to the word at `word_addr`, keeping
+/// its other bytes. Only the edge words of a range are read first.
+fn write_word_masked<T: HostInterface>(
+  ctx: &mut SyscallContext<T>,
+  word_addr: u32,
+  word: u32,
+  start: u32,
+  end: u32,
+) {
+  let lo = start.max(word_addr) - word_addr;
+  let hi = end.min(word_addr + 4) - word_addr;
+  let value = if lo == 0 && hi == 4 {
+    word
+  } else {
+    let mask = (((1u64 << ((hi - lo) * 8)) - 1) << (lo * 8)) as u32;
+    ctx.word_unsafe(word_addr) & !mask | word & mask
+  };
+  ctx.mw(word_addr, value);
+}
+
+// Memory is read without records, like the other syscalls: the words copied may be written
+// again at the same clk.
+pub(super) fn read_bytes<T: HostInterface>(
+  ctx: &mut SyscallContext<T>,
+  addr: u32,
+  len: u32,
+) -> Vec<u8> {
+  let start = addr & !3;
+  let end = (addr + len).next_multiple_of(4);
+  let mut bytes = Vec::with_capacity((end - start) as usize);
+  for word_addr in (start..end).step_by(4) {
+    bytes.extend_from_slice(&ctx.word_unsafe(word_addr).to_le_bytes());
+  }
+  let offset = (addr - start) as usize;
+  bytes.drain(..offset);
+  bytes.truncate(len as usize);
+  bytes
+}
+
+pub(super) fn write_bytes<T: HostInterface>(
+  ctx: &mut SyscallContext<T>,
+  addr: u32,
+  mut bytes: &[u8],
+) {
+  let mut word_addr = addr & !3;
+  let mut offset = (addr - word_addr) as usize;
+  while !bytes.is_empty() {
+    let n = (4 - offset).min(bytes.len());
+    // Partially written words keep their other bytes.
+    let mut word = if n < 4 {
+      ctx.word_unsafe(word_addr).to_le_bytes()
+    } else {
+      [0; 4]
+    };
+    word[offset..offset + n].copy_from_slice(&bytes[..n]);
+    ctx.mw(word_addr, u32::from_le_bytes(word));
+    bytes = &bytes[n..];
+    offset = 0;
+    word_addr += 4;
+  }
+}
+
+#[cfg(test)]
+mod tests {
+  use athena_interface::MockHost;
+
+  use crate::runtime::{ExecutionError, Instruction, Opcode, Program, Runtime, SyscallCode};
+  use crate::utils::AthenaCoreOpts;
+
+  /// Runs `syscall` with a0 = `a0`, a1 = `a1` and a2 = `len`, after initializing the memory from
+  /// 0x1000 to 0x1000 + 16 with 0x00, 0x01, ..., 0x0f.
+  fn run(
+    syscall: SyscallCode,
+    a0: u32,
+    a1: u32,
+    len: u32,
+  ) -> Result<Runtime<MockHost>, ExecutionError> {
+    let instructions = vec![
+      Instruction::new(Opcode::ADD, 5, 0, syscall as u32, false, true),
+      Instruction::new(Opcode::ADD, 10, 0, a0, false, true),
+      Instruction::new(Opcode::ADD, 11, 0, a1, false, true),
+      Instruction::new(Opcode::ADD, 12, 0, len, false, true),
+      Instruction::new(Opcode::ECALL, 5, 10, 11, false, false),
+    ];
+    let mut program = Program::new(instructions, 0, 0);
+    for (i, addr) in (0x1000..0x1010).step_by(4).enumerate() {
+      let i = i as u32 * 4;
+      program.memory_image.insert(
+        addr,
+        u32::from_le_bytes([i as u8, i as u8 + 1, i as u8 + 2, i as u8 + 3]),
+      );
+    }
+    let mut runtime = Runtime::<MockHost>::new(program, None, AthenaCoreOpts::default());
+    runtime.run()?;
+    Ok(runtime)
+  }
+
+  fn bytes(runtime: &Runtime<MockHost>, addr: u32, len: u32) -> Vec<u8> {
+    (addr..addr + len).map(|addr| runtime.byte(addr)).collect()
+  }
+
+  #[test]
+  fn test_memcpy_unaligned() {
+    let runtime = run(SyscallCode::MEMCPY, 0x2001, 0x1003, 9).unwrap();
+    assert_eq!(
+      bytes(&runtime, 0x2000, 12),
+      [0, 3, 4, 5, 6, 7, 8, 9, 10, 11, 0, 0]
+    );
+  }
+
+  #[test]
+  fn test_memmove_overlapping() {
+    let runtime = run(SyscallCode::MEMMOVE, 0x1002, 0x1000, 8).unwrap();
+    assert_eq!(
+      bytes(&runtime, 0x1000, 12),
+      [0, 1, 0, 1, 2, 3, 4, 5, 6, 7, 10, 11]
+    );
+    let runtime = run(SyscallCode::MEMMOVE, 0x1000, 0x1003, 8).unwrap();
+    assert_eq!(
+      bytes(&runtime, 0x1000, 12),
+      [3, 4, 5, 6, 7, 8, 9, 10, 8, 9, 10, 11]
+    );
+  }
+
+  #[test]
+  fn test_memmove_matches_copy_within() {
+    // Every alignment of the source and destination, overlapping or not, in either direction.
+    for dest in 0x1000..0x1008 {
+      for src in 0x1000..0x1008 {
+        for len in [1, 3, 4, 5, 8, 11] {
+          let runtime = run(SyscallCode::MEMMOVE, dest, src, len).unwrap();
+          let mut expected: Vec<u8> = (0..16).chain([0; 8]).collect();
+          let (dest, src) = ((dest - 0x1000) as usize, (src - 0x1000) as usize);
+          expected.copy_within(src..src + len as usize, dest);
+          assert_eq!(bytes(&runtime, 0x1000, 24), expected, "{dest} {src} {len}");
+        }
+      }
+    }
+  }
+
+  #[test]
+  fn test_memset() {
+    let runtime = run(SyscallCode::MEMSET, 0x1001, 0xab, 6).unwrap();
+    assert_eq!(
+      bytes(&runtime, 0x1000, 8),
+      [0, 0xab, 0xab, 0xab, 0xab, 0xab, 0xab, 7]
+    );
+    // Whole words are set between the edge words.
+    let runtime = run(SyscallCode::MEMSET, 0x1003, 0xcd, 10).unwrap();
+    assert_eq!(
+      bytes(&runtime, 0x1000, 16),
+      [0, 1, 2, 0xcd, 0xcd, 0xcd, 0xcd, 0xcd, 0xcd, 0xcd, 0xcd, 0xcd, 0xcd, 13, 14, 15]
+    );
+  }
+
+  #[test]
+  fn test_memory_syscalls_untraced() {
+    let instructions = vec![
+      Instruction::new(Opcode::ADD, 5, 0, SyscallCode::MEMSET as u32, false, true),
+      Instruction::new(Opcode::ADD, 10, 0, 0x1001, false, true),
+      Instruction::new(Opcode::ADD, 11, 0, 0xab, false, true),
+      Instruction::new(Opcode::ADD, 12, 0, 6, false, true),
+      Instruction::new(Opcode::ECALL, 5, 10, 11, false, false),
+    ];
+    let program = Program::new(instructions, 0, 0);
+    let mut runtime = Runtime::<MockHost>::new(program, None, AthenaCoreOpts::default());
+    runtime.run_fast().unwrap();
+    assert_eq!(
+      bytes(&runtime, 0x1000, 8),
+      [0, 0xab, 0xab, 0xab, 0xab, 0xab, 0xab, 0]
+    );
+  }
+
+  #[test]
+  fn test_memory_syscalls_read_hinted_memory() {
+    let ecall = |syscall: SyscallCode, a0, a1, a2| {
+      [
+        Instruction::new(Opcode::ADD, 5, 0, syscall as u32, false, true),
+        Instruction::new(Opcode::ADD, 10, 0, a0, false, true),
+        Instruction::new(Opcode::ADD, 11, 0, a1, false, true),
+        Instruction::new(Opcode::ADD, 12, 0, a2, false, true),
+        Instruction::new(Opcode::ECALL, 5, 10, 11, false, false),
+      ]
+    };
+    let instructions = [
+      ecall(SyscallCode::HINT_READ, 0x1000, 8, 0),
+      // Copies from hinted words, and sets part of one.
+      ecall(SyscallCode::MEMCPY, 0x2001, 0x1001, 6),
+      ecall(SyscallCode::MEMSET, 0x1005, 0xab, 2),
+    ]
+    .concat();
+    for traced in [true, false] {
+      let program = Program::new(instructions.clone(), 0, 0);
+      let mut runtime = Runtime::<MockHost>::new(program, None, AthenaCoreOpts::default());
+      runtime.write_stdin_slice(&[1, 2, 3, 4, 5, 6, 7, 8]);
+      if traced {
+        runtime.run().unwrap();
+      } else {
+        runtime.run_fast().unwrap();
+      }
+      assert_eq!(bytes(&runtime, 0x2000, 8), [0, 2, 3, 4, 5, 6, 7, 0]);
+      assert_eq!(bytes(&runtime, 0x1000, 8), [1, 2, 3, 4, 5, 0xab, 0xab, 8]);
+    }
+  }
+
+  #[test]
+  fn test_memory_syscall_cycles() {
+    let base = run(SyscallCode::MEMSET, 0x1000, 0, 0).unwrap().state.clk;
+    // 9 bytes from 0x2003 span 3 words.
+    let runtime = run(SyscallCode::MEMSET, 0x2003, 0, 9).unwrap();
+    assert_eq!(runtime.state.clk, base + 3 * super::MEMORY_CYCLES_PER_WORD);
+  }
+
+  #[test]
+  fn test_memory_syscall_memory_limit() {
+    let instructions = vec![
+      Instruction::new(Opcode::ADD, 5, 0, SyscallCode::MEMSET as u32, false, true),
+      Instruction::new(Opcode::ADD, 10, 0, 0x10000, false, true),
+      Instruction::new(Opcode::ADD, 12, 0, 1 << 20, false, true),
+      Instruction::new(Opcode::ECALL, 5, 10, 11, false, false),
+    ];
+    let run = |memory_limit| {
+      let opts = AthenaCoreOpts {
+        memory_limit: Some(memory_limit),
+        ..Default::default()
+      };
+      let mut runtime =
+        Runtime::<MockHost>::new(Program::new(instructions.clone(), 0, 0), None, opts);
+      let result = runtime.run_fast();
+      (result, runtime.state.memory.size())
+    };
+    let (result, size) = run(usize::MAX);
+    assert!(result.is_ok());
+    // The write fails before any of it is done, rather than after the block.
+    let (result, rejected) = run(size - 1);
+    assert!(matches!(result, Err(ExecutionError::OutOfMemory())));
+    assert!(rejected < size / 100);
+  }
+
+  #[test]
+  fn test_memory_syscall_invalid_range() {
+    assert!(matches!(
+      run(SyscallCode::MEMSET, 4, 0, 4),
+      Err(ExecutionError::InvalidMemoryOperation(_))
+    ));
+    assert!(matches!(
+      run(SyscallCode::MEMCPY, 0x1000, u32::MAX - 8, 16),
+      Err(ExecutionError::InvalidMemoryOperation(_))
+    ));
+  }
+}
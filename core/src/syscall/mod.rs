@@ -1,9 +1,13 @@
+mod crypto;
 mod halt;
 mod hint;
 mod host;
+mod memory;
 mod write;
 
+pub use crypto::*;
 pub use halt::*;
 pub use hint::*;
 pub use host::*;
+pub use memory::*;
 pub use write::*;
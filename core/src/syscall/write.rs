@@ -1,10 +1,17 @@
-use athena_interface::HostInterface;
+use athena_interface::{HostInterface, LogStream};
 
+use super::memory::{charge_words, check_range};
 use crate::{
-  runtime::{Register, Syscall, SyscallContext},
+  runtime::{ExecutionError, ExecutionState, GuestLogMode, Register, Syscall, SyscallContext},
   utils::num_to_comma_separated,
 };
 
+const CYCLE_TRACKER_START: &[u8] = b"cycle-tracker-start:";
+const CYCLE_TRACKER_END: &[u8] = b"cycle-tracker-end:";
+
+/// Writes longer than this aren't checked for cycle-tracker markers when buffering the log.
+const MAX_MARKER_LEN: usize = 128;
+
 pub struct SyscallWrite;
 
 impl SyscallWrite {
@@ -17,72 +24,191 @@ impl<T> Syscall<T> for SyscallWrite
 where
   T: HostInterface,
 {
-  fn execute(&self, ctx: &mut SyscallContext<T>, arg1: u32, arg2: u32) -> Option<u32> {
+  fn execute(
+    &self,
+    ctx: &mut SyscallContext<T>,
+    arg1: u32,
+    arg2: u32,
+  ) -> Result<Option<u32>, ExecutionError> {
     let a2 = Register::X12;
-    let rt = &mut ctx.rt;
     let fd = arg1;
-    if fd == 1 || fd == 2 || fd == 3 || fd == 4 {
-      let write_buf = arg2;
-      let nbytes = rt.register(a2);
-      // Read nbytes from memory starting at write_buf.
-      let bytes = (0..nbytes)
-        .map(|i| rt.byte(write_buf + i))
-        .collect::<Vec<u8>>();
-      let slice = bytes.as_slice();
-      if fd == 1 {
-        let s = core::str::from_utf8(slice).unwrap();
-        if s.contains("cycle-tracker-start:") {
-          let fn_name = s
-            .split("cycle-tracker-start:")
-            .last()
-            .unwrap()
-            .trim_end()
-            .trim_start();
-          let depth = rt.cycle_tracker.len() as u32;
-          rt.cycle_tracker
-            .insert(fn_name.to_string(), (rt.state.global_clk, depth));
-          let padding = (0..depth).map(|_| "│ ").collect::<String>();
-          log::debug!("{}┌╴{}", padding, fn_name);
-        } else if s.contains("cycle-tracker-end:") {
-          let fn_name = s
-            .split("cycle-tracker-end:")
-            .last()
-            .unwrap()
-            .trim_end()
-            .trim_start();
-          let (start, depth) = rt.cycle_tracker.remove(fn_name).unwrap_or((0, 0));
-          // Leftpad by 2 spaces for each depth.
-          let padding = (0..depth).map(|_| "│ ").collect::<String>();
-          log::info!(
-            "{}└╴{} cycles",
-            padding,
-            num_to_comma_separated(rt.state.global_clk - start as u64)
-          );
-        } else {
-          let flush_s = update_io_buf(ctx, fd, s);
-          if !flush_s.is_empty() {
-            flush_s
-              .into_iter()
-              .for_each(|line| println!("stdout: {}", line));
+    let write_buf = arg2;
+    let nbytes = ctx.rt.register(a2);
+    check_range(write_buf, nbytes)?;
+    // Every write is charged for the bytes it reads, so that its cost doesn't depend on how the
+    // host handles the guest's output.
+    charge_words(ctx, write_buf, nbytes)?;
+    let rt = &mut ctx.rt;
+    match fd {
+      1 | 2 => match rt.guest_log {
+        GuestLogMode::Off => {}
+        GuestLogMode::Buffer(_) => {
+          let stream = if fd == 1 {
+            LogStream::Stdout
+          } else {
+            LogStream::Stderr
+          };
+          let clk = rt.state.global_clk;
+          // The log is moved out while it is written, so that memory can be read meanwhile.
+          let mut log = std::mem::take(&mut rt.state.log);
+          let state = &rt.state;
+          if let Some((stream, name)) = (fd == 1)
+            .then(|| cycle_tracker_marker(state, write_buf, nbytes))
+            .flatten()
+          {
+            let name = name.trim_ascii();
+            log.push(stream, clk, name.len(), name.iter().copied());
+          } else {
+            let bytes = guest_bytes(state, write_buf, nbytes);
+            log.push(stream, clk, nbytes as usize, bytes);
           }
+          rt.state.log = log;
         }
-      } else if fd == 2 {
-        let s = core::str::from_utf8(slice).unwrap();
-        let flush_s = update_io_buf(ctx, fd, s);
-        if !flush_s.is_empty() {
-          flush_s
-            .into_iter()
-            .for_each(|line| println!("stderr: {}", line));
+        GuestLogMode::Print => {
+          let bytes = guest_bytes(&rt.state, write_buf, nbytes).collect::<Vec<u8>>();
+          print(ctx, fd, &bytes);
         }
-      } else if fd == 3 {
-        rt.state.public_values_stream.extend_from_slice(slice);
-      } else if fd == 4 {
-        rt.state.input_stream.push(slice.to_vec());
-      } else {
-        unreachable!()
+      },
+      3 => {
+        let len = rt.state.public_values_stream.len();
+        check_stream_len(rt.memory_limit, len, nbytes)?;
+        let mut stream = std::mem::take(&mut rt.state.public_values_stream);
+        stream.extend(guest_bytes(&rt.state, write_buf, nbytes));
+        rt.state.public_values_stream = stream;
       }
+      4 => {
+        let len = rt.state.input_stream.iter().map(Vec::len).sum();
+        check_stream_len(rt.memory_limit, len, nbytes)?;
+        let bytes = guest_bytes(&rt.state, write_buf, nbytes).collect();
+        rt.state.input_stream.push(bytes);
+      }
+      _ => {}
+    }
+    Ok(None)
+  }
+}
+
+/// Fails with [ExecutionError::OutOfMemory] if appending `nbytes` to a stream of `len` bytes
+/// would exceed `memory_limit`. The guest fills the streams as it does its memory, so they are
+/// bounded the same way.
+fn check_stream_len(
+  memory_limit: Option<usize>,
+  len: usize,
+  nbytes: u32,
+) -> Result<(), ExecutionError> {
+  match memory_limit {
+    Some(limit) if len + nbytes as usize > limit => Err(ExecutionError::OutOfMemory()),
+    _ => Ok(()),
+  }
+}
+
+/// Iterates over the `len` bytes of guest memory from `addr` on. Words never accessed read as
+/// their hinted value, see [ExecutionState::read_word].
+fn guest_bytes(state: &ExecutionState, addr: u32, len: u32) -> impl Iterator<Item = u8> + '_ {
+  (0..len).map(move |i| {
+    let addr = addr.wrapping_add(i);
+    let word = state.read_word(addr - addr % 4);
+    (word >> ((addr % 4) * 8)) as u8
+  })
+}
+
+/// Returns the stream and the region name of a write which is a cycle-tracker marker. The write
+/// is copied to the stack, as markers are short.
+fn cycle_tracker_marker(
+  state: &ExecutionState,
+  addr: u32,
+  len: u32,
+) -> Option<(LogStream, MarkerName)> {
+  if len as usize > MAX_MARKER_LEN {
+    return None;
+  }
+  let mut buf = [0; MAX_MARKER_LEN];
+  for (byte, value) in buf.iter_mut().zip(guest_bytes(state, addr, len)) {
+    *byte = value;
+  }
+  let s = &buf[..len as usize];
+  for (marker, stream) in [
+    (CYCLE_TRACKER_START, LogStream::CycleTrackerStart),
+    (CYCLE_TRACKER_END, LogStream::CycleTrackerEnd),
+  ] {
+    if let Some(pos) = s.windows(marker.len()).rposition(|w| w == marker) {
+      let start = pos + marker.len();
+      return Some((
+        stream,
+        MarkerName {
+          buf,
+          start,
+          end: len as usize,
+        },
+      ));
+    }
+  }
+  None
+}
+
+/// The region name of a cycle-tracker marker, held on the stack.
+struct MarkerName {
+  buf: [u8; MAX_MARKER_LEN],
+  start: usize,
+  end: usize,
+}
+
+impl std::ops::Deref for MarkerName {
+  type Target = [u8];
+
+  fn deref(&self) -> &[u8] {
+    &self.buf[self.start..self.end]
+  }
+}
+
+/// Prints a write to stdout or stderr, with [GuestLogMode::Print]. Invalid UTF-8 is replaced
+/// with U+FFFD.
+fn print<T: HostInterface>(ctx: &mut SyscallContext<T>, fd: u32, slice: &[u8]) {
+  let rt = &mut ctx.rt;
+  let s = String::from_utf8_lossy(slice);
+  if fd == 1 {
+    if s.contains("cycle-tracker-start:") {
+      let fn_name = s
+        .split("cycle-tracker-start:")
+        .last()
+        .unwrap()
+        .trim_end()
+        .trim_start();
+      let depth = rt.cycle_tracker.len() as u32;
+      rt.cycle_tracker
+        .insert(fn_name.to_string(), (rt.state.global_clk, depth));
+      let padding = (0..depth).map(|_| "│ ").collect::<String>();
+      log::debug!("{}┌╴{}", padding, fn_name);
+    } else if s.contains("cycle-tracker-end:") {
+      let fn_name = s
+        .split("cycle-tracker-end:")
+        .last()
+        .unwrap()
+        .trim_end()
+        .trim_start();
+      let (start, depth) = rt.cycle_tracker.remove(fn_name).unwrap_or((0, 0));
+      // Leftpad by 2 spaces for each depth.
+      let padding = (0..depth).map(|_| "│ ").collect::<String>();
+      log::info!(
+        "{}└╴{} cycles",
+        padding,
+        num_to_comma_separated(rt.state.global_clk - start as u64)
+      );
+    } else {
+      let flush_s = update_io_buf(ctx, fd, &s);
+      if !flush_s.is_empty() {
+        flush_s
+          .into_iter()
+          .for_each(|line| println!("stdout: {}", line));
+      }
+    }
+  } else {
+    let flush_s = update_io_buf(ctx, fd, &s);
+    if !flush_s.is_empty() {
+      flush_s
+        .into_iter()
+        .for_each(|line| println!("stderr: {}", line));
     }
-    None
   }
 }
 
@@ -108,3 +234,183 @@ pub fn update_io_buf<T: HostInterface>(
     vec![]
   }
 }
+
+#[cfg(test)]
+mod tests {
+  use athena_interface::{LogStream, MockHost};
+
+  use crate::runtime::{
+    ExecutionError, GuestLogMode, Instruction, Opcode, Program, Runtime, SyscallCode,
+  };
+  use crate::syscall::MEMORY_CYCLES_PER_WORD;
+  use crate::utils::{tests::HELLO_WORLD_ELF, AthenaCoreOpts};
+
+  /// Runs a program making a WRITE syscall of each of `writes`.
+  fn run(writes: &[(u32, &[u8])], guest_log: GuestLogMode) -> Runtime<MockHost> {
+    let opts = AthenaCoreOpts {
+      guest_log,
+      ..Default::default()
+    };
+    let mut runtime = Runtime::<MockHost>::new(program(writes), None, opts);
+    runtime.run_fast().unwrap();
+    runtime
+  }
+
+  /// A program making a WRITE syscall of each of `writes`.
+  fn program(writes: &[(u32, &[u8])]) -> Program {
+    let mut instructions = Vec::new();
+    let mut program = Program::new(vec![], 0, 0);
+    for (i, (fd, bytes)) in writes.iter().enumerate() {
+      let addr = 0x1000 + i as u32 * 0x100;
+      program.memory_image.insert_bytes(addr, bytes);
+      instructions.extend([
+        Instruction::new(Opcode::ADD, 5, 0, SyscallCode::WRITE as u32, false, true),
+        Instruction::new(Opcode::ADD, 10, 0, *fd, false, true),
+        Instruction::new(Opcode::ADD, 11, 0, addr, false, true),
+        Instruction::new(Opcode::ADD, 12, 0, bytes.len() as u32, false, true),
+        Instruction::new(Opcode::ECALL, 5, 10, 11, false, false),
+      ]);
+    }
+    program.instructions = instructions;
+    program
+  }
+
+  #[test]
+  fn test_buffered_log() {
+    let mut runtime = run(
+      &[
+        (1, b"cycle-tracker-start: loop\n"),
+        (1, b"hello"),
+        (2, b"oops\n"),
+        (1, b"cycle-tracker-end: loop\n"),
+        (3, b"public"),
+      ],
+      GuestLogMode::Buffer(1024),
+    );
+    assert_eq!(runtime.state.public_values_stream, b"public");
+    assert!(runtime.io_buf.is_empty());
+    let records: Vec<_> = runtime
+      .state
+      .log
+      .records()
+      .map(|record| (record.stream, record.clk, record.data.to_vec()))
+      .collect();
+    assert_eq!(
+      records,
+      [
+        (LogStream::CycleTrackerStart, 4, b"loop".to_vec()),
+        (LogStream::Stdout, 9, b"hello".to_vec()),
+        (LogStream::Stderr, 14, b"oops\n".to_vec()),
+        (LogStream::CycleTrackerEnd, 19, b"loop".to_vec()),
+      ]
+    );
+  }
+
+  #[test]
+  fn test_log_off() {
+    let runtime = run(
+      &[(1, b"hello\n"), (2, b"partial"), (3, b"public")],
+      GuestLogMode::Off,
+    );
+    assert!(runtime.state.log.is_empty());
+    assert!(runtime.io_buf.is_empty());
+    assert_eq!(runtime.state.public_values_stream, b"public");
+
+    // Printing keeps partial lines until they are completed.
+    let runtime = run(&[(2, b"partial")], GuestLogMode::Print);
+    assert_eq!(runtime.io_buf[&2], "partial");
+
+    // Invalid UTF-8 is printed lossily.
+    let runtime = run(&[(1, b"\xffpartial")], GuestLogMode::Print);
+    assert_eq!(runtime.io_buf[&1], "\u{fffd}partial");
+  }
+
+  #[test]
+  fn test_write_cycles() {
+    let gas_used = |fd, bytes: &[u8]| {
+      let opts = AthenaCoreOpts {
+        gas_limit: Some(1000),
+        guest_log: GuestLogMode::Off,
+        ..Default::default()
+      };
+      let mut runtime = Runtime::<MockHost>::new(program(&[(fd, bytes)]), None, opts);
+      runtime.run_fast().unwrap();
+      1000 - runtime.gas_left.unwrap()
+    };
+    for fd in [1, 3, 4, 5] {
+      assert_eq!(
+        gas_used(fd, &[7; 9]),
+        gas_used(fd, b"") + 3 * MEMORY_CYCLES_PER_WORD as u64
+      );
+    }
+  }
+
+  #[test]
+  fn test_write_stream_limit() {
+    for fd in [3, 4] {
+      let opts = AthenaCoreOpts {
+        memory_limit: Some(1 << 20),
+        ..Default::default()
+      };
+      let mut program = program(&[(fd, b"")]);
+      // Write more bytes than the memory limit, from memory which was never written.
+      program.instructions[3] = Instruction::new(Opcode::ADD, 12, 0, 1 << 21, false, true);
+      let mut runtime = Runtime::<MockHost>::new(program, None, opts);
+      assert!(matches!(
+        runtime.run_fast(),
+        Err(ExecutionError::OutOfMemory())
+      ));
+      assert!(runtime.state.public_values_stream.is_empty());
+    }
+  }
+
+  #[test]
+  fn test_write_hinted_bytes() {
+    // Hinted bytes are only copied to memory once accessed when tracing, and are written out
+    // all the same.
+    let addi = |rd, imm| Instruction::new(Opcode::ADD, rd, 0, imm, false, true);
+    let ecall = Instruction::new(Opcode::ECALL, 5, 10, 11, false, false);
+    let program = Program::new(
+      vec![
+        addi(5, SyscallCode::HINT_READ as u32),
+        addi(10, 0x1000),
+        addi(11, 5),
+        ecall,
+        addi(5, SyscallCode::WRITE as u32),
+        addi(10, 3),
+        addi(11, 0x1000),
+        addi(12, 5),
+        ecall,
+      ],
+      0,
+      0,
+    );
+    let input = [1, 2, 3, 4, 5];
+
+    let mut traced = Runtime::<MockHost>::new(program.clone(), None, AthenaCoreOpts::default());
+    traced.write_stdin_slice(&input);
+    traced.run().unwrap();
+    let mut fast = Runtime::<MockHost>::new(program, None, AthenaCoreOpts::default());
+    fast.run_fast_with_input(&[&input]).unwrap();
+    assert_eq!(traced.state.public_values_stream, input);
+    assert_eq!(fast.state.public_values_stream, input);
+  }
+
+  #[test]
+  fn test_buffered_program_output() {
+    let opts = AthenaCoreOpts {
+      guest_log: GuestLogMode::Buffer(1024),
+      ..Default::default()
+    };
+    let mut runtime = Runtime::<MockHost>::new(Program::from(HELLO_WORLD_ELF), None, opts);
+    runtime.run_fast().unwrap();
+    let stdout: Vec<u8> = runtime
+      .state
+      .log
+      .records()
+      .filter(|record| record.stream == LogStream::Stdout)
+      .flat_map(|record| record.data.to_vec())
+      .collect();
+    assert_eq!(stdout, b"Hello, world!\n");
+  }
+}
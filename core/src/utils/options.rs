@@ -1,10 +1,28 @@
+use crate::runtime::{GuestLogMode, MemoryBackend};
+
 #[derive(Debug, Clone, Copy)]
 pub struct AthenaCoreOpts {
+    /// The data structure backing guest memory.
+    pub memory_backend: MemoryBackend,
+
+    /// The gas available for execution, or `None` to run unmetered.
+    pub gas_limit: Option<u64>,
+
+    /// The maximum size of guest memory in bytes (see [crate::runtime::GuestMemory::size]), or
+    /// `None` for no limit.
+    pub memory_limit: Option<usize>,
+
+    /// Where the guest's log output goes.
+    pub guest_log: GuestLogMode,
 }
 
 impl Default for AthenaCoreOpts {
     fn default() -> Self {
         Self {
+            memory_backend: MemoryBackend::default(),
+            gas_limit: None,
+            memory_limit: None,
+            guest_log: GuestLogMode::default(),
         }
     }
 }
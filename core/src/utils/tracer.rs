@@ -1,4 +1,12 @@
+use std::collections::BTreeMap;
 use std::env;
+use std::ops::Range;
+
+use elf::abi::STT_FUNC;
+use elf::endian::LittleEndian;
+use elf::parse::ParseError;
+use elf::ElfBytes;
+use rustc_demangle::demangle;
 
 use tracing::level_filters::LevelFilter;
 use tracing_forest::ForestLayer;
@@ -6,6 +14,8 @@ use tracing_subscriber::layer::SubscriberExt;
 use tracing_subscriber::util::SubscriberInitExt;
 use tracing_subscriber::{EnvFilter, Registry};
 
+use crate::runtime::{TraceCodec, TraceError, TraceHeader, TraceRecord};
+
 /// A tracer to benchmark the performance of the vm.
 ///
 /// Set the `RUST_TRACER` environment variable to be set to `info` or `debug`.
@@ -26,3 +36,192 @@ pub fn setup_tracer() {
         .with(ForestLayer::default())
         .init();
 }
+
+/// Reads the records of a trace written by [TraceWriter](crate::runtime::TraceWriter).
+pub struct TraceReader<'a> {
+    header: TraceHeader,
+    codec: TraceCodec,
+    input: &'a [u8],
+}
+
+impl<'a> TraceReader<'a> {
+    pub fn new(mut input: &'a [u8]) -> Result<Self, TraceError> {
+        let header = TraceHeader::decode(&mut input)?;
+        Ok(Self {
+            header,
+            codec: TraceCodec::default(),
+            input,
+        })
+    }
+
+    pub fn header(&self) -> &TraceHeader {
+        &self.header
+    }
+}
+
+impl Iterator for TraceReader<'_> {
+    type Item = Result<TraceRecord, TraceError>;
+
+    fn next(&mut self) -> Option<Self::Item> {
+        if self.input.is_empty() {
+            return None;
+        }
+        let record = self.codec.decode(&mut self.input);
+        if record.is_err() {
+            self.input = &[];
+        }
+        Some(record)
+    }
+}
+
+/// The function symbols of an ELF, to attribute pcs to functions.
+#[derive(Debug, Clone, Default)]
+pub struct Symbols {
+    /// The address range and demangled name of each function, ordered by address.
+    functions: Vec<(Range<u32>, String)>,
+}
+
+impl Symbols {
+    pub fn from_elf(elf: &[u8]) -> Result<Self, TraceError> {
+        let invalid = |err: ParseError| TraceError::InvalidElf(err.to_string());
+        let elf = ElfBytes::<LittleEndian>::minimal_parse(elf).map_err(invalid)?;
+        let mut functions = Vec::new();
+        if let Some((symbols, names)) = elf.symbol_table().map_err(invalid)? {
+            for symbol in symbols.iter() {
+                if symbol.st_symtype() != STT_FUNC || symbol.st_size == 0 {
+                    continue;
+                }
+                let name = names.get(symbol.st_name as usize).map_err(invalid)?;
+                let start = symbol.st_value as u32;
+                let end = start.saturating_add(symbol.st_size as u32);
+                functions.push((start..end, format!("{:#}", demangle(name))));
+            }
+        }
+        functions.sort_by_key(|(range, _)| range.start);
+        Ok(Self { functions })
+    }
+
+    /// The index of the function containing `pc`.
+    fn lookup(&self, pc: u32) -> Option<usize> {
+        let idx = self
+            .functions
+            .partition_point(|(range, _)| range.start <= pc)
+            .checked_sub(1)?;
+        self.functions[idx].0.contains(&pc).then_some(idx)
+    }
+}
+
+/// Folds a trace into the call stacks of the functions executed, in the "folded stacks" format
+/// read by flamegraph tools: one `outer;inner count` line per stack, with the number of
+/// instructions executed in it.
+///
+/// Calls are recognized by jumps to the start of a function, and returns by jumps back into a
+/// function of the stack, so stacks are only exact for traces which aren't sampled. Instructions
+/// outside of any function are attributed to `[unknown]`.
+pub fn fold_stacks(trace: &[u8], symbols: &Symbols) -> Result<String, TraceError> {
+    const UNKNOWN: &str = "[unknown]";
+
+    let reader = TraceReader::new(trace)?;
+    let weight = reader.header().sample as u64;
+    let mut stacks: BTreeMap<String, u64> = BTreeMap::new();
+    let mut stack: Vec<Option<usize>> = Vec::new();
+    for record in reader {
+        let record = record?;
+        let function = symbols.lookup(record.pc);
+        if stack.last() != Some(&function) {
+            let is_call = function.is_some_and(|idx| symbols.functions[idx].0.start == record.pc);
+            match stack.iter().rposition(|caller| *caller == function) {
+                Some(caller) if !is_call => stack.truncate(caller + 1),
+                _ if is_call || stack.is_empty() => stack.push(function),
+                // A jump to another function without a call, e.g. a tail call.
+                _ => *stack.last_mut().unwrap() = function,
+            }
+        }
+        let name = stack
+            .iter()
+            .map(|function| match function {
+                Some(idx) => symbols.functions[*idx].1.as_str(),
+                None => UNKNOWN,
+            })
+            .collect::<Vec<_>>()
+            .join(";");
+        *stacks.entry(name).or_default() += weight;
+    }
+    Ok(stacks
+        .into_iter()
+        .map(|(stack, count)| format!("{stack} {count}\n"))
+        .collect())
+}
+
+#[cfg(test)]
+mod tests {
+    use athena_interface::MockHost;
+
+    use super::*;
+    use crate::runtime::{Program, Runtime, TraceConfig, TraceWriter};
+    use crate::utils::{tests::TEST_FIBONACCI_ELF, AthenaCoreOpts};
+
+    fn trace(config: TraceConfig) -> (Vec<u8>, u64) {
+        let path = config.path.clone();
+        let program = Program::from(TEST_FIBONACCI_ELF);
+        let mut runtime = Runtime::<MockHost>::new(program, None, AthenaCoreOpts::default());
+        runtime.trace = Some(TraceWriter::create(config).unwrap());
+        runtime.run().unwrap();
+        // Wait for the writer to finish.
+        runtime.trace = None;
+        let trace = std::fs::read(&path).unwrap();
+        std::fs::remove_file(&path).unwrap();
+        (trace, runtime.state.global_clk)
+    }
+
+    fn temp_path(name: &str) -> String {
+        let name = format!("athena-{name}-{}.trace", std::process::id());
+        std::env::temp_dir().join(name).to_str().unwrap().to_string()
+    }
+
+    #[test]
+    fn test_trace_execution() {
+        let (trace, cycles) = trace(TraceConfig::new(temp_path("full")));
+        let records = TraceReader::new(&trace)
+            .unwrap()
+            .collect::<Result<Vec<_>, _>>()
+            .unwrap();
+        assert_eq!(records.len() as u64, cycles);
+        assert!(records.iter().enumerate().all(|(i, r)| r.clk == i as u64));
+        assert!(records.iter().any(|r| r.memory.is_some_and(|m| m.write)));
+        // A record takes a few bytes, much less than its clk, pc, register and memory word.
+        assert!(trace.len() < records.len() * 8);
+
+        let symbols = Symbols::from_elf(TEST_FIBONACCI_ELF).unwrap();
+        let stacks = fold_stacks(&trace, &symbols).unwrap();
+        let total: u64 = stacks
+            .lines()
+            .map(|line| line.rsplit_once(' ').unwrap().1.parse::<u64>().unwrap())
+            .sum();
+        assert_eq!(total, cycles);
+        assert!(stacks.lines().any(|line| line.contains("main")));
+    }
+
+    #[test]
+    fn test_trace_sampling_and_filtering() {
+        let (full, _) = trace(TraceConfig::new(temp_path("unfiltered")));
+        let full: Vec<_> = TraceReader::new(&full).unwrap().map(Result::unwrap).collect();
+        let pc_range = full[10].pc..full[10].pc + 64;
+
+        let (trace, _) = trace(TraceConfig {
+            sample: 3,
+            pc_range: pc_range.clone(),
+            ..TraceConfig::new(temp_path("sampled"))
+        });
+        let reader = TraceReader::new(&trace).unwrap();
+        assert_eq!(reader.header().sample, 3);
+        let records: Vec<_> = reader.map(Result::unwrap).collect();
+        let expected: Vec<_> = full
+            .into_iter()
+            .filter(|r| r.clk % 3 == 0 && pc_range.contains(&r.pc))
+            .map(|r| (r.clk, r.pc))
+            .collect();
+        assert!(!expected.is_empty());
+        assert_eq!(records.iter().map(|r| (r.clk, r.pc)).collect::<Vec<_>>(), expected);
+    }
+}
@@ -26,7 +26,7 @@ extern "C"
      * The ATHCON ABI version always equals the major version number of the ATHCON project.
      * The Host SHOULD check if the ABI versions match when dynamically loading VMs.
      */
-    ATHCON_ABI_VERSION = 0
+    ATHCON_ABI_VERSION = 1
   };
 
   /**
@@ -52,6 +52,16 @@ extern "C"
     uint8_t bytes[24];
   } athcon_address;
 
+  /** A storage entry of an account. */
+  struct athcon_storage_slot
+  {
+    /** The address of the account. */
+    athcon_address address;
+
+    /** The index of the account's storage entry. */
+    athcon_bytes32 key;
+  };
+
   /** The kind of call-like instruction. */
   enum athcon_call_kind
   {
@@ -128,6 +138,22 @@ extern "C"
      * The length of the code to be executed.
      */
     size_t code_size;
+
+    /**
+     * The storage entries the execution is expected to access.
+     *
+     * The VM hands them to athcon_host_interface::prefetch_storage before the execution
+     * starts. The list is only a hint: entries missing from it are still accessible.
+     * This MAY be NULL.
+     */
+    const struct athcon_storage_slot *access_list;
+
+    /**
+     * The number of entries of the access list.
+     *
+     * If access_list is NULL this MUST be 0.
+     */
+    size_t access_list_size;
   };
 
   /** The transaction and block data for execution. */
@@ -262,6 +288,39 @@ extern "C"
     ATHCON_OUT_OF_MEMORY = -3
   };
 
+  /**
+   * The measured cost of an execution, see athcon_result::stats.
+   *
+   * The struct is versioned by its size: VMs fill in a prefix of the fields, and set
+   * athcon_execution_stats::size to the size of that prefix, so that fields can be added at the
+   * end without breaking Hosts built against an older header.
+   */
+  struct athcon_execution_stats
+  {
+    /**
+     * The size of the fields filled in, in bytes, including this one.
+     *
+     * If the VM doesn't report statistics this MUST be 0, and the other fields MUST be ignored.
+     * Fields ending past this size MUST be ignored.
+     */
+    uint32_t size;
+
+    /** The number of instructions executed. */
+    uint64_t cycles;
+
+    /** The number of syscalls made. */
+    uint64_t syscalls;
+
+    /** The number of syscalls calling the Host, e.g. to access storage. */
+    uint64_t host_calls;
+
+    /** The number of bytes of input read by the program with hint reads. */
+    uint64_t hint_bytes;
+
+    /** The largest size of guest memory, in bytes. */
+    uint64_t peak_memory;
+  };
+
   /* Forward declaration. */
   struct athcon_result;
 
@@ -304,7 +363,8 @@ extern "C"
      * field is ::ATHCON_SUCCESS) or from REVERT opcode.
      *
      * The memory containing the output data is owned by Athena and has to be
-     * freed with athcon_result::release().
+     * freed with athcon_result::release(). The Athena VM hands over the buffer the
+     * program wrote its output to, without copying it.
      *
      * This pointer MAY be NULL.
      * If athcon_result::output_size is 0 this pointer MUST NOT be dereferenced.
@@ -348,6 +408,23 @@ extern "C"
      * In all other cases the address MUST be null bytes.
      */
     athcon_address create_address;
+
+    /**
+     * The measured cost of the execution.
+     *
+     * It is reported whether the execution succeeded or not, so that the Host can account for
+     * the work done by failed executions too. Results created by the Host, e.g. those returned
+     * by athcon_call_fn, SHOULD set athcon_execution_stats::size to 0.
+     */
+    struct athcon_execution_stats stats;
+
+    /**
+     * Reserved for the creator of the result, e.g. to hold what athcon_result::release needs
+     * to free the output data.
+     *
+     * The user MUST NOT read or modify it. It MAY be NULL.
+     */
+    void *release_context;
   };
 
   /**
@@ -492,6 +569,99 @@ extern "C"
                                                               const athcon_bytes32 *key,
                                                               const athcon_bytes32 *value);
 
+  /**
+   * Get storage for many keys callback function.
+   *
+   * This callback function is used by a VM to query several storage entries of the given account
+   * in a single call. It is equivalent to calling athcon_get_storage_fn for each key in order.
+   * This callback is optional: if it is NULL, the VM uses athcon_get_storage_fn instead.
+   *
+   * @param context  The Host execution context.
+   * @param address  The address of the account.
+   * @param keys     The indices of the account's storage entries, an array of @p count items.
+   * @param values   The array of @p count items to store the values at the given keys into.
+   * @param count    The number of storage entries to read.
+   */
+  typedef void (*athcon_get_storage_many_fn)(struct athcon_host_context *context,
+                                             const athcon_address *address,
+                                             const athcon_bytes32 *keys,
+                                             athcon_bytes32 *values,
+                                             size_t count);
+
+  /**
+   * Set storage for many keys callback function.
+   *
+   * This callback function is used by a VM to update several storage entries of the given
+   * account in a single call. It is equivalent to calling athcon_set_storage_fn for each key in
+   * order. This callback is optional: if it is NULL, the VM uses athcon_set_storage_fn instead.
+   *
+   * @param context   The pointer to the Host execution context.
+   * @param address   The address of the account.
+   * @param keys      The indices of the storage entries, an array of @p count items.
+   * @param values    The values to be stored, an array of @p count items.
+   * @param statuses  The array of @p count items to store the effect on each storage item into.
+   * @param count     The number of storage entries to update.
+   */
+  typedef void (*athcon_set_storage_many_fn)(struct athcon_host_context *context,
+                                             const athcon_address *address,
+                                             const athcon_bytes32 *keys,
+                                             const athcon_bytes32 *values,
+                                             enum athcon_storage_status *statuses,
+                                             size_t count);
+
+  /**
+   * Prefetch storage callback function.
+   *
+   * This callback function is used by a VM to announce, before an execution starts, the storage
+   * entries it is about to access, e.g. those of athcon_message::access_list. The Host can load
+   * them concurrently and have them cached by the time they are read. The values are still read
+   * with athcon_get_storage_fn or athcon_get_storage_many_fn.
+   * This callback is optional: if it is NULL, the VM doesn't prefetch.
+   *
+   * @param context  The Host execution context.
+   * @param slots    The storage entries, an array of @p count items.
+   * @param count    The number of storage entries.
+   */
+  typedef void (*athcon_prefetch_storage_fn)(struct athcon_host_context *context,
+                                             const struct athcon_storage_slot *slots,
+                                             size_t count);
+
+  /** The kind of output of a log record, see athcon_log_fn. */
+  enum athcon_log_stream
+  {
+    /** Written to the standard output of the program. */
+    ATHCON_LOG_STDOUT = 1,
+
+    /** Written to the standard error of the program. */
+    ATHCON_LOG_STDERR = 2,
+
+    /** The start of a cycle-tracked region. The data is the name of the region. */
+    ATHCON_LOG_CYCLE_TRACKER_START = 3,
+
+    /** The end of a cycle-tracked region. The data is the name of the region. */
+    ATHCON_LOG_CYCLE_TRACKER_END = 4
+  };
+
+  /**
+   * Log callback function.
+   *
+   * This callback function is used by a VM to deliver the log output of an execution, once it
+   * has finished, one record per write of the program. The VM keeps a bounded amount of the
+   * most recent output, so older records may be missing.
+   * This callback is optional: if it is NULL, the output is discarded.
+   *
+   * @param context  The Host execution context.
+   * @param stream   The kind of output.
+   * @param clk      The number of instructions executed before the write.
+   * @param data     The bytes written, valid only for the duration of the call.
+   * @param size     The number of bytes written.
+   */
+  typedef void (*athcon_log_fn)(struct athcon_host_context *context,
+                                enum athcon_log_stream stream,
+                                uint64_t clk,
+                                const uint8_t *data,
+                                size_t size);
+
   /**
    * Get balance callback function.
    *
@@ -544,6 +714,18 @@ extern "C"
 
     /** Get block hash callback function. */
     athcon_get_block_hash_fn get_block_hash;
+
+    /** Get storage for many keys callback function. Optional, may be NULL. */
+    athcon_get_storage_many_fn get_storage_many;
+
+    /** Set storage for many keys callback function. Optional, may be NULL. */
+    athcon_set_storage_many_fn set_storage_many;
+
+    /** Prefetch storage callback function. Optional, may be NULL. */
+    athcon_prefetch_storage_fn prefetch_storage;
+
+    /** Log callback function. Optional, may be NULL. */
+    athcon_log_fn log;
   };
 
   /* Forward declaration. */
@@ -632,6 +814,94 @@ extern "C"
                                                     uint8_t const *code,
                                                     size_t code_size);
 
+  /**
+   * Flags describing a batch of messages passed to athcon_vm::execute_batch.
+   */
+  enum athcon_batch_flags
+  {
+    /**
+     * The messages don't read state written by one another, and the methods of the Host
+     * interface MAY be called from several threads at once.
+     *
+     * The VM MAY then execute the messages concurrently. The results are still the same as if
+     * they were executed in order.
+     */
+    ATHCON_BATCH_INDEPENDENT = (1u << 0),
+  };
+
+  /**
+   * Alias for unsigned integer representing a set of bit flags of ATHCON batch flags.
+   *
+   * @see athcon_batch_flags
+   */
+  typedef uint32_t athcon_batch_flagset;
+
+  /**
+   * Executes a batch of messages, each with its own code.
+   *
+   * The result is the same as calling athcon_vm::execute for each message in order, with the same
+   * Host interface and context, but the VM only crosses the FFI boundary and sets up its
+   * execution environment once.
+   *
+   * @param vm          The VM instance. This argument MUST NOT be NULL.
+   * @param host        The Host interface, as in ::athcon_execute_fn.
+   * @param context     The opaque pointer to the Host execution context, as in ::athcon_execute_fn.
+   * @param rev         The requested Athena specification revision.
+   * @param msgs        The array of @p count messages. This argument MAY be NULL if @p count is 0.
+   * @param codes       The array of @p count pointers to the code of each message. Each of them
+   *                    MAY be NULL if the matching code size is 0.
+   * @param code_sizes  The array of @p count code lengths.
+   * @param count       The number of messages in the batch.
+   * @param flags       The flags describing the batch. See ::athcon_batch_flags.
+   * @param results     The array of @p count results, written by the VM. The Client MUST release
+   *                    each of them with athcon_result::release().
+   */
+  typedef void (*athcon_execute_batch_fn)(struct athcon_vm *vm,
+                                          const struct athcon_host_interface *host,
+                                          struct athcon_host_context *context,
+                                          enum athcon_revision rev,
+                                          const struct athcon_message *msgs,
+                                          uint8_t const *const *codes,
+                                          const size_t *code_sizes,
+                                          size_t count,
+                                          athcon_batch_flagset flags,
+                                          struct athcon_result *results);
+
+  /**
+   * A counter of an execution, see athcon_vm::get_execution_stats.
+   */
+  struct athcon_counter
+  {
+    /**
+     * The name of the counter, e.g. "instructions.add".
+     *
+     * A NULL-terminated string owned by the VM, valid until the VM instance is destroyed.
+     */
+    const char *name;
+
+    /** The value of the counter. */
+    uint64_t value;
+  };
+
+  /**
+   * Gets the counters of the last execution made by athcon_vm::execute on the calling thread,
+   * e.g. to export them as metrics. The executions of athcon_vm::execute_batch may not be
+   * reported.
+   *
+   * The counters which are collected and their names are up to the VM. The VM writes at most
+   * @p capacity of them and returns how many are available, so calling it with a capacity of 0
+   * returns the size of the array to pass. VMs which don't collect counters return 0.
+   *
+   * @param vm          The VM instance. This argument MUST NOT be NULL.
+   * @param counters    The array of @p capacity counters to write to. It MAY be NULL if
+   *                    @p capacity is 0.
+   * @param capacity    The number of counters in @p counters.
+   * @return            The number of counters of the execution.
+   */
+  typedef size_t (*athcon_get_execution_stats_fn)(struct athcon_vm *vm,
+                                                  struct athcon_counter *counters,
+                                                  size_t capacity);
+
   /**
    * Possible capabilities of a VM.
    */
@@ -724,6 +994,21 @@ extern "C"
      * If the VM does not support this feature the pointer can be NULL.
      */
     athcon_set_option_fn set_option;
+
+    /**
+     * Optional pointer to function executing a batch of messages.
+     *
+     * If the VM does not support this feature the pointer can be NULL, and the Client executes
+     * the messages one by one with execute().
+     */
+    athcon_execute_batch_fn execute_batch;
+
+    /**
+     * Optional pointer to function getting the counters of the last execution.
+     *
+     * If the VM does not support this feature the pointer can be NULL.
+     */
+    athcon_get_execution_stats_fn get_execution_stats;
   };
 
   /* END CFFI declarations */
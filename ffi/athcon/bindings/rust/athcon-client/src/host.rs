@@ -11,6 +11,24 @@
      fn account_exists(&self, addr: &Address) -> bool;
      fn get_storage(&self, addr: &Address, key: &Bytes32) -> Bytes32;
      fn set_storage(&mut self, addr: &Address, key: &Bytes32, value: &Bytes32) -> StorageStatus;
+     fn get_storage_many(&self, addr: &Address, keys: &[Bytes32]) -> Vec<Bytes32> {
+         keys.iter().map(|key| self.get_storage(addr, key)).collect()
+     }
+     fn set_storage_many(
+         &mut self,
+         addr: &Address,
+         keys: &[Bytes32],
+         values: &[Bytes32],
+     ) -> Vec<StorageStatus> {
+         keys.iter()
+             .zip(values)
+             .map(|(key, value)| self.set_storage(addr, key, value))
+             .collect()
+     }
+     /// Hints that the execution will read `slots`. Does nothing by default.
+     fn prefetch_storage(&mut self, _slots: &[StorageSlot]) {}
+     /// Receives a record of the log output of the execution. Discards it by default.
+     fn log(&mut self, _stream: LogStream, _clk: u64, _data: &[u8]) {}
      fn get_balance(&self, addr: &Address) -> Bytes32;
      fn get_tx_context(&self) -> (Bytes32, Address, i64, i64, i64, Bytes32);
      fn get_block_hash(&self, number: i64) -> Bytes32;
@@ -35,6 +53,10 @@
          call: Some(call),
          get_tx_context: Some(get_tx_context),
          get_block_hash: Some(get_block_hash),
+         get_storage_many: Some(get_storage_many),
+         set_storage_many: Some(set_storage_many),
+         prefetch_storage: Some(prefetch_storage),
+         log: Some(log),
      }
  }
 
@@ -72,6 +94,74 @@
      );
  }
 
+ unsafe extern "C" fn get_storage_many(
+     context: *mut ffi::athcon_host_context,
+     address: *const ffi::athcon_address,
+     keys: *const ffi::athcon_bytes32,
+     values: *mut ffi::athcon_bytes32,
+     count: usize,
+ ) {
+     // athcon_bytes32 is a transparent wrapper of the byte array.
+     let keys = std::slice::from_raw_parts(keys as *const Bytes32, count);
+     let result = (*(context as *mut ExtendedContext))
+         .hctx
+         .get_storage_many(&(*address).bytes, keys);
+     assert_eq!(result.len(), count);
+     for (i, value) in result.into_iter().enumerate() {
+         *values.add(i) = ffi::athcon_bytes32 { bytes: value };
+     }
+ }
+
+ unsafe extern "C" fn set_storage_many(
+     context: *mut ffi::athcon_host_context,
+     address: *const ffi::athcon_address,
+     keys: *const ffi::athcon_bytes32,
+     values: *const ffi::athcon_bytes32,
+     statuses: *mut ffi::athcon_storage_status,
+     count: usize,
+ ) {
+     // athcon_bytes32 is a transparent wrapper of the byte array.
+     let keys = std::slice::from_raw_parts(keys as *const Bytes32, count);
+     let values = std::slice::from_raw_parts(values as *const Bytes32, count);
+     let result = (*(context as *mut ExtendedContext))
+         .hctx
+         .set_storage_many(&(*address).bytes, keys, values);
+     assert_eq!(result.len(), count);
+     std::ptr::copy_nonoverlapping(result.as_ptr(), statuses, count);
+ }
+
+ unsafe extern "C" fn prefetch_storage(
+     context: *mut ffi::athcon_host_context,
+     slots: *const ffi::athcon_storage_slot,
+     count: usize,
+ ) {
+     let slots = if count == 0 {
+         &[]
+     } else {
+         std::slice::from_raw_parts(slots, count)
+     };
+     (*(context as *mut ExtendedContext))
+         .hctx
+         .prefetch_storage(slots);
+ }
+
+ unsafe extern "C" fn log(
+     context: *mut ffi::athcon_host_context,
+     stream: ffi::athcon_log_stream,
+     clk: u64,
+     data: *const u8,
+     size: usize,
+ ) {
+     let data = if size == 0 {
+         &[]
+     } else {
+         std::slice::from_raw_parts(data, size)
+     };
+     (*(context as *mut ExtendedContext))
+         .hctx
+         .log(stream, clk, data);
+ }
+
  unsafe extern "C" fn get_balance(
      context: *mut ffi::athcon_host_context,
      address: *const ffi::athcon_address,
@@ -146,5 +236,15 @@
          create_address: ffi::athcon_address {
              bytes: create_address,
          },
+         // The host doesn't measure the calls it makes.
+         stats: ffi::athcon_execution_stats {
+             size: 0,
+             cycles: 0,
+             syscalls: 0,
+             host_calls: 0,
+             hint_bytes: 0,
+             peak_memory: 0,
+         },
+         release_context: std::ptr::null_mut(),
      };
  }
@@ -68,6 +68,8 @@ impl AthconVm {
         value: ffi::athcon_uint256be { bytes: *value },
         code: code.as_ptr(),
         code_size: code.len(),
+        access_list: std::ptr::null(),
+        access_list_size: 0,
       }
     }));
     unsafe {
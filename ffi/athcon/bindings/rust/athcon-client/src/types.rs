@@ -1,4 +1,5 @@
- pub use athcon_vm::{MessageKind, Revision, StatusCode, StorageStatus};
+ pub use athcon_sys::athcon_storage_slot as StorageSlot;
+ pub use athcon_vm::{LogStream, MessageKind, Revision, StatusCode, StorageStatus};
 
  pub const ADDRESS_LENGTH: usize = 24;
  pub const BYTES32_LENGTH: usize = 32;
@@ -233,6 +233,8 @@ pub fn athcon_declare_vm(args: TokenStream, item: TokenStream) -> TokenStream {
   let create_tokens = build_create_fn(&names);
   let destroy_tokens = build_destroy_fn(&names);
   let execute_tokens = build_execute_fn(&names);
+  let execute_batch_tokens = build_execute_batch_fn(&names);
+  let get_execution_stats_tokens = build_get_execution_stats_fn(&names);
 
   let quoted = quote! {
       #input
@@ -242,6 +244,8 @@ pub fn athcon_declare_vm(args: TokenStream, item: TokenStream) -> TokenStream {
       #create_tokens
       #destroy_tokens
       #execute_tokens
+      #execute_batch_tokens
+      #get_execution_stats_tokens
   };
 
   quoted.into()
@@ -356,6 +360,8 @@ fn build_create_fn(names: &VMNameSet) -> proc_macro2::TokenStream {
               execute: Some(__athcon_execute),
               get_capabilities: Some(__athcon_get_capabilities),
               set_option: Some(__athcon_set_option),
+              execute_batch: Some(__athcon_execute_batch),
+              get_execution_stats: Some(__athcon_get_execution_stats),
               name: unsafe { ::std::ffi::CStr::from_bytes_with_nul_unchecked(#static_name_ident.as_bytes()).as_ptr() },
               version: unsafe { ::std::ffi::CStr::from_bytes_with_nul_unchecked(#static_version_ident.as_bytes()).as_ptr() },
           };
@@ -453,3 +459,128 @@ fn build_execute_fn(names: &VMNameSet) -> proc_macro2::TokenStream {
       }
   }
 }
+
+/// Builds the entry point executing a batch of messages.
+fn build_execute_batch_fn(names: &VMNameSet) -> proc_macro2::TokenStream {
+  let type_name_ident = names.get_type_as_ident();
+
+  quote! {
+      extern "C" fn __athcon_execute_batch(
+          instance: *mut ::athcon_vm::ffi::athcon_vm,
+          host: *const ::athcon_vm::ffi::athcon_host_interface,
+          context: *mut ::athcon_vm::ffi::athcon_host_context,
+          revision: ::athcon_vm::ffi::athcon_revision,
+          msgs: *const ::athcon_vm::ffi::athcon_message,
+          codes: *const *const u8,
+          code_sizes: *const usize,
+          count: usize,
+          flags: ::athcon_vm::ffi::athcon_batch_flagset,
+          results: *mut ::athcon_vm::ffi::athcon_result
+      )
+      {
+          use athcon_vm::AthconVm;
+
+          if instance.is_null()
+              || (count != 0 && (msgs.is_null() || codes.is_null() || code_sizes.is_null() || results.is_null()))
+          {
+              // These are irrecoverable errors that violate the athcon spec.
+              std::process::abort();
+          }
+          if count == 0 {
+              return;
+          }
+
+          let (msgs, codes, code_sizes) = unsafe {
+              (
+                  ::std::slice::from_raw_parts(msgs, count),
+                  ::std::slice::from_raw_parts(codes, count),
+                  ::std::slice::from_raw_parts(code_sizes, count),
+              )
+          };
+          let execution_messages: Vec<::athcon_vm::ExecutionMessage> =
+              msgs.iter().map(Into::into).collect();
+          let code_refs: Vec<&[u8]> = codes
+              .iter()
+              .zip(code_sizes)
+              .map(|(code, code_size)| {
+                  if code.is_null() {
+                      assert_eq!(*code_size, 0);
+                      &[][..]
+                  } else {
+                      unsafe { ::std::slice::from_raw_parts(*code, *code_size) }
+                  }
+              })
+              .collect();
+
+          let container = unsafe {
+              // Acquire ownership from athcon.
+              ::athcon_vm::AthconContainer::<#type_name_ident>::from_ffi_pointer(instance)
+          };
+
+          let batch = ::std::panic::catch_unwind(|| {
+              container.execute_batch(revision, &code_refs, &execution_messages, flags, host, context)
+          });
+
+          unsafe {
+              // Release ownership to athcon.
+              ::athcon_vm::AthconContainer::into_ffi_pointer(container);
+          }
+
+          let batch = match batch {
+              Ok(batch) if batch.len() == count => batch,
+              // Consider a panic an internal error of every message.
+              _ => (0..count)
+                  .map(|_| ::athcon_vm::ExecutionResult::new(::athcon_vm::ffi::athcon_status_code::ATHCON_INTERNAL_ERROR, 0, None))
+                  .collect(),
+          };
+          for (idx, result) in batch.into_iter().enumerate() {
+              unsafe { results.add(idx).write(result.into()) };
+          }
+      }
+  }
+}
+
+/// Builds the entry point getting the counters of the last execution.
+fn build_get_execution_stats_fn(names: &VMNameSet) -> proc_macro2::TokenStream {
+  let type_name_ident = names.get_type_as_ident();
+
+  quote! {
+      extern "C" fn __athcon_get_execution_stats(
+          instance: *mut ::athcon_vm::ffi::athcon_vm,
+          counters: *mut ::athcon_vm::ffi::athcon_counter,
+          capacity: usize
+      ) -> usize
+      {
+          use athcon_vm::AthconVm;
+
+          if instance.is_null() || (capacity != 0 && counters.is_null()) {
+              // These are irrecoverable errors that violate the athcon spec.
+              std::process::abort();
+          }
+
+          let container = unsafe {
+              // Acquire ownership from athcon.
+              ::athcon_vm::AthconContainer::<#type_name_ident>::from_ffi_pointer(instance)
+          };
+
+          let stats = ::std::panic::catch_unwind(|| container.execution_stats());
+
+          unsafe {
+              // Release ownership to athcon.
+              ::athcon_vm::AthconContainer::into_ffi_pointer(container);
+          }
+
+          // Report no counters rather than unwinding into the caller.
+          let stats = stats.unwrap_or_default();
+          for (idx, (name, value)) in stats.iter().take(capacity).enumerate() {
+              unsafe {
+                  counters.add(idx).write(::athcon_vm::ffi::athcon_counter {
+                      name: name.as_ptr(),
+                      value: *value,
+                  })
+              };
+          }
+          stats.len()
+      }
+  }
+}
@@ -33,6 +33,6 @@ mod tests {
     fn container_new() {
         assert_eq!(size_of::<athcon_bytes32>(), 32);
         assert_eq!(size_of::<athcon_address>(), 24);
-        assert!(size_of::<athcon_vm>() <= 64);
+        assert!(size_of::<athcon_vm>() <= 72);
     }
 }
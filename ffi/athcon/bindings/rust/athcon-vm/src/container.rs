@@ -3,6 +3,10 @@ use crate::AthconVm;
 use std::ops::{Deref, DerefMut};
 
 /// Container struct for ATHCON instances and user-defined data.
+///
+/// The FFI `athcon_vm` pointer is cast to and from this struct, so the instance must stay the
+/// first field.
+#[repr(C)]
 pub struct AthconContainer<T>
 where
   T: AthconVm + Sized,
@@ -109,6 +113,8 @@ mod tests {
       execute: None,
       get_capabilities: None,
       set_option: None,
+      execute_batch: None,
+      get_execution_stats: None,
     };
 
     let code = [0u8; 0];
@@ -124,6 +130,8 @@ mod tests {
       value: ::athcon_sys::athcon_uint256be::default(),
       code: std::ptr::null(),
       code_size: 0,
+      access_list: std::ptr::null(),
+      access_list_size: 0,
     };
     let message: ExecutionMessage = (&message).into();
 
@@ -135,6 +143,10 @@ mod tests {
       call: None,
       get_tx_context: Some(get_dummy_tx_context),
       get_block_hash: None,
+      get_storage_many: None,
+      set_storage_many: None,
+      prefetch_storage: None,
+      log: None,
     };
     let host_context = std::ptr::null_mut();
 
@@ -3,6 +3,8 @@
 mod container;
 mod types;
 
+use std::ffi::CStr;
+
 pub use athcon_sys as ffi;
 pub use container::AthconContainer;
 pub use types::*;
@@ -22,10 +24,35 @@ pub trait AthconVm {
     &self,
     revision: Revision,
     code: &'a [u8],
-    message: &'a ExecutionMessage,
+    message: &'a ExecutionMessage<'a>,
     host: *const ffi::athcon_host_interface,
     context: *mut ffi::athcon_host_context,
   ) -> ExecutionResult;
+
+  /// This is called for a batch of messages, each with the code at the same index. See
+  /// `athcon_batch_flags` for the meaning of `flags`. By default the messages are executed one
+  /// after the other.
+  fn execute_batch<'a>(
+    &self,
+    revision: Revision,
+    codes: &[&'a [u8]],
+    messages: &'a [ExecutionMessage<'a>],
+    _flags: ffi::athcon_batch_flagset,
+    host: *const ffi::athcon_host_interface,
+    context: *mut ffi::athcon_host_context,
+  ) -> Vec<ExecutionResult> {
+    codes
+      .iter()
+      .zip(messages)
+      .map(|(code, message)| self.execute(revision, code, message, host, context))
+      .collect()
+  }
+
+  /// This is called to get the counters of the last execution on the calling thread, as name
+  /// and value pairs. By default no counters are collected.
+  fn execution_stats(&self) -> Vec<(&'static CStr, u64)> {
+    Vec::new()
+  }
 }
 
 /// Error codes for set_option.
@@ -42,19 +69,24 @@ pub struct ExecutionResult {
   gas_left: i64,
   output: Option<Vec<u8>>,
   create_address: Option<Address>,
+  stats: Option<ExecutionStats>,
 }
 
 /// ATHCON execution message structure.
+///
+/// The input and code are borrowed, e.g. from the `athcon_message` passed across FFI, which
+/// remains valid for the duration of the execution.
 #[derive(Debug)]
-pub struct ExecutionMessage {
+pub struct ExecutionMessage<'a> {
   kind: MessageKind,
   depth: i32,
   gas: i64,
   recipient: Address,
   sender: Address,
-  input: Option<Vec<u8>>,
+  input: Option<&'a [u8]>,
   value: Uint256,
-  code: Option<Vec<u8>>,
+  code: Option<&'a [u8]>,
+  access_list: &'a [ffi::athcon_storage_slot],
 }
 
 /// ATHCON transaction context structure.
@@ -76,9 +108,38 @@ impl ExecutionResult {
       gas_left: _gas_left,
       output: _output.map(|s| s.to_vec()),
       create_address: None,
+      stats: None,
     }
   }
 
+  /// Create a result taking ownership of the output, which is then handed over to FFI without
+  /// copying.
+  pub fn with_owned_output(
+    status_code: StatusCode,
+    gas_left: i64,
+    output: Option<Vec<u8>>,
+  ) -> Self {
+    ExecutionResult {
+      status_code,
+      gas_left,
+      output,
+      create_address: None,
+      stats: None,
+    }
+  }
+
+  /// Attach the address of the created account.
+  pub fn with_create_address(mut self, address: Address) -> Self {
+    self.create_address = Some(address);
+    self
+  }
+
+  /// Attach the measured cost of the execution. Its size is set by the conversion to FFI.
+  pub fn with_stats(mut self, stats: ExecutionStats) -> Self {
+    self.stats = Some(stats);
+    self
+  }
+
   /// Create failure result.
   pub fn failure() -> Self {
     ExecutionResult::new(StatusCode::ATHCON_FAILURE, 0, None)
@@ -114,18 +175,75 @@ impl ExecutionResult {
   pub fn create_address(&self) -> Option<&Address> {
     self.create_address.as_ref()
   }
+
+  /// Read the measured cost of the execution, if the VM reported it.
+  pub fn stats(&self) -> Option<&ExecutionStats> {
+    self.stats.as_ref()
+  }
+}
+
+/// The statistics of a result which doesn't report any.
+const NO_STATS: ExecutionStats = ExecutionStats {
+  size: 0,
+  cycles: 0,
+  syscalls: 0,
+  host_calls: 0,
+  hint_bytes: 0,
+  peak_memory: 0,
+};
+
+/// Reads the statistics reported by a VM, zeroing the fields it didn't fill in.
+fn stats_from_ffi(stats: &ExecutionStats) -> Option<ExecutionStats> {
+  if stats.size == 0 {
+    return None;
+  }
+  let filled = |end: usize| end <= stats.size as usize;
+  let field = |offset: usize, value: u64| {
+    if filled(offset + std::mem::size_of::<u64>()) {
+      value
+    } else {
+      0
+    }
+  };
+  Some(ExecutionStats {
+    size: stats.size,
+    cycles: field(std::mem::offset_of!(ExecutionStats, cycles), stats.cycles),
+    syscalls: field(
+      std::mem::offset_of!(ExecutionStats, syscalls),
+      stats.syscalls,
+    ),
+    host_calls: field(
+      std::mem::offset_of!(ExecutionStats, host_calls),
+      stats.host_calls,
+    ),
+    hint_bytes: field(
+      std::mem::offset_of!(ExecutionStats, hint_bytes),
+      stats.hint_bytes,
+    ),
+    peak_memory: field(
+      std::mem::offset_of!(ExecutionStats, peak_memory),
+      stats.peak_memory,
+    ),
+  })
+}
+
+fn stats_to_ffi(stats: Option<ExecutionStats>) -> ExecutionStats {
+  stats.map_or(NO_STATS, |stats| ExecutionStats {
+    size: std::mem::size_of::<ExecutionStats>() as u32,
+    ..stats
+  })
 }
 
-impl ExecutionMessage {
+impl<'a> ExecutionMessage<'a> {
   pub fn new(
     kind: MessageKind,
     depth: i32,
     gas: i64,
     recipient: Address,
     sender: Address,
-    input: Option<&[u8]>,
+    input: Option<&'a [u8]>,
     value: Uint256,
-    code: Option<&[u8]>,
+    code: Option<&'a [u8]>,
   ) -> Self {
     ExecutionMessage {
       kind,
@@ -133,9 +251,18 @@ impl ExecutionMessage {
       gas,
       recipient,
       sender,
-      input: input.map(|s| s.to_vec()),
+      input,
       value,
-      code: code.map(|s| s.to_vec()),
+      code,
+      access_list: &[],
+    }
+  }
+
+  /// Declare the storage slots the execution is expected to access.
+  pub fn with_access_list(self, access_list: &'a [ffi::athcon_storage_slot]) -> Self {
+    Self {
+      access_list,
+      ..self
     }
   }
 
@@ -165,8 +292,8 @@ impl ExecutionMessage {
   }
 
   /// Read the optional input message.
-  pub fn input(&self) -> Option<&Vec<u8>> {
-    self.input.as_ref()
+  pub fn input(&self) -> Option<&'a [u8]> {
+    self.input
   }
 
   /// Read the value of the message.
@@ -175,8 +302,13 @@ impl ExecutionMessage {
   }
 
   /// Read the optional init code.
-  pub fn code(&self) -> Option<&Vec<u8>> {
-    self.code.as_ref()
+  pub fn code(&self) -> Option<&'a [u8]> {
+    self.code
+  }
+
+  /// Read the declared storage access list.
+  pub fn access_list(&self) -> &'a [ffi::athcon_storage_slot] {
+    self.access_list
   }
 }
 
@@ -240,6 +372,75 @@ impl<'a> ExecutionContext<'a> {
     }
   }
 
+  /// Read from many storage keys, in a single call to the host if it supports it.
+  pub fn get_storage_many(&self, address: &Address, keys: &[Bytes32]) -> Vec<Bytes32> {
+    match self.host.get_storage_many {
+      Some(get_storage_many) => {
+        let mut values = vec![Bytes32::default(); keys.len()];
+        unsafe {
+          get_storage_many(
+            self.context,
+            address as *const Address,
+            keys.as_ptr(),
+            values.as_mut_ptr(),
+            keys.len(),
+          )
+        };
+        values
+      }
+      None => keys
+        .iter()
+        .map(|key| self.get_storage(address, key))
+        .collect(),
+    }
+  }
+
+  /// Set values of many storage keys, in a single call to the host if it supports it.
+  pub fn set_storage_many(
+    &mut self,
+    address: &Address,
+    keys: &[Bytes32],
+    values: &[Bytes32],
+  ) -> Vec<StorageStatus> {
+    assert_eq!(keys.len(), values.len());
+    match self.host.set_storage_many {
+      Some(set_storage_many) => {
+        let mut statuses = vec![StorageStatus::ATHCON_STORAGE_ASSIGNED; keys.len()];
+        unsafe {
+          set_storage_many(
+            self.context,
+            address as *const Address,
+            keys.as_ptr(),
+            values.as_ptr(),
+            statuses.as_mut_ptr(),
+            keys.len(),
+          )
+        };
+        statuses
+      }
+      None => keys
+        .iter()
+        .zip(values)
+        .map(|(key, value)| self.set_storage(address, key, value))
+        .collect(),
+    }
+  }
+
+  /// Hint the host to load storage slots ahead of their reads. Does nothing if the host doesn't
+  /// support prefetching.
+  pub fn prefetch_storage(&self, slots: &[ffi::athcon_storage_slot]) {
+    if let Some(prefetch_storage) = self.host.prefetch_storage {
+      unsafe { prefetch_storage(self.context, slots.as_ptr(), slots.len()) }
+    }
+  }
+
+  /// Deliver a record of log output to the host. Does nothing if the host doesn't take logs.
+  pub fn log(&self, stream: LogStream, clk: u64, data: &[u8]) {
+    if let Some(log) = self.host.log {
+      unsafe { log(self.context, stream, clk, data.as_ptr(), data.len()) }
+    }
+  }
+
   /// Get balance of an account.
   pub fn get_balance(&self, address: &Address) -> Uint256 {
     unsafe {
@@ -283,6 +484,8 @@ impl<'a> ExecutionContext<'a> {
       value: *message.value(),
       code: code_data,
       code_size,
+      access_list: message.access_list().as_ptr(),
+      access_list_size: message.access_list().len(),
     };
     unsafe {
       assert!((*self.host).call.is_some());
@@ -314,6 +517,7 @@ impl From<ffi::athcon_result> for ExecutionResult {
       },
       // Consider it is always valid.
       create_address: Some(result.create_address),
+      stats: stats_from_ffi(&result.stats),
     };
 
     // Release allocated ffi struct.
@@ -327,30 +531,28 @@ impl From<ffi::athcon_result> for ExecutionResult {
   }
 }
 
-fn allocate_output_data(output: Option<&Vec<u8>>) -> (*const u8, usize) {
-  if let Some(buf) = output {
-    let buf_len = buf.len();
-
-    // Manually allocate heap memory for the new home of the output buffer.
-    let memlayout = std::alloc::Layout::from_size_align(buf_len, 1).expect("Bad layout");
-    let new_buf = unsafe { std::alloc::alloc(memlayout) };
-    unsafe {
-      // Copy the data into the allocated buffer.
-      std::ptr::copy(buf.as_ptr(), new_buf, buf_len);
+/// Hands the output over to FFI without copying it: the vector is kept in
+/// `athcon_result::release_context` until the result is released.
+fn output_into_ffi(output: Option<Vec<u8>>) -> (*const u8, usize, *mut std::ffi::c_void) {
+  match output {
+    Some(output) => {
+      let output = Box::new(output);
+      let (data, size) = (output.as_ptr(), output.len());
+      (data, size, Box::into_raw(output) as *mut std::ffi::c_void)
     }
-
-    (new_buf as *const u8, buf_len)
-  } else {
-    (core::ptr::NonNull::<u8>::dangling().as_ptr(), 0)
+    // A slice can still be reconstructed from the empty output, see std::slice::from_raw_parts.
+    None => (
+      core::ptr::NonNull::<u8>::dangling().as_ptr(),
+      0,
+      std::ptr::null_mut(),
+    ),
   }
 }
 
-unsafe fn deallocate_output_data(ptr: *const u8, size: usize) {
-  // be careful with dangling, aligned pointers here; they are not null but
-  // not valid and cannot be deallocated!
-  if !ptr.is_null() && size > 0 {
-    let buf_layout = std::alloc::Layout::from_size_align(size, 1).expect("Bad layout");
-    std::alloc::dealloc(ptr as *mut u8, buf_layout);
+/// Frees the output handed over by [output_into_ffi].
+unsafe fn release_output(release_context: *mut std::ffi::c_void) {
+  if !release_context.is_null() {
+    drop(Box::from_raw(release_context as *mut Vec<u8>));
   }
 }
 
@@ -363,43 +565,45 @@ impl From<ExecutionResult> for *const ffi::athcon_result {
   }
 }
 
-/// Callback to pass across FFI, de-allocating the optional output_data.
+/// Callback to pass across FFI, de-allocating the result and its optional output.
 extern "C" fn release_heap_result(result: *const ffi::athcon_result) {
   unsafe {
     let tmp = Box::from_raw(result as *mut ffi::athcon_result);
-    deallocate_output_data(tmp.output_data, tmp.output_size);
+    release_output(tmp.release_context);
   }
 }
 
 /// Returns a pointer to a stack-allocated athcon_result.
 impl From<ExecutionResult> for ffi::athcon_result {
   fn from(value: ExecutionResult) -> Self {
-    let (buffer, len) = allocate_output_data(value.output.as_ref());
+    let (output_data, output_size, release_context) = output_into_ffi(value.output);
     Self {
       status_code: value.status_code,
       gas_left: value.gas_left,
-      output_data: buffer,
-      output_size: len,
+      output_data,
+      output_size,
       release: Some(release_stack_result),
       create_address: if value.create_address.is_some() {
         value.create_address.unwrap()
       } else {
         Address { bytes: [0u8; 24] }
       },
+      stats: stats_to_ffi(value.stats),
+      release_context,
     }
   }
 }
 
-/// Callback to pass across FFI, de-allocating the optional output_data.
+/// Callback to pass across FFI, de-allocating the optional output.
 extern "C" fn release_stack_result(result: *const ffi::athcon_result) {
   unsafe {
-    let tmp = *result;
-    deallocate_output_data(tmp.output_data, tmp.output_size);
+    release_output((*result).release_context);
   }
 }
 
-impl From<&ffi::athcon_message> for ExecutionMessage {
-  fn from(message: &ffi::athcon_message) -> Self {
+impl<'a> From<&'a ffi::athcon_message> for ExecutionMessage<'a> {
+  /// Borrows the input and code of `message`, which must remain valid for `'a`.
+  fn from(message: &'a ffi::athcon_message) -> Self {
     ExecutionMessage {
       kind: message.kind,
       depth: message.depth,
@@ -412,7 +616,7 @@ impl From<&ffi::athcon_message> for ExecutionMessage {
       } else if message.input_size == 0 {
         None
       } else {
-        Some(from_buf_raw::<u8>(message.input_data, message.input_size))
+        Some(unsafe { std::slice::from_raw_parts(message.input_data, message.input_size) })
       },
       value: message.value,
       code: if message.code.is_null() {
@@ -421,7 +625,12 @@ impl From<&ffi::athcon_message> for ExecutionMessage {
       } else if message.code_size == 0 {
         None
       } else {
-        Some(from_buf_raw::<u8>(message.code, message.code_size))
+        Some(unsafe { std::slice::from_raw_parts(message.code, message.code_size) })
+      },
+      access_list: if message.access_list.is_null() || message.access_list_size == 0 {
+        &[]
+      } else {
+        unsafe { std::slice::from_raw_parts(message.access_list, message.access_list_size) }
       },
     }
   }
@@ -476,6 +685,8 @@ mod tests {
       output_size: 4,
       release: Some(test_result_dispose),
       create_address: Address { bytes: [0u8; 24] },
+      stats: NO_STATS,
+      release_context: std::ptr::null_mut(),
     };
 
     let r: ExecutionResult = f.into();
@@ -485,6 +696,35 @@ mod tests {
     assert!(r.output().is_some());
     assert_eq!(r.output().unwrap().len(), 4);
     assert!(r.create_address().is_some());
+    assert!(r.stats().is_none());
+  }
+
+  #[test]
+  fn result_stats() {
+    let stats = ExecutionStats {
+      size: 0,
+      cycles: 1000,
+      syscalls: 10,
+      host_calls: 3,
+      hint_bytes: 64,
+      peak_memory: 4096,
+    };
+    let r = ExecutionResult::success(5, None).with_stats(stats);
+    let mut f: ffi::athcon_result = r.into();
+    assert_eq!(f.stats.size as usize, std::mem::size_of::<ExecutionStats>());
+    let stats = ExecutionStats {
+      size: f.stats.size,
+      ..stats
+    };
+    assert_eq!(stats_from_ffi(&f.stats), Some(stats));
+
+    // Fields past the size reported by the VM are ignored.
+    f.stats.size = std::mem::offset_of!(ExecutionStats, hint_bytes) as u32;
+    let r: ExecutionResult = f.into();
+    let read = r.stats().unwrap();
+    assert_eq!(read.host_calls, 3);
+    assert_eq!(read.hint_bytes, 0);
+    assert_eq!(read.peak_memory, 0);
   }
 
   #[test]
@@ -559,6 +799,23 @@ mod tests {
     }
   }
 
+  #[test]
+  fn result_into_ffi_moves_owned_output() {
+    let output = vec![0xc0, 0xff, 0xee];
+    let data = output.as_ptr();
+    let r = ExecutionResult::with_owned_output(StatusCode::ATHCON_SUCCESS, 7, Some(output))
+      .with_create_address(Address { bytes: [1u8; 24] });
+
+    let f: ffi::athcon_result = r.into();
+    assert_eq!(f.output_data, data);
+    assert_eq!(f.output_size, 3);
+    assert!(!f.release_context.is_null());
+    assert_eq!(f.create_address.bytes, [1u8; 24]);
+    unsafe {
+      f.release.unwrap()(&f);
+    }
+  }
+
   #[test]
   fn result_into_stack_ffi_empty_data() {
     let r = ExecutionResult::new(StatusCode::ATHCON_FAILURE, 420, None);
@@ -649,6 +906,8 @@ mod tests {
       value,
       code: std::ptr::null(),
       code_size: 0,
+      access_list: std::ptr::null(),
+      access_list_size: 0,
     };
 
     let ret: ExecutionMessage = (&msg).into();
@@ -681,6 +940,8 @@ mod tests {
       value,
       code: std::ptr::null(),
       code_size: 0,
+      access_list: std::ptr::null(),
+      access_list_size: 0,
     };
 
     let ret: ExecutionMessage = (&msg).into();
@@ -714,6 +975,8 @@ mod tests {
       value,
       code: code.as_ptr(),
       code_size: code.len(),
+      access_list: std::ptr::null(),
+      access_list_size: 0,
     };
 
     let ret: ExecutionMessage = (&msg).into();
@@ -773,6 +1036,30 @@ mod tests {
       output_size: msg.input_size,
       release: None,
       create_address: Address::default(),
+      stats: NO_STATS,
+      release_context: std::ptr::null_mut(),
+    }
+  }
+
+  unsafe extern "C" fn get_dummy_storage(
+    _context: *mut ffi::athcon_host_context,
+    _address: *const Address,
+    key: *const Bytes32,
+  ) -> Bytes32 {
+    let mut value = *key;
+    value.bytes.reverse();
+    value
+  }
+
+  unsafe extern "C" fn get_dummy_storage_many(
+    context: *mut ffi::athcon_host_context,
+    address: *const Address,
+    keys: *const Bytes32,
+    values: *mut Bytes32,
+    count: usize,
+  ) {
+    for i in 0..count {
+      *values.add(i) = get_dummy_storage(context, address, keys.add(i));
     }
   }
 
@@ -786,6 +1073,10 @@ mod tests {
       call: Some(execute_call),
       get_tx_context: Some(get_dummy_tx_context),
       get_block_hash: None,
+      get_storage_many: None,
+      set_storage_many: None,
+      prefetch_storage: None,
+      log: None,
     }
   }
 
@@ -861,4 +1152,63 @@ mod tests {
     assert!(b.create_address().is_some());
     assert_eq!(b.create_address().unwrap(), &Address::default());
   }
+
+  #[test]
+  fn message_access_list() {
+    let slots = [ffi::athcon_storage_slot {
+      address: Address { bytes: [1u8; 24] },
+      key: Bytes32 { bytes: [2u8; 32] },
+    }];
+    let message = ExecutionMessage::new(
+      MessageKind::ATHCON_CALL,
+      0,
+      6566,
+      Address::default(),
+      Address::default(),
+      None,
+      Uint256::default(),
+      None,
+    )
+    .with_access_list(&slots);
+    assert_eq!(message.access_list(), &slots);
+
+    let msg = ffi::athcon_message {
+      kind: MessageKind::ATHCON_CALL,
+      depth: 0,
+      gas: 6566,
+      recipient: Address::default(),
+      sender: Address::default(),
+      input_data: std::ptr::null(),
+      input_size: 0,
+      value: Uint256::default(),
+      code: std::ptr::null(),
+      code_size: 0,
+      access_list: slots.as_ptr(),
+      access_list_size: slots.len(),
+    };
+    let ret: ExecutionMessage = (&msg).into();
+    assert_eq!(ret.access_list(), &slots);
+  }
+
+  #[test]
+  fn test_get_storage_many() {
+    let address = Address::default();
+    let mut keys: Vec<Bytes32> = (0..3u8).map(|i| Bytes32 { bytes: [i; 32] }).collect();
+    keys[1].bytes[0] = 0xff;
+    let expected: Vec<Bytes32> = keys
+      .iter()
+      .map(|key| unsafe { get_dummy_storage(std::ptr::null_mut(), &address, key) })
+      .collect();
+
+    // Without the batch callback, the host is called once per key.
+    let mut host = get_dummy_host_interface();
+    host.get_storage = Some(get_dummy_storage);
+    let exe_context = ExecutionContext::new(&host, std::ptr::null_mut());
+    assert_eq!(exe_context.get_storage_many(&address, &keys), expected);
+
+    host.get_storage = None;
+    host.get_storage_many = Some(get_dummy_storage_many);
+    let exe_context = ExecutionContext::new(&host, std::ptr::null_mut());
+    assert_eq!(exe_context.get_storage_many(&address, &keys), expected);
+  }
 }
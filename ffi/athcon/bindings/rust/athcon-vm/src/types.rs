@@ -18,6 +18,12 @@ pub type StatusCode = ffi::athcon_status_code;
 /// ATHCON storage status.
 pub type StorageStatus = ffi::athcon_storage_status;
 
+/// ATHCON log stream.
+pub type LogStream = ffi::athcon_log_stream;
+
+/// ATHCON execution statistics.
+pub type ExecutionStats = ffi::athcon_execution_stats;
+
 /// ATHCON VM revision.
 pub type Revision = ffi::athcon_revision;
 
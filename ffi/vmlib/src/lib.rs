@@ -1,4 +1,4 @@
-use std::{cell::RefCell, panic, sync::Arc};
+use std::{borrow::Cow, cell::RefCell, panic, sync::Arc};
 
 use athcon_declare::athcon_declare_vm;
 use athcon_sys as ffi;
@@ -8,10 +8,14 @@ use athcon_vm::{
   SetOptionError,
 };
 use athena_interface::{
-  Address, AthenaMessage, Balance, Bytes32, ExecutionResult, HostInterface, HostProvider,
-  MessageKind, StatusCode, StorageStatus, TransactionContext,
+  Address, AthenaMessage, Balance, Bytes32, ExecutionMetrics, ExecutionResult, HostInterface,
+  HostProvider, LogRecord, LogStream, MessageKind, StatusCode, StorageSlot, StorageStatus,
+  TransactionContext,
+};
+use athena_runner::host::{AthenaOption, SetOptionError as RunnerSetOptionError};
+use athena_runner::{
+  AthenaVm, BlockState, Bytes32AsU64, ParallelExecutor, Transaction, VmInterface,
 };
-use athena_runner::{AthenaVm, Bytes32AsU64, VmInterface};
 
 #[athcon_declare_vm("Athena", "athena1", "0.1.0")]
 pub struct AthenaVMWrapper {
@@ -26,9 +30,14 @@ impl AthconVm for AthenaVMWrapper {
     }
   }
 
-  fn set_option(&mut self, _key: &str, _value: &str) -> Result<(), SetOptionError> {
-    // we don't currently support any options
-    Err(SetOptionError::InvalidKey)
+  fn set_option(&mut self, key: &str, value: &str) -> Result<(), SetOptionError> {
+    let option: AthenaOption = key.parse().map_err(|_| SetOptionError::InvalidKey)?;
+    VmInterface::<WrappedHostInterface>::set_option(&self.athena_vm, option, value).map_err(|err| {
+      match err {
+        RunnerSetOptionError::InvalidKey => SetOptionError::InvalidKey,
+        RunnerSetOptionError::InvalidValue => SetOptionError::InvalidValue,
+      }
+    })
   }
 
   /// `execute` is the main entrypoint from FFI. It's called from the macro-generated `__athcon_execute` fn.
@@ -63,6 +72,142 @@ impl AthconVm for AthenaVMWrapper {
     let execution_result = self.athena_vm.execute(host, rev as u32, athena_msg.0, code);
     ExecutionResultWrapper(execution_result).into()
   }
+
+  /// Executes a batch of messages, setting up the host only once. Independent messages are
+  /// executed in parallel, and their storage writes and log output handed to the host in order
+  /// afterwards, up to the first one calling another account or reading a balance. That one and
+  /// the rest are executed serially.
+  fn execute_batch<'a>(
+    &self,
+    rev: Revision,
+    codes: &[&'a [u8]],
+    messages: &'a [AthconExecutionMessage<'a>],
+    flags: ffi::athcon_batch_flagset,
+    host: *const ffi::athcon_host_interface,
+    context: *mut ffi::athcon_host_context,
+  ) -> Vec<AthconExecutionResult> {
+    if host.is_null() {
+      return messages
+        .iter()
+        .map(|_| AthconExecutionResult::failure())
+        .collect();
+    }
+    // Messages which can't be executed fail, as in `execute`.
+    let txs: Vec<Option<Transaction>> = codes
+      .iter()
+      .zip(messages)
+      .map(|(code, message)| {
+        (message.kind() == AthconMessageKind::ATHCON_CALL && !code.is_empty()).then(|| {
+          Transaction {
+            msg: AthenaMessageWrapper::from(message).0,
+            code,
+          }
+        })
+      })
+      .collect();
+
+    let host_interface: &ffi::athcon_host_interface = unsafe { &*host };
+    let execution_context = AthconExecutionContext::new(host_interface, context);
+    let host = WrappedHostInterface::new(execution_context);
+
+    let mut results: Vec<Option<ExecutionResult>> = txs.iter().map(|_| None).collect();
+    // The index of the first message to execute serially.
+    let mut serial_from = 0;
+    let mut host = host;
+    if flags & ffi::athcon_batch_flags::ATHCON_BATCH_INDEPENDENT as u32 != 0 {
+      let state = SharedHost(host);
+      let (indices, parallel): (Vec<usize>, Vec<Transaction>) = txs
+        .iter()
+        .enumerate()
+        .filter_map(|(idx, tx)| tx.clone().map(|tx| (idx, tx)))
+        .unzip();
+      let outputs =
+        ParallelExecutor::new(&self.athena_vm).execute_block(&state, rev as u32, &parallel);
+      host = state.0;
+      serial_from = indices.get(outputs.len()).copied().unwrap_or(txs.len());
+      for (idx, output) in indices.into_iter().zip(outputs) {
+        for writes in output.writes.chunk_by(|a, b| a.0 == b.0) {
+          let keys: Vec<Bytes32> = writes.iter().map(|(_, key, _)| *key).collect();
+          let values: Vec<Bytes32> = writes.iter().map(|(_, _, value)| *value).collect();
+          host.set_storage_many(&writes[0].0, &keys, &values);
+        }
+        for log in &output.logs {
+          host.log(&log.record());
+        }
+        results[idx] = Some(output.result);
+      }
+    }
+    if serial_from < txs.len() {
+      let host = Arc::new(RefCell::new(HostProvider::new(host)));
+      for (result, tx) in results.iter_mut().zip(txs).skip(serial_from) {
+        *result = tx.map(|tx| {
+          self
+            .athena_vm
+            .execute(host.clone(), rev as u32, tx.msg, tx.code)
+        });
+      }
+    }
+    results
+      .into_iter()
+      .map(|result| match result {
+        Some(result) => ExecutionResultWrapper(result).into(),
+        None => AthconExecutionResult::failure(),
+      })
+      .collect()
+  }
+
+  #[cfg(feature = "stats")]
+  fn execution_stats(&self) -> Vec<(&'static std::ffi::CStr, u64)> {
+    let Some(stats) = AthenaVm::last_execution_stats() else {
+      return Vec::new();
+    };
+    stats
+      .counters()
+      .into_iter()
+      .map(|(name, value)| (counter_name(name), value))
+      .collect()
+  }
+}
+
+/// Returns a C string of `name` living until the process exits. There are few distinct counter
+/// names, so each is allocated once.
+#[cfg(feature = "stats")]
+fn counter_name(name: String) -> &'static std::ffi::CStr {
+  use std::collections::HashMap;
+  use std::ffi::CString;
+  use std::sync::{Mutex, OnceLock};
+
+  static NAMES: OnceLock<Mutex<HashMap<String, &'static std::ffi::CStr>>> = OnceLock::new();
+  let mut names = NAMES.get_or_init(Default::default).lock().unwrap();
+  names
+    .entry(name)
+    .or_insert_with_key(|name| Box::leak(CString::new(name.as_str()).unwrap().into_boxed_c_str()))
+}
+
+/// The host of a batch of independent messages, shared by the threads executing them.
+struct SharedHost<'a>(WrappedHostInterface<'a>);
+
+// SAFETY: by declaring a batch independent, the host allows its interface to be called from
+// several threads at once.
+unsafe impl Send for SharedHost<'_> {}
+unsafe impl Sync for SharedHost<'_> {}
+
+impl BlockState for SharedHost<'_> {
+  fn account_exists(&self, addr: &Address) -> bool {
+    self.0.account_exists(addr)
+  }
+  fn get_storage(&self, addr: &Address, key: &Bytes32) -> Bytes32 {
+    self.0.get_storage(addr, key)
+  }
+  fn get_balance(&self, addr: &Address) -> Balance {
+    self.0.get_balance(addr)
+  }
+  fn get_tx_context(&self) -> TransactionContext {
+    self.0.get_tx_context()
+  }
+  fn get_block_hash(&self, number: i64) -> Bytes32 {
+    self.0.get_block_hash(number)
+  }
 }
 
 struct AddressWrapper(Address);
@@ -121,9 +266,30 @@ impl From<ffi::athcon_call_kind> for MessageKindWrapper {
   }
 }
 
-struct AthenaMessageWrapper(AthenaMessage);
+struct AthenaMessageWrapper<'a>(AthenaMessage<'a>);
 
-impl From<ffi::athcon_message> for AthenaMessageWrapper {
+// Storage slots are passed across FFI without copying, as both types are plain byte arrays.
+const _: () = assert!(
+  std::mem::size_of::<StorageSlot>() == std::mem::size_of::<ffi::athcon_storage_slot>()
+    && std::mem::align_of::<StorageSlot>() == std::mem::align_of::<ffi::athcon_storage_slot>()
+);
+
+fn storage_slots_from_ffi(slots: &[ffi::athcon_storage_slot]) -> &[StorageSlot] {
+  // SAFETY: Both types are `repr(C)` with the same fields and layout.
+  unsafe { std::slice::from_raw_parts(slots.as_ptr() as *const StorageSlot, slots.len()) }
+}
+
+fn storage_slots_to_ffi(slots: &[StorageSlot]) -> &[ffi::athcon_storage_slot] {
+  // SAFETY: Both types are `repr(C)` with the same fields and layout.
+  unsafe {
+    std::slice::from_raw_parts(
+      slots.as_ptr() as *const ffi::athcon_storage_slot,
+      slots.len(),
+    )
+  }
+}
+
+impl From<ffi::athcon_message> for AthenaMessageWrapper<'static> {
   fn from(item: ffi::athcon_message) -> Self {
     // Convert input_data pointer and size to Vec<u8>
     let input_data = if !item.input_data.is_null() && item.input_size > 0 {
@@ -139,6 +305,13 @@ impl From<ffi::athcon_message> for AthenaMessageWrapper {
       Vec::new()
     };
 
+    let access_list = if !item.access_list.is_null() && item.access_list_size > 0 {
+      let slots = unsafe { std::slice::from_raw_parts(item.access_list, item.access_list_size) };
+      storage_slots_from_ffi(slots).to_vec()
+    } else {
+      Vec::new()
+    };
+
     let kind: MessageKindWrapper = item.kind.into();
     let byteswrapper: Bytes32Wrapper = item.value.into();
     AthenaMessageWrapper(AthenaMessage {
@@ -147,50 +320,39 @@ impl From<ffi::athcon_message> for AthenaMessageWrapper {
       gas: item.gas,
       recipient: AddressWrapper::from(item.recipient).into(),
       sender: AddressWrapper::from(item.sender).into(),
-      input_data,
+      input_data: input_data.map(Cow::Owned),
       value: Bytes32AsU64::new(byteswrapper.0).into(),
-      code,
+      code: Cow::Owned(code),
+      access_list: Cow::Owned(access_list),
     })
   }
 }
 
-impl From<AthenaMessageWrapper> for ffi::athcon_message {
-  fn from(item: AthenaMessageWrapper) -> Self {
-    let (input_data, input_size) = if let Some(data) = item.0.input_data {
-      (data.as_ptr(), data.len())
-    } else {
-      (std::ptr::null(), 0)
-    };
-    let code = item.0.code.as_ptr();
-    let code_size = item.0.code.len();
+/// Borrows the input, code and access list of the message, which the caller keeps alive during the call.
+impl<'a> From<&'a AthenaMessageWrapper<'_>> for AthconExecutionMessage<'a> {
+  fn from(item: &'a AthenaMessageWrapper<'_>) -> Self {
     let kind = match item.0.kind {
       MessageKind::Call => ffi::athcon_call_kind::ATHCON_CALL,
     };
     let value: Bytes32AsU64 = item.0.value.into();
-    ffi::athcon_message {
+    AthconExecutionMessage::new(
       kind,
-      depth: item.0.depth,
-      gas: item.0.gas,
-      recipient: AddressWrapper(item.0.recipient).into(),
-      sender: AddressWrapper(item.0.sender).into(),
-      input_data,
-      input_size,
-      value: Bytes32Wrapper(value.into()).into(),
-      code,
-      code_size,
-    }
-  }
-}
-
-impl From<AthenaMessageWrapper> for AthconExecutionMessage {
-  fn from(item: AthenaMessageWrapper) -> Self {
-    // conversion is already implemented on the other side; utilize this
-    AthconExecutionMessage::from(&ffi::athcon_message::from(item))
+      item.0.depth,
+      item.0.gas,
+      AddressWrapper(item.0.recipient).into(),
+      AddressWrapper(item.0.sender).into(),
+      item.0.input_data.as_deref(),
+      Bytes32Wrapper(value.into()).into(),
+      (!item.0.code.is_empty()).then_some(&item.0.code[..]),
+    )
+    .with_access_list(storage_slots_to_ffi(&item.0.access_list))
   }
 }
 
-impl From<&AthconExecutionMessage> for AthenaMessageWrapper {
-  fn from(item: &AthconExecutionMessage) -> Self {
+/// Borrows the input, code and access list of the message, which remain valid for the duration of
+/// `athcon_execute`.
+impl<'a> From<&AthconExecutionMessage<'a>> for AthenaMessageWrapper<'a> {
+  fn from(item: &AthconExecutionMessage<'a>) -> Self {
     let kind: MessageKindWrapper = item.kind().into();
     let byteswrapper = Bytes32Wrapper::from(*item.value());
     AthenaMessageWrapper(AthenaMessage {
@@ -199,9 +361,10 @@ impl From<&AthconExecutionMessage> for AthenaMessageWrapper {
       gas: item.gas(),
       recipient: AddressWrapper::from(*item.recipient()).into(),
       sender: AddressWrapper::from(*item.sender()).into(),
-      input_data: item.input().cloned(),
+      input_data: item.input().map(Cow::Borrowed),
       value: Bytes32AsU64::new(byteswrapper.0).into(),
-      code: item.code().unwrap().clone(),
+      code: Cow::Borrowed(item.code().unwrap_or_default()),
+      access_list: Cow::Borrowed(storage_slots_from_ffi(item.access_list())),
     })
   }
 }
@@ -284,52 +447,58 @@ impl From<ExecutionResultWrapper> for ExecutionResult {
 
 impl From<AthconExecutionResult> for ExecutionResultWrapper {
   fn from(result: AthconExecutionResult) -> Self {
-    ExecutionResultWrapper(ExecutionResult::new(
+    let mut wrapped = ExecutionResult::new(
       StatusCodeWrapper::from(result.status_code()).into(),
       result.gas_left(),
       result.output().cloned(),
       result
         .create_address()
         .map(|address| AddressWrapper::from(*address).into()),
-    ))
+    );
+    wrapped.metrics = result.stats().map(|stats| ExecutionMetrics {
+      cycles: stats.cycles,
+      syscalls: stats.syscalls,
+      host_calls: stats.host_calls,
+      hint_bytes: stats.hint_bytes,
+      peak_memory: stats.peak_memory,
+    });
+    ExecutionResultWrapper(wrapped)
   }
 }
 
 impl From<ExecutionResultWrapper> for AthconExecutionResult {
+  /// Moves the output into the result, so that it's handed to the host without copying.
   fn from(wrapper: ExecutionResultWrapper) -> Self {
-    // use conversion implemented on the other side
-    ffi::athcon_result::from(wrapper).into()
+    let result = wrapper.0;
+    let mut converted = AthconExecutionResult::with_owned_output(
+      StatusCodeWrapper(result.status_code).into(),
+      result.gas_left,
+      result.output,
+    );
+    if let Some(address) = result.create_address {
+      converted = converted.with_create_address(AddressWrapper(address).into());
+    }
+    if result.metrics.is_some() {
+      converted = converted.with_stats(execution_stats_to_ffi(result.metrics));
+    }
+    converted
   }
 }
 
-impl From<ExecutionResultWrapper> for ffi::athcon_result {
-  fn from(value: ExecutionResultWrapper) -> Self {
-    let output = value.0.output.unwrap_or_else(Vec::new);
-    let output_size = output.len();
-
-    // in order to ensure that a slice can be reconstructed from empty output,
-    // we need some trickery here. see std::slice::from_raw_parts for more details.
-    let output_data = if output_size > 0 {
-      output.as_ptr()
-    } else {
-      core::ptr::NonNull::<u8>::dangling().as_ptr()
-    };
-
-    let gas_left = value.0.gas_left;
-    let create_address = value.0.create_address.map_or_else(
-      || ffi::athcon_address::default(),
-      |address| AddressWrapper(address).into(),
-    );
-    let status_code = StatusCodeWrapper(value.0.status_code).into();
-    let release = None;
-    ffi::athcon_result {
-      output_data,
-      output_size,
-      gas_left,
-      create_address,
-      status_code,
-      release,
-    }
+/// Reports `metrics` with every field filled in, or no statistics if they are `None`.
+fn execution_stats_to_ffi(metrics: Option<ExecutionMetrics>) -> ffi::athcon_execution_stats {
+  let size = match metrics {
+    Some(_) => std::mem::size_of::<ffi::athcon_execution_stats>() as u32,
+    None => 0,
+  };
+  let metrics = metrics.unwrap_or_default();
+  ffi::athcon_execution_stats {
+    size,
+    cycles: metrics.cycles,
+    syscalls: metrics.syscalls,
+    host_calls: metrics.host_calls,
+    hint_bytes: metrics.hint_bytes,
+    peak_memory: metrics.peak_memory,
   }
 }
 
@@ -400,6 +569,47 @@ impl<'a> HostInterface for WrappedHostInterface<'a> {
       &Bytes32Wrapper(*value).into(),
     ))
   }
+  fn get_storage_many(&self, addr: &Address, keys: &[Bytes32]) -> Vec<Bytes32> {
+    let keys: Vec<ffi::athcon_bytes32> =
+      keys.iter().map(|key| Bytes32Wrapper(*key).into()).collect();
+    self
+      .context
+      .get_storage_many(&AddressWrapper(*addr).into(), &keys)
+      .into_iter()
+      .map(|value| Bytes32Wrapper::from(value).into())
+      .collect()
+  }
+  fn set_storage_many(
+    &mut self,
+    addr: &Address,
+    keys: &[Bytes32],
+    values: &[Bytes32],
+  ) -> Vec<StorageStatus> {
+    let keys: Vec<ffi::athcon_bytes32> =
+      keys.iter().map(|key| Bytes32Wrapper(*key).into()).collect();
+    let values: Vec<ffi::athcon_bytes32> = values
+      .iter()
+      .map(|value| Bytes32Wrapper(*value).into())
+      .collect();
+    self
+      .context
+      .set_storage_many(&AddressWrapper(*addr).into(), &keys, &values)
+      .into_iter()
+      .map(convert_storage_status)
+      .collect()
+  }
+  fn prefetch_storage(&self, slots: &[StorageSlot]) {
+    self.context.prefetch_storage(storage_slots_to_ffi(slots));
+  }
+  fn log(&mut self, record: &LogRecord) {
+    let stream = match record.stream {
+      LogStream::Stdout => ffi::athcon_log_stream::ATHCON_LOG_STDOUT,
+      LogStream::Stderr => ffi::athcon_log_stream::ATHCON_LOG_STDERR,
+      LogStream::CycleTrackerStart => ffi::athcon_log_stream::ATHCON_LOG_CYCLE_TRACKER_START,
+      LogStream::CycleTrackerEnd => ffi::athcon_log_stream::ATHCON_LOG_CYCLE_TRACKER_END,
+    };
+    self.context.log(stream, record.clk, record.data);
+  }
   fn get_balance(&self, addr: &Address) -> Balance {
     let balance = self.context.get_balance(&AddressWrapper(*addr).into());
     Bytes32AsU64::new(Bytes32Wrapper::from(balance).into()).into()
@@ -414,7 +624,7 @@ impl<'a> HostInterface for WrappedHostInterface<'a> {
     ExecutionResultWrapper::from(
       self
         .context
-        .call(&AthconExecutionMessage::from(AthenaMessageWrapper(msg))),
+        .call(&AthconExecutionMessage::from(&AthenaMessageWrapper(msg))),
     )
     .into()
   }
@@ -446,9 +656,54 @@ fn get_dummy_host_interface() -> ffi::athcon_host_interface {
     call: None,
     get_tx_context: Some(get_dummy_tx_context),
     get_block_hash: None,
+    get_storage_many: None,
+    set_storage_many: None,
+    prefetch_storage: None,
+    log: None,
   }
 }
 
+/// The storage of the test host, which is passed as its context.
+type TestStorage = std::sync::Mutex<std::collections::BTreeMap<(Address, Bytes32), Bytes32>>;
+
+unsafe extern "C" fn get_test_storage(
+  context: *mut ffi::athcon_host_context,
+  address: *const ffi::athcon_address,
+  key: *const ffi::athcon_bytes32,
+) -> ffi::athcon_bytes32 {
+  let storage = &*(context as *const TestStorage);
+  let value = storage
+    .lock()
+    .unwrap()
+    .get(&((*address).bytes, (*key).bytes))
+    .copied();
+  ffi::athcon_bytes32 {
+    bytes: value.unwrap_or_default(),
+  }
+}
+
+unsafe extern "C" fn set_test_storage(
+  context: *mut ffi::athcon_host_context,
+  address: *const ffi::athcon_address,
+  key: *const ffi::athcon_bytes32,
+  value: *const ffi::athcon_bytes32,
+) -> ffi::athcon_storage_status {
+  let storage = &*(context as *const TestStorage);
+  let mut storage = storage.lock().unwrap();
+  match storage.insert(((*address).bytes, (*key).bytes), (*value).bytes) {
+    Some(_) => ffi::athcon_storage_status::ATHCON_STORAGE_ASSIGNED,
+    None => ffi::athcon_storage_status::ATHCON_STORAGE_ADDED,
+  }
+}
+
+// Calls do nothing but fail.
+unsafe extern "C" fn test_call(
+  _context: *mut ffi::athcon_host_context,
+  _msg: *const ffi::athcon_message,
+) -> ffi::athcon_result {
+  AthconExecutionResult::failure().into()
+}
+
 // This code is shared with the external FFI tests
 // These are raw tests, where the host context is null.
 pub fn vm_tests(vm_ptr: *mut ffi::athcon_vm) {
@@ -458,7 +713,7 @@ pub fn vm_tests(vm_ptr: *mut ffi::athcon_vm) {
 
     // Perform additional checks on the returned VM instance
     let vm = &*vm_ptr;
-    assert_eq!((*vm).abi_version, 0, "ABI version mismatch");
+    assert_eq!((*vm).abi_version, 1, "ABI version mismatch");
     assert_eq!(
       std::ffi::CStr::from_ptr((*vm).name).to_str().unwrap(),
       "Athena",
@@ -493,7 +748,7 @@ pub fn vm_tests(vm_ptr: *mut ffi::athcon_vm) {
     let message = ::athcon_sys::athcon_message {
       kind: ::athcon_sys::athcon_call_kind::ATHCON_CALL,
       depth: 0,
-      gas: 0,
+      gas: 1_000_000,
       recipient: ::athcon_sys::athcon_address::default(),
       sender: ::athcon_sys::athcon_address::default(),
       input_data: std::ptr::null(),
@@ -501,6 +756,8 @@ pub fn vm_tests(vm_ptr: *mut ffi::athcon_vm) {
       value: ::athcon_sys::athcon_uint256be::default(),
       code: code.as_ptr(),
       code_size: code.len(),
+      access_list: std::ptr::null(),
+      access_list_size: 0,
     };
 
     // this message is invalid because code_size doesn't match code length
@@ -515,6 +772,8 @@ pub fn vm_tests(vm_ptr: *mut ffi::athcon_vm) {
       value: ::athcon_sys::athcon_uint256be::default(),
       code: std::ptr::null(),
       code_size: 1,
+      access_list: std::ptr::null(),
+      access_list_size: 0,
     };
 
     // note: we cannot check for a null instance or message pointer here, as the VM wrapper code
@@ -591,6 +850,66 @@ pub fn vm_tests(vm_ptr: *mut ffi::athcon_vm) {
       ffi::athcon_status_code::ATHCON_SUCCESS
     );
 
+    // the counters of the execution can be read, if the VM collects them
+    let get_execution_stats = (*vm).get_execution_stats.unwrap();
+    let count = get_execution_stats(vm_ptr, std::ptr::null_mut(), 0);
+    let mut counters = vec![
+      ffi::athcon_counter {
+        name: std::ptr::null(),
+        value: 0,
+      };
+      count
+    ];
+    assert_eq!(
+      get_execution_stats(vm_ptr, counters.as_mut_ptr(), count),
+      count
+    );
+    if cfg!(feature = "stats") {
+      assert!(counters.iter().any(|counter| {
+        std::ffi::CStr::from_ptr(counter.name).to_bytes() == b"instructions.ecall"
+          && counter.value > 0
+      }));
+    } else {
+      assert_eq!(count, 0);
+    }
+
+    // the same call fails without enough gas
+    let message_without_gas = ::athcon_sys::athcon_message {
+      gas: 100,
+      ..message
+    };
+    assert_eq!(
+      (*vm).execute.unwrap()(
+        vm_ptr,
+        &host_interface,
+        std::ptr::null::<std::ffi::c_void>() as *mut std::ffi::c_void,
+        ffi::athcon_revision::ATHCON_FRONTIER,
+        &message_without_gas,
+        code.as_ptr(),
+        code.len(),
+      )
+      .status_code,
+      ffi::athcon_status_code::ATHCON_OUT_OF_GAS
+    );
+
+    // the code cache can be configured, but only with valid values
+    assert_eq!(
+      (*vm).set_option.unwrap()(
+        vm_ptr,
+        "code_cache\0".as_ptr() as *const i8,
+        "on\0".as_ptr() as *const i8
+      ),
+      ffi::athcon_set_option_result::ATHCON_SET_OPTION_SUCCESS
+    );
+    assert_eq!(
+      (*vm).set_option.unwrap()(
+        vm_ptr,
+        "code_cache\0".as_ptr() as *const i8,
+        "sometimes\0".as_ptr() as *const i8
+      ),
+      ffi::athcon_set_option_result::ATHCON_SET_OPTION_INVALID_VALUE
+    );
+
     // Call them a second way
     assert_eq!(
       wrapper.base.set_option.unwrap()(
@@ -621,6 +940,151 @@ pub fn vm_tests(vm_ptr: *mut ffi::athcon_vm) {
       ffi::athcon_status_code::ATHCON_FAILURE
     );
 
+    // a batch gives the same results as executing its messages one by one, whether or not the
+    // messages are declared independent
+    let messages = [message, message_without_gas, message];
+    let codes = [code.as_ptr(), code.as_ptr(), empty_code.as_ptr()];
+    let code_sizes = [code.len(), code.len(), 0];
+    for flags in [0, ffi::athcon_batch_flags::ATHCON_BATCH_INDEPENDENT as u32] {
+      let mut results = [ffi::athcon_result {
+        status_code: ffi::athcon_status_code::ATHCON_INTERNAL_ERROR,
+        gas_left: 0,
+        output_data: std::ptr::null(),
+        output_size: 0,
+        release: None,
+        create_address: ffi::athcon_address::default(),
+        stats: execution_stats_to_ffi(None),
+        release_context: std::ptr::null_mut(),
+      }; 3];
+      (*vm).execute_batch.unwrap()(
+        vm_ptr,
+        &host_interface,
+        std::ptr::null::<std::ffi::c_void>() as *mut std::ffi::c_void,
+        ffi::athcon_revision::ATHCON_FRONTIER,
+        messages.as_ptr(),
+        codes.as_ptr(),
+        code_sizes.as_ptr(),
+        messages.len(),
+        flags,
+        results.as_mut_ptr(),
+      );
+      let statuses = results.map(|result| result.status_code);
+      assert_eq!(
+        statuses,
+        [
+          ffi::athcon_status_code::ATHCON_SUCCESS,
+          ffi::athcon_status_code::ATHCON_OUT_OF_GAS,
+          ffi::athcon_status_code::ATHCON_FAILURE,
+        ]
+      );
+      // Executed messages report their cost, whether they succeeded or not.
+      assert!(results[0].stats.cycles > 0);
+      assert!(results[1].stats.size > 0);
+      assert_eq!(results[2].stats.size, 0);
+      for result in &results {
+        if let Some(release) = result.release {
+          release(result);
+        }
+      }
+    }
+
+    // a batch of messages accessing storage, with a host which can be called, leaves the same
+    // results and storage whether or not the messages are declared independent. Guests can't
+    // call other accounts or read balances yet, so all the messages can run in parallel.
+    let storage_host_interface = ffi::athcon_host_interface {
+      get_storage: Some(get_test_storage),
+      set_storage: Some(set_test_storage),
+      call: Some(test_call),
+      ..host_interface
+    };
+    let host_code = include_bytes!("../../../tests/host/elf/host-test");
+    let host_message = ::athcon_sys::athcon_message {
+      code: host_code.as_ptr(),
+      code_size: host_code.len(),
+      ..message
+    };
+    let messages = [host_message; 4];
+    let codes = [host_code.as_ptr(); 4];
+    let code_sizes = [host_code.len(); 4];
+    let key = std::array::from_fn(|i| if i % 4 == 0 { 2 } else { 0 });
+    let mut final_storage = Vec::new();
+    for flags in [0, ffi::athcon_batch_flags::ATHCON_BATCH_INDEPENDENT as u32] {
+      // The program expects its write to assign a slot which exists already.
+      let storage = TestStorage::default();
+      storage
+        .lock()
+        .unwrap()
+        .insert((Address::default(), key), [1; 32]);
+      let mut results = [ffi::athcon_result {
+        status_code: ffi::athcon_status_code::ATHCON_INTERNAL_ERROR,
+        gas_left: 0,
+        output_data: std::ptr::null(),
+        output_size: 0,
+        release: None,
+        create_address: ffi::athcon_address::default(),
+        stats: execution_stats_to_ffi(None),
+        release_context: std::ptr::null_mut(),
+      }; 4];
+      (*vm).execute_batch.unwrap()(
+        vm_ptr,
+        &storage_host_interface,
+        &storage as *const TestStorage as *mut ffi::athcon_host_context,
+        ffi::athcon_revision::ATHCON_FRONTIER,
+        messages.as_ptr(),
+        codes.as_ptr(),
+        code_sizes.as_ptr(),
+        messages.len(),
+        flags,
+        results.as_mut_ptr(),
+      );
+      for result in &results {
+        assert_eq!(result.status_code, ffi::athcon_status_code::ATHCON_SUCCESS);
+        if let Some(release) = result.release {
+          release(result);
+        }
+      }
+      final_storage.push(storage.into_inner().unwrap());
+    }
+    assert_eq!(final_storage[0], final_storage[1]);
+
+    // Written to an empty slot, the value is added rather than assigned, which fails the program.
+    // Its write reaches the host, which owns reverting it, whether or not the message is
+    // declared independent.
+    let mut final_storage = Vec::new();
+    for flags in [0, ffi::athcon_batch_flags::ATHCON_BATCH_INDEPENDENT as u32] {
+      let storage = TestStorage::default();
+      let mut result = ffi::athcon_result {
+        status_code: ffi::athcon_status_code::ATHCON_INTERNAL_ERROR,
+        gas_left: 0,
+        output_data: std::ptr::null(),
+        output_size: 0,
+        release: None,
+        create_address: ffi::athcon_address::default(),
+        stats: execution_stats_to_ffi(None),
+        release_context: std::ptr::null_mut(),
+      };
+      (*vm).execute_batch.unwrap()(
+        vm_ptr,
+        &storage_host_interface,
+        &storage as *const TestStorage as *mut ffi::athcon_host_context,
+        ffi::athcon_revision::ATHCON_FRONTIER,
+        &host_message,
+        codes.as_ptr(),
+        code_sizes.as_ptr(),
+        1,
+        flags,
+        &mut result,
+      );
+      assert_eq!(result.status_code, ffi::athcon_status_code::ATHCON_FAILURE);
+      if let Some(release) = result.release {
+        release(&result);
+      }
+      let storage = storage.into_inner().unwrap();
+      assert_eq!(storage.get(&(Address::default(), key)), Some(&[1; 32]));
+      final_storage.push(storage);
+    }
+    assert_eq!(final_storage[0], final_storage[1]);
+
     // Cleanup: Destroy the VM instance to prevent memory leaks
     (*vm).destroy.unwrap()(vm_ptr);
   }
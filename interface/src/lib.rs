@@ -2,7 +2,12 @@
 //!
 //! A library with no external dependencies that includes core types and traits.
 
+mod storage_cache;
+
+pub use storage_cache::*;
+
 use std::{
+  borrow::Cow,
   fmt,
   ops::{Deref, DerefMut},
 };
@@ -97,6 +102,16 @@ impl fmt::Display for StorageStatus {
   }
 }
 
+/// A storage slot of an account, e.g. an entry of an access list.
+///
+/// The layout matches `athcon_storage_slot`.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord, Hash)]
+#[repr(C)]
+pub struct StorageSlot {
+  pub address: Address,
+  pub key: Bytes32,
+}
+
 #[derive(Copy, Clone)]
 pub struct TransactionContext {
   pub gas_price: u64,
@@ -112,19 +127,26 @@ pub enum MessageKind {
   Call,
 }
 
+/// A message to execute.
+///
+/// The input data and code either belong to the message or are borrowed, e.g. from the host
+/// across the FFI boundary, for as long as the message is executed.
 #[derive(Debug, Clone, PartialEq)]
-pub struct AthenaMessage {
+pub struct AthenaMessage<'a> {
   pub kind: MessageKind,
   pub depth: i32,
   pub gas: i64,
   pub recipient: Address,
   pub sender: Address,
-  pub input_data: Option<Vec<u8>>,
+  pub input_data: Option<Cow<'a, [u8]>>,
   pub value: Balance,
-  pub code: Vec<u8>,
+  pub code: Cow<'a, [u8]>,
+  /// The storage slots the execution is expected to access, prefetched before it starts. The
+  /// list is only a hint: other slots remain accessible.
+  pub access_list: Cow<'a, [StorageSlot]>,
 }
 
-impl AthenaMessage {
+impl AthenaMessage<'_> {
   pub fn new(
     kind: MessageKind,
     depth: i32,
@@ -141,9 +163,10 @@ impl AthenaMessage {
       gas,
       recipient,
       sender,
-      input_data,
+      input_data: input_data.map(Cow::Owned),
       value,
-      code,
+      code: Cow::Owned(code),
+      access_list: Cow::Borrowed(&[]),
     }
   }
 }
@@ -193,6 +216,8 @@ pub struct ExecutionResult {
   pub gas_left: i64,
   pub output: Option<Vec<u8>>,
   pub create_address: Option<Address>,
+  /// The measured cost of the execution, if the VM reports it.
+  pub metrics: Option<ExecutionMetrics>,
 }
 
 impl ExecutionResult {
@@ -207,14 +232,108 @@ impl ExecutionResult {
       gas_left,
       output,
       create_address,
+      metrics: None,
+    }
+  }
+
+  pub fn with_metrics(self, metrics: ExecutionMetrics) -> Self {
+    Self {
+      metrics: Some(metrics),
+      ..self
+    }
+  }
+}
+
+/// What an execution actually cost, measured by the VM, e.g. to price and schedule transactions
+/// by more than their gas estimate. Failed executions report what they ran before failing.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct ExecutionMetrics {
+  /// The number of instructions executed.
+  pub cycles: u64,
+  /// The number of syscalls made.
+  pub syscalls: u64,
+  /// The number of syscalls calling the host, e.g. to access storage.
+  pub host_calls: u64,
+  /// The number of bytes of input read by the program with hint reads.
+  pub hint_bytes: u64,
+  /// The largest size of guest memory in bytes, see `GuestMemory::size` in the core crate. It is
+  /// sampled after each basic block.
+  pub peak_memory: u64,
+}
+
+/// A stream the guest writes log output to.
+#[repr(u8)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub enum LogStream {
+  Stdout = 1,
+  Stderr = 2,
+  /// The name of a region whose cycles are tracked, at its start.
+  CycleTrackerStart = 3,
+  /// The name of a region whose cycles are tracked, at its end.
+  CycleTrackerEnd = 4,
+}
+
+impl LogStream {
+  pub const fn from_u8(stream: u8) -> Option<Self> {
+    match stream {
+      1 => Some(LogStream::Stdout),
+      2 => Some(LogStream::Stderr),
+      3 => Some(LogStream::CycleTrackerStart),
+      4 => Some(LogStream::CycleTrackerEnd),
+      _ => None,
     }
   }
 }
 
+/// A write of the guest to one of its log streams.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct LogRecord<'a> {
+  pub stream: LogStream,
+  /// The number of instructions executed before the write.
+  pub clk: u64,
+  pub data: &'a [u8],
+}
+
 pub trait HostInterface {
   fn account_exists(&self, addr: &Address) -> bool;
   fn get_storage(&self, addr: &Address, key: &Bytes32) -> Bytes32;
   fn set_storage(&mut self, addr: &Address, key: &Bytes32, value: &Bytes32) -> StorageStatus;
+
+  /// Reads the storage at each of `keys`. Hosts which can serve several reads in one round-trip
+  /// should override this.
+  fn get_storage_many(&self, addr: &Address, keys: &[Bytes32]) -> Vec<Bytes32> {
+    keys.iter().map(|key| self.get_storage(addr, key)).collect()
+  }
+
+  /// Writes each of `values` to the storage at the matching key in `keys`, in order. Hosts which
+  /// can serve several writes in one round-trip should override this.
+  fn set_storage_many(
+    &mut self,
+    addr: &Address,
+    keys: &[Bytes32],
+    values: &[Bytes32],
+  ) -> Vec<StorageStatus> {
+    assert_eq!(
+      keys.len(),
+      values.len(),
+      "storage keys and values differ in length"
+    );
+    keys
+      .iter()
+      .zip(values)
+      .map(|(key, value)| self.set_storage(addr, key, value))
+      .collect()
+  }
+
+  /// Announces the storage slots an execution is about to access, before it starts, so that
+  /// the host can load them concurrently and serve the reads which follow from memory. Hosts
+  /// which have no use for it can ignore it, which is the default.
+  fn prefetch_storage(&self, _slots: &[StorageSlot]) {}
+
+  /// Receives the log output of an execution once it ends, a record at a time, when the VM
+  /// buffers it. Hosts which have no use for it can ignore it, which is the default.
+  fn log(&mut self, _record: &LogRecord) {}
+
   fn get_balance(&self, addr: &Address) -> Balance;
   fn get_tx_context(&self) -> TransactionContext;
   fn get_block_hash(&self, number: i64) -> Bytes32;
@@ -224,8 +343,14 @@ pub trait HostInterface {
 // provide a trait-bound generic struct to represent the host interface
 // this is better, and more performant, than using a trait object
 // since it allows more compile-time checks, and we don't need polymorphism.
+//
+// storage access goes through the provider, so that it can be served by an optional
+// write-back cache (see [StorageCache]).
 pub struct HostProvider<T: HostInterface> {
   host: T,
+  storage_cache: Option<StorageCache>,
+  /// The prefetch counters of the storage caches already committed or discarded.
+  prefetch_stats: PrefetchStats,
 }
 
 impl<T> HostProvider<T>
@@ -233,7 +358,114 @@ where
   T: HostInterface,
 {
   pub fn new(host: T) -> Self {
-    HostProvider { host }
+    HostProvider {
+      host,
+      storage_cache: None,
+      prefetch_stats: PrefetchStats::default(),
+    }
+  }
+
+  /// The wrapped host.
+  pub fn host(&self) -> &T {
+    &self.host
+  }
+
+  /// Serves storage access from a write-back cache until [HostProvider::commit_storage] or
+  /// [HostProvider::discard_storage] is called.
+  pub fn enable_storage_cache(&mut self) {
+    self.storage_cache.get_or_insert_with(StorageCache::new);
+  }
+
+  pub fn get_storage(&mut self, addr: &Address, key: &Bytes32) -> Bytes32 {
+    match &mut self.storage_cache {
+      Some(cache) => cache.get_storage(&self.host, addr, key),
+      None => self.host.get_storage(addr, key),
+    }
+  }
+
+  pub fn set_storage(&mut self, addr: &Address, key: &Bytes32, value: &Bytes32) -> StorageStatus {
+    match &mut self.storage_cache {
+      Some(cache) => cache.set_storage(&self.host, addr, key, value),
+      None => self.host.set_storage(addr, key, value),
+    }
+  }
+
+  pub fn get_storage_many(&mut self, addr: &Address, keys: &[Bytes32]) -> Vec<Bytes32> {
+    match &mut self.storage_cache {
+      Some(cache) => cache.get_storage_many(&self.host, addr, keys),
+      None => self.host.get_storage_many(addr, keys),
+    }
+  }
+
+  pub fn set_storage_many(
+    &mut self,
+    addr: &Address,
+    keys: &[Bytes32],
+    values: &[Bytes32],
+  ) -> Vec<StorageStatus> {
+    match &mut self.storage_cache {
+      Some(cache) => cache.set_storage_many(&self.host, addr, keys, values),
+      None => self.host.set_storage_many(addr, keys, values),
+    }
+  }
+
+  /// Hands `slots` to the host to prefetch, see [HostInterface::prefetch_storage]. With the
+  /// storage cache, the slots are then read into it, in one batch per account, so that the
+  /// execution reads them from the cache.
+  pub fn prefetch_storage(&mut self, slots: &[StorageSlot]) {
+    if slots.is_empty() {
+      return;
+    }
+    self.host.prefetch_storage(slots);
+    if let Some(cache) = &mut self.storage_cache {
+      cache.prefetch(&self.host, slots);
+    }
+  }
+
+  /// Returns how many of the storage slots accessed since the last call had been prefetched,
+  /// and resets the counters. Only slots served by the storage cache are counted.
+  pub fn take_prefetch_stats(&mut self) -> PrefetchStats {
+    let mut stats = std::mem::take(&mut self.prefetch_stats);
+    if let Some(cache) = &mut self.storage_cache {
+      stats.add(&cache.take_prefetch_stats());
+    }
+    stats
+  }
+
+  /// Hands a record of guest log output to the host, see [HostInterface::log].
+  pub fn log(&mut self, record: &LogRecord) {
+    self.host.log(record);
+  }
+
+  /// Calls another account. Cached writes are flushed first, as the callee may access them, and
+  /// the cached slots are read again afterwards, as the callee may have changed them. Flushed
+  /// writes are still undone by [HostProvider::discard_storage].
+  pub fn call(&mut self, msg: AthenaMessage) -> ExecutionResult {
+    if let Some(cache) = &mut self.storage_cache {
+      cache.flush(&mut self.host);
+    }
+    let result = self.host.call(msg);
+    if let Some(cache) = &mut self.storage_cache {
+      cache.invalidate();
+    }
+    result
+  }
+
+  /// Writes cached storage changes to the host, at the successful end of an execution.
+  pub fn commit_storage(&mut self) {
+    if let Some(mut cache) = self.storage_cache.take() {
+      cache.flush(&mut self.host);
+      self.prefetch_stats.add(&cache.take_prefetch_stats());
+    }
+  }
+
+  /// Drops cached storage changes, when an execution fails or reverts. Changes flushed before
+  /// calls are written back to their previous values, see [StorageCache::revert].
+  pub fn discard_storage(&mut self) {
+    if let Some(mut cache) = self.storage_cache.take() {
+      cache.revert(&mut self.host);
+      self.prefetch_stats.add(&cache.take_prefetch_stats());
+    }
   }
 }
 
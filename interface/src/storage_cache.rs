@@ -0,0 +1,481 @@
+use std::collections::hash_map::Entry;
+use std::collections::HashMap;
+
+use crate::{Address, Bytes32, HostInterface, StorageSlot, StorageStatus};
+
+#[derive(Debug, Clone, Copy)]
+struct CachedSlot {
+  /// The value of the slot when it was first accessed.
+  original: Bytes32,
+  /// The value of the slot including all writes so far.
+  current: Bytes32,
+  /// The value of the slot in the host, as of the last read or flush.
+  written: Bytes32,
+  /// Whether the host may have changed the slot since it was read, so that `current` must be
+  /// read again (see [StorageCache::invalidate]).
+  stale: bool,
+  /// Whether the slot was loaded by [StorageCache::prefetch] and not accessed since.
+  prefetched: bool,
+}
+
+impl CachedSlot {
+  fn new(value: Bytes32, prefetched: bool) -> Self {
+    Self {
+      original: value,
+      current: value,
+      written: value,
+      stale: false,
+      prefetched,
+    }
+  }
+
+  /// Takes `value` read from the host as the current value of the slot, keeping its original
+  /// value if it was cached already.
+  fn refresh(&mut self, value: Bytes32) {
+    self.current = value;
+    self.written = value;
+    self.stale = false;
+  }
+}
+
+/// Counters of how well prefetching predicted the storage slots accessed by executions.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct PrefetchStats {
+  /// The slots read ahead of the execution.
+  pub prefetched: u64,
+  /// The slots accessed by the execution which had been prefetched.
+  pub hits: u64,
+  /// The slots accessed by the execution which had to be read from the host.
+  pub misses: u64,
+}
+
+impl PrefetchStats {
+  /// The share of the slots accessed which had been prefetched, or `None` if none were
+  /// accessed.
+  pub fn hit_rate(&self) -> Option<f64> {
+    let accessed = self.hits + self.misses;
+    (accessed > 0).then(|| self.hits as f64 / accessed as f64)
+  }
+
+  pub fn add(&mut self, other: &PrefetchStats) {
+    self.prefetched += other.prefetched;
+    self.hits += other.hits;
+    self.misses += other.misses;
+  }
+}
+
+/// A write-back cache of the storage slots accessed during an execution.
+///
+/// Repeated reads of a slot are answered from the cache, and writes are coalesced and only sent
+/// to the host by [StorageCache::flush]. Storage statuses are computed locally, with the value of
+/// a slot at its first access as its original value. Slots stay cached across flushes, so their
+/// original values are kept for the whole execution, and the value each flushed slot had in the
+/// host before is journaled, so that [StorageCache::revert] can undo the flushes.
+#[derive(Debug, Default)]
+pub struct StorageCache {
+  slots: HashMap<(Address, Bytes32), CachedSlot>,
+  /// The value of each flushed slot in the host before it was first flushed.
+  journal: HashMap<(Address, Bytes32), Bytes32>,
+  prefetch_stats: PrefetchStats,
+}
+
+impl StorageCache {
+  pub fn new() -> Self {
+    Self::default()
+  }
+
+  pub fn get_storage<T: HostInterface>(
+    &mut self,
+    host: &T,
+    addr: &Address,
+    key: &Bytes32,
+  ) -> Bytes32 {
+    let stats = &mut self.prefetch_stats;
+    let slot = self.slots.entry((*addr, *key)).or_insert_with(|| {
+      stats.misses += 1;
+      CachedSlot::new(host.get_storage(addr, key), false)
+    });
+    if slot.stale {
+      slot.refresh(host.get_storage(addr, key));
+    }
+    if slot.prefetched {
+      slot.prefetched = false;
+      stats.hits += 1;
+    }
+    slot.current
+  }
+
+  /// Reads many slots, fetching all of those which aren't cached in one host call.
+  pub fn get_storage_many<T: HostInterface>(
+    &mut self,
+    host: &T,
+    addr: &Address,
+    keys: &[Bytes32],
+  ) -> Vec<Bytes32> {
+    let mut missing: Vec<Bytes32> = keys
+      .iter()
+      .filter(|key| !self.is_fresh(addr, key))
+      .copied()
+      .collect();
+    missing.sort_unstable();
+    missing.dedup();
+    if !missing.is_empty() {
+      let values = host.get_storage_many(addr, &missing);
+      for (key, value) in missing.into_iter().zip(values) {
+        match self.slots.entry((*addr, key)) {
+          Entry::Occupied(mut entry) => entry.get_mut().refresh(value),
+          Entry::Vacant(entry) => {
+            self.prefetch_stats.misses += 1;
+            entry.insert(CachedSlot::new(value, false));
+          }
+        }
+      }
+    }
+    keys
+      .iter()
+      .map(|key| {
+        let slot = self.slots.get_mut(&(*addr, *key)).unwrap();
+        if slot.prefetched {
+          slot.prefetched = false;
+          self.prefetch_stats.hits += 1;
+        }
+        slot.current
+      })
+      .collect()
+  }
+
+  /// Reads the slots which aren't cached yet ahead of their use, one host call per account.
+  /// Reads of prefetched slots count as hits in [StorageCache::take_prefetch_stats].
+  pub fn prefetch<T: HostInterface>(&mut self, host: &T, slots: &[StorageSlot]) {
+    let mut missing: Vec<StorageSlot> = slots
+      .iter()
+      .filter(|slot| !self.slots.contains_key(&(slot.address, slot.key)))
+      .copied()
+      .collect();
+    missing.sort_unstable();
+    missing.dedup();
+    for batch in missing.chunk_by(|a, b| a.address == b.address) {
+      let addr = &batch[0].address;
+      let keys: Vec<Bytes32> = batch.iter().map(|slot| slot.key).collect();
+      let values = host.get_storage_many(addr, &keys);
+      for (key, value) in keys.into_iter().zip(values) {
+        self
+          .slots
+          .insert((*addr, key), CachedSlot::new(value, true));
+      }
+      self.prefetch_stats.prefetched += batch.len() as u64;
+    }
+  }
+
+  /// Returns the prefetch counters since the last call and resets them.
+  pub fn take_prefetch_stats(&mut self) -> PrefetchStats {
+    std::mem::take(&mut self.prefetch_stats)
+  }
+
+  pub fn set_storage<T: HostInterface>(
+    &mut self,
+    host: &T,
+    addr: &Address,
+    key: &Bytes32,
+    value: &Bytes32,
+  ) -> StorageStatus {
+    self.get_storage(host, addr, key);
+    let slot = self.slots.get_mut(&(*addr, *key)).unwrap();
+    let status = storage_status(&slot.original, &slot.current, value);
+    slot.current = *value;
+    status
+  }
+
+  pub fn set_storage_many<T: HostInterface>(
+    &mut self,
+    host: &T,
+    addr: &Address,
+    keys: &[Bytes32],
+    values: &[Bytes32],
+  ) -> Vec<StorageStatus> {
+    assert_eq!(
+      keys.len(),
+      values.len(),
+      "storage keys and values differ in length"
+    );
+    self.get_storage_many(host, addr, keys);
+    keys
+      .iter()
+      .zip(values)
+      .map(|(key, value)| {
+        let slot = self.slots.get_mut(&(*addr, *key)).unwrap();
+        let status = storage_status(&slot.original, &slot.current, value);
+        slot.current = *value;
+        status
+      })
+      .collect()
+  }
+
+  /// Whether the slot is cached and the host can't have changed it since.
+  fn is_fresh(&self, addr: &Address, key: &Bytes32) -> bool {
+    self
+      .slots
+      .get(&(*addr, *key))
+      .is_some_and(|slot| !slot.stale)
+  }
+
+  /// Writes the slots whose value changed since they were last written to the host, one batch
+  /// per account. The slots stay cached, with their original values.
+  pub fn flush<T: HostInterface>(&mut self, host: &mut T) {
+    let journal = &mut self.journal;
+    let dirty: Vec<(Address, Bytes32, Bytes32)> = self
+      .slots
+      .iter_mut()
+      .filter(|(_, slot)| slot.current != slot.written)
+      .map(|((addr, key), slot)| {
+        journal.entry((*addr, *key)).or_insert(slot.written);
+        slot.written = slot.current;
+        (*addr, *key, slot.current)
+      })
+      .collect();
+    write_slots(host, dirty);
+  }
+
+  /// Writes back to the host the values the flushed slots had before they were first flushed,
+  /// and drops all cached slots, for when the execution fails after flushing (e.g. before a
+  /// call). Changes the host made to other slots meanwhile, e.g. in a call, are left to the host
+  /// to undo, as they are without the cache.
+  pub fn revert<T: HostInterface>(&mut self, host: &mut T) {
+    let journaled = self
+      .journal
+      .drain()
+      .map(|((addr, key), value)| (addr, key, value))
+      .collect();
+    write_slots(host, journaled);
+    self.clear();
+  }
+
+  /// Marks all cached slots to be read again from the host at their next access, keeping their
+  /// original values, for when the host may have changed them (e.g. during a call). Unflushed
+  /// writes are lost, so [StorageCache::flush] must come first.
+  pub fn invalidate(&mut self) {
+    for slot in self.slots.values_mut() {
+      slot.stale = true;
+    }
+  }
+
+  /// Drops all cached slots, including unflushed writes, and forgets the flushed ones.
+  pub fn clear(&mut self) {
+    self.slots.clear();
+    self.journal.clear();
+  }
+}
+
+/// Writes `slots` to the host in a deterministic order, one batch per account.
+fn write_slots<T: HostInterface>(host: &mut T, mut slots: Vec<(Address, Bytes32, Bytes32)>) {
+  slots.sort_unstable_by(|a, b| (a.0, a.1).cmp(&(b.0, b.1)));
+  for batch in slots.chunk_by(|a, b| a.0 == b.0) {
+    let keys: Vec<Bytes32> = batch.iter().map(|(_, key, _)| *key).collect();
+    let values: Vec<Bytes32> = batch.iter().map(|(_, _, value)| *value).collect();
+    host.set_storage_many(&batch[0].0, &keys, &values);
+  }
+}
+
+/// The effect of changing a storage slot from `current` to `new`, where `original` is its value
+/// before the execution. See `athcon_storage_status` for the meaning of each status.
+pub fn storage_status(original: &Bytes32, current: &Bytes32, new: &Bytes32) -> StorageStatus {
+  let zero = Bytes32::default();
+  if current == new {
+    StorageStatus::StorageAssigned
+  } else if original == current {
+    if *original == zero {
+      StorageStatus::StorageAdded
+    } else if *new == zero {
+      StorageStatus::StorageDeleted
+    } else {
+      StorageStatus::StorageModified
+    }
+  } else if *original == zero {
+    // 0 -> Y -> ?
+    if *new == zero {
+      StorageStatus::StorageAddedDeleted
+    } else {
+      StorageStatus::StorageAssigned
+    }
+  } else if *current == zero {
+    // X -> 0 -> ?
+    if new == original {
+      StorageStatus::StorageDeletedRestored
+    } else {
+      StorageStatus::StorageDeletedAdded
+    }
+  } else if *new == zero {
+    StorageStatus::StorageModifiedDeleted
+  } else if new == original {
+    StorageStatus::StorageModifiedRestored
+  } else {
+    StorageStatus::StorageAssigned
+  }
+}
+
+#[cfg(test)]
+mod tests {
+  use std::cell::Cell;
+
+  use super::*;
+  use crate::{AthenaMessage, ExecutionResult, TransactionContext, ADDRESS_LENGTH};
+
+  #[derive(Default)]
+  struct CountingHost {
+    storage: HashMap<Bytes32, Bytes32>,
+    reads: Cell<usize>,
+    writes: usize,
+  }
+
+  impl HostInterface for CountingHost {
+    fn account_exists(&self, _addr: &Address) -> bool {
+      true
+    }
+    fn get_storage(&self, _addr: &Address, key: &Bytes32) -> Bytes32 {
+      self.reads.set(self.reads.get() + 1);
+      self.storage.get(key).copied().unwrap_or_default()
+    }
+    fn set_storage(&mut self, _addr: &Address, key: &Bytes32, value: &Bytes32) -> StorageStatus {
+      self.writes += 1;
+      self.storage.insert(*key, *value);
+      StorageStatus::StorageAssigned
+    }
+    fn get_balance(&self, _addr: &Address) -> u64 {
+      0
+    }
+    fn get_tx_context(&self) -> TransactionContext {
+      unimplemented!()
+    }
+    fn get_block_hash(&self, _number: i64) -> Bytes32 {
+      unimplemented!()
+    }
+    fn call(&mut self, _msg: AthenaMessage) -> ExecutionResult {
+      unimplemented!()
+    }
+  }
+
+  #[test]
+  fn test_storage_status() {
+    let (zero, x, y, z) = ([0; 32], [1; 32], [2; 32], [3; 32]);
+    let cases = [
+      (zero, zero, zero, StorageStatus::StorageAssigned),
+      (x, y, z, StorageStatus::StorageAssigned),
+      (zero, zero, z, StorageStatus::StorageAdded),
+      (x, x, zero, StorageStatus::StorageDeleted),
+      (x, x, z, StorageStatus::StorageModified),
+      (x, zero, z, StorageStatus::StorageDeletedAdded),
+      (x, y, zero, StorageStatus::StorageModifiedDeleted),
+      (x, zero, x, StorageStatus::StorageDeletedRestored),
+      (zero, y, zero, StorageStatus::StorageAddedDeleted),
+      (x, y, x, StorageStatus::StorageModifiedRestored),
+    ];
+    for (original, current, new, status) in cases {
+      assert_eq!(storage_status(&original, &current, &new), status);
+    }
+  }
+
+  #[test]
+  fn test_storage_cache_write_back() {
+    let addr = [0; ADDRESS_LENGTH];
+    let (a, b) = ([1; 32], [2; 32]);
+    let mut host = CountingHost::default();
+    host.storage.insert(a, [7; 32]);
+    let mut cache = StorageCache::new();
+
+    assert_eq!(cache.get_storage(&host, &addr, &a), [7; 32]);
+    assert_eq!(cache.get_storage(&host, &addr, &a), [7; 32]);
+    assert_eq!(host.reads.get(), 1);
+
+    assert_eq!(
+      cache.set_storage(&host, &addr, &b, &[9; 32]),
+      StorageStatus::StorageAdded
+    );
+    assert_eq!(
+      cache.set_storage(&host, &addr, &b, &[8; 32]),
+      StorageStatus::StorageAssigned
+    );
+    assert_eq!(cache.get_storage(&host, &addr, &b), [8; 32]);
+    // Writing back the original value leaves nothing to flush for the slot.
+    cache.set_storage(&host, &addr, &a, &[0; 32]);
+    cache.set_storage(&host, &addr, &a, &[7; 32]);
+    assert_eq!(host.writes, 0);
+
+    cache.flush(&mut host);
+    assert_eq!(host.writes, 1);
+    assert_eq!(host.storage[&b], [8; 32]);
+
+    // Flushed slots keep their original value.
+    assert_eq!(
+      cache.set_storage(&host, &addr, &b, &[0; 32]),
+      StorageStatus::StorageAddedDeleted
+    );
+    cache.clear();
+    cache.flush(&mut host);
+    assert_eq!(host.storage[&b], [8; 32]);
+  }
+
+  #[test]
+  fn test_storage_cache_revert() {
+    let addr = [0; ADDRESS_LENGTH];
+    let (a, b, c) = ([1; 32], [2; 32], [3; 32]);
+    let mut host = CountingHost::default();
+    host.storage.insert(a, [7; 32]);
+    let mut cache = StorageCache::new();
+
+    cache.set_storage(&host, &addr, &a, &[8; 32]);
+    cache.set_storage(&host, &addr, &b, &[9; 32]);
+    cache.flush(&mut host);
+    cache.invalidate();
+    // Writes after a flush, and flushed again, are undone back to before the first flush.
+    cache.set_storage(&host, &addr, &a, &[10; 32]);
+    cache.flush(&mut host);
+    cache.set_storage(&host, &addr, &c, &[11; 32]);
+
+    cache.revert(&mut host);
+    assert_eq!(host.storage[&a], [7; 32]);
+    assert_eq!(host.storage[&b], [0; 32]);
+    assert!(!host.storage.contains_key(&c));
+    // Nothing is left to flush.
+    let writes = host.writes;
+    cache.flush(&mut host);
+    assert_eq!(host.writes, writes);
+  }
+
+  #[test]
+  fn test_storage_cache_prefetch() {
+    let addr = [0; ADDRESS_LENGTH];
+    let (a, b, c) = ([1; 32], [2; 32], [3; 32]);
+    let slot = |key| StorageSlot { address: addr, key };
+    let mut host = CountingHost::default();
+    host.storage.insert(a, [7; 32]);
+    let mut cache = StorageCache::new();
+
+    cache.prefetch(&host, &[slot(a), slot(b), slot(a)]);
+    assert_eq!(host.reads.get(), 2);
+    // Prefetched slots are served from the cache.
+    assert_eq!(cache.get_storage(&host, &addr, &a), [7; 32]);
+    assert_eq!(cache.get_storage(&host, &addr, &a), [7; 32]);
+    assert_eq!(
+      cache.get_storage_many(&host, &addr, &[b, c]),
+      [[0; 32], [0; 32]]
+    );
+    assert_eq!(host.reads.get(), 3);
+    // Writing to a prefetched slot keeps its original value.
+    assert_eq!(
+      cache.set_storage(&host, &addr, &a, &[0; 32]),
+      StorageStatus::StorageDeleted
+    );
+
+    let stats = cache.take_prefetch_stats();
+    assert_eq!(
+      stats,
+      PrefetchStats {
+        prefetched: 2,
+        hits: 2,
+        misses: 1
+      }
+    );
+    assert_eq!(stats.hit_rate(), Some(2.0 / 3.0));
+    assert_eq!(cache.take_prefetch_stats().hit_rate(), None);
+  }
+}
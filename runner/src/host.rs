@@ -35,11 +35,51 @@ impl From<u64> for Bytes32AsU64 {
 #[derive(Debug, Clone, Copy)]
 pub enum AthenaCapability {}
 
-// currently unused
-#[derive(Debug, Clone)]
-pub enum AthenaOption {}
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum AthenaOption {
+  /// Configures the decoded program cache: "on", "off", or the maximum number of cached programs.
+  CodeCache,
+
+  /// Keeps decoded programs as artifacts in a directory, from which later processes load them
+  /// without decoding: the path of the directory, or "off" (the default).
+  CodeCacheDir,
+
+  /// Serves storage reads and writes of an execution from a write-back cache: "on" or "off"
+  /// (the default). Writes are sent to the host once the execution succeeds.
+  StorageCache,
+
+  /// Limits the guest memory of each execution: a number of bytes, or "off". Executions which
+  /// exceed it fail with [athena_interface::StatusCode::OutOfMemory].
+  MemoryLimit,
+
+  /// Delivers the guest's standard output, standard error and cycle-tracker markers to the
+  /// host's log callback after each execution: "on" (the default), "off", or the number of bytes
+  /// of the most recent output to keep. Output is kept in a bounded per-execution buffer, so
+  /// writing it never allocates.
+  GuestLog,
+
+  /// Selects how programs are executed: "interpreter" (the default), the only engine available.
+  /// Other engines, such as "jit", are rejected.
+  Engine,
+}
 
-#[derive(Debug)]
+impl std::str::FromStr for AthenaOption {
+  type Err = SetOptionError;
+
+  fn from_str(key: &str) -> Result<Self, Self::Err> {
+    match key {
+      "code_cache" => Ok(AthenaOption::CodeCache),
+      "code_cache_dir" => Ok(AthenaOption::CodeCacheDir),
+      "storage_cache" => Ok(AthenaOption::StorageCache),
+      "memory_limit" => Ok(AthenaOption::MemoryLimit),
+      "guest_log" => Ok(AthenaOption::GuestLog),
+      "engine" => Ok(AthenaOption::Engine),
+      _ => Err(SetOptionError::InvalidKey),
+    }
+  }
+}
+
+#[derive(Debug, PartialEq, Eq)]
 pub enum SetOptionError {
   InvalidKey,
   InvalidValue,
@@ -50,7 +90,8 @@ use std::collections::BTreeMap;
 
 #[cfg(test)]
 use athena_interface::{
-  Address, AthenaMessage, ExecutionResult, HostInterface, StorageStatus, TransactionContext,
+  Address, AthenaMessage, ExecutionResult, HostInterface, LogRecord, LogStream, StorageStatus,
+  TransactionContext,
 };
 
 #[cfg(test)]
@@ -62,6 +103,9 @@ pub(crate) struct MockHost {
 
   // stores balance keyed by address
   balance: BTreeMap<Address, Bytes32>,
+
+  // stores the guest log output received
+  pub log: Vec<(LogStream, Vec<u8>)>,
 }
 
 #[cfg(test)]
@@ -71,6 +115,7 @@ impl MockHost {
       context: context,
       storage: BTreeMap::new(),
       balance: BTreeMap::new(),
+      log: Vec::new(),
     }
   }
 }
@@ -113,6 +158,10 @@ impl HostInterface for MockHost {
   fn call(&mut self, _msg: AthenaMessage) -> ExecutionResult {
     ExecutionResult::new(athena_interface::StatusCode::Failure, 0, None, None)
   }
+
+  fn log(&mut self, record: &LogRecord) {
+    self.log.push((record.stream, record.data.to_vec()));
+  }
 }
 
 #[cfg(test)]
@@ -1,5 +1,7 @@
 pub mod host;
+pub mod parallel;
 pub mod vm;
 
 pub use host::Bytes32AsU64;
+pub use parallel::{BlockState, ParallelExecutor, Transaction, TransactionLog, TransactionOutput};
 pub use vm::{AthenaVm, VmInterface};
@@ -0,0 +1,491 @@
+//! Parallel execution of the transactions of a block.
+
+use std::{
+  cell::{Cell, RefCell},
+  collections::BTreeMap,
+  num::NonZeroUsize,
+  sync::{
+    atomic::{AtomicUsize, Ordering},
+    Arc,
+  },
+  thread,
+};
+
+use athena_interface::{
+  storage_status, Address, AthenaMessage, Bytes32, ExecutionResult, HostInterface, HostProvider,
+  LogRecord, LogStream, StatusCode, StorageStatus, TransactionContext,
+};
+
+use crate::VmInterface;
+
+/// The state a block is executed on.
+///
+/// Unlike a [HostInterface], which belongs to a single execution, the state is shared by all the
+/// worker threads executing a block and is only read. The writes of each transaction are
+/// returned to the caller instead. Balances are only read to find the transactions which must be
+/// executed serially, see [ParallelExecutor].
+pub trait BlockState: Send + Sync {
+  fn account_exists(&self, addr: &Address) -> bool;
+  fn get_storage(&self, addr: &Address, key: &Bytes32) -> Bytes32;
+  fn get_balance(&self, addr: &Address) -> u64;
+  fn get_tx_context(&self) -> TransactionContext;
+  fn get_block_hash(&self, number: i64) -> Bytes32;
+}
+
+/// A transaction of a block.
+#[derive(Debug, Clone)]
+pub struct Transaction<'a> {
+  pub msg: AthenaMessage<'a>,
+  pub code: &'a [u8],
+}
+
+/// The outcome of a transaction, identical to that of executing the block serially.
+#[derive(Debug)]
+pub struct TransactionOutput {
+  pub result: ExecutionResult,
+  /// The storage slots written by the transaction, in slot order. Kept if it failed, for the
+  /// host to revert like the writes of a failed serial execution.
+  pub writes: Vec<(Address, Bytes32, Bytes32)>,
+  /// The log output of the transaction, to hand to the host after its writes. Kept if it
+  /// failed, like the log of a serial execution.
+  pub logs: Vec<TransactionLog>,
+  /// Whether the transaction conflicted with an earlier one and was executed again.
+  pub reexecuted: bool,
+}
+
+/// A record of guest log output, kept until it is handed to the host in block order.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct TransactionLog {
+  pub stream: LogStream,
+  /// The number of instructions executed before the write.
+  pub clk: u64,
+  pub data: Vec<u8>,
+}
+
+impl TransactionLog {
+  pub fn record(&self) -> LogRecord<'_> {
+    LogRecord {
+      stream: self.stream,
+      clk: self.clk,
+      data: &self.data,
+    }
+  }
+}
+
+type Slot = (Address, Bytes32);
+
+/// The host of one execution of a transaction.
+///
+/// Storage is read through the writes of the transactions committed before it, and the slots
+/// read and written are recorded to detect conflicts. Log output is buffered, so that it reaches
+/// the host in block order.
+pub struct TxHost<'s, S> {
+  state: &'s S,
+  committed: &'s BTreeMap<Slot, Bytes32>,
+  /// The value of each slot at the start of the transaction, recorded when first accessed.
+  reads: RefCell<BTreeMap<Slot, Bytes32>>,
+  writes: BTreeMap<Slot, Bytes32>,
+  logs: Vec<TransactionLog>,
+  /// Whether the transaction called another account or read a balance, so that its execution
+  /// depends on state which isn't tracked and must be done serially.
+  serial: Cell<bool>,
+}
+
+impl<'s, S: BlockState> TxHost<'s, S> {
+  fn new(state: &'s S, committed: &'s BTreeMap<Slot, Bytes32>) -> Self {
+    Self {
+      state,
+      committed,
+      reads: RefCell::new(BTreeMap::new()),
+      writes: BTreeMap::new(),
+      logs: Vec::new(),
+      serial: Cell::new(false),
+    }
+  }
+
+  fn original(&self, slot: Slot) -> Bytes32 {
+    *self
+      .reads
+      .borrow_mut()
+      .entry(slot)
+      .or_insert_with(|| match self.committed.get(&slot) {
+        Some(value) => *value,
+        None => self.state.get_storage(&slot.0, &slot.1),
+      })
+  }
+}
+
+impl<S: BlockState> HostInterface for TxHost<'_, S> {
+  fn account_exists(&self, addr: &Address) -> bool {
+    self.state.account_exists(addr)
+  }
+
+  fn get_storage(&self, addr: &Address, key: &Bytes32) -> Bytes32 {
+    let slot = (*addr, *key);
+    match self.writes.get(&slot) {
+      Some(value) => *value,
+      None => self.original(slot),
+    }
+  }
+
+  fn set_storage(&mut self, addr: &Address, key: &Bytes32, value: &Bytes32) -> StorageStatus {
+    let slot = (*addr, *key);
+    let original = self.original(slot);
+    let current = self.writes.insert(slot, *value).unwrap_or(original);
+    storage_status(&original, &current, value)
+  }
+
+  fn log(&mut self, record: &LogRecord) {
+    self.logs.push(TransactionLog {
+      stream: record.stream,
+      clk: record.clk,
+      data: record.data.to_vec(),
+    });
+  }
+
+  fn get_balance(&self, addr: &Address) -> u64 {
+    self.serial.set(true);
+    self.state.get_balance(addr)
+  }
+
+  fn get_tx_context(&self) -> TransactionContext {
+    self.state.get_tx_context()
+  }
+
+  fn get_block_hash(&self, number: i64) -> Bytes32 {
+    self.state.get_block_hash(number)
+  }
+
+  // Calls to other contracts can't be made on the shared state. The execution is discarded and
+  // done again serially.
+  fn call(&mut self, _msg: AthenaMessage) -> ExecutionResult {
+    self.serial.set(true);
+    ExecutionResult::new(StatusCode::Failure, 0, None, None)
+  }
+}
+
+/// One execution of a transaction, with the slots it read and wrote and its log output.
+struct Execution {
+  result: ExecutionResult,
+  reads: BTreeMap<Slot, Bytes32>,
+  writes: BTreeMap<Slot, Bytes32>,
+  logs: Vec<TransactionLog>,
+  serial: bool,
+}
+
+impl Execution {
+  /// Whether the execution read the same values it would have read after the `committed`
+  /// writes.
+  fn is_valid(&self, committed: &BTreeMap<Slot, Bytes32>) -> bool {
+    self.reads.iter().all(|(slot, value)| {
+      committed
+        .get(slot)
+        .map_or(true, |committed| committed == value)
+    })
+  }
+}
+
+/// Executes the transactions of a block on several threads, with the same results as executing
+/// them one after the other.
+///
+/// All transactions are first executed optimistically on the state at the start of the block,
+/// each worker taking the next transaction left as soon as it is done with the previous one. The
+/// executions are then validated in block order: a transaction which read a slot since written
+/// by an earlier transaction is executed again, on the state including the writes of all the
+/// transactions before it.
+///
+/// Calls to other accounts and balances can't be tracked this way, so validation stops at the
+/// first transaction whose execution calls another account or reads a balance. Only the outputs
+/// of the transactions before it are returned, and the caller must execute it and the rest of
+/// the block serially, on the state including their writes.
+pub struct ParallelExecutor<'v, V> {
+  vm: &'v V,
+  threads: usize,
+}
+
+impl<'v, V: Sync> ParallelExecutor<'v, V> {
+  /// Creates an executor using one thread per available core.
+  pub fn new(vm: &'v V) -> Self {
+    let threads = thread::available_parallelism().map_or(1, NonZeroUsize::get);
+    Self::with_threads(vm, threads)
+  }
+
+  pub fn with_threads(vm: &'v V, threads: usize) -> Self {
+    Self {
+      vm,
+      threads: threads.max(1),
+    }
+  }
+
+  /// Executes `txs` with revision `rev`, returning the outputs of the transactions which could
+  /// be executed in parallel, in block order. There are fewer outputs than transactions if one
+  /// of them must be executed serially.
+  pub fn execute_block<S: BlockState>(
+    &self,
+    state: &S,
+    rev: u32,
+    txs: &[Transaction],
+  ) -> Vec<TransactionOutput>
+  where
+    V: for<'s> VmInterface<TxHost<'s, S>>,
+  {
+    let initial = BTreeMap::new();
+    let next = AtomicUsize::new(0);
+    let mut executions: Vec<Option<Execution>> =
+      std::iter::repeat_with(|| None).take(txs.len()).collect();
+    thread::scope(|scope| {
+      let workers: Vec<_> = (0..self.threads.min(txs.len()))
+        .map(|_| {
+          scope.spawn(|| {
+            let mut done = Vec::new();
+            loop {
+              let idx = next.fetch_add(1, Ordering::Relaxed);
+              let Some(tx) = txs.get(idx) else {
+                return done;
+              };
+              done.push((idx, self.run(state, &initial, rev, tx)));
+            }
+          })
+        })
+        .collect();
+      for worker in workers {
+        for (idx, execution) in worker.join().unwrap() {
+          executions[idx] = Some(execution);
+        }
+      }
+    });
+
+    let mut committed = BTreeMap::new();
+    let mut outputs = Vec::with_capacity(txs.len());
+    for (execution, tx) in executions.into_iter().zip(txs) {
+      let mut execution = execution.unwrap();
+      let reexecuted = !execution.is_valid(&committed);
+      if reexecuted {
+        execution = self.run(state, &committed, rev, tx);
+      }
+      if execution.serial {
+        break;
+      }
+      // The writes of failed transactions are left to the host to revert, so the transactions
+      // after them don't see them.
+      if execution.result.status_code == StatusCode::Success {
+        committed.extend(execution.writes.iter().map(|(slot, value)| (*slot, *value)));
+      }
+      outputs.push(TransactionOutput {
+        result: execution.result,
+        writes: execution
+          .writes
+          .into_iter()
+          .map(|((addr, key), value)| (addr, key, value))
+          .collect(),
+        logs: execution.logs,
+        reexecuted,
+      });
+    }
+    outputs
+  }
+
+  fn run<S: BlockState>(
+    &self,
+    state: &S,
+    committed: &BTreeMap<Slot, Bytes32>,
+    rev: u32,
+    tx: &Transaction,
+  ) -> Execution
+  where
+    V: for<'s> VmInterface<TxHost<'s, S>>,
+  {
+    let host = Arc::new(RefCell::new(HostProvider::new(TxHost::new(
+      state, committed,
+    ))));
+    let result = self.vm.execute(host.clone(), rev, tx.msg.clone(), tx.code);
+    let mut host = host.borrow_mut();
+    Execution {
+      result,
+      reads: host.reads.take(),
+      writes: std::mem::take(&mut host.writes),
+      logs: std::mem::take(&mut host.logs),
+      serial: host.serial.get(),
+    }
+  }
+}
+
+#[cfg(test)]
+mod tests {
+  use athena_interface::{Balance, MessageKind};
+  use athena_sdk::ProgramCache;
+
+  use super::*;
+  use crate::host::{AthenaCapability, AthenaOption, SetOptionError};
+  use crate::AthenaVm;
+
+  #[derive(Default)]
+  struct MapState(BTreeMap<Slot, Bytes32>);
+
+  impl BlockState for MapState {
+    fn account_exists(&self, _addr: &Address) -> bool {
+      true
+    }
+    fn get_storage(&self, addr: &Address, key: &Bytes32) -> Bytes32 {
+      self.0.get(&(*addr, *key)).copied().unwrap_or_default()
+    }
+    fn get_balance(&self, _addr: &Address) -> u64 {
+      0
+    }
+    fn get_tx_context(&self) -> TransactionContext {
+      unimplemented!()
+    }
+    fn get_block_hash(&self, _number: i64) -> Bytes32 {
+      Bytes32::default()
+    }
+  }
+
+  /// Increments a counter in the first slot of the recipient and logs its new value. Messages
+  /// carrying input data call another account first, and messages executed with a nonzero
+  /// revision fail after the increment.
+  struct CounterVm;
+
+  impl<T: HostInterface> VmInterface<T> for CounterVm {
+    fn get_capabilities(&self) -> Vec<AthenaCapability> {
+      vec![]
+    }
+
+    fn set_option(&self, _option: AthenaOption, _value: &str) -> Result<(), SetOptionError> {
+      Err(SetOptionError::InvalidKey)
+    }
+
+    fn execute(
+      &self,
+      host: Arc<RefCell<HostProvider<T>>>,
+      rev: u32,
+      msg: AthenaMessage,
+      _code: &[u8],
+    ) -> ExecutionResult {
+      if msg.input_data.is_some() {
+        host.borrow_mut().call(message(msg.recipient));
+      }
+      let key = Bytes32::default();
+      let mut value = host.borrow_mut().get_storage(&msg.recipient, &key);
+      value[0] += 1;
+      host.borrow_mut().set_storage(&msg.recipient, &key, &value);
+      host.borrow_mut().log(&LogRecord {
+        stream: LogStream::Stdout,
+        clk: 0,
+        data: &value[..1],
+      });
+      if rev != 0 {
+        return ExecutionResult::new(StatusCode::Failure, 0, None, None);
+      }
+      ExecutionResult::new(StatusCode::Success, msg.gas, None, None)
+    }
+  }
+
+  fn message(recipient: Address) -> AthenaMessage<'static> {
+    AthenaMessage::new(
+      MessageKind::Call,
+      0,
+      1_000_000,
+      recipient,
+      Address::default(),
+      None,
+      Balance::default(),
+      vec![],
+    )
+  }
+
+  #[test]
+  fn test_conflicting_transactions_are_reexecuted_in_order() {
+    let (counter, other) = ([1; 24], [2; 24]);
+    let mut txs: Vec<_> = (0..8)
+      .map(|_| Transaction {
+        msg: message(counter),
+        code: &[],
+      })
+      .collect();
+    txs.insert(
+      3,
+      Transaction {
+        msg: message(other),
+        code: &[],
+      },
+    );
+
+    let outputs =
+      ParallelExecutor::with_threads(&CounterVm, 4).execute_block(&MapState::default(), 0, &txs);
+
+    let mut count = 0;
+    for (idx, output) in outputs.iter().enumerate() {
+      let (addr, _, value) = output.writes[0];
+      if addr == counter {
+        count += 1;
+        assert_eq!(value[0], count);
+        // The log is that of the execution kept.
+        assert_eq!(output.logs[0].data, [count]);
+        // Every transaction but the first read the counter before it was incremented.
+        assert_eq!(output.reexecuted, idx > 0);
+      } else {
+        assert_eq!(value[0], 1);
+        assert!(!output.reexecuted);
+      }
+    }
+    assert_eq!(count, 8);
+  }
+
+  #[test]
+  fn test_execute_block_with_athena_vm() {
+    let code = include_bytes!("../../tests/host/elf/host-test");
+    // The program writes a slot and expects it to be assigned rather than added.
+    let key = std::array::from_fn(|i| if i % 4 == 0 { 2 } else { 0 });
+    let mut state = MapState::default();
+    state.0.insert((Address::default(), key), [1; 32]);
+    let txs: Vec<_> = (0..4)
+      .map(|_| Transaction {
+        msg: message(Address::default()),
+        code,
+      })
+      .collect();
+
+    let vm = AthenaVm::with_code_cache(Arc::new(ProgramCache::new(8)));
+    let outputs = ParallelExecutor::new(&vm).execute_block(&state, 0, &txs);
+    assert_eq!(outputs.len(), txs.len());
+    for output in outputs {
+      assert_eq!(output.result.status_code, StatusCode::Success);
+      assert_eq!(output.writes, [(Address::default(), key, [1; 32])]);
+      assert!(!output.reexecuted);
+      // The guest's output is kept for the host, as it would be delivered serially.
+      let stdout: Vec<u8> = output
+        .logs
+        .iter()
+        .filter(|log| log.stream == LogStream::Stdout)
+        .flat_map(|log| log.data.clone())
+        .collect();
+      assert_eq!(stdout, b"success\n");
+    }
+  }
+
+  #[test]
+  fn test_execution_stops_at_calls() {
+    let counter = [1; 24];
+    let mut txs: Vec<_> = (0..6)
+      .map(|_| Transaction {
+        msg: message(counter),
+        code: &[],
+      })
+      .collect();
+    txs[4].msg.input_data = Some(vec![1].into());
+
+    let executor = ParallelExecutor::with_threads(&CounterVm, 4);
+    let outputs = executor.execute_block(&MapState::default(), 0, &txs);
+    // The transactions from the one calling another account on are left to the caller.
+    assert_eq!(outputs.len(), 4);
+    assert_eq!(outputs[3].writes[0].2[0], 4);
+
+    // The revision is passed to the VM. The writes of failed transactions are handed to the
+    // host, but not seen by the transactions after them.
+    for output in executor.execute_block(&MapState::default(), 1, &txs[..2]) {
+      assert_eq!(output.result.status_code, StatusCode::Failure);
+      assert_eq!(output.writes[0].2[0], 1);
+      assert!(!output.reexecuted);
+    }
+  }
+}
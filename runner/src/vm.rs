@@ -1,8 +1,19 @@
-use std::{cell::RefCell, sync::Arc};
+use std::{
+  cell::RefCell,
+  sync::{
+    atomic::{AtomicBool, Ordering},
+    Arc, Mutex,
+  },
+};
 
 use crate::host::{AthenaCapability, AthenaOption, SetOptionError};
 use athena_interface::{AthenaMessage, ExecutionResult, HostInterface, HostProvider, StatusCode};
-use athena_sdk::{AthenaStdin, ExecutionClient};
+#[cfg(feature = "stats")]
+use athena_sdk::ExecutionStats;
+use athena_sdk::{
+  AthenaCoreOpts, AthenaStdin, ExecutionClient, ExecutionError, GuestLogMode, MemoryBackend,
+  ProgramCache, RuntimePool,
+};
 
 pub trait VmInterface<T: HostInterface> {
   fn get_capabilities(&self) -> Vec<AthenaCapability>;
@@ -18,14 +29,69 @@ pub trait VmInterface<T: HostInterface> {
 
 pub struct AthenaVm {
   client: ExecutionClient,
+  code_cache: Arc<ProgramCache>,
+  storage_cache: AtomicBool,
+  memory_limit: Mutex<Option<usize>>,
+  guest_log: Mutex<GuestLogMode>,
+  runtimes: RuntimePool,
 }
 
 impl AthenaVm {
+  /// The guest memory limit of each execution, by default.
+  pub const DEFAULT_MEMORY_LIMIT: usize = 128 << 20;
+
+  /// The number of bytes of guest log output kept per execution, by default.
+  pub const DEFAULT_GUEST_LOG_CAPACITY: usize = 64 << 10;
+
+  /// Creates a VM that shares the process-wide decoded program cache.
   pub fn new() -> Self {
+    Self::with_code_cache(ProgramCache::global())
+  }
+
+  /// Creates a VM that uses the given decoded program cache.
+  pub fn with_code_cache(code_cache: Arc<ProgramCache>) -> Self {
     AthenaVm {
       client: ExecutionClient::default(),
+      code_cache,
+      storage_cache: AtomicBool::new(false),
+      memory_limit: Mutex::new(Some(Self::DEFAULT_MEMORY_LIMIT)),
+      guest_log: Mutex::new(GuestLogMode::Buffer(Self::DEFAULT_GUEST_LOG_CAPACITY)),
+      runtimes: RuntimePool::default(),
     }
   }
+
+  pub fn code_cache(&self) -> &Arc<ProgramCache> {
+    &self.code_cache
+  }
+
+  pub fn storage_cache(&self) -> bool {
+    self.storage_cache.load(Ordering::Relaxed)
+  }
+
+  pub fn memory_limit(&self) -> Option<usize> {
+    *self.memory_limit.lock().unwrap()
+  }
+
+  pub fn guest_log(&self) -> GuestLogMode {
+    *self.guest_log.lock().unwrap()
+  }
+
+  /// The counters of the last execution made on the calling thread, by any VM.
+  #[cfg(feature = "stats")]
+  pub fn last_execution_stats() -> Option<ExecutionStats> {
+    LAST_STATS.with_borrow(Clone::clone)
+  }
+}
+
+#[cfg(feature = "stats")]
+thread_local! {
+  static LAST_STATS: RefCell<Option<ExecutionStats>> = const { RefCell::new(None) };
+}
+
+impl Default for AthenaVm {
+  fn default() -> Self {
+    Self::new()
+  }
 }
 
 impl<T> VmInterface<T> for AthenaVm
@@ -36,8 +102,57 @@ where
     vec![]
   }
 
-  fn set_option(&self, _option: AthenaOption, _value: &str) -> Result<(), SetOptionError> {
-    Err(SetOptionError::InvalidKey)
+  fn set_option(&self, option: AthenaOption, value: &str) -> Result<(), SetOptionError> {
+    match option {
+      AthenaOption::CodeCache => {
+        let capacity = match value {
+          "on" if self.code_cache.capacity() > 0 => self.code_cache.capacity(),
+          "on" => ProgramCache::DEFAULT_CAPACITY,
+          "off" => 0,
+          _ => value.parse().map_err(|_| SetOptionError::InvalidValue)?,
+        };
+        self.code_cache.set_capacity(capacity);
+        Ok(())
+      }
+      AthenaOption::CodeCacheDir => {
+        let dir = match value {
+          "off" => None,
+          _ => Some(value.into()),
+        };
+        self
+          .code_cache
+          .set_artifact_dir(dir)
+          .map_err(|_| SetOptionError::InvalidValue)
+      }
+      AthenaOption::StorageCache => {
+        let enabled = match value {
+          "on" => true,
+          "off" => false,
+          _ => return Err(SetOptionError::InvalidValue),
+        };
+        self.storage_cache.store(enabled, Ordering::Relaxed);
+        Ok(())
+      }
+      AthenaOption::MemoryLimit => {
+        *self.memory_limit.lock().unwrap() = match value {
+          "off" => None,
+          _ => Some(value.parse().map_err(|_| SetOptionError::InvalidValue)?),
+        };
+        Ok(())
+      }
+      AthenaOption::GuestLog => {
+        *self.guest_log.lock().unwrap() = match value {
+          "on" => GuestLogMode::Buffer(Self::DEFAULT_GUEST_LOG_CAPACITY),
+          "off" => GuestLogMode::Off,
+          _ => GuestLogMode::Buffer(value.parse().map_err(|_| SetOptionError::InvalidValue)?),
+        };
+        Ok(())
+      }
+      AthenaOption::Engine => match value {
+        "interpreter" => Ok(()),
+        _ => Err(SetOptionError::InvalidValue),
+      },
+    }
   }
 
   fn execute(
@@ -48,25 +163,84 @@ where
     // note: ignore _msg.code, should only be used on deploy
     code: &[u8],
   ) -> ExecutionResult {
-    let mut stdin = AthenaStdin::new();
-
-    // input data is optional
-    if let Some(input_data) = msg.input_data {
-      stdin.write_vec(input_data);
+    // input data is optional, and is read by the program straight from the message
+    let input_data = msg.input_data.as_deref();
+    let program = self.code_cache.get_or_decode(code);
+    // Executions are never proven, so guest memory only holds values.
+    let opts = AthenaCoreOpts {
+      memory_backend: MemoryBackend::Compact,
+      gas_limit: Some(msg.gas.max(0) as u64),
+      memory_limit: self.memory_limit(),
+      guest_log: self.guest_log(),
+    };
+    if self.storage_cache() {
+      host.borrow_mut().enable_storage_cache();
+    }
+    // Let the host load the declared storage slots before the execution asks for them.
+    host.borrow_mut().prefetch_storage(&msg.access_list);
+    #[cfg(not(feature = "stats"))]
+    let (result, metrics) = self.client.execute_program_pooled(
+      &self.runtimes,
+      program,
+      input_data.as_slice(),
+      AthenaStdin::new(),
+      Some(host.clone()),
+      opts,
+    );
+    #[cfg(feature = "stats")]
+    let (result, metrics, mut stats) = self.client.execute_program_pooled_with_stats(
+      &self.runtimes,
+      program,
+      input_data.as_slice(),
+      AthenaStdin::new(),
+      Some(host.clone()),
+      opts,
+    );
+    // Storage changes of failed executions are dropped from the cache, and otherwise left to the
+    // host to revert.
+    if result.is_ok() {
+      host.borrow_mut().commit_storage();
+    } else {
+      host.borrow_mut().discard_storage();
     }
-    let output = self.client.execute(&code, stdin, Some(host)).unwrap();
-    ExecutionResult::new(StatusCode::Success, 1337, Some(output.to_vec()), None)
+    #[cfg(feature = "stats")]
+    {
+      stats.prefetch = host.borrow_mut().take_prefetch_stats();
+      LAST_STATS.set(Some(stats));
+    }
+    let result = match result {
+      Ok((output, gas_left)) => ExecutionResult::new(
+        StatusCode::Success,
+        gas_left.unwrap_or_default() as i64,
+        Some(output.into_vec()),
+        None,
+      ),
+      // Failed executions consume all of their gas.
+      Err(err) => match err.downcast_ref::<ExecutionError>() {
+        Some(ExecutionError::OutOfGas()) => {
+          ExecutionResult::new(StatusCode::OutOfGas, 0, None, None)
+        }
+        Some(ExecutionError::OutOfMemory()) => {
+          ExecutionResult::new(StatusCode::OutOfMemory, 0, None, None)
+        }
+        _ => ExecutionResult::new(StatusCode::Failure, 0, None, None),
+      },
+    };
+    result.with_metrics(metrics)
   }
 }
 
 #[cfg(test)]
 mod tests {
-  use std::{cell::RefCell, sync::Arc};
+  use std::{cell::RefCell, collections::BTreeMap, sync::Arc};
 
   use super::*;
   use crate::host::MockHost;
   use crate::VmInterface;
-  use athena_interface::{Address, AthenaMessage, Balance, MessageKind, StatusCode};
+  use athena_interface::{
+    storage_status, Address, AthenaMessage, Balance, Bytes32, LogStream, MessageKind,
+    PrefetchStats, StatusCode, StorageSlot, StorageStatus, TransactionContext,
+  };
 
   struct MockVm {}
 
@@ -113,6 +287,395 @@ mod tests {
     }
   }
 
+  #[test]
+  fn test_set_code_cache_option() {
+    let vm = AthenaVm::with_code_cache(Arc::new(ProgramCache::new(8)));
+    let set_option =
+      |value: &str| VmInterface::<MockHost>::set_option(&vm, AthenaOption::CodeCache, value);
+
+    assert_eq!(set_option("off"), Ok(()));
+    assert_eq!(vm.code_cache().capacity(), 0);
+    assert_eq!(set_option("on"), Ok(()));
+    assert_eq!(vm.code_cache().capacity(), ProgramCache::DEFAULT_CAPACITY);
+    assert_eq!(set_option("16"), Ok(()));
+    assert_eq!(vm.code_cache().capacity(), 16);
+    assert_eq!(set_option("on"), Ok(()));
+    assert_eq!(vm.code_cache().capacity(), 16);
+    assert_eq!(set_option("lots"), Err(SetOptionError::InvalidValue));
+    assert_eq!("code_cache".parse(), Ok(AthenaOption::CodeCache));
+    assert_eq!(
+      "foo".parse::<AthenaOption>(),
+      Err(SetOptionError::InvalidKey)
+    );
+  }
+
+  #[test]
+  fn test_set_code_cache_dir_option() {
+    let vm = AthenaVm::with_code_cache(Arc::new(ProgramCache::new(8)));
+    let set_option =
+      |value: &str| VmInterface::<MockHost>::set_option(&vm, AthenaOption::CodeCacheDir, value);
+    let dir = std::env::temp_dir().join(format!("athena-code-cache-dir-{}", std::process::id()));
+    let code = include_bytes!("../../examples/hello_world/program/elf/hello-world-program");
+
+    assert_eq!(set_option(dir.to_str().unwrap()), Ok(()));
+    assert_eq!(vm.code_cache().artifact_dir(), Some(dir.clone()));
+    vm.code_cache().get_or_decode(code);
+    assert_eq!(std::fs::read_dir(&dir).unwrap().count(), 1);
+
+    // A file isn't a directory.
+    let file = std::fs::read_dir(&dir)
+      .unwrap()
+      .next()
+      .unwrap()
+      .unwrap()
+      .path();
+    assert_eq!(
+      set_option(file.to_str().unwrap()),
+      Err(SetOptionError::InvalidValue)
+    );
+    assert_eq!(set_option("off"), Ok(()));
+    assert_eq!(vm.code_cache().artifact_dir(), None);
+    assert_eq!("code_cache_dir".parse(), Ok(AthenaOption::CodeCacheDir));
+    std::fs::remove_dir_all(&dir).unwrap();
+  }
+
+  #[test]
+  fn test_execute_with_storage_cache() {
+    let code = include_bytes!("../../tests/host/elf/host-test");
+    let msg = AthenaMessage::new(
+      MessageKind::Call,
+      0,
+      1_000_000,
+      Address::default(),
+      Address::default(),
+      None,
+      Balance::default(),
+      vec![],
+    );
+    let vm = AthenaVm::with_code_cache(Arc::new(ProgramCache::new(8)));
+    let set_option =
+      |value: &str| VmInterface::<MockHost>::set_option(&vm, AthenaOption::StorageCache, value);
+    assert_eq!(set_option("maybe"), Err(SetOptionError::InvalidValue));
+    assert_eq!(set_option("on"), Ok(()));
+    assert!(vm.storage_cache());
+
+    // The program writes a slot and reads it back, expecting the write not to change the cost
+    // structure, so the slot already holds the value written.
+    let key = std::array::from_fn(|i| if i % 4 == 0 { 2 } else { 0 });
+    let mut mock_host = MockHost::new(None);
+    mock_host.set_storage(&Address::default(), &key, &[1u8; 32]);
+    let host = Arc::new(RefCell::new(HostProvider::new(mock_host)));
+    let result = vm.execute(host.clone(), 0, msg.clone(), code);
+    assert_eq!(result.status_code, StatusCode::Success);
+
+    // Written to an empty slot, the value is added rather than assigned, which fails the program.
+    // Its write doesn't reach the host.
+    let host = Arc::new(RefCell::new(HostProvider::new(MockHost::new(None))));
+    let result = vm.execute(host.clone(), 0, msg, code);
+    assert_eq!(result.status_code, StatusCode::Failure);
+    assert_eq!(
+      host.borrow().host().get_storage(&Address::default(), &key),
+      [0; 32]
+    );
+  }
+
+  /// A host computing storage statuses across the whole transaction, whose calls write to the
+  /// caller's storage.
+  #[derive(Default)]
+  struct ReentrantHost {
+    storage: BTreeMap<Bytes32, Bytes32>,
+    originals: BTreeMap<Bytes32, Bytes32>,
+  }
+
+  impl HostInterface for ReentrantHost {
+    fn account_exists(&self, _addr: &Address) -> bool {
+      true
+    }
+    fn get_storage(&self, _addr: &Address, key: &Bytes32) -> Bytes32 {
+      self.storage.get(key).copied().unwrap_or_default()
+    }
+    fn set_storage(&mut self, addr: &Address, key: &Bytes32, value: &Bytes32) -> StorageStatus {
+      let current = self.get_storage(addr, key);
+      let original = *self.originals.entry(*key).or_insert(current);
+      self.storage.insert(*key, *value);
+      storage_status(&original, &current, value)
+    }
+    fn get_balance(&self, _addr: &Address) -> u64 {
+      0
+    }
+    fn get_tx_context(&self) -> TransactionContext {
+      unimplemented!()
+    }
+    fn get_block_hash(&self, _number: i64) -> Bytes32 {
+      Bytes32::default()
+    }
+    fn call(&mut self, msg: AthenaMessage) -> ExecutionResult {
+      self.set_storage(&msg.recipient, &[1; 32], &[2; 32]);
+      ExecutionResult::new(StatusCode::Success, msg.gas, None, None)
+    }
+  }
+
+  #[test]
+  fn test_storage_cache_across_calls() {
+    let addr = Address::default();
+    let key = [1; 32];
+    let msg = AthenaMessage::new(
+      MessageKind::Call,
+      1,
+      1_000,
+      addr,
+      addr,
+      None,
+      Balance::default(),
+      vec![],
+    );
+    // Write a slot, call out to a callee changing it, and write it again.
+    let run = |storage_cache| {
+      let mut host = HostProvider::new(ReentrantHost::default());
+      if storage_cache {
+        host.enable_storage_cache();
+      }
+      let first = host.set_storage(&addr, &key, &[1; 32]);
+      assert_eq!(host.call(msg.clone()).status_code, StatusCode::Success);
+      let read = host.get_storage(&addr, &key);
+      let second = host.set_storage(&addr, &key, &[0; 32]);
+      host.commit_storage();
+      (first, read, second, host.host().storage.clone())
+    };
+    let (first, read, second, storage) = run(false);
+    assert_eq!(first, StorageStatus::StorageAdded);
+    assert_eq!(read, [2; 32]);
+    assert_eq!(second, StorageStatus::StorageAddedDeleted);
+    assert_eq!(run(true), (first, read, second, storage));
+  }
+
+  #[test]
+  fn test_storage_cache_discarded_after_call() {
+    let addr = Address::default();
+    let (key, other) = ([1; 32], [5; 32]);
+    let msg = AthenaMessage::new(
+      MessageKind::Call,
+      1,
+      1_000,
+      addr,
+      addr,
+      None,
+      Balance::default(),
+      vec![],
+    );
+    // Write a slot, call out to a callee changing another one, write again and fail.
+    let mut host = HostProvider::new(ReentrantHost::default());
+    host.enable_storage_cache();
+    host.set_storage(&addr, &other, &[1; 32]);
+    assert_eq!(host.call(msg).status_code, StatusCode::Success);
+    assert_eq!(host.host().storage[&other], [1; 32]);
+    host.set_storage(&addr, &other, &[3; 32]);
+    host.set_storage(&addr, &key, &[4; 32]);
+    host.discard_storage();
+
+    // The write flushed before the call is undone, and the later ones never reach the host.
+    // The callee's write is left to the host to revert.
+    assert_eq!(host.get_storage(&addr, &other), [0; 32]);
+    assert_eq!(host.get_storage(&addr, &key), [2; 32]);
+  }
+
+  #[test]
+  fn test_execute_prefetches_access_list() {
+    let code = include_bytes!("../../tests/host/elf/host-test");
+    let key = std::array::from_fn(|i| if i % 4 == 0 { 2 } else { 0 });
+    let slot = |key| StorageSlot {
+      address: Address::default(),
+      key,
+    };
+    let mut msg = AthenaMessage::new(
+      MessageKind::Call,
+      0,
+      1_000_000,
+      Address::default(),
+      Address::default(),
+      None,
+      Balance::default(),
+      vec![],
+    );
+    // The program only accesses the first slot.
+    msg.access_list = vec![slot(key), slot([9; 32])].into();
+    let vm = AthenaVm::with_code_cache(Arc::new(ProgramCache::new(8)));
+    VmInterface::<MockHost>::set_option(&vm, AthenaOption::StorageCache, "on").unwrap();
+
+    let mut mock_host = MockHost::new(None);
+    mock_host.set_storage(&Address::default(), &key, &[1u8; 32]);
+    let host = Arc::new(RefCell::new(HostProvider::new(mock_host)));
+    let result = vm.execute(host.clone(), 0, msg, code);
+    assert_eq!(result.status_code, StatusCode::Success);
+
+    #[cfg(feature = "stats")]
+    let stats = AthenaVm::last_execution_stats().unwrap().prefetch;
+    #[cfg(not(feature = "stats"))]
+    let stats = host.borrow_mut().take_prefetch_stats();
+    assert_eq!(
+      stats,
+      PrefetchStats {
+        prefetched: 2,
+        hits: 1,
+        misses: 0
+      }
+    );
+  }
+
+  #[test]
+  fn test_execute_uses_code_cache() {
+    let vm = AthenaVm::with_code_cache(Arc::new(ProgramCache::new(8)));
+    let code = include_bytes!("../../examples/hello_world/program/elf/hello-world-program");
+    let host = Arc::new(RefCell::new(HostProvider::new(MockHost::new(None))));
+    let msg = AthenaMessage::new(
+      MessageKind::Call,
+      0,
+      1_000_000,
+      Address::default(),
+      Address::default(),
+      None,
+      Balance::default(),
+      vec![],
+    );
+
+    for _ in 0..2 {
+      let result = vm.execute(host.clone(), 0, msg.clone(), code);
+      assert_eq!(result.status_code, StatusCode::Success);
+    }
+    let stats = vm.code_cache().stats();
+    assert_eq!(stats.misses, 1);
+    assert_eq!(stats.hits, 1);
+  }
+
+  #[test]
+  fn test_execute_meters_gas() {
+    let vm = AthenaVm::with_code_cache(Arc::new(ProgramCache::new(8)));
+    let code = include_bytes!("../../examples/hello_world/program/elf/hello-world-program");
+    let execute = |gas| {
+      let host = Arc::new(RefCell::new(HostProvider::new(MockHost::new(None))));
+      let msg = AthenaMessage::new(
+        MessageKind::Call,
+        0,
+        gas,
+        Address::default(),
+        Address::default(),
+        None,
+        Balance::default(),
+        vec![],
+      );
+      vm.execute(host, 0, msg, code)
+    };
+
+    let result = execute(1_000_000);
+    assert_eq!(result.status_code, StatusCode::Success);
+    assert!(result.gas_left > 0 && result.gas_left < 1_000_000);
+
+    // Every instruction costs gas, and syscalls more.
+    let gas_used = 1_000_000 - result.gas_left;
+    let metrics = result.metrics.unwrap();
+    assert!(metrics.cycles > 0 && metrics.cycles <= gas_used as u64);
+    assert!(metrics.syscalls > 0);
+    assert!(metrics.peak_memory > 0);
+
+    // Exactly the gas used is enough.
+    let result = execute(gas_used);
+    assert_eq!(result.status_code, StatusCode::Success);
+    assert_eq!(result.gas_left, 0);
+
+    let result = execute(gas_used - 1);
+    assert_eq!(result.status_code, StatusCode::OutOfGas);
+    assert_eq!(result.gas_left, 0);
+    assert_eq!(result.output, None);
+    // Failed executions report what they ran.
+    assert!(result.metrics.unwrap().cycles <= metrics.cycles);
+  }
+
+  #[test]
+  fn test_execute_memory_limit() {
+    let vm = AthenaVm::with_code_cache(Arc::new(ProgramCache::new(8)));
+    let code = include_bytes!("../../examples/hello_world/program/elf/hello-world-program");
+    let set_option =
+      |value: &str| VmInterface::<MockHost>::set_option(&vm, AthenaOption::MemoryLimit, value);
+    let execute = || {
+      let host = Arc::new(RefCell::new(HostProvider::new(MockHost::new(None))));
+      let msg = AthenaMessage::new(
+        MessageKind::Call,
+        0,
+        1_000_000,
+        Address::default(),
+        Address::default(),
+        None,
+        Balance::default(),
+        vec![],
+      );
+      vm.execute(host, 0, msg, code)
+    };
+
+    assert_eq!(vm.memory_limit(), Some(AthenaVm::DEFAULT_MEMORY_LIMIT));
+    assert_eq!(execute().status_code, StatusCode::Success);
+
+    assert_eq!(set_option("4096"), Ok(()));
+    let result = execute();
+    assert_eq!(result.status_code, StatusCode::OutOfMemory);
+    assert_eq!(result.gas_left, 0);
+
+    assert_eq!(set_option("off"), Ok(()));
+    assert_eq!(vm.memory_limit(), None);
+    assert_eq!(execute().status_code, StatusCode::Success);
+    assert_eq!(set_option("lots"), Err(SetOptionError::InvalidValue));
+    assert_eq!("memory_limit".parse(), Ok(AthenaOption::MemoryLimit));
+  }
+
+  #[test]
+  fn test_execute_delivers_guest_log() {
+    let vm = AthenaVm::with_code_cache(Arc::new(ProgramCache::new(8)));
+    let code = include_bytes!("../../examples/hello_world/program/elf/hello-world-program");
+    let set_option =
+      |value: &str| VmInterface::<MockHost>::set_option(&vm, AthenaOption::GuestLog, value);
+    let execute = || {
+      let host = Arc::new(RefCell::new(HostProvider::new(MockHost::new(None))));
+      let msg = AthenaMessage::new(
+        MessageKind::Call,
+        0,
+        1_000_000,
+        Address::default(),
+        Address::default(),
+        None,
+        Balance::default(),
+        vec![],
+      );
+      let result = vm.execute(host.clone(), 0, msg, code);
+      assert_eq!(result.status_code, StatusCode::Success);
+      let log = host.borrow().host().log.clone();
+      log
+    };
+
+    let stdout: Vec<u8> = execute()
+      .into_iter()
+      .filter(|(stream, _)| *stream == LogStream::Stdout)
+      .flat_map(|(_, data)| data)
+      .collect();
+    assert_eq!(stdout, b"Hello, world!\n");
+
+    assert_eq!(set_option("off"), Ok(()));
+    assert!(execute().is_empty());
+    assert_eq!(set_option("1024"), Ok(()));
+    assert_eq!(vm.guest_log(), GuestLogMode::Buffer(1024));
+    assert_eq!(set_option("loud"), Err(SetOptionError::InvalidValue));
+    assert_eq!("guest_log".parse(), Ok(AthenaOption::GuestLog));
+  }
+
+  #[test]
+  fn test_set_engine() {
+    let vm = AthenaVm::with_code_cache(Arc::new(ProgramCache::new(8)));
+    let set_option =
+      |value: &str| VmInterface::<MockHost>::set_option(&vm, AthenaOption::Engine, value);
+    assert_eq!(set_option("interpreter"), Ok(()));
+    // No compiling engine is available.
+    assert_eq!(set_option("jit"), Err(SetOptionError::InvalidValue));
+    assert_eq!("engine".parse(), Ok(AthenaOption::Engine));
+  }
+
   #[test]
   fn test_vm() {
     // construct a mock host
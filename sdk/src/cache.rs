@@ -0,0 +1,319 @@
+//! A process-wide cache of decoded programs.
+//!
+//! Parsing an ELF and transpiling every instruction is a fixed cost paid on every execution of the
+//! same code. The cache below keeps recently used programs keyed by a hash of their code so that
+//! repeated calls into the same contract can skip straight to execution.
+//!
+//! With an artifact directory, decoded programs are also kept on disk as program artifacts named
+//! after the Keccak-256 hash of their code, so that a new process loads them without decoding.
+
+use std::collections::hash_map::DefaultHasher;
+use std::collections::HashMap;
+use std::hash::{Hash, Hasher};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, OnceLock};
+
+use athena_core::runtime::Program;
+use athena_core::syscall::keccak256;
+
+/// A snapshot of the cache counters.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct ProgramCacheStats {
+  /// The number of lookups served from the cache.
+  pub hits: u64,
+
+  /// The number of lookups that had to decode the program.
+  pub misses: u64,
+
+  /// The number of misses served from an artifact file instead of decoding the program.
+  pub artifact_loads: u64,
+
+  /// The number of programs currently cached.
+  pub entries: usize,
+
+  /// The maximum number of programs the cache may hold (zero when disabled).
+  pub capacity: usize,
+}
+
+struct CacheEntry {
+  /// The code the program was decoded from, compared on lookup so a hash collision can never
+  /// return the wrong program.
+  code: Box<[u8]>,
+  program: Arc<Program>,
+  last_used: u64,
+}
+
+struct CacheInner {
+  capacity: usize,
+  tick: u64,
+  entries: HashMap<u64, CacheEntry>,
+  artifact_dir: Option<PathBuf>,
+}
+
+/// A bounded, thread-safe cache of decoded programs keyed by a hash of their code.
+///
+/// When full, the least recently used program is evicted. A capacity of zero disables the cache.
+pub struct ProgramCache {
+  inner: Mutex<CacheInner>,
+  hits: AtomicU64,
+  misses: AtomicU64,
+  artifact_loads: AtomicU64,
+}
+
+static GLOBAL_CACHE: OnceLock<Arc<ProgramCache>> = OnceLock::new();
+
+impl ProgramCache {
+  /// The number of programs cached by default.
+  pub const DEFAULT_CAPACITY: usize = 256;
+
+  /// Creates a new cache holding at most `capacity` programs.
+  pub fn new(capacity: usize) -> Self {
+    Self {
+      inner: Mutex::new(CacheInner {
+        capacity,
+        tick: 0,
+        entries: HashMap::new(),
+        artifact_dir: None,
+      }),
+      hits: AtomicU64::new(0),
+      misses: AtomicU64::new(0),
+      artifact_loads: AtomicU64::new(0),
+    }
+  }
+
+  /// Returns the cache shared by every VM instance in this process.
+  pub fn global() -> Arc<ProgramCache> {
+    GLOBAL_CACHE
+      .get_or_init(|| Arc::new(ProgramCache::new(Self::DEFAULT_CAPACITY)))
+      .clone()
+  }
+
+  /// Returns the decoded program for `code`, decoding and caching it if necessary.
+  pub fn get_or_decode(&self, code: &[u8]) -> Arc<Program> {
+    let key = Self::hash_code(code);
+    let artifact_dir = {
+      let mut inner = self.inner.lock().unwrap();
+      if inner.capacity == 0 {
+        drop(inner);
+        return Arc::new(Program::from(code));
+      }
+      inner.tick += 1;
+      let tick = inner.tick;
+      if let Some(entry) = inner.entries.get_mut(&key) {
+        if *entry.code == *code {
+          entry.last_used = tick;
+          self.hits.fetch_add(1, Ordering::Relaxed);
+          return entry.program.clone();
+        }
+      }
+      inner.artifact_dir.clone()
+    };
+
+    // Decode without holding the lock so that misses on different programs don't serialize.
+    self.misses.fetch_add(1, Ordering::Relaxed);
+    let program = Arc::new(self.load(code, artifact_dir.as_deref()));
+
+    let mut inner = self.inner.lock().unwrap();
+    if inner.capacity == 0 {
+      return program;
+    }
+    if !inner.entries.contains_key(&key) && inner.entries.len() >= inner.capacity {
+      Self::evict_lru(&mut inner);
+    }
+    let last_used = inner.tick;
+    inner.entries.insert(
+      key,
+      CacheEntry {
+        code: code.into(),
+        program: program.clone(),
+        last_used,
+      },
+    );
+    program
+  }
+
+  /// Sets the maximum number of cached programs, evicting as needed. Zero disables the cache.
+  pub fn set_capacity(&self, capacity: usize) {
+    let mut inner = self.inner.lock().unwrap();
+    inner.capacity = capacity;
+    while inner.entries.len() > capacity {
+      Self::evict_lru(&mut inner);
+    }
+  }
+
+  /// Returns the maximum number of cached programs.
+  pub fn capacity(&self) -> usize {
+    self.inner.lock().unwrap().capacity
+  }
+
+  /// Sets the directory where programs are kept as artifacts across processes, or `None` to
+  /// only decode programs in memory. The directory is created if necessary.
+  pub fn set_artifact_dir(&self, dir: Option<PathBuf>) -> std::io::Result<()> {
+    if let Some(dir) = &dir {
+      std::fs::create_dir_all(dir)?;
+    }
+    self.inner.lock().unwrap().artifact_dir = dir;
+    Ok(())
+  }
+
+  /// Returns the directory where programs are kept as artifacts, if any.
+  pub fn artifact_dir(&self) -> Option<PathBuf> {
+    self.inner.lock().unwrap().artifact_dir.clone()
+  }
+
+  /// Removes every cached program. The hit and miss counters are preserved.
+  pub fn clear(&self) {
+    self.inner.lock().unwrap().entries.clear();
+  }
+
+  /// Returns a snapshot of the cache counters.
+  pub fn stats(&self) -> ProgramCacheStats {
+    let inner = self.inner.lock().unwrap();
+    ProgramCacheStats {
+      hits: self.hits.load(Ordering::Relaxed),
+      misses: self.misses.load(Ordering::Relaxed),
+      artifact_loads: self.artifact_loads.load(Ordering::Relaxed),
+      entries: inner.entries.len(),
+      capacity: inner.capacity,
+    }
+  }
+
+  /// Loads the program for `code` from its artifact in `dir`, or decodes it and writes the
+  /// artifact there. A missing, outdated or invalid artifact is replaced, and failing to write one
+  /// only costs decoding the program again in the next process.
+  fn load(&self, code: &[u8], dir: Option<&Path>) -> Program {
+    let Some(dir) = dir else {
+      return Program::from(code);
+    };
+    let path = dir.join(format!("{}.athp", hex::encode(keccak256(code))));
+    if let Ok(program) = Program::from_artifact_file(&path) {
+      self.artifact_loads.fetch_add(1, Ordering::Relaxed);
+      return program;
+    }
+    let program = Program::from(code);
+    // Write a temporary file and rename it, so that other loads never read a partial artifact.
+    static TEMP_FILES: AtomicU64 = AtomicU64::new(0);
+    let temp = path.with_extension(format!(
+      "{}-{}.tmp",
+      std::process::id(),
+      TEMP_FILES.fetch_add(1, Ordering::Relaxed)
+    ));
+    if std::fs::write(&temp, program.to_artifact())
+      .and_then(|_| std::fs::rename(&temp, &path))
+      .is_err()
+    {
+      let _ = std::fs::remove_file(&temp);
+    }
+    program
+  }
+
+  fn hash_code(code: &[u8]) -> u64 {
+    let mut hasher = DefaultHasher::new();
+    code.hash(&mut hasher);
+    hasher.finish()
+  }
+
+  fn evict_lru(inner: &mut CacheInner) {
+    let oldest = inner
+      .entries
+      .iter()
+      .min_by_key(|(_, entry)| entry.last_used)
+      .map(|(key, _)| *key);
+    if let Some(key) = oldest {
+      inner.entries.remove(&key);
+    }
+  }
+}
+
+impl Default for ProgramCache {
+  fn default() -> Self {
+    Self::new(Self::DEFAULT_CAPACITY)
+  }
+}
+
+#[cfg(test)]
+mod tests {
+  use std::sync::Arc;
+
+  use athena_core::runtime::Program;
+
+  use super::ProgramCache;
+
+  const FIBONACCI_ELF: &[u8] =
+    include_bytes!("../../examples/fibonacci/program/elf/fibonacci-program");
+  const HELLO_WORLD_ELF: &[u8] =
+    include_bytes!("../../examples/hello_world/program/elf/hello-world-program");
+
+  #[test]
+  fn test_cache_hit_returns_same_program() {
+    let cache = ProgramCache::new(4);
+    let first = cache.get_or_decode(FIBONACCI_ELF);
+    let second = cache.get_or_decode(FIBONACCI_ELF);
+    assert!(Arc::ptr_eq(&first, &second));
+
+    let stats = cache.stats();
+    assert_eq!(stats.hits, 1);
+    assert_eq!(stats.misses, 1);
+    assert_eq!(stats.entries, 1);
+  }
+
+  #[test]
+  fn test_cache_evicts_least_recently_used() {
+    let cache = ProgramCache::new(1);
+    let fibonacci = cache.get_or_decode(FIBONACCI_ELF);
+    cache.get_or_decode(HELLO_WORLD_ELF);
+    assert_eq!(cache.stats().entries, 1);
+
+    // fibonacci was evicted, so this decodes it again.
+    let again = cache.get_or_decode(FIBONACCI_ELF);
+    assert!(!Arc::ptr_eq(&fibonacci, &again));
+    assert_eq!(cache.stats().misses, 3);
+  }
+
+  #[test]
+  fn test_cache_disabled() {
+    let cache = ProgramCache::new(2);
+    cache.get_or_decode(FIBONACCI_ELF);
+    cache.set_capacity(0);
+    assert_eq!(cache.stats().entries, 0);
+
+    let first = cache.get_or_decode(FIBONACCI_ELF);
+    let second = cache.get_or_decode(FIBONACCI_ELF);
+    assert!(!Arc::ptr_eq(&first, &second));
+    assert_eq!(cache.stats().entries, 0);
+    assert_eq!(cache.stats().hits, 0);
+  }
+
+  #[test]
+  fn test_cache_loads_artifacts() {
+    let dir = std::env::temp_dir().join(format!("athena-program-cache-{}", std::process::id()));
+    let cache = ProgramCache::new(4);
+    cache.set_artifact_dir(Some(dir.clone())).unwrap();
+    let decoded = cache.get_or_decode(FIBONACCI_ELF);
+    assert_eq!(cache.stats().artifact_loads, 0);
+
+    // Another process, or a cache without the program, loads the artifact written above.
+    let other = ProgramCache::new(4);
+    other.set_artifact_dir(Some(dir.clone())).unwrap();
+    let loaded = other.get_or_decode(FIBONACCI_ELF);
+    assert_eq!(other.stats().artifact_loads, 1);
+    assert_eq!(loaded.instructions, decoded.instructions);
+    assert_eq!(loaded.pc_start, decoded.pc_start);
+
+    // An invalid artifact is replaced.
+    let artifacts: Vec<_> = std::fs::read_dir(&dir)
+      .unwrap()
+      .map(|entry| entry.unwrap().path())
+      .collect();
+    assert_eq!(artifacts.len(), 1);
+    std::fs::write(&artifacts[0], b"ATHP").unwrap();
+    let fresh = ProgramCache::new(4);
+    fresh.set_artifact_dir(Some(dir.clone())).unwrap();
+    fresh.get_or_decode(FIBONACCI_ELF);
+    assert_eq!(fresh.stats().artifact_loads, 0);
+    assert!(Program::from_artifact_file(&artifacts[0]).is_ok());
+
+    std::fs::remove_dir_all(&dir).unwrap();
+  }
+}
@@ -5,6 +5,8 @@
 #![allow(incomplete_features)]
 #![feature(generic_const_exprs)]
 
+mod cache;
+
 pub mod utils {
   pub use athena_core::utils::setup_logger;
 }
@@ -14,9 +16,13 @@ use std::sync::Arc;
 
 use anyhow::{Ok, Result};
 pub use athena_core::io::{AthenaPublicValues, AthenaStdin};
+#[cfg(feature = "stats")]
+pub use athena_core::runtime::ExecutionStats;
+pub use athena_core::runtime::{ExecutionError, GuestLogMode, MemoryBackend, RuntimePool};
 use athena_core::runtime::{Program, Runtime};
-use athena_core::utils::AthenaCoreOpts;
-use athena_interface::{HostInterface, HostProvider};
+pub use athena_core::utils::AthenaCoreOpts;
+use athena_interface::{ExecutionMetrics, HostInterface, HostProvider};
+pub use cache::{ProgramCache, ProgramCacheStats};
 
 /// A client for interacting with Athena.
 pub struct ExecutionClient;
@@ -64,13 +70,105 @@ impl ExecutionClient {
     stdin: AthenaStdin,
     host: Option<Arc<RefCell<HostProvider<T>>>>,
   ) -> Result<AthenaPublicValues> {
-    let program = Program::from(elf);
-    let opts = AthenaCoreOpts::default();
+    self.execute_program(Arc::new(Program::from(elf)), stdin, host)
+  }
+
+  /// Executes an already decoded program on the given input.
+  ///
+  /// This skips parsing the ELF, which makes it the entrypoint to use together with a
+  /// [ProgramCache].
+  pub fn execute_program<T: HostInterface>(
+    &self,
+    program: Arc<Program>,
+    stdin: AthenaStdin,
+    host: Option<Arc<RefCell<HostProvider<T>>>>,
+  ) -> Result<AthenaPublicValues> {
+    // Executions only produce values, so guest memory doesn't need access records.
+    let opts = AthenaCoreOpts {
+      memory_backend: MemoryBackend::Compact,
+      ..Default::default()
+    };
+    let (public_values, _) = self.execute_program_with_opts(program, stdin, host, opts)?;
+    Ok(public_values)
+  }
+
+  /// Executes an already decoded program on the given input, with the given runtime options.
+  ///
+  /// Returns the public values together with the gas left, if execution was metered (see
+  /// [AthenaCoreOpts::gas_limit]).
+  pub fn execute_program_with_opts<T: HostInterface>(
+    &self,
+    program: Arc<Program>,
+    stdin: AthenaStdin,
+    host: Option<Arc<RefCell<HostProvider<T>>>>,
+    opts: AthenaCoreOpts,
+  ) -> Result<(AthenaPublicValues, Option<u64>)> {
     let mut runtime = Runtime::new(program, host, opts);
-    runtime.write_vecs(&stdin.buffer);
-    runtime.run_untraced()?;
-    Ok(AthenaPublicValues::from(
-      &runtime.state.public_values_stream,
+    Self::run(&mut runtime, stdin, &[])
+  }
+
+  /// Executes an already decoded program like [ExecutionClient::execute_program_with_opts], on a
+  /// runtime taken from (and returned to) `pool`.
+  ///
+  /// `input` is read by the program ahead of `stdin`. It is borrowed rather than copied into the
+  /// runtime, so hint reads copy it only once, straight into guest memory.
+  ///
+  /// The measured cost of the execution is returned too, whether it succeeded or not.
+  pub fn execute_program_pooled<T: HostInterface>(
+    &self,
+    pool: &RuntimePool,
+    program: Arc<Program>,
+    input: &[&[u8]],
+    stdin: AthenaStdin,
+    host: Option<Arc<RefCell<HostProvider<T>>>>,
+    opts: AthenaCoreOpts,
+  ) -> (Result<(AthenaPublicValues, Option<u64>)>, ExecutionMetrics) {
+    let mut runtime = pool.acquire(program, host, opts);
+    let result = Self::run(&mut runtime, stdin, input);
+    let metrics = runtime.metrics();
+    pool.release(runtime);
+    (result, metrics)
+  }
+
+  /// Executes a program like [ExecutionClient::execute_program_pooled], also returning the
+  /// counters of the execution.
+  #[cfg(feature = "stats")]
+  pub fn execute_program_pooled_with_stats<T: HostInterface>(
+    &self,
+    pool: &RuntimePool,
+    program: Arc<Program>,
+    input: &[&[u8]],
+    stdin: AthenaStdin,
+    host: Option<Arc<RefCell<HostProvider<T>>>>,
+    opts: AthenaCoreOpts,
+  ) -> (
+    Result<(AthenaPublicValues, Option<u64>)>,
+    ExecutionMetrics,
+    ExecutionStats,
+  ) {
+    let mut runtime = pool.acquire(program, host, opts);
+    let result = Self::run(&mut runtime, stdin, input);
+    let metrics = runtime.metrics();
+    let stats = runtime.take_stats();
+    pool.release(runtime);
+    (result, metrics, stats)
+  }
+
+  fn run<T: HostInterface>(
+    runtime: &mut Runtime<T>,
+    stdin: AthenaStdin,
+    input: &[&[u8]],
+  ) -> Result<(AthenaPublicValues, Option<u64>)> {
+    runtime.state.input_stream.extend(stdin.buffer);
+    let result = runtime.run_fast_with_input(input);
+    // The log of a failed execution is delivered too, as it shows what went wrong.
+    runtime.flush_log();
+    result?;
+    // The output is moved out rather than copied, so it's only copied once, from guest memory.
+    let public_values = std::mem::take(&mut runtime.state.public_values_stream);
+    Ok((
+      AthenaPublicValues::from_vec(public_values),
+      runtime.gas_left,
     ))
   }
 }
@@ -1,12 +1,35 @@
 use core::alloc::{GlobalAlloc, Layout};
+use core::cell::UnsafeCell;
+use core::ptr;
 
+#[cfg(not(test))]
 use crate::syscalls::sys_alloc_aligned;
 
+// Tests run on the host, which has no guest heap.
+#[cfg(test)]
+unsafe fn sys_alloc_aligned(bytes: usize, align: usize) -> *mut u8 {
+    std::alloc::alloc(Layout::from_size_align(bytes, align).unwrap())
+}
+
+/// The allocator installed by [entrypoint](crate::entrypoint): [FreeListAlloc] with the
+/// `free-list` feature, [SimpleAlloc] otherwise.
+#[cfg(not(feature = "free-list"))]
+pub type HeapAlloc = SimpleAlloc;
+#[cfg(feature = "free-list")]
+pub type HeapAlloc = FreeListAlloc;
+
 /// A simple heap allocator.
 ///
 /// Allocates memory from left to right, without any deallocation.
+#[derive(Default)]
 pub struct SimpleAlloc;
 
+impl SimpleAlloc {
+    pub const fn new() -> Self {
+        Self
+    }
+}
+
 unsafe impl GlobalAlloc for SimpleAlloc {
     unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
         sys_alloc_aligned(layout.size(), layout.align())
@@ -14,3 +37,166 @@ unsafe impl GlobalAlloc for SimpleAlloc {
 
     unsafe fn dealloc(&self, _: *mut u8, _: Layout) {}
 }
+
+/// The size of the smallest block, which must hold the pointer to the next free block.
+const MIN_BLOCK_SHIFT: u32 = 3;
+const MIN_BLOCK: usize = 1 << MIN_BLOCK_SHIFT;
+/// The number of size classes, enough for blocks as large as the address space.
+const NUM_CLASSES: usize = (usize::BITS - MIN_BLOCK_SHIFT) as usize;
+
+/// A heap allocator reusing freed memory.
+///
+/// Allocations are rounded up to a power of two of at least 8 bytes, their size class, and fail
+/// if that power of two doesn't fit in a `usize`. Freed blocks are put at the front of the free
+/// list of their class, and an allocation takes the first block of its class it can use before
+/// taking new memory from the heap. Blocks are never split or merged, so the allocator only
+/// ever does a few operations per call, and the addresses returned only depend on the sequence
+/// of calls.
+///
+/// Compared to [SimpleAlloc], programs which repeatedly build and drop collections touch much
+/// less memory, at the cost of wasting up to half of each block.
+pub struct FreeListAlloc {
+    /// The first free block of each size class, or null. The first word of a free block points
+    /// to the next free block of its class.
+    free: UnsafeCell<[*mut u8; NUM_CLASSES]>,
+}
+
+// SAFETY: The VM is single threaded.
+unsafe impl Sync for FreeListAlloc {}
+
+impl FreeListAlloc {
+    pub const fn new() -> Self {
+        Self {
+            free: UnsafeCell::new([ptr::null_mut(); NUM_CLASSES]),
+        }
+    }
+
+    /// The size class of blocks of `size` bytes aligned to `align`, and their size, or `None` if
+    /// they would be larger than the address space.
+    fn class(size: usize, align: usize) -> Option<(usize, usize)> {
+        let size = size.max(align).max(MIN_BLOCK).checked_next_power_of_two()?;
+        Some(((size.trailing_zeros() - MIN_BLOCK_SHIFT) as usize, size))
+    }
+}
+
+impl Default for FreeListAlloc {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+unsafe impl GlobalAlloc for FreeListAlloc {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        let Some((class, size)) = Self::class(layout.size(), layout.align()) else {
+            return ptr::null_mut();
+        };
+        let head = &mut (*self.free.get())[class];
+        // Blocks are aligned to at least MIN_BLOCK, more alignment has to be checked.
+        let block = *head;
+        if !block.is_null() && (block as usize) & (layout.align() - 1) == 0 {
+            *head = *(block as *mut *mut u8);
+            return block;
+        }
+        sys_alloc_aligned(size, layout.align().max(MIN_BLOCK))
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        // The layout was allocated, so its class exists.
+        let Some((class, _)) = Self::class(layout.size(), layout.align()) else {
+            return;
+        };
+        let head = &mut (*self.free.get())[class];
+        *(ptr as *mut *mut u8) = *head;
+        *head = ptr;
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        let Some((new_class, _)) = Self::class(new_size, layout.align()) else {
+            return ptr::null_mut();
+        };
+        if Self::class(layout.size(), layout.align()).map(|(class, _)| class) == Some(new_class) {
+            return ptr;
+        }
+        let new_layout = Layout::from_size_align_unchecked(new_size, layout.align());
+        let new_ptr = self.alloc(new_layout);
+        if !new_ptr.is_null() {
+            ptr::copy_nonoverlapping(ptr, new_ptr, layout.size().min(new_size));
+            self.dealloc(ptr, layout);
+        }
+        new_ptr
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_size_classes() {
+        assert_eq!(FreeListAlloc::class(1, 1), Some((0, 8)));
+        assert_eq!(FreeListAlloc::class(9, 4), Some((1, 16)));
+        assert_eq!(FreeListAlloc::class(8, 64), Some((3, 64)));
+        assert_eq!(FreeListAlloc::class(1 << 31, 1), Some((28, 1 << 31)));
+        // Blocks larger than the address space can't be allocated.
+        assert_eq!(FreeListAlloc::class(usize::MAX / 2 + 2, 1), None);
+        assert_eq!(FreeListAlloc::class(usize::MAX, 1), None);
+    }
+
+    #[test]
+    fn test_freed_blocks_are_reused() {
+        let heap = FreeListAlloc::new();
+        let layout = Layout::from_size_align(24, 8).unwrap();
+        unsafe {
+            let a = heap.alloc(layout);
+            let b = heap.alloc(layout);
+            assert_ne!(a, b);
+            heap.dealloc(a, layout);
+            heap.dealloc(b, layout);
+            // The last block freed is reused first, for any size of its class.
+            assert_eq!(heap.alloc(Layout::from_size_align(32, 1).unwrap()), b);
+            assert_eq!(heap.alloc(layout), a);
+            // Smaller sizes have their own class.
+            let small = heap.alloc(Layout::from_size_align(8, 8).unwrap());
+            assert!(small != a && small != b);
+        }
+    }
+
+    #[test]
+    fn test_alignment_is_kept() {
+        let heap = FreeListAlloc::new();
+        let unaligned = Layout::from_size_align(64, 8).unwrap();
+        let aligned = Layout::from_size_align(64, 64).unwrap();
+        unsafe {
+            // Find a free block which isn't aligned to 64 bytes.
+            let mut block = heap.alloc(unaligned);
+            while block as usize % 64 == 0 {
+                block = heap.alloc(unaligned);
+            }
+            heap.dealloc(block, unaligned);
+            let other = heap.alloc(aligned);
+            assert_ne!(other, block);
+            assert_eq!(other as usize % 64, 0);
+            assert_eq!(heap.alloc(unaligned), block);
+        }
+    }
+
+    #[test]
+    fn test_realloc() {
+        let heap = FreeListAlloc::new();
+        let layout = Layout::from_size_align(10, 1).unwrap();
+        unsafe {
+            let block = heap.alloc(layout);
+            block.copy_from_nonoverlapping([1, 2, 3, 4, 5, 6, 7, 8, 9, 10].as_ptr(), 10);
+            // Growing within the class keeps the block.
+            assert_eq!(heap.realloc(block, layout, 16), block);
+            let grown = heap.realloc(block, Layout::from_size_align(16, 1).unwrap(), 100);
+            assert_ne!(grown, block);
+            assert_eq!(*grown.add(9), 10);
+            // The old block was freed.
+            assert_eq!(heap.alloc(layout), block);
+            assert!(heap
+                .realloc(grown, Layout::from_size_align(100, 1).unwrap(), usize::MAX)
+                .is_null());
+        }
+    }
+}
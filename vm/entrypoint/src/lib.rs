@@ -17,10 +17,10 @@ macro_rules! entrypoint {
   ($path:path) => {
     const VM_ENTRY: fn() = $path;
 
-    use $crate::heap::SimpleAlloc;
+    use $crate::heap::HeapAlloc;
 
     #[global_allocator]
-    static HEAP: SimpleAlloc = SimpleAlloc;
+    static HEAP: HeapAlloc = HeapAlloc::new();
 
     mod vm_generated_main {
       #[no_mangle]
@@ -52,14 +52,25 @@ mod vm {
 
   static STACK_TOP: u32 = 0x0020_0400;
 
-  #[cfg(feature = "rv32e")]
-  core::arch::global_asm!(include_str!("memset-rv32e.s"));
-  #[cfg(feature = "rv32e")]
-  core::arch::global_asm!(include_str!("memcpy-rv32e.s"));
-  #[cfg(not(feature = "rv32e"))]
-  core::arch::global_asm!(include_str!("memset.s"));
-  #[cfg(not(feature = "rv32e"))]
-  core::arch::global_asm!(include_str!("memcpy.s"));
+  // Bulk memory operations are executed natively by the VM rather than one instruction at a
+  // time. The compiler lowers copies and fills to these functions.
+  #[no_mangle]
+  unsafe extern "C" fn memcpy(dest: *mut u8, src: *const u8, n: usize) -> *mut u8 {
+    crate::syscalls::syscall_memcpy(dest, src, n);
+    dest
+  }
+
+  #[no_mangle]
+  unsafe extern "C" fn memmove(dest: *mut u8, src: *const u8, n: usize) -> *mut u8 {
+    crate::syscalls::syscall_memmove(dest, src, n);
+    dest
+  }
+
+  #[no_mangle]
+  unsafe extern "C" fn memset(dest: *mut u8, value: i32, n: usize) -> *mut u8 {
+    crate::syscalls::syscall_memset(dest, value as u8, n);
+    dest
+  }
 
   core::arch::global_asm!(
       r#"
@@ -0,0 +1,72 @@
+cfg_if::cfg_if! {
+    if #[cfg(target_os = "zkvm")] {
+        use core::arch::asm;
+    }
+}
+
+/// Hashes `len` bytes from `input` with Keccak-256, writing the 32-byte digest to `output`.
+#[allow(unused_variables)]
+#[no_mangle]
+pub extern "C" fn syscall_keccak256(input: *const u8, len: usize, output: *mut u8) {
+    #[cfg(target_os = "zkvm")]
+    unsafe {
+        asm!(
+            "ecall",
+            in("t0") crate::syscalls::KECCAK256,
+            in("a0") input,
+            in("a1") len,
+            in("a2") output,
+        );
+    }
+
+    #[cfg(not(target_os = "zkvm"))]
+    unreachable!()
+}
+
+/// Hashes `len` bytes from `input` with SHA-256, writing the 32-byte digest to `output`.
+#[allow(unused_variables)]
+#[no_mangle]
+pub extern "C" fn syscall_sha256(input: *const u8, len: usize, output: *mut u8) {
+    #[cfg(target_os = "zkvm")]
+    unsafe {
+        asm!(
+            "ecall",
+            in("t0") crate::syscalls::SHA256,
+            in("a0") input,
+            in("a1") len,
+            in("a2") output,
+        );
+    }
+
+    #[cfg(not(target_os = "zkvm"))]
+    unreachable!()
+}
+
+/// Verifies the 64-byte Ed25519 `signature` of `len` bytes from `msg` by the 32-byte
+/// `public_key`. Returns 1 if the signature is valid, 0 otherwise.
+#[allow(unused_variables)]
+#[no_mangle]
+pub extern "C" fn syscall_ed25519_verify(
+    msg: *const u8,
+    len: usize,
+    public_key: *const u8,
+    signature: *const u8,
+) -> u32 {
+    #[cfg(target_os = "zkvm")]
+    unsafe {
+        let valid;
+        asm!(
+            "ecall",
+            in("t0") crate::syscalls::ED25519_VERIFY,
+            in("a0") msg,
+            in("a1") len,
+            in("a2") public_key,
+            in("a3") signature,
+            lateout("t0") valid,
+        );
+        valid
+    }
+
+    #[cfg(not(target_os = "zkvm"))]
+    unreachable!()
+}
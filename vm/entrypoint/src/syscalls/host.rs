@@ -46,3 +46,52 @@ pub extern "C" fn host_write_storage(key: *mut u32, address: *const u32, value:
   #[cfg(not(target_os = "zkvm"))]
   unreachable!()
 }
+
+/// Read many storage slots of the account at the given address with a single host call.
+///
+/// `key` points to `count` 32-byte keys. The values are stored in the `key` pointer.
+#[allow(unused_variables)]
+#[no_mangle]
+pub extern "C" fn host_read_storage_many(key: *mut u32, address: *const u32, count: usize) {
+  #[cfg(target_os = "zkvm")]
+  unsafe {
+    asm!(
+        "ecall",
+        in("t0") crate::syscalls::HOST_READ_MANY,
+        in("a0") key,
+        in("a1") address,
+        in("a2") count,
+    )
+  }
+
+  #[cfg(not(target_os = "zkvm"))]
+  unreachable!()
+}
+
+/// Write many storage slots of the account at the given address with a single host call.
+///
+/// `key` and `value` each point to `count` 32-byte items. The result status code of each write
+/// is stored in the first word of its key in the `key` pointer.
+#[allow(unused_variables)]
+#[no_mangle]
+pub extern "C" fn host_write_storage_many(
+  key: *mut u32,
+  address: *const u32,
+  value: *const u32,
+  count: usize,
+) {
+  #[cfg(target_os = "zkvm")]
+  unsafe {
+    asm!(
+        "ecall",
+        in("t0") crate::syscalls::HOST_WRITE_MANY,
+        in("a0") key,
+        in("a1") address,
+        in("a2") value,
+        in("a3") count,
+    )
+  }
+
+  #[cfg(not(target_os = "zkvm"))]
+  unreachable!()
+}
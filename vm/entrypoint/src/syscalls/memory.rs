@@ -49,3 +49,60 @@ pub unsafe extern "C" fn sys_alloc_aligned(bytes: usize, align: usize) -> *mut u
     unsafe { HEAP_POS = heap_pos };
     ptr
 }
+
+/// Copies `n` bytes from `src` to `dest`. The ranges may overlap.
+#[allow(unused_variables)]
+#[no_mangle]
+pub extern "C" fn syscall_memmove(dest: *mut u8, src: *const u8, n: usize) {
+    #[cfg(target_os = "zkvm")]
+    unsafe {
+        core::arch::asm!(
+            "ecall",
+            in("t0") crate::syscalls::MEMMOVE,
+            in("a0") dest,
+            in("a1") src,
+            in("a2") n,
+        );
+    }
+
+    #[cfg(not(target_os = "zkvm"))]
+    unreachable!()
+}
+
+/// Copies `n` bytes from `src` to `dest`.
+#[allow(unused_variables)]
+#[no_mangle]
+pub extern "C" fn syscall_memcpy(dest: *mut u8, src: *const u8, n: usize) {
+    #[cfg(target_os = "zkvm")]
+    unsafe {
+        core::arch::asm!(
+            "ecall",
+            in("t0") crate::syscalls::MEMCPY,
+            in("a0") dest,
+            in("a1") src,
+            in("a2") n,
+        );
+    }
+
+    #[cfg(not(target_os = "zkvm"))]
+    unreachable!()
+}
+
+/// Sets `n` bytes from `dest` to `value`.
+#[allow(unused_variables)]
+#[no_mangle]
+pub extern "C" fn syscall_memset(dest: *mut u8, value: u8, n: usize) {
+    #[cfg(target_os = "zkvm")]
+    unsafe {
+        core::arch::asm!(
+            "ecall",
+            in("t0") crate::syscalls::MEMSET,
+            in("a0") dest,
+            in("a1") value as u32,
+            in("a2") n,
+        );
+    }
+
+    #[cfg(not(target_os = "zkvm"))]
+    unreachable!()
+}
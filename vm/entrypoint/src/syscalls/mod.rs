@@ -1,9 +1,11 @@
+mod crypto;
 mod halt;
 mod host;
 mod io;
 mod memory;
 mod sys;
 
+pub use crypto::*;
 pub use halt::*;
 pub use host::*;
 pub use io::*;
@@ -28,3 +30,15 @@ pub const HINT_READ: u32 = 0x00_00_00_F1;
 /// Host functions
 pub const HOST_READ: u32 = 0x00_00_00_A0;
 pub const HOST_WRITE: u32 = 0x00_00_00_A1;
+pub const HOST_READ_MANY: u32 = 0x00_00_00_A2;
+pub const HOST_WRITE_MANY: u32 = 0x00_00_00_A3;
+
+/// Memory operations
+pub const MEMCPY: u32 = 0x00_00_00_B0;
+pub const MEMMOVE: u32 = 0x00_00_00_B1;
+pub const MEMSET: u32 = 0x00_00_00_B2;
+
+/// Cryptographic precompiles
+pub const KECCAK256: u32 = 0x00_40_00_C0;
+pub const SHA256: u32 = 0x00_40_00_C1;
+pub const ED25519_VERIFY: u32 = 0x00_FF_00_C2;
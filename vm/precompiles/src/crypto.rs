@@ -0,0 +1,35 @@
+//! Hashing and signature verification, executed natively by the VM.
+
+use crate::{syscall_ed25519_verify, syscall_keccak256, syscall_sha256};
+
+/// Hashes `data` with Keccak-256, as used by Ethereum.
+pub fn keccak256(data: &[u8]) -> [u8; 32] {
+    let mut digest = [0; 32];
+    unsafe {
+        syscall_keccak256(data.as_ptr(), data.len(), digest.as_mut_ptr());
+    }
+    digest
+}
+
+/// Hashes `data` with SHA-256.
+pub fn sha256(data: &[u8]) -> [u8; 32] {
+    let mut digest = [0; 32];
+    unsafe {
+        syscall_sha256(data.as_ptr(), data.len(), digest.as_mut_ptr());
+    }
+    digest
+}
+
+/// Verifies the Ed25519 `signature` of `msg` by `public_key`.
+///
+/// Verification is strict: non-canonical encodings and small order points are rejected.
+pub fn ed25519_verify(public_key: &[u8; 32], signature: &[u8; 64], msg: &[u8]) -> bool {
+    unsafe {
+        syscall_ed25519_verify(
+            msg.as_ptr(),
+            msg.len(),
+            public_key.as_ptr(),
+            signature.as_ptr(),
+        ) == 1
+    }
+}
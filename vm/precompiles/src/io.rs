@@ -43,8 +43,8 @@ pub fn read_vec() -> Vec<u8> {
     // 4/5. Length is 0
     // 7. Layout::from_size_align already checks this
     let mut vec = unsafe { Vec::from_raw_parts(ptr, 0, capacity) };
-    // Read the vec into uninitialized memory. The syscall assumes the memory is uninitialized,
-    // which should be true because the allocator does not dealloc, so a new alloc should be fresh.
+    // Read the vec into the buffer. The memory may have been used before if the allocator reuses
+    // freed blocks, which the syscall supports.
     unsafe {
         syscall_hint_read(ptr, len);
         vec.set_len(len);
@@ -1,3 +1,4 @@
+pub mod crypto;
 pub mod io;
 pub mod utils;
 #[cfg(feature = "verify")]
@@ -10,4 +11,12 @@ extern "C" {
     pub fn syscall_hint_len() -> usize;
     pub fn syscall_hint_read(ptr: *mut u8, len: usize);
     pub fn sys_alloc_aligned(bytes: usize, align: usize) -> *mut u8;
+    pub fn syscall_keccak256(input: *const u8, len: usize, output: *mut u8);
+    pub fn syscall_sha256(input: *const u8, len: usize, output: *mut u8);
+    pub fn syscall_ed25519_verify(
+        msg: *const u8,
+        len: usize,
+        public_key: *const u8,
+        signature: *const u8,
+    ) -> u32;
 }